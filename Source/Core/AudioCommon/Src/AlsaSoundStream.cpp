@@ -6,6 +6,7 @@
 
 #include "Common.h"
 #include "Thread.h"
+#include "AudioStats.h"
 #include "AlsaSoundStream.h"
 
 #define FRAME_COUNT_MIN 256
@@ -61,6 +62,14 @@ void AlsaSound::SoundLoop()
 		{
 			ERROR_LOG(AUDIO, "writei fail: %s", snd_strerror(rc));
 		}
+
+		if (AudioStats::IsEnabled())
+		{
+			snd_pcm_sframes_t delay = 0;
+			if (m_muted || snd_pcm_delay(handle, &delay) < 0)
+				delay = 0;
+			AudioStats::OnBackendWrite(frames_to_deliver, (u32)delay, rc == -EPIPE);
+		}
 	}
 	AlsaShutdown();
 	thread_data = 2;
@@ -5,6 +5,7 @@
 #include "AudioCommon.h"
 #include "FileUtil.h"
 #include "Mixer.h"
+#include "AudioStats.h"
 #include "NullSoundStream.h"
 #include "DSoundStream.h"
 #include "XAudio2_7Stream.h"
@@ -62,6 +63,14 @@ namespace AudioCommon
 		if (soundStream)
 		{
 			UpdateSoundStream();
+
+			AudioStats::Reset(backend, mixer->GetSampleRate());
+			if (SConfig::GetInstance().m_DumpAudioStats)
+			{
+				AudioStats::StartCSV(File::GetUserPath(D_DUMPAUDIO_IDX) + "audiostats.csv");
+				AudioStats::SetEnabled(true);
+			}
+
 			if (soundStream->Start())
 			{
 				if (SConfig::GetInstance().m_DumpAudio)
@@ -97,6 +106,13 @@ namespace AudioCommon
 			soundStream = nullptr;
 		}
 
+		if (SConfig::GetInstance().m_DumpAudioStats)
+		{
+			AudioStats::SetEnabled(false);
+			AudioStats::StopCSV();
+			NOTICE_LOG(AUDIO, "Audio stats:\n%s", AudioStats::GetSummary().c_str());
+		}
+
 		INFO_LOG(DSPHLE, "Done shutting down sound stream");	
 	}
 
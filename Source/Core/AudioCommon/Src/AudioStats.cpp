@@ -0,0 +1,237 @@
+// Copyright 2013 Dolphin Emulator Project
+// Licensed under GPLv2
+// Refer to the license.txt file included.
+
+#include "Common.h"
+#include "FileUtil.h"
+#include "StringUtil.h"
+#include "Timer.h"
+#include "StdMutex.h"
+
+#include "AudioStats.h"
+#include "Mixer.h"
+
+namespace AudioStats
+{
+
+struct IntervalTracker
+{
+	u64 last_us;
+	u64 count;
+	u64 total_us;
+	u64 max_us;
+	u64 deviation_us;
+
+	void Clear()
+	{
+		last_us = 0;
+		count = 0;
+		total_us = 0;
+		max_us = 0;
+		deviation_us = 0;
+	}
+
+	void Add(u64 now_us)
+	{
+		if (last_us != 0)
+		{
+			const u64 interval = now_us - last_us;
+			count++;
+			total_us += interval;
+			max_us = std::max(max_us, interval);
+
+			const u64 avg = total_us / count;
+			deviation_us += (interval > avg) ? interval - avg : avg - interval;
+		}
+		last_us = now_us;
+	}
+
+	IntervalStats Get() const
+	{
+		IntervalStats s;
+		s.count = count;
+		s.avg_us = count ? total_us / count : 0;
+		s.max_us = max_us;
+		s.jitter_us = count ? deviation_us / count : 0;
+		return s;
+	}
+};
+
+static volatile bool s_enabled = false;
+static std::mutex s_lock;
+
+static Stats s_stats;
+static IntervalTracker s_push;
+static IntervalTracker s_pull;
+static u32 s_last_fill;
+static u64 s_latency_count;
+static double s_latency_total_ms;
+
+static File::IOFile s_csv;
+static u64 s_csv_start_us;
+
+static void WriteCSV(u64 now_us, const char* event, u32 samples, u32 fill, u32 queued, u32 latency_us, bool flag)
+{
+	if (!s_csv.IsOpen())
+		return;
+
+	std::string line = StringFromFormat("%llu,%s,%u,%u,%u,%u,%d\n",
+		(unsigned long long)(now_us - s_csv_start_us), event, samples, fill, queued, latency_us, flag ? 1 : 0);
+	s_csv.WriteBytes(line.data(), line.size());
+}
+
+void SetEnabled(bool enabled)
+{
+	s_enabled = enabled;
+}
+
+bool IsEnabled()
+{
+	return s_enabled;
+}
+
+void Reset(const std::string& backend, u32 sample_rate)
+{
+	std::lock_guard<std::mutex> lk(s_lock);
+
+	s_stats = Stats();
+	s_stats.backend = backend;
+	s_stats.sample_rate = sample_rate;
+
+	s_push.Clear();
+	s_pull.Clear();
+	s_last_fill = 0;
+	s_latency_count = 0;
+	s_latency_total_ms = 0.0;
+}
+
+void OnPush(u32 num_samples, u32 fill, bool dropped)
+{
+	if (!s_enabled)
+		return;
+
+	const u64 now = Common::Timer::GetTimeUs();
+	std::lock_guard<std::mutex> lk(s_lock);
+
+	s_push.Add(now);
+	if (dropped)
+		s_stats.dropped_pushes++;
+	else
+		s_stats.pushed_samples += num_samples;
+
+	WriteCSV(now, "push", num_samples, fill, 0, 0, dropped);
+}
+
+void OnPull(u32 num_samples, u32 delivered, u32 fill)
+{
+	if (!s_enabled)
+		return;
+
+	const u64 now = Common::Timer::GetTimeUs();
+	std::lock_guard<std::mutex> lk(s_lock);
+
+	const bool underrun = delivered < num_samples;
+
+	s_pull.Add(now);
+	s_stats.pulled_samples += delivered;
+	if (underrun)
+		s_stats.underruns++;
+
+	const u32 bucket = std::min<u32>(fill / (MAX_SAMPLES / FILL_BUCKETS), FILL_BUCKETS - 1);
+	s_stats.fill_histogram[bucket]++;
+	s_last_fill = fill;
+
+	WriteCSV(now, "pull", num_samples, fill, 0, 0, underrun);
+}
+
+void OnBackendWrite(u32 num_samples, u32 queued, bool xrun)
+{
+	if (!s_enabled)
+		return;
+
+	const u64 now = Common::Timer::GetTimeUs();
+	std::lock_guard<std::mutex> lk(s_lock);
+
+	if (xrun)
+		s_stats.backend_xruns++;
+
+	// A sample pushed now has to get through the mixer FIFO and then
+	// through whatever the host still has queued.
+	u32 latency_us = 0;
+	if (s_stats.sample_rate)
+	{
+		latency_us = (u32)((u64)(s_last_fill + queued) * 1000000 / s_stats.sample_rate);
+
+		const float latency_ms = latency_us / 1000.0f;
+		s_latency_count++;
+		s_latency_total_ms += latency_ms;
+		s_stats.latency_last_ms = latency_ms;
+		s_stats.latency_avg_ms = (float)(s_latency_total_ms / s_latency_count);
+		s_stats.latency_max_ms = std::max(s_stats.latency_max_ms, latency_ms);
+	}
+
+	WriteCSV(now, "write", num_samples, s_last_fill, queued, latency_us, xrun);
+}
+
+Stats GetStats()
+{
+	std::lock_guard<std::mutex> lk(s_lock);
+
+	Stats stats = s_stats;
+	stats.push_interval = s_push.Get();
+	stats.pull_interval = s_pull.Get();
+	return stats;
+}
+
+std::string GetSummary()
+{
+	const Stats s = GetStats();
+
+	std::string summary = StringFromFormat(
+		"Backend %s @ %uHz\n"
+		"Push: %llu samples, %llu dropped, interval avg %lluus max %lluus jitter %lluus\n"
+		"Pull: %llu samples, %llu underruns, interval avg %lluus max %lluus jitter %lluus\n"
+		"Backend xruns: %llu\n"
+		"Latency: last %.1fms avg %.1fms max %.1fms\n"
+		"Mixer fill:",
+		s.backend.c_str(), s.sample_rate,
+		(unsigned long long)s.pushed_samples, (unsigned long long)s.dropped_pushes,
+		(unsigned long long)s.push_interval.avg_us, (unsigned long long)s.push_interval.max_us,
+		(unsigned long long)s.push_interval.jitter_us,
+		(unsigned long long)s.pulled_samples, (unsigned long long)s.underruns,
+		(unsigned long long)s.pull_interval.avg_us, (unsigned long long)s.pull_interval.max_us,
+		(unsigned long long)s.pull_interval.jitter_us,
+		(unsigned long long)s.backend_xruns,
+		s.latency_last_ms, s.latency_avg_ms, s.latency_max_ms);
+
+	for (int i = 0; i < FILL_BUCKETS; i++)
+		summary += StringFromFormat(" %llu", (unsigned long long)s.fill_histogram[i]);
+	summary += "\n";
+
+	return summary;
+}
+
+bool StartCSV(const std::string& filename)
+{
+	std::lock_guard<std::mutex> lk(s_lock);
+
+	File::CreateFullPath(filename);
+	if (!s_csv.Open(filename, "w"))
+	{
+		ERROR_LOG(AUDIO, "Could not open audio stats file %s", filename.c_str());
+		return false;
+	}
+
+	static const char header[] = "time_us,event,samples,mixer_fill,backend_queued,latency_us,flag\n";
+	s_csv.WriteBytes(header, sizeof(header) - 1);
+	s_csv_start_us = Common::Timer::GetTimeUs();
+	return true;
+}
+
+void StopCSV()
+{
+	std::lock_guard<std::mutex> lk(s_lock);
+	s_csv.Close();
+}
+
+}  // namespace
@@ -0,0 +1,84 @@
+// Copyright 2013 Dolphin Emulator Project
+// Licensed under GPLv2
+// Refer to the license.txt file included.
+
+// Audio pipeline instrumentation.
+// CMixer reports every push (emulation side) and pull (sound thread side),
+// the backends report what they handed to the host and how much is still
+// queued there. From that we keep interval jitter, a mixer fill histogram,
+// underrun counts and the estimated output latency, and optionally log
+// every event to a CSV file.
+// All entry points are cheap no-ops while stats are disabled.
+
+#ifndef _AUDIOSTATS_H_
+#define _AUDIOSTATS_H_
+
+#include "CommonTypes.h"
+#include <string>
+
+namespace AudioStats
+{
+
+enum
+{
+	FILL_BUCKETS = 16,
+};
+
+struct IntervalStats
+{
+	u64 count;
+	u64 avg_us;
+	u64 max_us;
+	u64 jitter_us; // mean absolute deviation from avg_us
+};
+
+struct Stats
+{
+	std::string backend;
+	u32 sample_rate;
+
+	u64 pushed_samples;
+	u64 dropped_pushes; // mixer FIFO full, samples thrown away
+	u64 pulled_samples;
+	u64 underruns;      // mixer could not fill a pull
+	u64 backend_xruns;  // reported by the host API
+
+	IntervalStats push_interval;
+	IntervalStats pull_interval;
+
+	// Mixer fill at each pull, bucket i covers
+	// [i, i + 1) * MAX_SAMPLES / FILL_BUCKETS samples.
+	u64 fill_histogram[FILL_BUCKETS];
+
+	// Mixer FIFO + backend queue, in milliseconds
+	float latency_last_ms;
+	float latency_avg_ms;
+	float latency_max_ms;
+};
+
+void SetEnabled(bool enabled);
+bool IsEnabled();
+
+// Clears all counters, called when a sound stream starts.
+void Reset(const std::string& backend, u32 sample_rate);
+
+// Called from CMixer::PushSamples. fill is the mixer FIFO level in stereo samples.
+void OnPush(u32 num_samples, u32 fill, bool dropped);
+// Called from CMixer::Mix. delivered < num_samples is an underrun,
+// fill is the number of output samples that were available.
+void OnPull(u32 num_samples, u32 delivered, u32 fill);
+// Called by the backends after handing num_samples to the host.
+// queued is what the host still has to play, in output samples.
+void OnBackendWrite(u32 num_samples, u32 queued, bool xrun);
+
+Stats GetStats();
+// Human readable one-shot summary
+std::string GetSummary();
+
+// Logs every event to filename until StopCSV
+bool StartCSV(const std::string& filename);
+void StopCSV();
+
+}  // namespace
+
+#endif // _AUDIOSTATS_H_
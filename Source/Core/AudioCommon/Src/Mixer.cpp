@@ -5,6 +5,7 @@
 #include "Atomic.h"
 #include "Mixer.h"
 #include "AudioCommon.h"
+#include "AudioStats.h"
 #include "CPUDetect.h"
 #include "../../Core/Src/Host.h"
 
@@ -33,6 +34,7 @@ unsigned int CMixer::Mix(short* samples, unsigned int numSamples)
 	}
 
 	unsigned int numLeft = GetNumSamples();
+	const unsigned int numAvailable = numLeft;
 	if (m_AIplaying) {
 		if (numLeft < numSamples)//cannot do much about this
 			m_AIplaying = false;
@@ -129,6 +131,8 @@ unsigned int CMixer::Mix(short* samples, unsigned int numSamples)
 	// Flush cached variable	
 	Common::AtomicStore(m_indexR, indexR);
 
+	AudioStats::OnPull(numSamples, numLeft, numAvailable);
+
 	//when logging, also throttle HLE audio
 	if (m_logAudio) {
 		if (m_AIplaying) {
@@ -176,8 +180,12 @@ void CMixer::PushSamples(const short *samples, unsigned int num_samples)
 
 	// Check if we have enough free space
 	// indexW == m_indexR results in empty buffer, so indexR must always be smaller than indexW
-	if (num_samples * 2 + ((indexW - Common::AtomicLoad(m_indexR)) & INDEX_MASK) >= MAX_SAMPLES * 2)
+	const u32 fill = (indexW - Common::AtomicLoad(m_indexR)) & INDEX_MASK;
+	if (num_samples * 2 + fill >= MAX_SAMPLES * 2)
+	{
+		AudioStats::OnPush(num_samples, fill / 2, true);
 		return;
+	}
 
 	// AyuanX: Actual re-sampling work has been moved to sound thread
 	// to alleviate the workload on main thread
@@ -194,6 +202,8 @@ void CMixer::PushSamples(const short *samples, unsigned int num_samples)
 	}
 	
 	Common::AtomicAdd(m_indexW, num_samples * 2);
+
+	AudioStats::OnPush(num_samples, fill / 2 + num_samples, false);
 	
 	return;
 }
@@ -3,6 +3,7 @@
 // Refer to the license.txt file included.
 
 #include "NullSoundStream.h"
+#include "AudioStats.h"
 #include "../../Core/Src/HW/SystemTimers.h"
 #include "../../Core/Src/HW/AudioInterface.h"
 
@@ -29,6 +30,10 @@ void NullSound::Update()
 	const u64 num_samples_to_render = (audio_dma_period * ais_samples_per_second) / SystemTimers::GetTicksPerSecond();
 
 	m_mixer->Mix(realtimeBuffer, (unsigned int)num_samples_to_render);
+
+	// Nothing is queued behind us, so the measured latency is the mixer
+	// FIFO alone. Useful to measure the emulation side headless.
+	AudioStats::OnBackendWrite((u32)num_samples_to_render, 0, false);
 }
 
 void NullSound::Clear(bool mute)
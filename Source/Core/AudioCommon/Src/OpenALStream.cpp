@@ -5,6 +5,7 @@
 #include "aldlist.h"
 #include "OpenALStream.h"
 #include "DPL2Decoder.h"
+#include "AudioStats.h"
 
 #if defined HAVE_OPENAL && HAVE_OPENAL
 
@@ -319,6 +320,15 @@ void OpenALStream::SoundLoop()
 					ERROR_LOG(AUDIO, "Error occurred resuming playback: %08x", err);
 				}
 			}
+
+			if (AudioStats::IsEnabled())
+			{
+				// Buffers are roughly the same size, so the queue length
+				// in buffers times this one is close enough.
+				ALint iQueued = 0;
+				alGetSourcei(uiSource, AL_BUFFERS_QUEUED, &iQueued);
+				AudioStats::OnBackendWrite(nSamples, iQueued * nSamples, iState != AL_PLAYING);
+			}
 		}
 		else
 		{
@@ -6,6 +6,7 @@
 
 #include "Common.h"
 #include "Thread.h"
+#include "AudioStats.h"
 
 #include "PulseAudioStream.h"
 
@@ -96,4 +97,13 @@ void PulseAudio::Write(const void *data, size_t length)
 		ERROR_LOG(AUDIO, "PulseAudio failed to write data: %s",
 			pa_strerror(error));
 	}
+
+	if (AudioStats::IsEnabled())
+	{
+		pa_usec_t latency = pa_simple_get_latency(pa, &error);
+		if (latency == (pa_usec_t)-1)
+			latency = 0;
+		AudioStats::OnBackendWrite(length / (CHANNEL_COUNT * sizeof(s16)),
+			(u32)(latency * m_mixer->GetSampleRate() / 1000000), false);
+	}
 }
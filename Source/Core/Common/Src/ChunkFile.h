@@ -15,6 +15,7 @@
 // - Zero backwards/forwards compatibility
 // - Serialization code for anything complex has to be manually written.
 
+#include <algorithm>
 #include <map>
 #include <set>
 #include <vector>
@@ -62,8 +63,59 @@ public:
 	u8 **ptr;
 	Mode mode;
 
+private:
+	// Single pass writing: the buffer grows as DoState goes, so no
+	// MODE_MEASURE pass is needed to size it first.
+	std::vector<u8>* arena;
+	u8* arena_ptr;
+
 public:
-	PointerWrap(u8 **ptr_, Mode mode_) : ptr(ptr_), mode(mode_) {}
+	// Returns the new end of readable data once needed is covered, NULL on failure
+	typedef u8* (*ReadWaitFunc)(void* userdata, u8* needed);
+
+private:
+	// MODE_READ from a buffer that is still being filled in
+	u8* read_limit;
+	ReadWaitFunc read_wait;
+	void* read_userdata;
+
+public:
+	PointerWrap(u8 **ptr_, Mode mode_) : ptr(ptr_), mode(mode_), arena(NULL), arena_ptr(NULL),
+		read_limit(NULL), read_wait(NULL), read_userdata(NULL) {}
+
+	// MODE_WRITE into buffer, reusing whatever capacity it already has.
+	// Call FinishArena() afterwards to trim it to the written size.
+	PointerWrap(std::vector<u8>& buffer) : ptr(&arena_ptr), mode(MODE_WRITE), arena(&buffer),
+		read_limit(NULL), read_wait(NULL), read_userdata(NULL)
+	{
+		if (buffer.size() < buffer.capacity())
+			buffer.resize(buffer.capacity());
+		if (buffer.empty())
+			buffer.resize(ARENA_MIN_SIZE);
+		arena_ptr = &buffer[0];
+	}
+
+	// Returns the number of bytes written, 0 if DoState aborted
+	size_t FinishArena()
+	{
+		if (mode != MODE_WRITE)
+		{
+			arena->clear();
+			return 0;
+		}
+
+		const size_t size = arena_ptr - &(*arena)[0];
+		arena->resize(size);
+		return size;
+	}
+
+	// Everything up to limit may be read, reading further first calls wait
+	void SetReadFence(u8* limit, ReadWaitFunc wait, void* userdata)
+	{
+		read_limit = limit;
+		read_wait = wait;
+		read_userdata = userdata;
+	}
 
 	void SetMode(Mode mode_) { mode = mode_; }
 	Mode GetMode() const { return mode; }
@@ -172,8 +224,7 @@ public:
 	template <typename T>
 	void DoArray(T* x, u32 count)
 	{
-		for (u32 i = 0; i != count; ++i)
-			Do(x[i]);
+		DoArray(x, count, std::integral_constant<bool, std::is_pod<T>::value>());
 	}
 
 	template <typename T>
@@ -275,38 +326,77 @@ public:
 	}
 
 private:
-	__forceinline void DoByte(u8& x)
+	enum
+	{
+		ARENA_MIN_SIZE = 1024 * 1024,
+	};
+
+	// PODs have the same layout as an element-wise Do(), so copy them in one go
+	template <typename T>
+	void DoArray(T* x, u32 count, std::true_type)
+	{
+		DoVoid((void*)x, count * sizeof(T));
+	}
+
+	template <typename T>
+	void DoArray(T* x, u32 count, std::false_type)
+	{
+		for (u32 i = 0; i != count; ++i)
+			Do(x[i]);
+	}
+
+	void GrowArena(u32 size)
+	{
+		const size_t offset = *ptr - &(*arena)[0];
+		arena->resize(std::max(arena->size() * 2, offset + size));
+		*ptr = &(*arena)[0] + offset;
+	}
+
+	void DoVoid(void *data, u32 size)
 	{
 		switch (mode)
 		{
 		case MODE_READ:
-			x = **ptr;
+			if (read_wait && *ptr + size > read_limit)
+			{
+				read_limit = read_wait(read_userdata, *ptr + size);
+				if (!read_limit)
+				{
+					mode = MODE_MEASURE;
+					break;
+				}
+			}
+			memcpy(data, *ptr, size);
 			break;
 
 		case MODE_WRITE:
-			**ptr = x;
+			if (arena && *ptr + size > &(*arena)[0] + arena->size())
+				GrowArena(size);
+			memcpy(*ptr, data, size);
 			break;
 
 		case MODE_MEASURE:
 			break;
 
 		case MODE_VERIFY:
-			_dbg_assert_msg_(COMMON, (x == **ptr),
-				"Savestate verification failure: %d (0x%X) (at %p) != %d (0x%X) (at %p).\n",
-					x, x, &x, **ptr, **ptr, *ptr);
+			if (memcmp(data, *ptr, size))
+			{
+				for (u32 i = 0; i != size; ++i)
+				{
+					const u8 x = reinterpret_cast<u8*>(data)[i];
+					const u8 y = (*ptr)[i];
+					_dbg_assert_msg_(COMMON, (x == y),
+						"Savestate verification failure: %d (0x%X) (at %p) != %d (0x%X) (at %p).\n",
+							x, x, &reinterpret_cast<u8*>(data)[i], y, y, &(*ptr)[i]);
+				}
+			}
 			break;
 
 		default:
 			break;
 		}
 
-		++(*ptr);
-	}
-
-	void DoVoid(void *data, u32 size)
-	{
-		for(u32 i = 0; i != size; ++i)
-			DoByte(reinterpret_cast<u8*>(data)[i]);
+		*ptr += size;
 	}
 };
 
@@ -392,14 +482,10 @@ public:
 		}
 
 		// Get data
-		u8 *ptr = 0;
-		PointerWrap p(&ptr, PointerWrap::MODE_MEASURE);
-		_class.DoState(p);
-		size_t const sz = (size_t)ptr;
-		std::vector<u8> buffer(sz);
-		ptr = &buffer[0];
-		p.SetMode(PointerWrap::MODE_WRITE);
+		std::vector<u8> buffer;
+		PointerWrap p(buffer);
 		_class.DoState(p);
+		size_t const sz = p.FinishArena();
 
 		// Create header
 		SChunkHeader header;
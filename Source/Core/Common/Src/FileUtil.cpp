@@ -20,6 +20,8 @@
 #include <errno.h>
 #include <stdlib.h>
 #include <libgen.h>
+#include <unistd.h>
+#include <sys/mman.h>
 #endif
 #include <fcntl.h>
 
@@ -1084,6 +1086,21 @@ bool IOFile::Flush()
 	return m_good;
 }
 
+bool IOFile::Sync()
+{
+	if (!Flush())
+		return false;
+
+#ifdef _WIN32
+	if (0 != _commit(_fileno(m_file)))
+#else
+	if (0 != fsync(fileno(m_file)))
+#endif
+		m_good = false;
+
+	return m_good;
+}
+
 bool IOFile::Resize(u64 size)
 {
 	if (!IsOpen() || 0 !=
@@ -1101,4 +1118,99 @@ bool IOFile::Resize(u64 size)
 	return m_good;
 }
 
+MappedFile::MappedFile()
+	: m_data(NULL), m_size(0), m_open_empty(false)
+#ifdef _WIN32
+	, m_file_handle(INVALID_HANDLE_VALUE), m_mapping_handle(NULL)
+#endif
+{}
+
+MappedFile::~MappedFile()
+{
+	Close();
+}
+
+bool MappedFile::Open(const std::string& filename)
+{
+	Close();
+
+#ifdef _WIN32
+	m_file_handle = CreateFile(UTF8ToTStr(filename).c_str(), GENERIC_READ, FILE_SHARE_READ, NULL,
+		OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (m_file_handle == INVALID_HANDLE_VALUE)
+		return false;
+
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(m_file_handle, &size))
+	{
+		Close();
+		return false;
+	}
+	m_size = size.QuadPart;
+
+	if (m_size == 0)
+	{
+		m_open_empty = true;
+		return true;
+	}
+
+	m_mapping_handle = CreateFileMapping(m_file_handle, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (m_mapping_handle)
+		m_data = (const u8*)MapViewOfFile(m_mapping_handle, FILE_MAP_READ, 0, 0, 0);
+#else
+	const int fd = open(filename.c_str(), O_RDONLY);
+	if (fd < 0)
+		return false;
+
+	struct stat64 file_info;
+	if (fstat64(fd, &file_info) != 0)
+	{
+		close(fd);
+		return false;
+	}
+	m_size = file_info.st_size;
+
+	if (m_size == 0)
+	{
+		close(fd);
+		m_open_empty = true;
+		return true;
+	}
+
+	// The mapping keeps its own reference to the file
+	void* data = mmap(NULL, (size_t)m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (data != MAP_FAILED)
+		m_data = (const u8*)data;
+#endif
+
+	if (!m_data)
+	{
+		ERROR_LOG(COMMON, "MappedFile: failed to map %s: %s", filename.c_str(), GetLastErrorMsg());
+		Close();
+		return false;
+	}
+	return true;
+}
+
+void MappedFile::Close()
+{
+#ifdef _WIN32
+	if (m_data)
+		UnmapViewOfFile(m_data);
+	if (m_mapping_handle)
+		CloseHandle(m_mapping_handle);
+	if (m_file_handle != INVALID_HANDLE_VALUE)
+		CloseHandle(m_file_handle);
+	m_mapping_handle = NULL;
+	m_file_handle = INVALID_HANDLE_VALUE;
+#else
+	if (m_data)
+		munmap((void*)m_data, (size_t)m_size);
+#endif
+	m_data = NULL;
+	m_size = 0;
+	m_open_empty = false;
+}
+
 } // namespace
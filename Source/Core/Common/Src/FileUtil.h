@@ -216,6 +216,8 @@ public:
 	u64 GetSize();
 	bool Resize(u64 size);
 	bool Flush();
+	// Flush, then wait until the OS has the data on the disk
+	bool Sync();
 
 	// clear error state
 	void Clear() { m_good = true; std::clearerr(m_file); }
@@ -227,6 +229,31 @@ private:
 	IOFile& operator=(IOFile& other);
 };
 
+// Read-only view of a whole file, for readers that want to seek around
+// without copying everything through a FILE* first
+class MappedFile : public NonCopyable
+{
+public:
+	MappedFile();
+	~MappedFile();
+
+	bool Open(const std::string& filename);
+	void Close();
+
+	bool IsOpen() const { return NULL != m_data || m_open_empty; }
+	const u8* GetData() const { return m_data; }
+	u64 GetSize() const { return m_size; }
+
+private:
+	const u8* m_data;
+	u64 m_size;
+	bool m_open_empty; // mapping zero bytes fails, remember the file opened anyway
+#ifdef _WIN32
+	void* m_file_handle;
+	void* m_mapping_handle;
+#endif
+};
+
 }  // namespace
 
 // To deal with Windows being dumb at unicode:
@@ -518,3 +518,77 @@ void SetHash64Function(bool useHiresTextures)
 
 
 
+
+// CRC32C (Castagnoli) without the final inversion, same as the SSE4.2
+// crc32 instruction computes it.
+static u32 Crc32cByte(u32 crc, u8 value)
+{
+	static u32 table[256];
+	static bool table_ready = false;
+	if (!table_ready)
+	{
+		for (u32 i = 0; i < 256; i++)
+		{
+			u32 c = i;
+			for (int k = 0; k < 8; k++)
+				c = (c & 1) ? (c >> 1) ^ 0x82F63B78 : c >> 1;
+			table[i] = c;
+		}
+		table_ready = true;
+	}
+	return table[(crc ^ value) & 0xFF] ^ (crc >> 8);
+}
+
+static u32 Crc32cU64(u32 crc, u64 value)
+{
+	for (int i = 0; i < 8; i++)
+		crc = Crc32cByte(crc, (u8)(value >> (i * 8)));
+	return crc;
+}
+
+// Four independent CRC32C lanes over interleaved 64-bit words, so the
+// crc32 instruction's latency is hidden. Little endian words, the result
+// doesn't depend on whether SSE4.2 is there.
+u32 HashCRC32C(const u8 *src, size_t len, u32 seed)
+{
+	u32 h[4] = { seed, seed + 1, seed + 2, seed + 3 };
+	const size_t blocks = len / 32;
+	const u8 *tail = src + blocks * 32;
+
+#if _M_SSE >= 0x402
+	if (cpu_info.bSSE4_2)
+	{
+		const u64 *data = (const u64 *)src;
+		for (size_t i = 0; i < blocks; i++, data += 4)
+		{
+#ifdef _M_X64
+			h[0] = (u32)_mm_crc32_u64(h[0], data[0]);
+			h[1] = (u32)_mm_crc32_u64(h[1], data[1]);
+			h[2] = (u32)_mm_crc32_u64(h[2], data[2]);
+			h[3] = (u32)_mm_crc32_u64(h[3], data[3]);
+#else
+			const u32 *words = (const u32 *)data;
+			for (int l = 0; l < 4; l++)
+				h[l] = _mm_crc32_u32(_mm_crc32_u32(h[l], words[l * 2]), words[l * 2 + 1]);
+#endif
+		}
+	}
+	else
+#endif
+	{
+		const u64 *data = (const u64 *)src;
+		for (size_t i = 0; i < blocks; i++, data += 4)
+		{
+			for (int l = 0; l < 4; l++)
+				h[l] = Crc32cU64(h[l], data[l]);
+		}
+	}
+
+	for (const u8 *p = tail; p != src + len; p++)
+		h[0] = Crc32cByte(h[0], *p);
+
+	u32 result = (u32)len;
+	for (int l = 0; l < 4; l++)
+		result = Crc32cU64(result, h[l]);
+	return result;
+}
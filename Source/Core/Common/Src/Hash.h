@@ -16,5 +16,7 @@ u64 GetCRC32(const u8 *src, int len, u32 samples);   // SSE4.2 version of CRC32
 u64 GetHashHiresTexture(const u8 *src, int len, u32 samples);
 u64 GetMurmurHash3(const u8 *src, int len, u32 samples);
 u64 GetHash64(const u8 *src, int len, u32 samples);
+// Same result with or without SSE4.2, for comparing between machines
+u32 HashCRC32C(const u8 *src, size_t len, u32 seed = 0);
 void SetHash64Function(bool useHiresTextures);
 #endif // _HASH_H_
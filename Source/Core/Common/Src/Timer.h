@@ -34,6 +34,8 @@ public:
 	u64 GetTimeElapsed();
 
 	static u32 GetTimeMs();
+	// Monotonic, for measuring short intervals
+	static u64 GetTimeUs();
 
 private:
 	u64 m_LastTime;
@@ -36,6 +36,7 @@
 #include "VideoBackendBase.h"
 #include "Movie.h"
 #include "NetPlayProto.h"
+#include "Replay.h"
 
 namespace BootManager
 {
@@ -160,6 +161,8 @@ bool BootCore(const std::string& _rFilename)
 		}
 	}
 
+	Replay::ApplyConfig();
+
 	if (NetPlay::IsNetPlayRunning())
 	{
 		StartUp.bCPUThread = g_NetPlaySettings.m_CPUthread;
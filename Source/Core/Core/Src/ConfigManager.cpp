@@ -108,6 +108,7 @@ static const struct
 	{ "UndoSaveState",	351 /* WXK_F12 */,	4 /* wxMOD_SHIFT */ },
 	{ "SaveStateFile",	0,	0 /* wxMOD_NONE */ },
 	{ "LoadStateFile",	0,	0 /* wxMOD_NONE */ },
+	{ "Rewind",	0,	0 /* wxMOD_NONE */ },
 };
 
 SConfig::SConfig()
@@ -245,10 +246,18 @@ void SConfig::SaveSettings()
 	ini.Set("Core", "Latency",			m_LocalCoreStartupParameter.iLatency);
 	ini.Set("Core", "MemcardAPath",		m_strMemoryCardA);
 	ini.Set("Core", "MemcardBPath",		m_strMemoryCardB);
+	ini.Set("Core", "MemcardSync",		m_MemcardSync);
 	ini.Set("Core", "SlotA",			m_EXIDevice[0]);
 	ini.Set("Core", "SlotB",			m_EXIDevice[1]);
 	ini.Set("Core", "SerialPort1",		m_EXIDevice[2]);
 	ini.Set("Core", "BBA_MAC",			m_bba_mac);
+	ini.Set("Core", "BBA_Backend",		m_bba_backend);
+	ini.Set("Core", "BBA_Pcap",			m_bba_pcap);
+	ini.Set("Core", "TriforceLinkMode",	m_TriforceLinkMode);
+	ini.Set("Core", "TriforceLinkNode",	m_TriforceLinkNode);
+	ini.Set("Core", "TriforceLinkName",	m_TriforceLinkName);
+	ini.Set("Core", "TriforceLinkHosts",	m_TriforceLinkHosts);
+	ini.Set("Core", "TriforceLinkPort",	m_TriforceLinkPort);
 	char sidevicenum[16];
 	for (int i = 0; i < 4; ++i)
 	{
@@ -275,12 +284,18 @@ void SConfig::SaveSettings()
 	// DSP
 	ini.Set("DSP", "EnableJIT", m_EnableJIT);
 	ini.Set("DSP", "DumpAudio", m_DumpAudio);
+	ini.Set("DSP", "DumpAudioStats", m_DumpAudioStats);
 	ini.Set("DSP", "Backend", sBackend);
 	ini.Set("DSP", "Volume", m_Volume);
 
 	// Fifo Player
 	ini.Set("FifoPlayer", "LoopReplay", m_LocalCoreStartupParameter.bLoopFifoReplay);
 
+	// NetPlay
+	ini.Set("NetPlay", "SimulatedLatency", m_NetPlaySimulatedLatency);
+	ini.Set("NetPlay", "SimulatedJitter", m_NetPlaySimulatedJitter);
+	ini.Set("NetPlay", "SimulatedLoss", m_NetPlaySimulatedLoss);
+
 	ini.Save(File::GetUserPath(F_DOLPHINCONFIG_IDX));
 	m_SYSCONF->Save();
 }
@@ -404,12 +419,21 @@ void SConfig::LoadSettings()
 		ini.Get("Core", "Latency",		&m_LocalCoreStartupParameter.iLatency,		2);
 		ini.Get("Core", "MemcardAPath",	&m_strMemoryCardA);
 		ini.Get("Core", "MemcardBPath",	&m_strMemoryCardB);
+		ini.Get("Core", "MemcardSync",	&m_MemcardSync,	0);
 		ini.Get("Core", "SlotA",		(int*)&m_EXIDevice[0], EXIDEVICE_MEMORYCARD);
 		ini.Get("Core", "SlotB",		(int*)&m_EXIDevice[1], EXIDEVICE_NONE);
 		ini.Get("Core", "SerialPort1",	(int*)&m_EXIDevice[2], EXIDEVICE_NONE);
 		ini.Get("Core", "BBA_MAC",		&m_bba_mac);
+		ini.Get("Core", "BBA_Backend",	&m_bba_backend,	"tap");
+		ini.Get("Core", "BBA_Pcap",		&m_bba_pcap);
+		ini.Get("Core", "TriforceLinkMode",	&m_TriforceLinkMode,	0);
+		ini.Get("Core", "TriforceLinkNode",	&m_TriforceLinkNode,	0);
+		ini.Get("Core", "TriforceLinkName",	&m_TriforceLinkName,	"dolphin-trilink");
+		ini.Get("Core", "TriforceLinkHosts",	&m_TriforceLinkHosts);
+		ini.Get("Core", "TriforceLinkPort",	&m_TriforceLinkPort,	27400);
 		ini.Get("Core", "TimeProfiling",&m_LocalCoreStartupParameter.bJITILTimeProfiling,		false);
 		ini.Get("Core", "OutputIR",		&m_LocalCoreStartupParameter.bJITILOutputIR,			false);
+		ini.Get("Core", "JITVerify",	&m_LocalCoreStartupParameter.bJITVerify,				false);
 		char sidevicenum[16];
 		for (int i = 0; i < 4; ++i)
 		{
@@ -429,6 +453,11 @@ void SConfig::LoadSettings()
 		ini.Get("Core", "VBeam",			&m_LocalCoreStartupParameter.bVBeamSpeedHack,			false);
 		ini.Get("Core", "SyncGPU",			&m_LocalCoreStartupParameter.bSyncGPU,			false);
 		ini.Get("Core", "FastDiscSpeed",	&m_LocalCoreStartupParameter.bFastDiscSpeed,	false);
+		ini.Get("Core", "IncrementalStates",	&m_LocalCoreStartupParameter.bIncrementalStates,	false);
+		ini.Get("Core", "RewindSeconds",	&m_LocalCoreStartupParameter.iRewindSeconds,	0);
+		ini.Get("Core", "RewindInterval",	&m_LocalCoreStartupParameter.iRewindInterval,	30);
+		ini.Get("Core", "DesyncCheckInterval",	&m_LocalCoreStartupParameter.iDesyncCheckInterval,	0);
+		ini.Get("Core", "DesyncCheckRanges",	&m_LocalCoreStartupParameter.strDesyncCheckRanges,	"");
 		ini.Get("Core", "DCBZ",				&m_LocalCoreStartupParameter.bDCBZOFF,			false);
 		ini.Get("Core", "FrameLimit",		&m_Framelimit,									1); // auto frame limit by default
 		ini.Get("Core", "UseFPS",			&b_UseFPS,										false); // use vps as default
@@ -443,6 +472,7 @@ void SConfig::LoadSettings()
 		// DSP
 		ini.Get("DSP", "EnableJIT", &m_EnableJIT, true);
 		ini.Get("DSP", "DumpAudio", &m_DumpAudio, false);
+		ini.Get("DSP", "DumpAudioStats", &m_DumpAudioStats, false);
 	#if defined __linux__ && HAVE_ALSA
 		ini.Get("DSP", "Backend", &sBackend, BACKEND_ALSA);
 	#elif defined __APPLE__
@@ -457,6 +487,10 @@ void SConfig::LoadSettings()
 		ini.Get("DSP", "Volume", &m_Volume, 100);
 
 		ini.Get("FifoPlayer", "LoopReplay", &m_LocalCoreStartupParameter.bLoopFifoReplay, true);
+
+		ini.Get("NetPlay", "SimulatedLatency", &m_NetPlaySimulatedLatency, 0);
+		ini.Get("NetPlay", "SimulatedJitter", &m_NetPlaySimulatedJitter, 0);
+		ini.Get("NetPlay", "SimulatedLoss", &m_NetPlaySimulatedLoss, 0);
 	}
 
 	m_SYSCONF = new SysConf();
@@ -43,9 +43,24 @@ struct SConfig : NonCopyable
 
 	std::string m_strMemoryCardA;
 	std::string m_strMemoryCardB;
+	int m_MemcardSync;	// 0: left to the OS, 1: after every flush, 2: when the card is removed
 	TEXIDevices m_EXIDevice[3];
 	SIDevices m_SIDevice[4];
 	std::string m_bba_mac;
+	std::string m_bba_backend;
+	std::string m_bba_pcap;
+
+	// Network link between Triforce instances, see HW/TriforceLink.h
+	int m_TriforceLinkMode;
+	u32 m_TriforceLinkNode;
+	std::string m_TriforceLinkName;
+	std::string m_TriforceLinkHosts;
+	int m_TriforceLinkPort;
+
+	// Applied to the datagrams NetPlay sends, see NetPlayUDP.h
+	int m_NetPlaySimulatedLatency;	// ms
+	int m_NetPlaySimulatedJitter;	// ms
+	int m_NetPlaySimulatedLoss;		// percent
 
 	// interface language
 	int m_InterfaceLanguage;
@@ -82,6 +97,7 @@ struct SConfig : NonCopyable
 	// DSP settings
 	bool m_EnableJIT;
 	bool m_DumpAudio;
+	bool m_DumpAudioStats;
 	int m_Volume;
 	std::string sBackend;
 
@@ -58,6 +58,7 @@
 
 #include "State.h"
 #include "Movie.h"
+#include "Rewind.h"
 #include "PatchEngine.h"
 
 // TODO: ugly, remove
@@ -87,6 +88,9 @@ std::thread g_EmuThread;
 
 static std::thread g_cpu_thread;
 static bool g_requestRefreshInfo = false;
+// Held from the outermost PauseAndLock(true) until the matching unlock,
+// g_pauseAndLockDepth is only touched with it held
+static std::recursive_mutex g_pauseAndLockMutex;
 static int g_pauseAndLockDepth = 0;
 
 SCoreStartupParameter g_CoreStartupParameter;
@@ -584,7 +588,7 @@ void RequestRefreshInfo()
 	g_requestRefreshInfo = true;
 }
 
-bool PauseAndLock(bool doLock, bool unpauseOnUnlock)
+static bool PauseAndLockLocked(bool doLock, bool unpauseOnUnlock)
 {
 	// let's support recursive locking to simplify things on the caller's side,
 	// and let's do it at this outer level in case the individual systems don't support it.
@@ -604,6 +608,27 @@ bool PauseAndLock(bool doLock, bool unpauseOnUnlock)
 	return wasUnpaused;
 }
 
+bool PauseAndLock(bool doLock, bool unpauseOnUnlock)
+{
+	// A second thread waits here until the first one has unlocked again
+	if (doLock)
+		g_pauseAndLockMutex.lock();
+	bool wasUnpaused = PauseAndLockLocked(doLock, unpauseOnUnlock);
+	if (!doLock)
+		g_pauseAndLockMutex.unlock();
+	return wasUnpaused;
+}
+
+bool TryPauseAndLock(bool& wasUnpaused)
+{
+	// Whoever holds the mutex may be waiting for the CPU thread to pause,
+	// so the CPU thread must not block on it
+	if (!g_pauseAndLockMutex.try_lock())
+		return false;
+	wasUnpaused = PauseAndLockLocked(true, true);
+	return true;
+}
+
 // Apply Frame Limit and Display FPS info
 // This should only be called from VI
 void VideoThrottle()
@@ -668,6 +693,7 @@ void Callback_VideoCopiedToXFB(bool video_update)
 	if(video_update)
 		Common::AtomicIncrement(DrawnFrame);
 	Movie::FrameUpdate();
+	Rewind::FrameAdvanced();
 }
 
 // Callback_ISOName: Let the DSP emulator get the game name
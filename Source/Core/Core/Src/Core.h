@@ -85,6 +85,9 @@ void UpdateTitle();
 // calls must be balanced (once with doLock true, then once with doLock false) but may be recursive.
 // the return value of the first call should be passed in as the second argument of the second call.
 bool PauseAndLock(bool doLock, bool unpauseOnUnlock=true);
+// PauseAndLock(true) for the CPU thread, which can't wait for another thread's lock.
+// returns false and locks nothing if another thread holds it.
+bool TryPauseAndLock(bool& wasUnpaused);
 
 }  // namespace
 
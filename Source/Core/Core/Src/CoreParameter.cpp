@@ -30,6 +30,7 @@ SCoreStartupParameter::SCoreStartupParameter()
   bJITPairedOff(false), bJITSystemRegistersOff(false),
   bJITBranchOff(false),
   bJITILTimeProfiling(false), bJITILOutputIR(false),
+  bJITVerify(false),
   bEnableFPRF(false),
   bCPUThread(true), bDSPThread(false), bDSPHLE(true),
   bSkipIdle(true), bNTSC(false), bForceNTSCJ(false),
@@ -38,7 +39,8 @@ SCoreStartupParameter::SCoreStartupParameter()
   bDPL2Decoder(false), iLatency(14),
   bRunCompareServer(false), bRunCompareClient(false),
   bMMU(false), bDCBZOFF(false), bTLBHack(false), iBBDumpPort(0), bVBeamSpeedHack(false),
-  bSyncGPU(false), bFastDiscSpeed(false),
+  bSyncGPU(false), bFastDiscSpeed(false), bIncrementalStates(false),
+  iRewindSeconds(0), iRewindInterval(30), iDesyncCheckInterval(0),
   SelectedLanguage(0), bWii(false),
   bConfirmStop(false), bHideCursor(false),
   bAutoHideCursor(false), bUsePanicHandlers(true), bOnScreenDisplayMessages(true),
@@ -78,6 +80,11 @@ void SCoreStartupParameter::LoadDefaults()
 	bVBeamSpeedHack = false;
 	bSyncGPU = false;
 	bFastDiscSpeed = false;
+	bIncrementalStates = false;
+	iRewindSeconds = 0;
+	iRewindInterval = 30;
+	iDesyncCheckInterval = 0;
+	strDesyncCheckRanges.clear();
 	bMergeBlocks = false;
 	bEnableMemcardSaving = true;
 	SelectedLanguage = 0;
@@ -78,6 +78,7 @@ enum Hotkey
 	HK_UNDO_SAVE_STATE,
 	HK_SAVE_STATE_FILE,
 	HK_LOAD_STATE_FILE,
+	HK_REWIND,
 
 	NUM_HOTKEYS,
 };
@@ -113,6 +114,7 @@ struct SCoreStartupParameter
 	bool bJITBranchOff;
 	bool bJITILTimeProfiling;
 	bool bJITILOutputIR;
+	bool bJITVerify;
 
 	bool bFastmem;
 	bool bEnableFPRF;
@@ -141,6 +143,11 @@ struct SCoreStartupParameter
 	bool bVBeamSpeedHack;
 	bool bSyncGPU;
 	bool bFastDiscSpeed;
+	bool bIncrementalStates;
+	int iRewindSeconds; // 0 = rewind off
+	int iRewindInterval; // frames between rewind snapshots
+	int iDesyncCheckInterval; // fields between state hashes, 0 = off, see DesyncCheck.h
+	std::string strDesyncCheckRanges; // RAM hashed by the desync check, empty = all
 
 	int SelectedLanguage;
 
@@ -474,6 +474,16 @@ std::string GetScheduledEventsSummary()
 	return text;
 }
 
+void GetScheduledEvents(std::vector<u64> &events)
+{
+	events.clear();
+	for (Event *ptr = first; ptr; ptr = ptr->next)
+	{
+		events.push_back((u64)ptr->time);
+		events.push_back((u64)ptr->type);
+	}
+}
+
 u32 GetFakeDecStartValue()
 {
 	return fakeDecStartValue;
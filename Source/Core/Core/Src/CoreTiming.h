@@ -21,6 +21,7 @@
 #include "Common.h"
 
 #include <string>
+#include <vector>
 
 #include "ChunkFile.h"
 
@@ -68,6 +69,9 @@ void ResetSliceLength();
 void RegisterAdvanceCallback(void (*callback)(int cyclesExecuted));
 
 std::string GetScheduledEventsSummary();
+// Time and type of each scheduled event, in the order they will run.
+// Userdata is left out, some events keep host pointers in it.
+void GetScheduledEvents(std::vector<u64> &events);
 
 u32 GetFakeDecStartValue();
 void SetFakeDecStartValue(u32 val);
@@ -8,49 +8,7 @@
 #include "DSPHost.h"
 #include "DSPHWInterface.h"
 #include "DSPInterpreter.h"
-
-// The hardware adpcm decoder :)
-static s16 ADPCM_Step(u32& _rSamplePos)
-{
-	const s16 *pCoefTable = (const s16 *)&g_dsp.ifx_regs[DSP_COEF_A1_0];
-
-	if (((_rSamplePos) & 15) == 0)
-	{
-		g_dsp.ifx_regs[DSP_PRED_SCALE] = DSPHost_ReadHostMemory((_rSamplePos & ~15) >> 1);
-		_rSamplePos += 2;
-	}
-
-	int scale = 1 << (g_dsp.ifx_regs[DSP_PRED_SCALE] & 0xF);
-	int coef_idx = (g_dsp.ifx_regs[DSP_PRED_SCALE] >> 4) & 0x7;
-
-	s32 coef1 = pCoefTable[coef_idx * 2 + 0];
-	s32 coef2 = pCoefTable[coef_idx * 2 + 1];
-
-	int temp = (_rSamplePos & 1) ?
-		   (DSPHost_ReadHostMemory(_rSamplePos >> 1) & 0xF) :
-		   (DSPHost_ReadHostMemory(_rSamplePos >> 1) >> 4);
-
-	if (temp >= 8)
-		temp -= 16;
-
-	// 0x400 = 0.5  in 11-bit fixed point
-	int val = (scale * temp) + ((0x400 + coef1 * (s16)g_dsp.ifx_regs[DSP_YN1] + coef2 * (s16)g_dsp.ifx_regs[DSP_YN2]) >> 11);
-
-	// Clamp values.
-	if (val > 0x7FFF)
-		val = 0x7FFF;
-	else if (val < -0x7FFF)
-		val = -0x7FFF;
-
-	g_dsp.ifx_regs[DSP_YN2] = g_dsp.ifx_regs[DSP_YN1];
-	g_dsp.ifx_regs[DSP_YN1] = val;
-
-	_rSamplePos++;
-
-	// The advanced interpolation (linear, polyphase,...) is done by the UCode,
-	// so we don't need to bother with it here.
-	return val;
-}
+#include "DSPAccelerator.h"
 
 u16 dsp_read_aram_d3()
 {
@@ -119,28 +77,33 @@ u16 dsp_read_accelerator()
 	// extention and do/do not use ADPCM.  It also remains to be figured out
 	// whether there's a difference between the usual accelerator "read
 	// address" and 0xd3.
-	switch (g_dsp.ifx_regs[DSP_FORMAT])
+	if (AcceleratorIsFormatSupported(g_dsp.ifx_regs[DSP_FORMAT]))
 	{
-		case 0x00:  // ADPCM audio
-			val = ADPCM_Step(Address);
-			break;
-		case 0x0A:  // 16-bit PCM audio
-			val = (DSPHost_ReadHostMemory(Address*2) << 8) | DSPHost_ReadHostMemory(Address*2 + 1);
-			g_dsp.ifx_regs[DSP_YN2] = g_dsp.ifx_regs[DSP_YN1];
-			g_dsp.ifx_regs[DSP_YN1] = val;
-			Address++;
-			break;
-		case 0x19:  // 8-bit PCM audio
-			val = DSPHost_ReadHostMemory(Address) << 8; 
-			g_dsp.ifx_regs[DSP_YN2] = g_dsp.ifx_regs[DSP_YN1];
-			g_dsp.ifx_regs[DSP_YN1] = val;
-			Address++;
-			break;
-		default:
-			ERROR_LOG(DSPLLE, "dsp_read_accelerator() - unknown format 0x%x", g_dsp.ifx_regs[DSP_FORMAT]);
-			Address++;
-			val = 0;
-			break;
+		AcceleratorState state;
+		state.cur_addr = Address;
+		state.end_addr = EndAddress;
+		state.format = g_dsp.ifx_regs[DSP_FORMAT];
+		state.pred_scale = g_dsp.ifx_regs[DSP_PRED_SCALE];
+		state.yn1 = g_dsp.ifx_regs[DSP_YN1];
+		state.yn2 = g_dsp.ifx_regs[DSP_YN2];
+		state.coefs = (const s16 *)&g_dsp.ifx_regs[DSP_COEF_A1_0];
+
+		// The ucode reads one sample per register access, so there's nothing
+		// to batch here - but this is the same decoder the HLE uses.
+		s16 sample;
+		AcceleratorDecodeSamples(state, &sample, 1, DSPHost_ReadHostMemory);
+
+		g_dsp.ifx_regs[DSP_PRED_SCALE] = state.pred_scale;
+		g_dsp.ifx_regs[DSP_YN1] = state.yn1;
+		g_dsp.ifx_regs[DSP_YN2] = state.yn2;
+		Address = state.cur_addr;
+		val = sample;
+	}
+	else
+	{
+		ERROR_LOG(DSPLLE, "dsp_read_accelerator() - unknown format 0x%x", g_dsp.ifx_regs[DSP_FORMAT]);
+		Address++;
+		val = 0;
 	}
 
 	// TODO: Take GAIN into account
@@ -5,9 +5,175 @@
 #ifndef _DSP_ACCELERATOR_H
 #define _DSP_ACCELERATOR_H
 
+#include <algorithm>
+
+#include "Common.h"
+
 u16 dsp_read_accelerator();
 
 u16 dsp_read_aram_d3();
 void dsp_write_aram_d3(u16 value);
 
+// Sample formats understood by the accelerator (DSP_FORMAT / PB sample_format).
+enum
+{
+	ACCELERATOR_FORMAT_ADPCM = 0x00,
+	ACCELERATOR_FORMAT_PCM16 = 0x0A,
+	ACCELERATOR_FORMAT_PCM8  = 0x19,
+};
+
+// Decoder state shared by the LLE accelerator registers and the AX HLE
+// parameter blocks. Addresses are in units of the sample format: nibbles for
+// ADPCM, bytes for PCM8 and 16-bit words for PCM16.
+struct AcceleratorState
+{
+	u32 cur_addr;
+	u32 end_addr;
+	u16 format;
+	u16 pred_scale;
+	s16 yn1;
+	s16 yn2;
+	const s16 *coefs;
+};
+
+inline bool AcceleratorIsFormatSupported(u16 format)
+{
+	return format == ACCELERATOR_FORMAT_ADPCM ||
+	       format == ACCELERATOR_FORMAT_PCM16 ||
+	       format == ACCELERATOR_FORMAT_PCM8;
+}
+
+// The end address is compared without its lowest bit, like the hardware.
+inline bool AcceleratorAtEnd(u32 cur_addr, u32 end_addr)
+{
+	return (cur_addr & ~1) == (end_addr & ~1);
+}
+
+// Decodes up to count samples of a supported format into dst. Stops right
+// after the sample that brings cur_addr to end_addr, so that the caller can
+// handle looping; returns the number of samples written.
+//
+// The format, predictor and coefficients are only looked up once per call
+// (once per 14 sample frame for ADPCM) instead of for every sample.
+template <typename ReadByte>
+u32 AcceleratorDecodeSamples(AcceleratorState &state, s16 *dst, u32 count, ReadByte read_byte)
+{
+	u32 cur_addr = state.cur_addr;
+	const u32 end_addr = state.end_addr;
+	s32 yn1 = state.yn1;
+	s32 yn2 = state.yn2;
+	u32 decoded = 0;
+
+	switch (state.format)
+	{
+	case ACCELERATOR_FORMAT_ADPCM:
+		while (decoded < count)
+		{
+			// Every 8 byte frame starts with its predictor/scale byte.
+			if ((cur_addr & 15) == 0)
+			{
+				state.pred_scale = read_byte((cur_addr & ~15) >> 1);
+				cur_addr += 2;
+			}
+
+			const int scale = 1 << (state.pred_scale & 0xF);
+			const int coef_idx = (state.pred_scale >> 4) & 0x7;
+			const s32 coef1 = state.coefs[coef_idx * 2 + 0];
+			const s32 coef2 = state.coefs[coef_idx * 2 + 1];
+
+			do
+			{
+				const u8 byte = read_byte(cur_addr >> 1);
+				int temp = (cur_addr & 1) ? (byte & 0xF) : (byte >> 4);
+				if (temp >= 8)
+					temp -= 16;
+
+				// 0x400 = 0.5  in 11-bit fixed point
+				int val = (scale * temp) + ((0x400 + coef1 * yn1 + coef2 * yn2) >> 11);
+				if (val > 0x7FFF)
+					val = 0x7FFF;
+				else if (val < -0x7FFF)
+					val = -0x7FFF;
+
+				yn2 = yn1;
+				yn1 = val;
+				dst[decoded++] = val;
+				cur_addr++;
+
+				if (AcceleratorAtEnd(cur_addr, end_addr))
+					goto done;
+			} while (decoded < count && (cur_addr & 15) != 0);
+		}
+		break;
+
+	case ACCELERATOR_FORMAT_PCM16:
+		while (decoded < count)
+		{
+			const s16 val = (read_byte(cur_addr * 2) << 8) | read_byte(cur_addr * 2 + 1);
+			yn2 = yn1;
+			yn1 = val;
+			dst[decoded++] = val;
+			cur_addr++;
+
+			if (AcceleratorAtEnd(cur_addr, end_addr))
+				break;
+		}
+		break;
+
+	case ACCELERATOR_FORMAT_PCM8:
+		while (decoded < count)
+		{
+			const s16 val = read_byte(cur_addr) << 8;
+			yn2 = yn1;
+			yn1 = val;
+			dst[decoded++] = val;
+			cur_addr++;
+
+			if (AcceleratorAtEnd(cur_addr, end_addr))
+				break;
+		}
+		break;
+	}
+
+done:
+	state.cur_addr = cur_addr;
+	state.yn1 = yn1;
+	state.yn2 = yn2;
+	return decoded;
+}
+
+// Hands samples one at a time to a resampler, decoding them in blocks into
+// buffer. Only the expected number of samples is decoded in blocks, so that
+// the accelerator ends up where it would have one sample at a time; if the
+// resampler pulls more than that, the rest is decoded one by one.
+template <typename Decode>
+class AcceleratorSampleReader
+{
+public:
+	AcceleratorSampleReader(s16 *buffer, u32 size, u32 expected, Decode decode)
+		: m_buffer(buffer), m_size(size), m_expected(expected), m_pos(0), m_count(0), m_decode(decode)
+	{
+	}
+
+	s16 Next()
+	{
+		if (m_pos == m_count)
+		{
+			m_count = m_expected ? std::min(m_expected, m_size) : 1;
+			m_decode(m_buffer, m_count);
+			m_expected -= std::min(m_expected, m_count);
+			m_pos = 0;
+		}
+		return m_buffer[m_pos++];
+	}
+
+private:
+	s16 *m_buffer;
+	u32 m_size;
+	u32 m_expected;
+	u32 m_pos;
+	u32 m_count;
+	Decode m_decode;
+};
+
 #endif
@@ -368,19 +368,20 @@ void CompileCurrent()
 {
 	dspjit->Compile(g_dsp.pc);
 
+	// Compile the destinations this block is still waiting on. Compiling can
+	// add or drop entries, so rescan until nothing is left to compile.
 	bool retry = true;
 
 	while (retry)
 	{
 		retry = false;
-		for(u16 i = 0x0000; i < 0xffff; ++i)
+		for (size_t i = 0; i < dspjit->unresolvedJumps.size(); ++i)
 		{
-			if (!dspjit->unresolvedJumps[i].empty())
+			u16 addrToCompile = dspjit->unresolvedJumps[i].to;
+			if (!dspjit->IsCompiled(addrToCompile))
 			{
-				u16 addrToCompile = dspjit->unresolvedJumps[i].front();
 				dspjit->Compile(addrToCompile);
-				if (!dspjit->unresolvedJumps[i].empty())
-					retry = true;
+				retry = true;
 			}
 		}
 	}
@@ -10,6 +10,7 @@
 #include "DSPHost.h"
 #include "DSPInterpreter.h"
 #include "DSPAnalyzer.h"
+#include "DSPProfiler.h"
 
 #define MAX_BLOCK_SIZE 250
 #define DSP_IDLE_SKIP_CYCLES 0x1000
@@ -25,6 +26,7 @@ DSPEmitter::DSPEmitter() : gpr(*this), storeIndex(-1), storeIndex2(-1)
 	blocks = new DSPCompiledCode[MAX_BLOCKS];
 	blockLinks = new Block[MAX_BLOCKS];
 	blockSize = new u16[MAX_BLOCKS];
+	iramBlockEnd = new u16[DSP_IRAM_SIZE];
 	
 	compileSR = 0;
 	compileSR |= SR_INT_ENABLE;
@@ -36,10 +38,9 @@ DSPEmitter::DSPEmitter() : gpr(*this), storeIndex(-1), storeIndex2(-1)
 	//clear all of the block references
 	for(int i = 0x0000; i < MAX_BLOCKS; i++)
 	{
-		blocks[i] = (DSPCompiledCode)stubEntryPoint;
-		blockLinks[i] = 0;
-		blockSize[i] = 0;
+		ResetBlock(i);
 	}
+	memset(iramBlockEnd, 0, DSP_IRAM_SIZE * sizeof(u16));
 }
 
 DSPEmitter::~DSPEmitter() 
@@ -47,19 +48,111 @@ DSPEmitter::~DSPEmitter()
 	delete[] blocks;
 	delete[] blockLinks;
 	delete[] blockSize;
+	delete[] iramBlockEnd;
 	FreeCodeSpace();
 }
 
-void DSPEmitter::ClearIRAM()
+static bool HasEdgeFrom(const std::vector<DSPBlockEdge>& edges, u16 from)
 {
-	for(int i = 0x0000; i < 0x1000; i++)
+	for (size_t i = 0; i < edges.size(); i++)
 	{
-		blocks[i] = (DSPCompiledCode)stubEntryPoint;
-		blockLinks[i] = 0;
-		blockSize[i] = 0;
-		unresolvedJumps[i].clear();
+		if (edges[i].from == from)
+			return true;
 	}
-	g_dsp.reset_dspjit_codespace = true;
+	return false;
+}
+
+static void AddEdge(std::vector<DSPBlockEdge>& edges, u16 from, u16 to)
+{
+	for (size_t i = 0; i < edges.size(); i++)
+	{
+		if (edges[i].from == from && edges[i].to == to)
+			return;
+	}
+	DSPBlockEdge edge = { from, to };
+	edges.push_back(edge);
+}
+
+// The edge lists are unordered, so erasing swaps in the last element.
+static void RemoveEdge(std::vector<DSPBlockEdge>& edges, u16 from, u16 to)
+{
+	for (size_t i = 0; i < edges.size(); i++)
+	{
+		if (edges[i].from == from && edges[i].to == to)
+		{
+			edges[i] = edges.back();
+			edges.pop_back();
+			return;
+		}
+	}
+}
+
+static void RemoveEdgesFrom(std::vector<DSPBlockEdge>& edges, u16 from)
+{
+	for (size_t i = 0; i < edges.size();)
+	{
+		if (edges[i].from == from)
+		{
+			edges[i] = edges.back();
+			edges.pop_back();
+		}
+		else
+		{
+			i++;
+		}
+	}
+}
+
+void DSPEmitter::ResetBlock(u16 address)
+{
+	blocks[address] = (DSPCompiledCode)stubEntryPoint;
+	blockLinks[address] = 0;
+	blockSize[address] = 0;
+}
+
+// Drops a block whose code no longer matches IRAM, together with every block
+// that jumps straight into its code.
+void DSPEmitter::InvalidateBlock(u16 address)
+{
+	ResetBlock(address);
+	if (address < DSP_IRAM_SIZE)
+		iramBlockEnd[address] = 0;
+	RemoveEdgesFrom(unresolvedJumps, address);
+
+	std::vector<u16> linkers;
+	for (size_t i = 0; i < linkedJumps.size();)
+	{
+		if (linkedJumps[i].to == address || linkedJumps[i].from == address)
+		{
+			if (linkedJumps[i].to == address && linkedJumps[i].from != address)
+				linkers.push_back(linkedJumps[i].from);
+			linkedJumps[i] = linkedJumps.back();
+			linkedJumps.pop_back();
+		}
+		else
+		{
+			i++;
+		}
+	}
+
+	for (size_t i = 0; i < linkers.size(); i++)
+		InvalidateBlock(linkers[i]);
+}
+
+// Only the blocks overlapping the given IRAM words (and the blocks linked to
+// them) are recompiled. The stale code stays in the code space until the next
+// full reset.
+void DSPEmitter::ClearIRAMRange(u16 address, u16 size)
+{
+	u32 end = (u32)address + size;
+	for (u32 i = 0x0000; i < DSP_IRAM_SIZE && i < end; i++)
+	{
+		if (iramBlockEnd[i] > address)
+			InvalidateBlock(i);
+	}
+
+	if (GetSpaceLeft() < COMPILED_CODE_SIZE / 4)
+		g_dsp.reset_dspjit_codespace = true;
 }
 
 void DSPEmitter::ClearIRAMandDSPJITCodespaceReset() 
@@ -70,15 +163,14 @@ void DSPEmitter::ClearIRAMandDSPJITCodespaceReset()
 
 	for(int i = 0x0000; i < 0x10000; i++)
 	{
-		blocks[i] = (DSPCompiledCode)stubEntryPoint;
-		blockLinks[i] = 0;
-		blockSize[i] = 0;
-		unresolvedJumps[i].clear();
+		ResetBlock(i);
 	}
+	memset(iramBlockEnd, 0, DSP_IRAM_SIZE * sizeof(u16));
+	unresolvedJumps.clear();
+	linkedJumps.clear();
 	g_dsp.reset_dspjit_codespace = false;
 }
 
-
 // Must go out of block if exception is detected
 void DSPEmitter::checkExceptions(u32 retval)
 {
@@ -202,7 +294,7 @@ void DSPEmitter::Compile(u16 start_addr)
 {
 	// Remember the current block address for later
 	startAddr = start_addr;
-	unresolvedJumps[start_addr].clear();
+	RemoveEdgesFrom(unresolvedJumps, start_addr);
 
 	const u8 *entryPoint = AlignCode16();
 
@@ -219,6 +311,13 @@ void DSPEmitter::Compile(u16 start_addr)
 
 	blockLinkEntry = GetCodePtr();
 
+	if (profiling)
+	{
+		gpr.pushRegs();
+		ABI_CallFunctionC16((void *)&DSPProfiler::OnBlockEntry, start_addr);
+		gpr.popRegs();
+	}
+
 	compilePC = start_addr;
 	bool fixup_pc = false;
 	blockSize[start_addr] = 0;
@@ -237,7 +336,7 @@ void DSPEmitter::Compile(u16 start_addr)
 		compilePC += opcode->size;
 
 		// If the block was trying to link into itself, remove the link
-		unresolvedJumps[start_addr].remove(compilePC);
+		RemoveEdge(unresolvedJumps, start_addr, compilePC);
 
 		fixup_pc = true;
 
@@ -321,44 +420,56 @@ void DSPEmitter::Compile(u16 start_addr)
 		}
 	}
 
+	if (blockSize[start_addr] == 0) 
+	{
+		// just a safeguard, should never happen anymore.
+		// if it does we might get stuck over in RunForCycles.
+		ERROR_LOG(DSPLLE, "Block at 0x%04x has zero size", start_addr);
+		blockSize[start_addr] = 1;
+	}
+
 	if (fixup_pc)
 	{
 		MOV(16, M(&(g_dsp.pc)), Imm16(compilePC));
+
+		// The block was cut short, continue straight into the next one as
+		// long as it is still in the same memory (IRAM or IROM).
+		if ((compilePC >> 12) == (start_addr >> 12) &&
+			!(DSPAnalyzer::code_flags[start_addr] & DSPAnalyzer::CODE_IDLE_SKIP))
+			WriteBlockLink(compilePC);
 	}
 
 	blocks[start_addr] = (DSPCompiledCode)entryPoint;
+	if (start_addr < DSP_IRAM_SIZE)
+		iramBlockEnd[start_addr] = compilePC;
+	if (profiling)
+		DSPProfiler::RegisterBlock(start_addr, compilePC);
 
 	// Mark this block as a linkable destination if it does not contain
 	// any unresolved CALL's
-	if (unresolvedJumps[start_addr].empty())
+	if (!HasEdgeFrom(unresolvedJumps, start_addr))
 	{
 		blockLinks[start_addr] = blockLinkEntry;
 
-		for(u16 i = 0x0000; i < 0xffff; ++i)
+		// Check if there were any blocks waiting for this block to be linkable
+		for (size_t i = 0; i < unresolvedJumps.size();)
 		{
-			if (!unresolvedJumps[i].empty())
+			if (unresolvedJumps[i].to == start_addr)
 			{
-				// Check if there were any blocks waiting for this block to be linkable
-				size_t size = unresolvedJumps[i].size();
-				unresolvedJumps[i].remove(start_addr);
-				if (unresolvedJumps[i].size() < size)
-				{
-					// Mark the block to be recompiled again
-					blocks[i] = (DSPCompiledCode)stubEntryPoint;
-					blockLinks[i] = 0;
-					blockSize[i] = 0;
-				}
+				// Mark the block to be recompiled again
+				ResetBlock(unresolvedJumps[i].from);
+				unresolvedJumps[i] = unresolvedJumps.back();
+				unresolvedJumps.pop_back();
+			}
+			else
+			{
+				i++;
 			}
 		}
 	}
 
-	if (blockSize[start_addr] == 0) 
-	{
-		// just a safeguard, should never happen anymore.
-		// if it does we might get stuck over in RunForCycles.
-		ERROR_LOG(DSPLLE, "Block at 0x%04x has zero size", start_addr);
-		blockSize[start_addr] = 1;
-	}
+	if (GetSpaceLeft() < COMPILED_CODE_SIZE / 4)
+		g_dsp.reset_dspjit_codespace = true;
 
 	gpr.saveRegs();
 	if (!DSPHost_OnThread() && DSPAnalyzer::code_flags[start_addr] & DSPAnalyzer::CODE_IDLE_SKIP)
@@ -372,6 +483,38 @@ void DSPEmitter::Compile(u16 start_addr)
 	JMP(returnDispatcher, true);
 }
 
+void DSPEmitter::WriteBlockLink(u16 dest)
+{
+	// Jump directly to the called block if it has already been compiled.
+	if (blockLinks[dest] != 0)
+	{
+		gpr.flushRegs();
+		// Check if we have enough cycles to execute the next block
+		MOV(16, R(ECX), M(&cyclesLeft));
+		CMP(16, R(ECX), Imm16(blockSize[startAddr] + blockSize[dest]));
+		FixupBranch notEnoughCycles = J_CC(CC_BE);
+
+		SUB(16, R(ECX), Imm16(blockSize[startAddr]));
+		MOV(16, M(&cyclesLeft), R(ECX));
+		if (profiling)
+		{
+			gpr.pushRegs();
+			ABI_CallFunctionC16((void *)&DSPProfiler::AddCycles, blockSize[startAddr]);
+			gpr.popRegs();
+		}
+		JMP(blockLinks[dest], true);
+		SetJumpTarget(notEnoughCycles);
+
+		AddEdge(linkedJumps, startAddr, dest);
+	}
+	else
+	{
+		// The destination has not been compiled yet.  Add it to the list
+		// of blocks that this block is waiting on.
+		AddEdge(unresolvedJumps, startAddr, dest);
+	}
+}
+
 const u8 *DSPEmitter::CompileStub()
 {
 	const u8 *entryPoint = AlignCode16();
@@ -383,6 +526,8 @@ const u8 *DSPEmitter::CompileStub()
 
 void DSPEmitter::CompileDispatcher()
 {
+	profiling = DSPProfiler::IsEnabled();
+
 	enterDispatcher = AlignCode16();
 	ABI_PushAllCalleeSavedRegsAndAdjustStack();
 
@@ -413,6 +558,10 @@ void DSPEmitter::CompileDispatcher()
 
 	returnDispatcher = GetCodePtr();
 
+	// Charge the cycles to the block that just returned.
+	if (profiling)
+		ABI_CallFunctionR((void *)&DSPProfiler::AddCycles, EAX);
+
 	// Decrement cyclesLeft
 	SUB(16, M(&cyclesLeft), R(EAX));
 
@@ -5,7 +5,7 @@
 #ifndef _DSPEMITTER_H
 #define _DSPEMITTER_H
 
-#include <list>
+#include <vector>
 
 #include "DSPCommon.h"
 #include "x64ABI.h"
@@ -19,6 +19,13 @@
 typedef u32 (*DSPCompiledCode)();
 typedef const u8 *Block;
 
+// A jump from the block starting at 'from' into the block starting at 'to'.
+struct DSPBlockEdge
+{
+	u16 from;
+	u16 to;
+};
+
 class DSPEmitter : public Gen::XCodeBlock, NonCopyable
 {
 public:
@@ -28,13 +35,15 @@ public:
 	Block m_compiledCode;
 
 	void EmitInstruction(UDSPInstruction inst);
-	void ClearIRAM();
+	void ClearIRAMRange(u16 address, u16 size);
 	void ClearIRAMandDSPJITCodespaceReset();
 
 	void CompileDispatcher();
 	Block CompileStub();
 	void Compile(u16 start_addr);
 	void ClearCallFlag();
+	bool IsCompiled(u16 address) const { return blocks[address] != (DSPCompiledCode)stubEntryPoint; }
+	void WriteBlockLink(u16 dest);
 
 	bool FlagsNeeded();
 
@@ -253,11 +262,20 @@ public:
 	u16 startAddr;
 	Block *blockLinks;
 	u16 *blockSize;
-	std::list<u16> unresolvedJumps[MAX_BLOCKS];
+	// Jumps to blocks that were not linkable yet when their source block was
+	// compiled. The source is recompiled once the destination becomes linkable.
+	std::vector<DSPBlockEdge> unresolvedJumps;
 
 	DSPJitRegCache gpr;
 private:
 	DSPCompiledCode *blocks;
+	// Whether the dispatcher and blocks carry the DSPProfiler hooks.
+	bool profiling;
+	// End address of every block starting in IRAM, used to find the blocks
+	// touched by an IRAM DMA.
+	u16 *iramBlockEnd;
+	// Jumps that were emitted directly into the code of another block.
+	std::vector<DSPBlockEdge> linkedJumps;
 	Block blockLinkEntry;
 	u16 compileSR;
 
@@ -268,6 +286,9 @@ private:
 	// Counts down.
 	// int cycles;
 
+	void ResetBlock(u16 address);
+	void InvalidateBlock(u16 address);
+
 	void Update_SR_Register(Gen::X64Reg val = Gen::EAX);
 
 	void get_long_prod(Gen::X64Reg long_prod = Gen::RAX);
@@ -0,0 +1,230 @@
+// Copyright 2013 Dolphin Emulator Project
+// Licensed under GPLv2
+// Refer to the license.txt file included.
+
+#include <algorithm>
+#include <vector>
+
+#include "Common.h"
+#include "FileUtil.h"
+#include "StringUtil.h"
+
+#include "DSPProfiler.h"
+#include "DSPAnalyzer.h"
+#include "DSPCore.h"
+#include "DSPMemoryMap.h"
+#include "DSPTables.h"
+#include "LabelMap.h"
+#include "disassemble.h"
+
+namespace DSPProfiler {
+
+// Blocks listed in the report, hottest first.
+#define REPORT_BLOCKS 50
+// Disassembly lines printed per block.
+#define REPORT_BLOCK_LINES 32
+// Blocks averaging more cycles than this per entry are not idle loops.
+#define IDLE_MAX_CYCLES 16
+
+static bool s_enabled = false;
+static BlockStats s_stats[PROFILE_SIZE];
+static u32 s_current = 0;
+
+void SetEnabled(bool enabled)
+{
+	if (enabled == s_enabled)
+		return;
+
+	s_enabled = enabled;
+	Reset();
+	g_dsp.reset_dspjit_codespace = true;
+}
+
+bool IsEnabled()
+{
+	return s_enabled;
+}
+
+void Reset()
+{
+	for (u32 i = 0; i < PROFILE_SIZE; i++)
+	{
+		s_stats[i].entries = 0;
+		s_stats[i].cycles = 0;
+	}
+	s_current = 0;
+}
+
+const BlockStats &GetStats(u16 address)
+{
+	return s_stats[GetIndex(address)];
+}
+
+void RegisterBlock(u16 start_addr, u16 end_addr)
+{
+	s_stats[GetIndex(start_addr)].end = end_addr;
+}
+
+void OnBlockEntry(u16 address)
+{
+	s_current = GetIndex(address);
+	s_stats[s_current].entries++;
+}
+
+// Returns its argument so the dispatcher can keep using it.
+u32 AddCycles(u32 cycles)
+{
+	cycles &= 0xffff;
+	s_stats[s_current].cycles += cycles;
+	return cycles;
+}
+
+static const u16 *GetCode(u16 address)
+{
+	return (address >> 15) ? g_dsp.irom : g_dsp.iram;
+}
+
+static std::string GetBlockName(u16 address, const LabelMap *labels)
+{
+	std::string name;
+	u16 offset;
+	if (labels && labels->GetLabelName(address, &name, &offset, LABEL_IADDR))
+	{
+		if (offset)
+			name += StringFromFormat("+0x%x", offset);
+		return name;
+	}
+	return StringFromFormat("%04x", address);
+}
+
+static bool IsStore(const DSPOPCTemplate *opcode)
+{
+	switch (opcode->opcode)
+	{
+	case 0x00e0: // SR
+	case 0x1600: // SI
+	case 0x1a00: // SRR
+	case 0x1a80: // SRRD
+	case 0x1b00: // SRRI
+	case 0x1b80: // SRRN
+	case 0x2800: // SRS
+		return true;
+	default:
+		return false;
+	}
+}
+
+static bool IsExtStore(UDSPInstruction inst)
+{
+	const DSPOPCTemplate *ext = ((inst >> 12) == 0x3) ? extOpTable[inst & 0x7F] : extOpTable[inst & 0xFF];
+	// S, SN and the combined load/store LS/SL variants.
+	return (ext->opcode & 0xf8) == 0x20 || (ext->opcode & 0xf0) == 0x80;
+}
+
+// A block qualifies if it loops back onto itself, polls a hardware register
+// and writes nothing - the same shape as the signatures in DSPAnalyzer.
+static bool IsIdleCandidate(u16 start_addr, u16 end_addr)
+{
+	if (DSPAnalyzer::code_flags[start_addr] & DSPAnalyzer::CODE_IDLE_SKIP)
+		return false;
+
+	bool polls_hw = false;
+	bool loops = false;
+	for (u16 addr = start_addr; addr < end_addr;)
+	{
+		UDSPInstruction inst = dsp_imem_read(addr);
+		const DSPOPCTemplate *opcode = GetOpTemplate(inst);
+
+		if (IsStore(opcode) || (opcode->extended && IsExtStore(inst)))
+			return false;
+		// CALLcc and HALT
+		if ((opcode->opcode & 0xfff0) == 0x02b0 || opcode->opcode == 0x0021)
+			return false;
+
+		// LRS and LR from the 0xffxx hardware registers
+		if ((opcode->opcode == 0x2000) ||
+			(opcode->opcode == 0x00c0 && dsp_imem_read(addr + 1) >= 0xff00))
+			polls_hw = true;
+		// Jcc / JMP back to the start of the block
+		if ((opcode->opcode & 0xfff0) == 0x0290 && dsp_imem_read(addr + 1) == start_addr)
+			loops = true;
+
+		addr += opcode->size;
+	}
+	return polls_hw && loops;
+}
+
+static bool CompareCycles(u32 a, u32 b)
+{
+	return s_stats[a].cycles > s_stats[b].cycles;
+}
+
+void WriteReport(const std::string &filename, const LabelMap *labels)
+{
+	File::IOFile f(filename, "w");
+	if (!f)
+	{
+		PanicAlert("Failed to open %s", filename.c_str());
+		return;
+	}
+
+	std::vector<u32> blocks;
+	u64 total_cycles = 0;
+	for (u32 i = 0; i < PROFILE_SIZE; i++)
+	{
+		if (s_stats[i].entries)
+		{
+			blocks.push_back(i);
+			total_cycles += s_stats[i].cycles;
+		}
+	}
+	std::sort(blocks.begin(), blocks.end(), CompareCycles);
+
+	AssemblerSettings settings;
+	settings.show_pc = true;
+	settings.show_hex = true;
+	DSPDisassembler disasm(settings);
+
+	fprintf(f.GetHandle(), "DSP block profile, iram crc %08x, %llu cycles in %u blocks\n\n",
+		g_dsp.iram_crc, (unsigned long long)total_cycles, (u32)blocks.size());
+
+	for (u32 i = 0; i < blocks.size() && i < REPORT_BLOCKS; i++)
+	{
+		const BlockStats &stats = s_stats[blocks[i]];
+		u16 start_addr = GetAddress(blocks[i]);
+		double percent = total_cycles ? 100.0 * stats.cycles / total_cycles : 0.0;
+
+		fprintf(f.GetHandle(), "%04x %-24s entries %10llu cycles %12llu %6.2f%% avg %7.1f\n",
+			start_addr, GetBlockName(start_addr, labels).c_str(),
+			(unsigned long long)stats.entries, (unsigned long long)stats.cycles,
+			percent, (double)stats.cycles / stats.entries);
+
+		u16 pc = start_addr;
+		for (int line = 0; pc < stats.end && line < REPORT_BLOCK_LINES; line++)
+		{
+			std::string text;
+			if (!disasm.DisOpcode(GetCode(start_addr), 0, 2, &pc, text))
+				break;
+			fprintf(f.GetHandle(), "    %s\n", text.c_str());
+		}
+		fprintf(f.GetHandle(), "\n");
+	}
+
+	fprintf(f.GetHandle(), "Idle loop candidates not caught by DSPAnalyzer:\n");
+	for (u32 i = 0; i < blocks.size(); i++)
+	{
+		const BlockStats &stats = s_stats[blocks[i]];
+		u16 start_addr = GetAddress(blocks[i]);
+		if (stats.cycles > stats.entries * IDLE_MAX_CYCLES)
+			continue;
+		if (!IsIdleCandidate(start_addr, stats.end))
+			continue;
+
+		double percent = total_cycles ? 100.0 * stats.cycles / total_cycles : 0.0;
+		fprintf(f.GetHandle(), "%04x %-24s entries %10llu %6.2f%%\n",
+			start_addr, GetBlockName(start_addr, labels).c_str(),
+			(unsigned long long)stats.entries, percent);
+	}
+}
+
+}  // namespace
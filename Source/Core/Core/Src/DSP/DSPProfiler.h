@@ -0,0 +1,60 @@
+// Copyright 2013 Dolphin Emulator Project
+// Licensed under GPLv2
+// Refer to the license.txt file included.
+
+// Optional instrumentation of the DSP JIT. When enabled, every compiled block
+// counts how often it is entered and how many DSP cycles it accounts for, so
+// that we can see where LLE time goes for a given ucode.
+
+#ifndef _DSPPROFILER_H
+#define _DSPPROFILER_H
+
+#include <string>
+
+#include "Common.h"
+
+class LabelMap;
+
+namespace DSPProfiler {
+
+// IRAM (0x0xxx) and IROM (0x8xxx) folded into one table.
+#define PROFILE_SIZE 0x2000
+
+struct BlockStats
+{
+	u64 entries;
+	u64 cycles;
+	u16 end;
+};
+
+inline u32 GetIndex(u16 address)
+{
+	return (address & 0x0fff) | ((address >> 3) & 0x1000);
+}
+
+inline u16 GetAddress(u32 index)
+{
+	return (index & 0x0fff) | ((index & 0x1000) << 3);
+}
+
+// Toggling the profiler flushes the JIT so that all blocks get recompiled
+// with (or without) the counting code.
+void SetEnabled(bool enabled);
+bool IsEnabled();
+void Reset();
+
+const BlockStats &GetStats(u16 address);
+
+// Called by the JIT.
+void RegisterBlock(u16 start_addr, u16 end_addr);
+void OnBlockEntry(u16 address);
+u32 AddCycles(u32 cycles);
+
+// Writes the hottest blocks with their disassembly, followed by loops that
+// look like idle loops but are not handled by DSPAnalyzer yet. Labels of type
+// LABEL_IADDR are used to name the blocks.
+void WriteReport(const std::string &filename, const LabelMap *labels = NULL);
+
+}  // namespace
+
+#endif  // _DSPPROFILER_H
@@ -69,6 +69,24 @@ bool LabelMap::GetLabelValue(const std::string &label, u16 *value, LabelType typ
 	return false;
 }
 
+bool LabelMap::GetLabelName(u16 value, std::string *name, u16 *offset, LabelType type) const
+{
+	const label_t *best = NULL;
+	for (u32 i = 0; i < labels.size(); i++)
+	{
+		if (!(type & labels[i].type) || labels[i].addr > value)
+			continue;
+		if (!best || labels[i].addr > best->addr)
+			best = &labels[i];
+	}
+	if (!best)
+		return false;
+
+	*name = best->name;
+	*offset = value - best->addr;
+	return true;
+}
+
 void LabelMap::Clear()
 {
 	labels.clear();
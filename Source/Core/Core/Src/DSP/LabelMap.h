@@ -36,6 +36,8 @@ public:
 	void RegisterLabel(const std::string &label, u16 lval, LabelType type = LABEL_VALUE);
 	void DeleteLabel(const std::string &label);
 	bool GetLabelValue(const std::string &label, u16 *value, LabelType type = LABEL_ANY) const;
+	// Finds the closest label at or below value.
+	bool GetLabelName(u16 value, std::string *name, u16 *offset, LabelType type = LABEL_ANY) const;
 	void Clear();
 };
 
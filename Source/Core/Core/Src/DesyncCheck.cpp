@@ -0,0 +1,377 @@
+// Copyright 2013 Dolphin Emulator Project
+// Licensed under GPLv2
+// Refer to the license.txt file included.
+
+#include <algorithm>
+
+#include "Common.h"
+#include "FileUtil.h"
+#include "Hash.h"
+#include "StringUtil.h"
+#include "Thread.h"
+#include "Timer.h"
+
+#include "ConfigManager.h"
+#include "Core.h"
+#include "CoreTiming.h"
+#include "DesyncCheck.h"
+#include "Movie.h"
+#include "NetPlayProto.h"
+#include "HW/Memmap.h"
+#include "PowerPC/PowerPC.h"
+
+namespace DesyncCheck
+{
+
+// RAM hashed per check
+static const u32 SLICE_SIZE = 0x40000;
+
+static const u32 MEM2_BASE = 0x10000000;
+
+// Hash file next to the movie: FileHeader, the ranges text, then the records
+#pragma pack(push,1)
+struct FileHeader
+{
+	u8 filetype[4];		// "DSC"0x1A
+	u32 version;
+	u32 interval;
+	u32 ranges_size;
+};
+#pragma pack(pop)
+static const u32 FILE_VERSION = 1;
+
+struct Slice
+{
+	u32 address;
+	u32 size;
+};
+
+static bool s_enabled = false;
+static u32 s_interval;
+static std::string s_ranges;
+static std::vector<Slice> s_slices;
+static u32 s_field;
+static std::vector<u64> s_events;
+
+// Movie hashes, touched from the CPU thread and from the GUI when saving
+static std::mutex s_movie_lock;
+static std::vector<Record> s_movie_hashes;
+static bool s_movie_loaded = false;	// Interval and ranges below came from a file
+static u32 s_movie_interval;
+static std::string s_movie_ranges;
+static bool s_reported;
+
+// Statistics, logged on shutdown
+static u32 s_checks;
+static u64 s_total_us;
+static u64 s_max_us;
+
+static const u8 *GetPointer(const Slice &slice)
+{
+	const u32 physical = slice.address & 0x3FFFFFFF;
+	if (physical >= MEM2_BASE)
+		return Memory::m_pEXRAM + (physical - MEM2_BASE);
+	return Memory::m_pRAM + physical;
+}
+
+static void AddRange(u32 start, u32 end)
+{
+	for (u32 address = start; address < end; address += SLICE_SIZE)
+	{
+		Slice slice = { address, std::min(SLICE_SIZE, end - address) };
+		s_slices.push_back(slice);
+	}
+}
+
+// "start-end,start-end", hex, end exclusive
+static void ParseRanges(const std::string &text, bool wii)
+{
+	s_slices.clear();
+
+	std::vector<std::string> ranges;
+	SplitString(text, ',', ranges);
+	for (size_t i = 0; i < ranges.size(); i++)
+	{
+		const std::string range = StripSpaces(ranges[i]);
+		if (range.empty())
+			continue;
+
+		u32 start, end;
+		if (sscanf(range.c_str(), "%x-%x", &start, &end) != 2 || start >= end)
+		{
+			WARN_LOG(COMMON, "Desync check: ignoring range \"%s\"", range.c_str());
+			continue;
+		}
+
+		const u32 physical = start & 0x3FFFFFFF;
+		const u32 size = end - start;
+		const bool in_mem1 = physical < Memory::REALRAM_SIZE && size <= Memory::REALRAM_SIZE - physical;
+		const bool in_mem2 = wii && physical >= MEM2_BASE && physical - MEM2_BASE < Memory::EXRAM_SIZE &&
+			size <= Memory::EXRAM_SIZE - (physical - MEM2_BASE);
+		if (!in_mem1 && !in_mem2)
+		{
+			WARN_LOG(COMMON, "Desync check: range \"%s\" is outside of RAM", range.c_str());
+			continue;
+		}
+
+		AddRange(start, end);
+	}
+
+	if (s_slices.empty())
+	{
+		AddRange(0x80000000, 0x80000000 + Memory::REALRAM_SIZE);
+		if (wii)
+			AddRange(0x90000000, 0x90000000 + Memory::EXRAM_SIZE);
+	}
+}
+
+void Init()
+{
+	const SCoreStartupParameter &startup = SConfig::GetInstance().m_LocalCoreStartupParameter;
+
+	if (Movie::IsPlayingInput() && s_movie_loaded)
+	{
+		s_interval = s_movie_interval;
+		s_ranges = s_movie_ranges;
+	}
+	else if (NetPlay::IsNetPlayRunning())
+	{
+		s_interval = g_NetPlaySettings.m_DesyncCheckInterval;
+		s_ranges = g_NetPlaySettings.m_DesyncCheckRanges;
+	}
+	else
+	{
+		s_interval = std::max(startup.iDesyncCheckInterval, 0);
+		s_ranges = startup.strDesyncCheckRanges;
+	}
+
+	s_enabled = s_interval != 0;
+	s_field = 0;
+	s_reported = false;
+	s_checks = 0;
+	s_total_us = 0;
+	s_max_us = 0;
+
+	if (!s_enabled)
+		return;
+
+	ParseRanges(s_ranges, startup.bWii);
+	NOTICE_LOG(COMMON, "Desync check: every %u fields, %u RAM slices of 0x%x bytes",
+		s_interval, (u32)s_slices.size(), SLICE_SIZE);
+}
+
+void Shutdown()
+{
+	if (s_enabled && s_checks)
+	{
+		NOTICE_LOG(COMMON, "Desync check: %u checks, %llu us on average, %llu us at most",
+			s_checks, (unsigned long long)(s_total_us / s_checks), (unsigned long long)s_max_us);
+	}
+
+	s_enabled = false;
+	s_slices.clear();
+	std::vector<u64>().swap(s_events);
+}
+
+bool IsEnabled()
+{
+	return s_enabled;
+}
+
+u32 HashCPU()
+{
+	const PowerPC::PowerPCState &state = PowerPC::ppcState;
+
+	u32 h = HashCRC32C((const u8 *)state.gpr, sizeof(state.gpr));
+	h = HashCRC32C((const u8 *)state.ps, sizeof(state.ps), h);
+	h = HashCRC32C((const u8 *)state.sr, sizeof(state.sr), h);
+	h = HashCRC32C((const u8 *)&state.spr[SPR_GQR0], 8 * sizeof(u32), h);
+
+	u32 regs[8];
+	regs[0] = state.pc;
+	regs[1] = state.msr;
+	regs[2] = state.fpscr;
+	regs[3] = state.spr[SPR_XER];
+	regs[4] = state.spr[SPR_LR];
+	regs[5] = state.spr[SPR_CTR];
+	memcpy(&regs[6], state.cr_fast, sizeof(state.cr_fast));
+	return HashCRC32C((const u8 *)regs, sizeof(regs), h);
+}
+
+static u32 HashEvents()
+{
+	CoreTiming::GetScheduledEvents(s_events);
+	s_events.push_back(CoreTiming::GetTicks());
+	return HashCRC32C((const u8 *)&s_events[0], s_events.size() * sizeof(u64));
+}
+
+static const Slice &GetSlice(u32 field)
+{
+	return s_slices[(field / s_interval) % s_slices.size()];
+}
+
+static bool FieldLess(const Record &a, const Record &b)
+{
+	return a.field < b.field;
+}
+
+static void CheckMovie(const Record &record)
+{
+	std::lock_guard<std::mutex> lk(s_movie_lock);
+
+	if (Movie::IsRecordingInput())
+	{
+		// Anything past this field is from before a state was loaded
+		while (!s_movie_hashes.empty() && s_movie_hashes.back().field >= record.field)
+			s_movie_hashes.pop_back();
+		s_movie_hashes.push_back(record);
+	}
+	else if (Movie::IsPlayingInput() && !s_reported)
+	{
+		std::vector<Record>::const_iterator it =
+			std::lower_bound(s_movie_hashes.begin(), s_movie_hashes.end(), record, FieldLess);
+		if (it == s_movie_hashes.end() || it->field != record.field)
+			return;
+
+		const u32 mask = Compare(*it, record);
+		if (mask)
+		{
+			s_reported = true;
+			const std::string message = StringFromFormat("Movie desynced at field %u (frame %llu): %s",
+				record.field, (unsigned long long)Movie::g_currentFrame, DescribeRegions(record.field, mask).c_str());
+			ERROR_LOG(COMMON, "Desync check: %s", message.c_str());
+			Core::DisplayMessage(message, 10000);
+		}
+	}
+}
+
+void FieldEnded()
+{
+	s_field++;
+	if (!s_enabled || s_field % s_interval)
+		return;
+
+	const u64 start = Common::Timer::GetTimeUs();
+
+	Record record;
+	record.field = s_field;
+	record.hashes[REGION_CPU] = HashCPU();
+	record.hashes[REGION_EVENTS] = HashEvents();
+	const Slice &slice = GetSlice(s_field);
+	record.hashes[REGION_RAM] = HashCRC32C(GetPointer(slice), slice.size, slice.address);
+
+	const u64 elapsed = Common::Timer::GetTimeUs() - start;
+	s_checks++;
+	s_total_us += elapsed;
+	s_max_us = std::max(s_max_us, elapsed);
+
+	if (NetPlay::IsNetPlayRunning())
+		NetPlay::SendSyncHash(record);
+	if (Movie::IsRecordingInput() || Movie::IsPlayingInput())
+		CheckMovie(record);
+}
+
+void DoState(PointerWrap &p)
+{
+	p.Do(s_field);
+
+	if (p.GetMode() == PointerWrap::MODE_READ)
+	{
+		std::lock_guard<std::mutex> lk(s_movie_lock);
+		s_reported = false;
+	}
+}
+
+u32 Compare(const Record &a, const Record &b)
+{
+	u32 mask = 0;
+	for (int i = 0; i < NUM_REGIONS; i++)
+	{
+		if (a.hashes[i] != b.hashes[i])
+			mask |= 1 << i;
+	}
+	return mask;
+}
+
+std::string DescribeRegions(u32 field, u32 mask)
+{
+	std::string result;
+	if (mask & (1 << REGION_CPU))
+		result += "CPU registers, ";
+	if (mask & (1 << REGION_EVENTS))
+		result += "scheduled events, ";
+	if ((mask & (1 << REGION_RAM)) && s_interval && !s_slices.empty())
+	{
+		const Slice &slice = GetSlice(field);
+		result += StringFromFormat("RAM %08x-%08x, ", slice.address, slice.address + slice.size);
+	}
+
+	if (result.empty())
+		return "nothing";
+	return result.substr(0, result.size() - 2);
+}
+
+void ClearMovieHashes()
+{
+	std::lock_guard<std::mutex> lk(s_movie_lock);
+	s_movie_hashes.clear();
+	s_movie_loaded = false;
+}
+
+bool LoadMovieHashes(const std::string &filename)
+{
+	ClearMovieHashes();
+
+	File::IOFile file(filename, "rb");
+	if (!file)
+		return false;
+
+	FileHeader header;
+	if (!file.ReadArray(&header, 1) || memcmp(header.filetype, "DSC\x1A", 4) || header.version != FILE_VERSION)
+	{
+		WARN_LOG(COMMON, "Desync check: %s isn't a hash file", filename.c_str());
+		return false;
+	}
+
+	std::string ranges(header.ranges_size, '\0');
+	if (header.ranges_size && !file.ReadBytes(&ranges[0], header.ranges_size))
+		return false;
+
+	const u64 count = (file.GetSize() - file.Tell()) / sizeof(Record);
+	std::vector<Record> hashes((size_t)count);
+	if (count && !file.ReadArray(&hashes[0], (size_t)count))
+		return false;
+
+	std::lock_guard<std::mutex> lk(s_movie_lock);
+	s_movie_hashes.swap(hashes);
+	s_movie_interval = header.interval;
+	s_movie_ranges = ranges;
+	s_movie_loaded = true;
+	return true;
+}
+
+bool SaveMovieHashes(const std::string &filename)
+{
+	std::lock_guard<std::mutex> lk(s_movie_lock);
+
+	// Don't leave hashes of an older recording around
+	if (s_movie_hashes.empty())
+	{
+		if (File::Exists(filename))
+			File::Delete(filename);
+		return true;
+	}
+
+	FileHeader header;
+	memcpy(header.filetype, "DSC\x1A", 4);
+	header.version = FILE_VERSION;
+	header.interval = s_interval;
+	header.ranges_size = (u32)s_ranges.size();
+
+	File::IOFile file(filename, "wb");
+	return file.WriteArray(&header, 1) &&
+		(s_ranges.empty() || file.WriteBytes(s_ranges.data(), s_ranges.size())) &&
+		file.WriteArray(&s_movie_hashes[0], s_movie_hashes.size());
+}
+
+}  // namespace
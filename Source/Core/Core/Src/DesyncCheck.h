@@ -0,0 +1,68 @@
+// Copyright 2013 Dolphin Emulator Project
+// Licensed under GPLv2
+// Refer to the license.txt file included.
+
+// Desync detection.
+// Every interval VI fields the CPU registers, the CoreTiming event queue and
+// one slice of the selected RAM ranges are hashed (HashCRC32C). The slice
+// moves on with every check, so all of the ranges are covered every
+// interval * number-of-slices fields while a check stays in the tens of
+// microseconds. NetPlay clients send their hashes to the server, which
+// compares them; movies keep them in a file next to the .dtm and compare
+// them on playback. The first mismatch is reported with its field number
+// and the regions that differ.
+//
+// Dual core isn't deterministic, expect false reports with it.
+
+#ifndef _DESYNCCHECK_H_
+#define _DESYNCCHECK_H_
+
+#include <string>
+
+#include "CommonTypes.h"
+#include "ChunkFile.h"
+
+namespace DesyncCheck
+{
+
+enum Region
+{
+	REGION_CPU = 0,
+	REGION_EVENTS,
+	REGION_RAM,		// The slice for this field
+	NUM_REGIONS
+};
+
+struct Record
+{
+	u32 field;
+	u32 hashes[NUM_REGIONS];
+};
+
+// Takes the interval and ranges from the movie being played, NetPlay or
+// the config, in that order
+void Init();
+void Shutdown();
+bool IsEnabled();
+
+// Called from VideoInterface at the end of every field, on the CPU thread
+void FieldEnded();
+
+void DoState(PointerWrap &p);
+
+// Hash of the CPU registers, REGION_CPU
+u32 HashCPU();
+
+// Mask of the regions that differ
+u32 Compare(const Record &a, const Record &b);
+// "CPU registers, RAM 80400000-80440000" and so on
+std::string DescribeRegions(u32 field, u32 mask);
+
+// Hashes recorded along with a movie, see Movie.cpp
+void ClearMovieHashes();
+bool LoadMovieHashes(const std::string &filename);
+bool SaveMovieHashes(const std::string &filename);
+
+}  // namespace
+
+#endif // _DESYNCCHECK_H_
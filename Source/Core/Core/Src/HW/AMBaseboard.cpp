@@ -2,6 +2,9 @@
 // Licensed under GPLv2
 // Refer to the license.txt file included.
 
+#include <deque>
+#include <vector>
+
 #include "Common.h" // Common
 #include "ChunkFile.h"
 #include "../ConfigManager.h"
@@ -11,6 +14,7 @@
 #include "DVDInterface.h"
 
 #include "AMBaseboard.h"
+#include "TriforceLink.h"
 
 namespace AMBaseboard
 {
@@ -24,6 +28,54 @@ static u32 m_controllertype;
 static unsigned char media_buffer[0x60];
 static unsigned char network_command_buffer[0x200];
 
+// Media board sockets, carried between cabinets by TriforceLink. Cabinets
+// are told apart by the IP they get with command 0x415, which every node
+// announces to the others. The command numbers and arguments follow what
+// is known of the media board firmware's socket API.
+enum
+{
+	MAX_SOCKETS = 16,
+	FIRST_EPHEMERAL_PORT = 0xC000,
+	// Where network_command_buffer is in the media board's address space
+	NETWORK_BUFFER_ADDRESS = 0x1F800200,
+};
+
+enum LinkMessageType
+{
+	LINK_HELLO,
+	LINK_CONNECT,
+	LINK_DATA,
+	LINK_CLOSE,
+};
+
+struct LinkMessage
+{
+	u8 type;
+	u8 pad;
+	u16 source_port;
+	u16 dest_port;
+	u16 pad2;
+	u32 ip;		// The sender's, for LINK_HELLO
+};
+
+struct Socket
+{
+	bool used;
+	bool listening;
+	bool closed;	// The other end is gone
+	u16 local_port;
+	u32 remote_ip;
+	u16 remote_port;
+	std::deque<u8> data;
+	// Pending LINK_CONNECTs for accept, IP and port
+	std::deque<std::pair<u32, u16> > connections;
+};
+
+static Socket s_sockets[MAX_SOCKETS];
+static u32 s_local_ip;
+static u32 s_node_ips[TriforceLink::MAX_NODES];
+static u16 s_next_port;
+
 static inline void PrintMBBuffer( u32 Address )
 {
 	NOTICE_LOG(DVDINTERFACE, "GC-AM: %08x %08x %08x %08x",	Memory::Read_U32(Address),
@@ -36,11 +88,391 @@ static inline void PrintMBBuffer( u32 Address )
 															Memory::Read_U32(Address+28) );
 }
 
+static void ResetSocket( Socket &socket )
+{
+	socket.used = false;
+	socket.listening = false;
+	socket.closed = false;
+	socket.local_port = 0;
+	socket.remote_ip = 0;
+	socket.remote_port = 0;
+	socket.data.clear();
+	socket.connections.clear();
+}
+
+static u32 GetArgument( int index )
+{
+	return *(u32*)(media_buffer + 0x24 + index * 4);
+}
+
+static void SetResult( s32 value )
+{
+	*(u32*)(media_buffer + 4) = (u32)value;
+}
+
+static Socket *GetSocket( u32 fd )
+{
+	if( fd < MAX_SOCKETS && s_sockets[fd].used )
+		return &s_sockets[fd];
+	return NULL;
+}
+
+// Buffers passed to the socket commands live in network_command_buffer
+static u8 *GetNetworkBuffer( u32 address, u32 size )
+{
+	u32 offset = address - NETWORK_BUFFER_ADDRESS;
+	if( offset >= sizeof(network_command_buffer) || size > sizeof(network_command_buffer) - offset )
+		return NULL;
+	return network_command_buffer + offset;
+}
+
+// sockaddr_in, port and address in network order at offsets 2 and 4
+static bool ReadSockAddr( u32 address, u32 &ip, u16 &port )
+{
+	const u8 *addr = GetNetworkBuffer( address, 8 );
+	if( !addr )
+		return false;
+	port = (addr[2] << 8) | addr[3];
+	ip = (addr[4] << 24) | (addr[5] << 16) | (addr[6] << 8) | addr[7];
+	return true;
+}
+
+static void WriteSockAddr( u32 address, u32 ip, u16 port )
+{
+	u8 *addr = GetNetworkBuffer( address, 8 );
+	if( !addr )
+		return;
+	addr[2] = port >> 8;
+	addr[3] = (u8)port;
+	addr[4] = ip >> 24;
+	addr[5] = (u8)(ip >> 16);
+	addr[6] = (u8)(ip >> 8);
+	addr[7] = (u8)ip;
+}
+
+static bool SendLinkMessage( u32 node, u8 type, u16 source_port, u16 dest_port, const u8 *data, u32 size )
+{
+	u8 packet[TriforceLink::MAX_PACKET_SIZE];
+	LinkMessage message = { type, 0, source_port, dest_port, 0, s_local_ip };
+	memcpy( packet, &message, sizeof(message) );
+	if( size )
+		memcpy( packet + sizeof(message), data, size );
+	return TriforceLink::Send( node, packet, sizeof(message) + size );
+}
+
+static int FindNode( u32 ip )
+{
+	for( u32 i = 0; i < TriforceLink::MAX_NODES; i++ )
+	{
+		if( ip != 0 && s_node_ips[i] == ip && i != TriforceLink::GetNode() )
+			return i;
+	}
+	return -1;
+}
+
+// Tells one node, or all of them, which IP this cabinet has
+static void Announce( int node )
+{
+	if( s_local_ip == 0 )
+		return;
+	for( u32 i = 0; i < TriforceLink::MAX_NODES; i++ )
+	{
+		if( (node < 0 || (u32)node == i) && i != TriforceLink::GetNode() )
+			SendLinkMessage( i, LINK_HELLO, 0, 0, NULL, 0 );
+	}
+}
+
+static void SetLocalIP( const char *ip )
+{
+	u32 a, b, c, d;
+	if( !TriforceLink::IsEnabled() || sscanf( ip, "%u.%u.%u.%u", &a, &b, &c, &d ) != 4 )
+		return;
+	s_local_ip = (a << 24) | (b << 16) | (c << 8) | d;
+	Announce( -1 );
+}
+
+// The connected socket for a packet, or an unconnected one bound to the port
+static Socket *FindSocket( u32 ip, u16 source_port, u16 dest_port )
+{
+	Socket *unconnected = NULL;
+	for( int i = 0; i < MAX_SOCKETS; i++ )
+	{
+		Socket &socket = s_sockets[i];
+		if( !socket.used || socket.listening || socket.local_port != dest_port )
+			continue;
+		if( socket.remote_ip == ip && socket.remote_port == source_port )
+			return &socket;
+		if( socket.remote_ip == 0 && !unconnected )
+			unconnected = &socket;
+	}
+	return unconnected;
+}
+
+static void PollLink( void )
+{
+	u32 node;
+	std::vector<u8> packet;
+	while( TriforceLink::Receive( node, packet ) )
+	{
+		if( packet.size() < sizeof(LinkMessage) )
+			continue;
+
+		LinkMessage message;
+		memcpy( &message, &packet[0], sizeof(message) );
+		const u32 ip = s_node_ips[node];
+
+		switch( message.type )
+		{
+		case LINK_HELLO:
+			if( s_node_ips[node] != message.ip )
+			{
+				NOTICE_LOG(DVDINTERFACE, "GC-AM: Cabinet %u is %u.%u.%u.%u", node,
+					message.ip >> 24, (message.ip >> 16) & 0xFF, (message.ip >> 8) & 0xFF, message.ip & 0xFF );
+				s_node_ips[node] = message.ip;
+				Announce( node );
+			}
+			break;
+
+		case LINK_CONNECT:
+		{
+			bool accepted = false;
+			for( int i = 0; i < MAX_SOCKETS && !accepted; i++ )
+			{
+				Socket &socket = s_sockets[i];
+				if( socket.used && socket.listening && socket.local_port == message.dest_port )
+				{
+					socket.connections.push_back( std::make_pair( ip, message.source_port ) );
+					accepted = true;
+				}
+			}
+			if( !accepted )
+				WARN_LOG(DVDINTERFACE, "GC-AM: Connection from cabinet %u to closed port %u", node, message.dest_port );
+			break;
+		}
+
+		case LINK_DATA:
+		{
+			Socket *socket = FindSocket( ip, message.source_port, message.dest_port );
+			if( socket )
+				socket->data.insert( socket->data.end(), packet.begin() + sizeof(message), packet.end() );
+			else
+				WARN_LOG(DVDINTERFACE, "GC-AM: Dropped %u bytes from cabinet %u to port %u",
+					(u32)(packet.size() - sizeof(message)), node, message.dest_port );
+			break;
+		}
+
+		case LINK_CLOSE:
+		{
+			Socket *socket = FindSocket( ip, message.source_port, message.dest_port );
+			if( socket && socket->remote_ip == ip )
+				socket->closed = true;
+			break;
+		}
+		}
+	}
+}
+
+// Returns false for the commands that aren't socket operations
+static bool ExecuteSocketCommand( u16 command )
+{
+	PollLink();
+
+	switch( command )
+	{
+	// accept(fd, addr, addrlen)
+	case 0x401:
+	{
+		Socket *socket = GetSocket( GetArgument(0) );
+		int fd = -1;
+		if( socket && socket->listening && !socket->connections.empty() )
+		{
+			for( int i = 0; i < MAX_SOCKETS; i++ )
+			{
+				if( !s_sockets[i].used )
+				{
+					fd = i;
+					break;
+				}
+			}
+		}
+		if( fd >= 0 )
+		{
+			Socket &accepted = s_sockets[fd];
+			ResetSocket( accepted );
+			accepted.used = true;
+			accepted.local_port = socket->local_port;
+			accepted.remote_ip = socket->connections.front().first;
+			accepted.remote_port = socket->connections.front().second;
+			socket->connections.pop_front();
+			WriteSockAddr( GetArgument(1), accepted.remote_ip, accepted.remote_port );
+		}
+		SetResult( fd );
+		break;
+	}
+	// bind(fd, addr, addrlen)
+	case 0x402:
+	{
+		Socket *socket = GetSocket( GetArgument(0) );
+		u32 ip;
+		u16 port;
+		if( socket && ReadSockAddr( GetArgument(1), ip, port ) )
+		{
+			socket->local_port = port;
+			SetResult( 0 );
+		}
+		else
+		{
+			SetResult( -1 );
+		}
+		break;
+	}
+	// closesocket(fd)
+	case 0x403:
+	{
+		Socket *socket = GetSocket( GetArgument(0) );
+		if( socket )
+		{
+			int node = FindNode( socket->remote_ip );
+			if( node >= 0 && !socket->closed )
+				SendLinkMessage( node, LINK_CLOSE, socket->local_port, socket->remote_port, NULL, 0 );
+			ResetSocket( *socket );
+		}
+		SetResult( socket ? 0 : -1 );
+		break;
+	}
+	// connect(fd, addr, addrlen)
+	case 0x404:
+	{
+		Socket *socket = GetSocket( GetArgument(0) );
+		u32 ip;
+		u16 port;
+		int node = -1;
+		if( socket && ReadSockAddr( GetArgument(1), ip, port ) )
+			node = FindNode( ip );
+		if( node >= 0 )
+		{
+			if( socket->local_port == 0 )
+				socket->local_port = FIRST_EPHEMERAL_PORT + (s_next_port++ & 0x3FFF);
+			socket->remote_ip = ip;
+			socket->remote_port = port;
+			socket->closed = false;
+		}
+		if( node >= 0 && SendLinkMessage( node, LINK_CONNECT, socket->local_port, port, NULL, 0 ) )
+			SetResult( 0 );
+		else
+			SetResult( -1 );
+		break;
+	}
+	// listen(fd, backlog)
+	case 0x408:
+	{
+		Socket *socket = GetSocket( GetArgument(0) );
+		if( socket && socket->local_port != 0 )
+			socket->listening = true;
+		SetResult( (socket && socket->listening) ? 0 : -1 );
+		break;
+	}
+	// recv(fd, buf, len)
+	case 0x409:
+	{
+		Socket *socket = GetSocket( GetArgument(0) );
+		u32 length = GetArgument(2);
+		u8 *buffer = GetNetworkBuffer( GetArgument(1), length );
+		if( !socket || !buffer )
+		{
+			SetResult( -1 );
+		}
+		else if( socket->data.empty() )
+		{
+			// Nothing yet, or end of stream
+			SetResult( socket->closed ? 0 : -1 );
+		}
+		else
+		{
+			length = std::min<u32>( length, (u32)socket->data.size() );
+			std::copy( socket->data.begin(), socket->data.begin() + length, buffer );
+			socket->data.erase( socket->data.begin(), socket->data.begin() + length );
+			SetResult( length );
+		}
+		break;
+	}
+	// send(fd, buf, len)
+	case 0x40A:
+	{
+		Socket *socket = GetSocket( GetArgument(0) );
+		u32 length = GetArgument(2);
+		const u8 *buffer = GetNetworkBuffer( GetArgument(1), length );
+		int node = socket ? FindNode( socket->remote_ip ) : -1;
+		if( !buffer || node < 0 || socket->closed )
+		{
+			SetResult( -1 );
+			break;
+		}
+
+		const u32 max_size = TriforceLink::GetMaxPayload() - sizeof(LinkMessage);
+		u32 sent = 0;
+		while( sent < length )
+		{
+			u32 size = std::min( length - sent, max_size );
+			if( !SendLinkMessage( node, LINK_DATA, socket->local_port, socket->remote_port, buffer + sent, size ) )
+				break;
+			sent += size;
+		}
+		SetResult( (sent || !length) ? (s32)sent : -1 );
+		break;
+	}
+	// socket(domain, type, protocol)
+	case 0x40B:
+	{
+		int fd = -1;
+		for( int i = 0; i < MAX_SOCKETS; i++ )
+		{
+			if( !s_sockets[i].used )
+			{
+				ResetSocket( s_sockets[i] );
+				s_sockets[i].used = true;
+				fd = i;
+				break;
+			}
+		}
+		SetResult( fd );
+		break;
+	}
+	// select(nfds, readfds, writefds, exceptfds, timeout). The sets are left
+	// alone, the result is how many sockets have something to read.
+	case 0x40C:
+	{
+		s32 ready = 0;
+		for( int i = 0; i < MAX_SOCKETS; i++ )
+		{
+			const Socket &socket = s_sockets[i];
+			if( socket.used && (!socket.data.empty() || !socket.connections.empty() || socket.closed) )
+				ready++;
+		}
+		SetResult( ready );
+		break;
+	}
+	default:
+		return false;
+	}
+
+	DEBUG_LOG(DVDINTERFACE, "GC-AM: Socket command %03x (%08x %08x %08x) = %d",
+		command, GetArgument(0), GetArgument(1), GetArgument(2), *(s32*)(media_buffer + 4) );
+	return true;
+}
+
 void Init( void )
 {
 	u32 gameid;
 	memset( media_buffer, 0, sizeof(media_buffer) );
 
+	for( int i = 0; i < MAX_SOCKETS; i++ )
+		ResetSocket( s_sockets[i] );
+	memset( s_node_ips, 0, sizeof(s_node_ips) );
+	s_local_ip = 0;
+	s_next_port = 0;
+	TriforceLink::Init();
+
 	//Convert game ID into hex
 	sscanf( SConfig::GetInstance().m_LocalCoreStartupParameter.GetUniqueID().c_str(), "%s", &gameid );
 
@@ -308,6 +740,12 @@ u32 ExecuteCommand( u32 Command, u32 Length, u32 Address, u32 Offset )
 				
 				NOTICE_LOG(DVDINTERFACE, "GCAM: Execute command:%03X", *(u16*)(media_buffer+0x22) );
 
+				if( TriforceLink::IsEnabled() && ExecuteSocketCommand( *(u16*)(media_buffer+0x22) ) )
+				{
+					memset( media_buffer + 0x20, 0, 0x20 );
+					return 0x66556677;
+				}
+
 				switch(*(u16*)(media_buffer+0x22))
 				{
 					// ?
@@ -455,6 +893,8 @@ u32 ExecuteCommand( u32 Command, u32 Length, u32 Address, u32 Offset )
 
 						u32 offset = *(u32*)(media_buffer+0x28) - 0x1F800200;						
 						NOTICE_LOG(DVDINTERFACE, "GC-AM: Set IP:%s", (char*)(network_command_buffer+offset) );
+						if( offset < sizeof(network_command_buffer) )
+							SetLocalIP( (char*)(network_command_buffer+offset) );
 						break;
 					}
 					case 0x601:
@@ -501,6 +941,7 @@ u32 GetControllerType( void )
 }
 void Shutdown( void )
 {
+	TriforceLink::Shutdown();
 	m_netcfg->Close();
 	m_netctrl->Close();
 	m_dimm->Close();
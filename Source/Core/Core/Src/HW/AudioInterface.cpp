@@ -51,6 +51,7 @@ This file mainly deals with the [Drive I/F], however [AIDFR] controls
 */
 
 #include "Common.h"
+#include "Thread.h"
 
 #include "StreamADPCM.h"
 #include "AudioInterface.h"
@@ -144,10 +145,118 @@ void DoState(PointerWrap &p)
 static void GenerateAudioInterrupt();
 static void UpdateInterrupts();
 static void IncreaseSampleCount(const u32 _uAmount);
-void ReadStreamBlock(s16* _pPCM);
+static void ReadStreamBlock(s16* _pPCM);
 u64 GetAIPeriod();
 int et_AI;
 
+// Disc streaming read-ahead
+// A worker thread reads the streamed region ahead of playback and decodes it
+// into a ring of PCM blocks; the audio thread only copies and resamples.
+// Blocks are tagged with the DVDInterface stream epoch they were read under,
+// a new epoch (stream start/stop, savestate load) drops the ring.
+enum
+{
+	STREAM_RING_BLOCKS = 64, // ~37ms of audio at 48KHz
+};
+
+struct StreamBlock
+{
+	s16 pcm[NGCADPCM::SAMPLES_PER_BLOCK * 2];
+	bool looped;
+};
+
+static StreamBlock s_stream_ring[STREAM_RING_BLOCKS];
+static u32 s_stream_read = 0;
+static u32 s_stream_count = 0;
+static u32 s_stream_epoch = 0;
+static bool s_stream_epoch_valid = false;
+static bool s_stream_changed = false;
+static bool s_stream_running = false;
+static std::mutex s_stream_lock;
+static std::condition_variable s_stream_cond;
+static std::thread s_stream_thread;
+
+static void StreamingThread()
+{
+	Common::SetCurrentThreadName("DTK Streaming");
+
+	u8 adpcm[NGCADPCM::ONE_BLOCK_SIZE];
+	StreamBlock block;
+
+	std::unique_lock<std::mutex> lk(s_stream_lock);
+	while (true)
+	{
+		s_stream_cond.wait(lk, [] {
+			return !s_stream_running || s_stream_changed || s_stream_count < STREAM_RING_BLOCKS;
+		});
+		if (!s_stream_running)
+			break;
+		s_stream_changed = false;
+
+		lk.unlock();
+
+		u32 epoch;
+		bool streaming = DVDInterface::DVDReadADPCM(adpcm, NGCADPCM::ONE_BLOCK_SIZE, &epoch, &block.looped);
+
+		lk.lock();
+
+		if (!s_stream_epoch_valid || epoch != s_stream_epoch)
+		{
+			// The position moved under us, everything read ahead is stale
+			s_stream_epoch = epoch;
+			s_stream_epoch_valid = true;
+			s_stream_read = 0;
+			s_stream_count = 0;
+			NGCADPCM::InitFilter();
+		}
+
+		if (block.looped)
+			NGCADPCM::InitFilter();
+
+		if (streaming)
+			NGCADPCM::DecodeBlock(block.pcm, adpcm);
+		else
+			memset(block.pcm, 0, sizeof(block.pcm));
+
+		if (s_stream_count < STREAM_RING_BLOCKS)
+		{
+			s_stream_ring[(s_stream_read + s_stream_count) % STREAM_RING_BLOCKS] = block;
+			s_stream_count++;
+		}
+	}
+}
+
+static void StartStreamingThread()
+{
+	std::lock_guard<std::mutex> lk(s_stream_lock);
+	s_stream_read = 0;
+	s_stream_count = 0;
+	s_stream_epoch_valid = false;
+	s_stream_changed = false;
+	s_stream_running = true;
+	s_stream_thread = std::thread(StreamingThread);
+}
+
+static void StopStreamingThread()
+{
+	{
+		std::lock_guard<std::mutex> lk(s_stream_lock);
+		s_stream_running = false;
+	}
+	s_stream_cond.notify_one();
+	if (s_stream_thread.joinable())
+		s_stream_thread.join();
+}
+
+void NotifyStreamChanged()
+{
+	{
+		std::lock_guard<std::mutex> lk(s_stream_lock);
+		s_stream_changed = true;
+	}
+	s_stream_cond.notify_one();
+}
+
 void Init()
 {
 	m_Control.hex = 0;
@@ -163,10 +272,13 @@ void Init()
 	g_AIDSampleRate = 32000;
 
 	et_AI = CoreTiming::RegisterEvent("AICallback", Update);
+
+	StartStreamingThread();
 }
 
 void Shutdown()
 {
+	StopStreamingThread();
 }
 
 void Read32(u32& _rReturnValue, const u32 _Address)
@@ -421,17 +533,29 @@ unsigned int Callback_GetStreaming(short* _pDestBuffer, unsigned int _numSamples
 }
 
 // WARNING - called from audio thread
-void ReadStreamBlock(s16 *_pPCM)
+// Takes the next decoded block from the read-ahead ring, silence on underrun.
+static void ReadStreamBlock(s16 *_pPCM)
 {
-	u8 tempADPCM[NGCADPCM::ONE_BLOCK_SIZE];
-	if (DVDInterface::DVDReadADPCM(tempADPCM, NGCADPCM::ONE_BLOCK_SIZE))
-	{
-		NGCADPCM::DecodeBlock(_pPCM, tempADPCM);
-	}
-	else
+	bool looped = false;
 	{
-		memset(_pPCM, 0, NGCADPCM::SAMPLES_PER_BLOCK*2);
+		std::lock_guard<std::mutex> lk(s_stream_lock);
+		if (s_stream_count != 0)
+		{
+			const StreamBlock& block = s_stream_ring[s_stream_read];
+			memcpy(_pPCM, block.pcm, sizeof(block.pcm));
+			looped = block.looped;
+			s_stream_read = (s_stream_read + 1) % STREAM_RING_BLOCKS;
+			s_stream_count--;
+		}
+		else
+		{
+			memset(_pPCM, 0, NGCADPCM::SAMPLES_PER_BLOCK * 2 * sizeof(s16));
+		}
 	}
+	s_stream_cond.notify_one();
+
+	if (looped)
+		GenerateAISInterrupt();
 
 	// our whole streaming code is "faked" ... so it shouldn't increase the sample counter
 	// streaming will never work correctly this way, but at least the program will think all is alright.
@@ -32,6 +32,10 @@ unsigned int GetAIDSampleRate();
 
 void GenerateAISInterrupt();
 
+// Called by DVDInterface after it moved the stream position, so the
+// streaming reader throws away what it has read ahead.
+void NotifyStreamChanged();
+
 }  // namespace
 
 #endif
@@ -16,10 +16,12 @@
 // http://code.google.com/p/dolphin-emu/
 
 #include "StringUtil.h"
+#include "Thread.h"
 #include "../EXI_Device.h"
 #include "../EXI_DeviceEthernet.h"
 
 #ifdef __linux__
+#include <errno.h>
 #include <fcntl.h>
 #include <linux/if_tun.h>
 #include <net/if.h>
@@ -62,6 +64,7 @@ bool CEXIETHERNET::Activate()
 		return false;
 	}
 	ioctl(fd, TUNSETNOCSUM, 1);
+	fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
 
 	readEnabled = false;
 
@@ -121,6 +124,8 @@ bool CEXIETHERNET::SendFrame(u8* frame, u32 size)
 
 void ReadThreadHandler(CEXIETHERNET* self)
 {
+	u8 discard[BBA_RECV_SIZE];
+
 	while (true)
 	{
 		if (self->fd < 0)
@@ -136,17 +141,42 @@ void ReadThreadHandler(CEXIETHERNET* self)
 		if (select(self->fd + 1, &rfds, NULL, NULL, &timeout) <= 0)
 			continue;
 
-		int readBytes = read(self->fd, self->mRecvBuffer, BBA_RECV_SIZE);
-		if (readBytes < 0)
-		{
-			ERROR_LOG(SP1, "Failed to read from BBA, err=%d", readBytes);
-		}
-		else if (self->readEnabled)
+		// The tap hands out one frame per read. Take everything that is
+		// queued straight into the ring and wake the CPU thread once.
+		u32 frames = 0;
+		while (true)
 		{
-			INFO_LOG(SP1, "Read data: %s", ArrayToString(self->mRecvBuffer, readBytes, 0x10).c_str());
-			self->mRecvBufferLength = readBytes;
-			self->RecvHandlePacket();
+			u8 *buffer = discard;
+			if (self->readEnabled)
+			{
+				buffer = self->mRecvRing.GetWriteBuffer();
+				if (!buffer)
+				{
+					// Leave the rest in the kernel queue until the CPU
+					// thread caught up
+					self->RecvNotify();
+					Common::SleepCurrentThread(1);
+					break;
+				}
+			}
+
+			int readBytes = read(self->fd, buffer, BBA_RECV_SIZE);
+			if (readBytes < 0)
+			{
+				if (errno != EAGAIN && errno != EWOULDBLOCK)
+					ERROR_LOG(SP1, "Failed to read from BBA, err=%d", errno);
+				break;
+			}
+
+			if (buffer != discard)
+			{
+				self->mRecvRing.Push(readBytes);
+				frames++;
+			}
 		}
+
+		if (frames)
+			self->RecvNotify();
 	}
 }
 
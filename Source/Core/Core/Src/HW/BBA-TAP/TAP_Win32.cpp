@@ -277,7 +277,9 @@ VOID CALLBACK CEXIETHERNET::ReadWaitCallback(PVOID lpParameter, BOOLEAN TimerFir
 	GetOverlappedResult(self->mHAdapter, &self->mReadOverlapped,
 		(LPDWORD)&self->mRecvBufferLength, false);
 
-	self->RecvHandlePacket();
+	self->RecvQueue(self->mRecvBuffer, self->mRecvBufferLength);
+	if (self->mBbaMem[BBA_NCRA] & NCRA_SR)
+		self->RecvStart();
 }
 
 bool CEXIETHERNET::RecvInit()
@@ -320,7 +322,9 @@ bool CEXIETHERNET::RecvStart()
 	if (res)
 	{
 		// Completed immediately
-		RecvHandlePacket();
+		RecvQueue(mRecvBuffer, mRecvBufferLength);
+		if (mBbaMem[BBA_NCRA] & NCRA_SR)
+			RecvStart();
 	}
 
 	return true;
@@ -35,6 +35,7 @@
 #include "../PowerPC/PowerPC.h"
 #include "../ConfigManager.h"
 #include "../DSPEmulator.h"
+#include "../Replay.h"
 
 namespace DSP
 {
@@ -671,6 +672,7 @@ void UpdateAudioDMA()
 
 		if (g_audioDMA.BlocksLeft == 0)
 		{
+			Replay::AudioDMA(g_audioDMA.SourceAddress, 32*g_audioDMA.AudioDMAControl.NumBlocks);
 			dsp_emulator->DSP_SendAIBuffer(g_audioDMA.SourceAddress, 8*g_audioDMA.AudioDMAControl.NumBlocks);
 			GenerateDSPInterrupt(DSP::INT_AID);
 			g_audioDMA.BlocksLeft = g_audioDMA.AudioDMAControl.NumBlocks;
@@ -16,7 +16,9 @@
 #include "Common.h"
 #include "UCode_AXStructs.h"
 #include "../../DSP.h"
+#include "DSP/DSPAccelerator.h"
 
+#include <algorithm>
 #include <functional>
 
 #ifdef AX_GC
@@ -141,112 +143,83 @@ void AcceleratorSetup(PB_TYPE* pb, u32* cur_addr)
 	acc_end_reached = false;
 }
 
-// Reads a sample from the simulated accelerator. Also handles looping and
-// disabling streams that reached the end (this is done by an exception raised
-// by the accelerator on real hardware).
-u16 AcceleratorGetSample()
+// Reads <count> samples from the simulated accelerator. Also handles looping
+// and disabling streams that reached the end (this is done by an exception
+// raised by the accelerator on real hardware).
+void AcceleratorGetSamples(s16* samples, u32 count)
 {
-	u16 ret;
-
-	// Have we reached the end address?
-	//
-	// On real hardware, this would raise an interrupt that is handled by the
-	// UCode. We simulate what this interrupt does here.
-	if ((*acc_cur_addr & ~1) == (acc_end_addr & ~1))
+	u32 decoded = 0;
+	while (decoded < count)
 	{
-		// loop back to loop_addr.
-		*acc_cur_addr = acc_loop_addr;
-
-		if (acc_pb->audio_addr.looping)
+		// Have we reached the end address?
+		//
+		// On real hardware, this would raise an interrupt that is handled by the
+		// UCode. We simulate what this interrupt does here.
+		if (AcceleratorAtEnd(*acc_cur_addr, acc_end_addr))
 		{
-			// Set the ADPCM infos to continue processing at loop_addr.
-			//
-			// For some reason, yn1 and yn2 aren't set if the voice is not of
-			// stream type. This is what the AX UCode does and I don't really
-			// know why.
-			acc_pb->adpcm.pred_scale = acc_pb->adpcm_loop_info.pred_scale;
-			if (!acc_pb->is_stream)
+			// loop back to loop_addr.
+			*acc_cur_addr = acc_loop_addr;
+
+			if (acc_pb->audio_addr.looping)
 			{
-				acc_pb->adpcm.yn1 = acc_pb->adpcm_loop_info.yn1;
-				acc_pb->adpcm.yn2 = acc_pb->adpcm_loop_info.yn2;
+				// Set the ADPCM infos to continue processing at loop_addr.
+				//
+				// For some reason, yn1 and yn2 aren't set if the voice is not of
+				// stream type. This is what the AX UCode does and I don't really
+				// know why.
+				acc_pb->adpcm.pred_scale = acc_pb->adpcm_loop_info.pred_scale;
+				if (!acc_pb->is_stream)
+				{
+					acc_pb->adpcm.yn1 = acc_pb->adpcm_loop_info.yn1;
+					acc_pb->adpcm.yn2 = acc_pb->adpcm_loop_info.yn2;
+				}
 			}
-		}
-		else
-		{
-			// Non looping voice reached the end -> running = 0.
-			acc_pb->running = 0;
+			else
+			{
+				// Non looping voice reached the end -> running = 0.
+				acc_pb->running = 0;
 
 #ifdef AX_WII
-			// One of the few meaningful differences between AXGC and AXWii:
-			// while AXGC handles non looping voices ending by having 0000
-			// samples at the loop address, AXWii has the 0000 samples
-			// internally in DRAM and use an internal pointer to it (loop addr
-			// does not contain 0000 samples on AXWii!).
-			acc_end_reached = true;
+				// One of the few meaningful differences between AXGC and AXWii:
+				// while AXGC handles non looping voices ending by having 0000
+				// samples at the loop address, AXWii has the 0000 samples
+				// internally in DRAM and use an internal pointer to it (loop addr
+				// does not contain 0000 samples on AXWii!).
+				acc_end_reached = true;
 #endif
-		}
-	}
-
-	// See above for explanations about acc_end_reached.
-	if (acc_end_reached)
-		return 0;
-
-	switch (acc_pb->audio_addr.sample_format)
-	{
-		case 0x00:	// ADPCM
-		{
-			// ADPCM decoding, not much to explain here.
-			if ((*acc_cur_addr & 15) == 0)
-			{
-				acc_pb->adpcm.pred_scale = DSP::ReadARAM((*acc_cur_addr & ~15) >> 1);
-				*acc_cur_addr += 2;
 			}
-
-			int scale = 1 << (acc_pb->adpcm.pred_scale & 0xF);
-			int coef_idx = (acc_pb->adpcm.pred_scale >> 4) & 0x7;
-
-			s32 coef1 = acc_pb->adpcm.coefs[coef_idx * 2 + 0];
-			s32 coef2 = acc_pb->adpcm.coefs[coef_idx * 2 + 1];
-
-			int temp = (*acc_cur_addr & 1) ?
-					(DSP::ReadARAM(*acc_cur_addr >> 1) & 0xF) :
-					(DSP::ReadARAM(*acc_cur_addr >> 1) >> 4);
-
-			if (temp >= 8)
-				temp -= 16;
-
-			int val = (scale * temp) + ((0x400 + coef1 * acc_pb->adpcm.yn1 + coef2 * acc_pb->adpcm.yn2) >> 11);
-
-			if (val > 0x7FFF) val = 0x7FFF;
-			else if (val < -0x7FFF) val = -0x7FFF;
-
-			acc_pb->adpcm.yn2 = acc_pb->adpcm.yn1;
-			acc_pb->adpcm.yn1 = val;
-			*acc_cur_addr += 1;
-			ret = val;
-			break;
 		}
 
-		case 0x0A:	// 16-bit PCM audio
-			ret = (DSP::ReadARAM(*acc_cur_addr * 2) << 8) | DSP::ReadARAM(*acc_cur_addr * 2 + 1);
-			acc_pb->adpcm.yn2 = acc_pb->adpcm.yn1;
-			acc_pb->adpcm.yn1 = ret;
-			*acc_cur_addr += 1;
+		// See above for explanations about acc_end_reached.
+		if (acc_end_reached)
 			break;
 
-		case 0x19:	// 8-bit PCM audio
-			ret = DSP::ReadARAM(*acc_cur_addr) << 8;
-			acc_pb->adpcm.yn2 = acc_pb->adpcm.yn1;
-			acc_pb->adpcm.yn1 = ret;
-			*acc_cur_addr += 1;
+		if (!AcceleratorIsFormatSupported(acc_pb->audio_addr.sample_format))
+		{
+			ERROR_LOG(DSPHLE, "Unknown sample format: %d", acc_pb->audio_addr.sample_format);
 			break;
+		}
 
-		default:
-			ERROR_LOG(DSPHLE, "Unknown sample format: %d", acc_pb->audio_addr.sample_format);
-			return 0;
+		AcceleratorState state;
+		state.cur_addr = *acc_cur_addr;
+		state.end_addr = acc_end_addr;
+		state.format = acc_pb->audio_addr.sample_format;
+		state.pred_scale = acc_pb->adpcm.pred_scale;
+		state.yn1 = acc_pb->adpcm.yn1;
+		state.yn2 = acc_pb->adpcm.yn2;
+		state.coefs = acc_pb->adpcm.coefs;
+
+		// Decodes up to the end address at most, the loop is handled above.
+		decoded += AcceleratorDecodeSamples(state, samples + decoded, count - decoded, DSP::ReadARAM);
+
+		*acc_cur_addr = state.cur_addr;
+		acc_pb->adpcm.pred_scale = state.pred_scale;
+		acc_pb->adpcm.yn1 = state.yn1;
+		acc_pb->adpcm.yn2 = state.yn2;
 	}
 
-	return ret;
+	for (; decoded < count; ++decoded)
+		samples[decoded] = 0;
 }
 
 // Reads samples from the input callback, resamples them to <count> samples at
@@ -394,9 +367,24 @@ void GetInputSamples(PB_TYPE& pb, s16* samples, u16 count, const s16* coeffs)
 
 	if (coeffs)
 		coeffs += pb.coef_select * 0x200;
-	u32 curr_pos = ResampleAudio([](u32) { return AcceleratorGetSample(); },
+
+	// The resampler pulls samples one at a time; hand them out from a buffer
+	// that is decoded in blocks. As many samples as the resampler should
+	// consume are decoded in blocks, so the PB ends up in the same state.
+	u32 ratio = HILO_TO_32(pb.src.ratio);
+	u32 needed = count;
+	if (pb.src_type == SRCTYPE_LINEAR || pb.src_type == SRCTYPE_POLYPHASE)
+		needed = (u32)((pb.src.cur_addr_frac + (u64)ratio * count) >> 16);
+
+	s16 input[MAX_SAMPLES_PER_FRAME * 4];
+	AcceleratorSampleReader<void (*)(s16*, u32)> reader(input, ArraySize(input), needed, AcceleratorGetSamples);
+	auto input_callback = [&](u32) -> s16 {
+		return reader.Next();
+	};
+
+	u32 curr_pos = ResampleAudio(input_callback,
 	                             samples, count, pb.src.last_samples,
-	                             pb.src.cur_addr_frac, HILO_TO_32(pb.src.ratio),
+	                             pb.src.cur_addr_frac, ratio,
 	                             pb.src_type, coeffs);
 	pb.src.cur_addr_frac = (curr_pos & 0xFFFF);
 
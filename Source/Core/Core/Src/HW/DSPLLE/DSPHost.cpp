@@ -88,10 +88,34 @@ void DSPHost_CodeLoaded(const u8 *ptr, int size)
 
 	DSPHost_UpdateDebugger();
 
-	if (dspjit)
-		dspjit->ClearIRAM();
+	// Keep the old analysis around so blocks outside the loaded range whose
+	// flags changed (e.g. a loop end set by a new BLOOP) get recompiled too.
+	u8 old_flags[DSP_IRAM_SIZE];
+	memcpy(old_flags, DSPAnalyzer::code_flags, sizeof(old_flags));
 
 	DSPAnalyzer::Analyze();
+
+	if (dspjit)
+	{
+		u16 start = (u16)((ptr - (const u8*)g_dsp.iram) / 2);
+		dspjit->ClearIRAMRange(start, (u16)(size / 2));
+
+		// One clear per run of changed flags, each clear walks the blocks
+		for (u16 i = 0; i < DSP_IRAM_SIZE; )
+		{
+			if (old_flags[i] == DSPAnalyzer::code_flags[i])
+			{
+				i++;
+				continue;
+			}
+
+			u16 end = i + 1;
+			while (end < DSP_IRAM_SIZE && old_flags[end] != DSPAnalyzer::code_flags[end])
+				end++;
+			dspjit->ClearIRAMRange(i, end - i);
+			i = end;
+		}
+	}
 }
 
 void DSPHost_UpdateDebugger()
@@ -13,6 +13,7 @@
 #include "DSP/DSPCore.h"
 #include "DSPSymbols.h"
 #include "DSP/disassemble.h"
+#include "DSP/LabelMap.h"
 
 namespace DSPSymbols {
 
@@ -276,6 +277,13 @@ void AutoDisassembly(u16 start_addr, u16 end_addr)
 	}
 }
 
+void FillLabelMap(LabelMap &labels)
+{
+	const SymbolDB::XFuncMap &symbols = g_dsp_symbol_db.Symbols();
+	for (SymbolDB::XFuncMap::const_iterator iter = symbols.begin(); iter != symbols.end(); ++iter)
+		labels.RegisterLabel(iter->second.name, (u16)iter->first, LABEL_IADDR);
+}
+
 void Clear()
 {
 	addr_to_line.clear();
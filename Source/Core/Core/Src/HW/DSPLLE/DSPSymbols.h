@@ -8,6 +8,8 @@
 #include "Common.h"
 #include "SymbolDB.h"
 
+class LabelMap;
+
 namespace DSPSymbols {
 
 class DSPSymbolDB : public SymbolDB 
@@ -25,6 +27,9 @@ extern DSPSymbolDB g_dsp_symbol_db;
 bool ReadAnnotatedAssembly(const char *filename);
 void AutoDisassembly(u16 start_addr, u16 end_addr);
 
+// Registers every known function as a LABEL_IADDR label.
+void FillLabelMap(LabelMap &labels);
+
 void Clear();
 
 int Addr2Line(u16 address);
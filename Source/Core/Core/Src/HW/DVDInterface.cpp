@@ -8,7 +8,6 @@
 #include "../CoreTiming.h"
 #include "../HW/SystemTimers.h"
 
-#include "StreamADPCM.h" // Core
 #include "DVDInterface.h"
 #include "../PowerPC/PowerPC.h"
 #include "ProcessorInterface.h"
@@ -195,6 +194,9 @@ static u32			AudioPos;
 static u32			CurrentStart;
 static u32			LoopLength;
 static u32			CurrentLength;
+// Bumped whenever the stream position is changed from outside the
+// streaming reader, so it can drop what it has already read ahead.
+static u32			StreamEpoch;
 
 u32	 g_ErrorCode = 0;
 bool g_bDiscInside = false;
@@ -237,6 +239,15 @@ void DoState(PointerWrap &p)
 
 	p.Do(CurrentStart);
 	p.Do(CurrentLength);
+
+	if (p.GetMode() == PointerWrap::MODE_READ)
+	{
+		{
+			std::lock_guard<std::mutex> lk(dvdread_section);
+			StreamEpoch++;
+		}
+		AudioInterface::NotifyStreamChanged();
+	}
 }
 
 void TransferComplete(u64 userdata, int cyclesLate)
@@ -264,6 +275,7 @@ void Init()
 	LoopLength = 0;
 	CurrentStart = 0;
 	CurrentLength = 0;
+	StreamEpoch = 0;
 
 	g_GCAM = ((SConfig::GetInstance().m_SIDevice[0] == SIDEVICE_AM_BASEBOARD)
 	&& (SConfig::GetInstance().m_EXIDevice[2] == EXIDEVICE_AM_BASEBOARD))
@@ -373,17 +385,22 @@ bool DVDRead(u32 _iDVDOffset, u32 _iRamAddress, u32 _iLength)
 	return VolumeHandler::ReadToPtr(Memory::GetPointer(_iRamAddress), _iDVDOffset, _iLength);
 }
 
-bool DVDReadADPCM(u8* _pDestBuffer, u32 _iNumSamples)
+bool DVDReadADPCM(u8* _pDestBuffer, u32 _iNumSamples, u32* _pEpoch, bool* _pLooped)
 {
 	_iNumSamples &= ~31;
 
+	// Position and data are read under the same lock, so the epoch handed
+	// back always matches the position the block was read from.
+	std::lock_guard<std::mutex> lk(dvdread_section);
+	*_pEpoch = StreamEpoch;
+	*_pLooped = false;
+
 	if (AudioPos == 0)
 	{
 		memset(_pDestBuffer, 0, _iNumSamples); // probably __AI_SRC_INIT :P
 	}
 	else
 	{
-		std::lock_guard<std::mutex> lk(dvdread_section);
 		VolumeHandler::ReadToPtr(_pDestBuffer, AudioPos, _iNumSamples);
 	}
 
@@ -406,8 +423,9 @@ bool DVDReadADPCM(u8* _pDestBuffer, u32 _iNumSamples)
 				CurrentStart = LoopStart;
 				CurrentLength = LoopLength;
 			}
-			NGCADPCM::InitFilter();
-			AudioInterface::GenerateAISInterrupt();
+			// The caller resets the decoder and raises the AIS interrupt
+			// once playback actually reaches this block.
+			*_pLooped = true;
 		}
 
 		//WARN_LOG(DVDINTERFACE,"ReadADPCM");
@@ -684,29 +702,36 @@ void ExecuteCommand(UDICR& _DICR)
 			u32 pos = m_DICMDBUF[1].Hex << 2;
 			u32 length = m_DICMDBUF[2].Hex;
 
-			// Start playing
-			if (!g_bStream && m_DICMDBUF[0].CMDBYTE1 == 0 && pos != 0 && length != 0)
 			{
-				AudioPos = pos;
-				CurrentStart = pos;
-				CurrentLength = length;
-				NGCADPCM::InitFilter();
-				g_bStream = true;
-			}
+				std::lock_guard<std::mutex> lk(dvdread_section);
+
+				// Start playing
+				if (!g_bStream && m_DICMDBUF[0].CMDBYTE1 == 0 && pos != 0 && length != 0)
+				{
+					AudioPos = pos;
+					CurrentStart = pos;
+					CurrentLength = length;
+					g_bStream = true;
+				}
 
-			LoopStart = pos;
-			LoopLength = length;
-			g_bStream = (m_DICMDBUF[0].CMDBYTE1 == 0); // This command can start/stop the stream
+				LoopStart = pos;
+				LoopLength = length;
+				g_bStream = (m_DICMDBUF[0].CMDBYTE1 == 0); // This command can start/stop the stream
 
-			// Stop stream
-			if (m_DICMDBUF[0].CMDBYTE1 == 1)
-			{
-				AudioPos = 0;
-				LoopStart = 0;
-				LoopLength = 0;
-				CurrentStart = 0;
-				CurrentLength = 0;
+				// Stop stream
+				if (m_DICMDBUF[0].CMDBYTE1 == 1)
+				{
+					AudioPos = 0;
+					LoopStart = 0;
+					LoopLength = 0;
+					CurrentStart = 0;
+					CurrentLength = 0;
+				}
+
+				StreamEpoch++;
 			}
+			// The streaming reader resets the ADPCM filter when it sees the new epoch
+			AudioInterface::NotifyStreamChanged();
 
 			WARN_LOG(DVDINTERFACE, "(Audio) Stream subcmd = %08x offset = %08x length=%08x",
 				m_DICMDBUF[0].Hex, m_DICMDBUF[1].Hex << 2, m_DICMDBUF[2].Hex);
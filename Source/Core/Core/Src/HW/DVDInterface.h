@@ -31,8 +31,9 @@ void ClearCoverInterrupt();
 
 // DVD Access Functions
 bool DVDRead(u32 _iDVDOffset, u32 _iRamAddress, u32 _iLength);
-// For AudioInterface
-bool DVDReadADPCM(u8* _pDestBuffer, u32 _iNumSamples);
+// For AudioInterface. _pEpoch receives the stream epoch the block was read
+// under, _pLooped is set when the read reached the end of the stream.
+bool DVDReadADPCM(u8* _pDestBuffer, u32 _iNumSamples, u32* _pEpoch, bool* _pLooped);
 extern bool g_bStream;
 
 // Read32
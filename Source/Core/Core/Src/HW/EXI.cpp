@@ -19,6 +19,7 @@ namespace ExpansionInterface
 {
 
 static int changeDevice;
+static int transferComplete;
 
 enum
 {
@@ -44,6 +45,13 @@ void Init()
 	g_Channels[2]->AddDevice(EXIDEVICE_AD16,						0);
 
 	changeDevice = CoreTiming::RegisterEvent("ChangeEXIDevice", ChangeDeviceCallback);
+	transferComplete = CoreTiming::RegisterEvent("EXITransferComplete", TransferCompleteCallback);
+}
+
+void RegisterMMIO()
+{
+	for (u32 i = 0; i < NUM_CHANNELS; i++)
+		g_Channels[i]->RegisterMMIO(0xCC006800 + i * 0x14);
 }
 
 void Shutdown()
@@ -85,6 +93,17 @@ void ChangeDevice(const u8 channel, const TEXIDevices device_type, const u8 devi
 	CoreTiming::ScheduleEvent_Threadsafe(500000000, changeDevice, ((u64)channel << 32) | ((u64)device_type << 16) | device_num);
 }
 
+void ScheduleTransferComplete(u32 channel, int cyclesIntoFuture)
+{
+	CoreTiming::ScheduleEvent(cyclesIntoFuture, transferComplete, channel);
+}
+
+void TransferCompleteCallback(u64 userdata, int cyclesLate)
+{
+	if (userdata < NUM_CHANNELS)
+		g_Channels[userdata]->CompleteTransfer();
+}
+
 IEXIDevice* FindDevice(TEXIDevices device_type, int customIndex)
 {
 	for (int i = 0; i < NUM_CHANNELS; ++i)
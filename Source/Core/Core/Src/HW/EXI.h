@@ -15,6 +15,7 @@ namespace ExpansionInterface
 
 void Init();
 void Shutdown();
+void RegisterMMIO();
 void DoState(PointerWrap &p);
 void PauseAndLock(bool doLock, bool unpauseOnUnlock);
 
@@ -25,6 +26,10 @@ void ChangeDeviceCallback(u64 userdata, int cyclesLate);
 void ChangeDevice(const u8 channel, const TEXIDevices device_type, const u8 device_num);
 IEXIDevice* FindDevice(TEXIDevices device_type, int customIndex=-1);
 
+// Finishes the DMA running on a channel after the given number of cycles
+void ScheduleTransferComplete(u32 channel, int cyclesIntoFuture);
+void TransferCompleteCallback(u64 userdata, int cyclesLate);
+
 void Read32(u32& _uReturnValue, const u32 _iAddress);
 void Write32(const u32 _iValue, const u32 _iAddress);
 
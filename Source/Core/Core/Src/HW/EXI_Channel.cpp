@@ -5,6 +5,7 @@
 #include "EXI_Channel.h"
 #include "EXI_Device.h"
 #include "EXI.h"
+#include "MMIO.h"
 #include "../ConfigManager.h"
 #include "../Movie.h"
 
@@ -15,6 +16,7 @@
 #include "ProcessorInterface.h"
 #include "../PowerPC/PowerPC.h"
 #include "CoreTiming.h"
+#include "SystemTimers.h"
 
 CEXIChannel::CEXIChannel(u32 ChannelId) :
 	m_DMAMemoryAddress(0),
@@ -173,6 +175,15 @@ void CEXIChannel::Read32(u32& _uReturnValue, const u32 _iRegister)
 		_uReturnValue, m_ChannelId, Debug_GetRegisterName(_iRegister));
 }
 
+void CEXIChannel::RegisterMMIO(u32 base)
+{
+	// STATUS samples device presence and DMACONTROL starts transfers
+	MMIO::RegisterDirect(base + EXI_DMAADDR * 4, &m_DMAMemoryAddress);
+	MMIO::RegisterDirect(base + EXI_DMALENGTH * 4, &m_DMALength);
+	MMIO::RegisterReadDirect(base + EXI_DMACONTROL * 4, &m_Control.Hex);
+	MMIO::RegisterDirect(base + EXI_IMMDATA * 4, &m_ImmData);
+}
+
 void CEXIChannel::Write32(const u32 _iValue, const u32 _iRegister)
 {
 	DEBUG_LOG(EXPANSIONINTERFACE, "(w32) 0x%08x channel: %i  register: %s",
@@ -248,14 +259,15 @@ void CEXIChannel::Write32(const u32 _iValue, const u32 _iRegister)
 			}
 			else
 			{
-				// DMA
+				// DMA. The device gets the whole block at once, TSTART stays
+				// set for as long as the transfer would take on the bus.
 				switch (m_Control.RW)
 				{
 					case EXI_READ: pDevice->DMARead (m_DMAMemoryAddress, m_DMALength); break;
 					case EXI_WRITE: pDevice->DMAWrite(m_DMAMemoryAddress, m_DMALength); break;
 					default: _dbg_assert_msg_(EXPANSIONINTERFACE,0,"EXI DMA: Unknown transfer type %i", m_Control.RW);
 				}
-				m_Control.TSTART = 0;
+				ExpansionInterface::ScheduleTransferComplete(m_ChannelId, GetTransferCycles(m_DMALength));
 			}
 
 			if(!m_Control.TSTART) // completed !
@@ -273,6 +285,23 @@ void CEXIChannel::Write32(const u32 _iValue, const u32 _iRegister)
 	}
 }
 
+int CEXIChannel::GetTransferCycles(u32 _uSize) const
+{
+	// CLK selects 1MHz to 32MHz, one bit per clock
+	const u64 frequency = 1000000ULL << std::min<u32>(m_Status.CLK, 5);
+	return (int)((u64)_uSize * 8 * SystemTimers::GetTicksPerSecond() / frequency);
+}
+
+void CEXIChannel::CompleteTransfer()
+{
+	if (!m_Control.TSTART)
+		return;
+
+	m_Control.TSTART = 0;
+	m_Status.TCINT = 1;
+	ExpansionInterface::UpdateInterrupts();
+}
+
 void CEXIChannel::DoState(PointerWrap &p)
 {
 	p.DoPOD(m_Status);
@@ -100,6 +100,10 @@ private:
 	int updateInterrupts;
 
 	static void UpdateInterrupts(u64 userdata, int cyclesLate);
+
+	// Cycles it takes to shift the given number of bytes at the current
+	// EXI clock
+	int GetTransferCycles(u32 _uSize) const;
 public:
 	// get device
 	IEXIDevice* GetDevice(const u8 _CHIP_SELECT);
@@ -117,7 +121,12 @@ public:
 	void Read32(u32& _uReturnValue, const u32 _iRegister);
 	void Write32(const u32 _iValue, const u32 _iRegister);
 
+	// Registers the side-effect free registers of this channel at base
+	void RegisterMMIO(u32 base);
+
 	void Update();
+	// Called when a DMA started by Write32 is done on the bus
+	void CompleteTransfer();
 	bool IsCausingInterrupt();
 	void DoState(PointerWrap &p);
 	void PauseAndLock(bool doLock, bool unpauseOnUnlock);
@@ -2,6 +2,8 @@
 // Licensed under GPLv2
 // Refer to the license.txt file included.
 
+#include <algorithm>
+
 #include "Memmap.h"
 
 #include "EXI_Device.h"
@@ -18,49 +20,98 @@
 
 
 // --- interface IEXIDevice ---
-void IEXIDevice::ImmWrite(u32 _uData, u32 _uSize)
+void IEXIDevice::BlockWrite(const u8 *_pData, u32 _uSize)
 {
 	while (_uSize--)
 	{
-		u8 uByte = _uData >> 24;
+		u8 uByte = *_pData++;
 		TransferByte(uByte);
-		_uData <<= 8;
 	}
 }
 
+void IEXIDevice::BlockRead(u8 *_pData, u32 _uSize)
+{
+	while (_uSize--)
+		TransferByte(*_pData++);
+}
+
+void IEXIDevice::ImmWrite(u32 _uData, u32 _uSize)
+{
+	u8 data[4];
+	for (u32 i = 0; i < _uSize; i++)
+		data[i] = _uData >> (24 - i * 8);
+	BlockWrite(data, _uSize);
+}
+
 u32 IEXIDevice::ImmRead(u32 _uSize)
 {
+	u8 data[4] = {0};
+	BlockRead(data, _uSize);
+
 	u32 uResult = 0;
-	u32 uPosition = 0;
-	while (_uSize--)
+	for (u32 i = 0; i < _uSize; i++)
+		uResult |= data[i] << (24 - i * 8);
+	return uResult;
+}
+
+// Host pointer to the whole DMA range, or NULL if it doesn't lie in one
+// contiguous piece of emulated memory.
+static u8 *GetDMAPointer(u32 _uAddr, u32 _uSize)
+{
+	const u32 uLast = _uAddr + _uSize - 1;
+	if (_uSize == 0 || uLast < _uAddr ||
+		!Memory::IsRAMAddress(_uAddr) || !Memory::IsRAMAddress(uLast))
 	{
-		u8 uByte = 0;
-		TransferByte(uByte);
-		uResult |= uByte << (24-(uPosition++ * 8));
+		return NULL;
 	}
-	return uResult;
+
+	u8 *ptr = Memory::GetPointer(_uAddr);
+	if (ptr == NULL || Memory::GetPointer(uLast) != ptr + _uSize - 1)
+		return NULL;
+	return ptr;
 }
 
 void IEXIDevice::DMAWrite(u32 _uAddr, u32 _uSize)
 {
-//	_dbg_assert_(EXPANSIONINTERFACE, 0);
-	while (_uSize--)
+	const u8 *ptr = GetDMAPointer(_uAddr, _uSize);
+	if (ptr != NULL)
 	{
-		u8 uByte = Memory::Read_U8(_uAddr++);
-		TransferByte(uByte);
+		BlockWrite(ptr, _uSize);
+		return;
+	}
+
+	u8 buffer[256];
+	while (_uSize)
+	{
+		u32 uChunk = std::min<u32>(_uSize, sizeof(buffer));
+		for (u32 i = 0; i < uChunk; i++)
+			buffer[i] = Memory::Read_U8(_uAddr++);
+		BlockWrite(buffer, uChunk);
+		_uSize -= uChunk;
 	}
 }
 
 void IEXIDevice::DMARead(u32 _uAddr, u32 _uSize)
 {
-//	_dbg_assert_(EXPANSIONINTERFACE, 0);
-	while (_uSize--)
+	u8 *ptr = GetDMAPointer(_uAddr, _uSize);
+	if (ptr != NULL)
 	{
-		u8 uByte = 0;
-		TransferByte(uByte);
-		Memory::Write_U8(uByte, _uAddr++);
+		memset(ptr, 0, _uSize);
+		BlockRead(ptr, _uSize);
+		return;
 	}
-};
+
+	u8 buffer[256];
+	while (_uSize)
+	{
+		u32 uChunk = std::min<u32>(_uSize, sizeof(buffer));
+		memset(buffer, 0, uChunk);
+		BlockRead(buffer, uChunk);
+		for (u32 i = 0; i < uChunk; i++)
+			Memory::Write_U8(buffer[i], _uAddr++);
+		_uSize -= uChunk;
+	}
+}
 
 
 // --- class CEXIDummy ---
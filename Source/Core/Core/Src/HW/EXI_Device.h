@@ -27,6 +27,13 @@ private:
 	// Byte transfer function for this device
 	virtual void TransferByte(u8&) {}
 
+protected:
+	// Block transfer functions, used by the Imm and DMA functions for the
+	// whole transfer. The defaults run TransferByte over the buffer, devices
+	// that can do better override these. BlockRead gets a zeroed buffer.
+	virtual void BlockWrite(const u8 *_pData, u32 _uSize);
+	virtual void BlockRead(u8 *_pData, u32 _uSize);
+
 public:
 	// Immediate copy functions
 	virtual void ImmWrite(u32 _uData,  u32 _uSize);
@@ -2,26 +2,201 @@
 // Licensed under GPLv2
 // Refer to the license.txt file included.
 
+#include "Common.h"
+#include "FileUtil.h"
+#include "Timer.h"
+
 #include "../Core.h"
+#include "../CoreTiming.h"
 #include "../ConfigManager.h"
 
+#include "EXI.h"
 #include "EXI_Device.h"
 #include "EXI_DeviceAMBaseboard.h"
+#include "SystemTimers.h"
+
+enum
+{
+	JOURNAL_MAGIC = 0x4A424D41,	// "AMBJ"
+	JOURNAL_VERSION = 1,
+	// The backup offset is 16 bits
+	BACKUP_MAX_SIZE = 0x10000,
+	// Journal entries after which the whole backup is written out again
+	COMPACT_ENTRIES = 0x4000,
+};
+
+static u16 JournalCheck(u32 offset, u8 value)
+{
+	return (u16)(0xA55A ^ offset ^ (offset >> 16) ^ (value * 0x0101));
+}
+
+// Truncates the journal, the backup file holds everything written so far
+static bool ResetJournal(File::IOFile &journal, const std::string &filename)
+{
+	const u32 header[2] = { JOURNAL_MAGIC, JOURNAL_VERSION };
+	return journal.Open(filename, "wb") && journal.WriteArray(header, 2) && journal.Flush();
+}
+
+void CEXIAMBaseboard::FlushCallback(u64 userdata, int cyclesLate)
+{
+	CEXIAMBaseboard* pThis = (CEXIAMBaseboard*)ExpansionInterface::FindDevice(EXIDEVICE_AM_BASEBOARD);
+	if (pThis)
+		pThis->Flush();
+}
+
+void CEXIAMBaseboard::FlushThread(FlushData *data)
+{
+	const u64 start = Common::Timer::GetTimeUs();
+
+	if (!data->entries.empty())
+	{
+		if (!data->journal->WriteArray(&data->entries[0], data->entries.size()) || !data->journal->Flush())
+			ERROR_LOG(SP1, "AM-BB: Could not write %s", data->journal_filename.c_str());
+	}
+
+	if (!data->image.empty())
+	{
+		// Written next to the old one so a crash leaves either of them
+		// intact, the journal is only restarted once it is in place
+		const std::string temp = data->backup_filename + ".tmp";
+		bool written;
+		{
+			File::IOFile file(temp, "wb");
+			written = file.WriteBytes(&data->image[0], data->image.size());
+		}
+		if (!written || !File::RenameSync(temp, data->backup_filename))
+			ERROR_LOG(SP1, "AM-BB: Could not write %s", data->backup_filename.c_str());
+		else if (!ResetJournal(*data->journal, data->journal_filename))
+			ERROR_LOG(SP1, "AM-BB: Could not write %s", data->journal_filename.c_str());
+	}
+
+	data->latency_us = Common::Timer::GetTimeUs() - start;
+}
 
 CEXIAMBaseboard::CEXIAMBaseboard()
 	: m_position(0)
 	, m_have_irq(false)
+	, m_backoffset(0)
+	, m_backup_position(0)
+	, m_journal_size(0)
+	, m_num_reads(0)
+	, m_num_writes(0)
+	, m_num_flushes(0)
+	, m_num_compactions(0)
+	, m_total_flush_us(0)
+	, m_max_flush_us(0)
 {
-	std::string backup_Filename( File::GetUserPath(D_TRIUSER_IDX) + "tribackup_" + SConfig::GetInstance().m_LocalCoreStartupParameter.GetUniqueID() + ".bin" );
+	const std::string base = File::GetUserPath(D_TRIUSER_IDX) + "tribackup_" + SConfig::GetInstance().m_LocalCoreStartupParameter.GetUniqueID();
+	m_flush_data.backup_filename = base + ".bin";
+	m_flush_data.journal_filename = base + ".journal";
+	m_flush_data.journal = &m_journal;
+	m_flush_data.latency_us = 0;
 
-	if( File::Exists( backup_Filename ) )
+	File::IOFile backup(m_flush_data.backup_filename, "rb");
+	if (backup)
 	{
-		m_backup = new File::IOFile( backup_Filename, "rb+" );		
+		m_backup.resize(std::min<u64>(backup.GetSize(), BACKUP_MAX_SIZE));
+		if (!m_backup.empty())
+			backup.ReadBytes(&m_backup[0], m_backup.size());
 	}
-	else
+	backup.Close();
+
+	ReplayJournal();
+
+	et_flush = CoreTiming::RegisterEvent("AMBaseboardFlush", FlushCallback);
+	m_start_time = Common::Timer::GetTimeMs();
+}
+
+// Applies what a previous session journaled but didn't get to write to the
+// backup file, up to the first incomplete entry.
+void CEXIAMBaseboard::ReplayJournal()
+{
+	u32 replayed = 0;
+	File::IOFile journal(m_flush_data.journal_filename, "rb");
+	u32 header[2];
+	if (journal && journal.ReadArray(header, 2) && header[0] == JOURNAL_MAGIC && header[1] == JOURNAL_VERSION)
 	{
-		m_backup = new File::IOFile( backup_Filename, "wb+" );
+		JournalEntry entry;
+		while (journal.ReadArray(&entry, 1) && entry.offset < BACKUP_MAX_SIZE &&
+			entry.check == JournalCheck(entry.offset, entry.value))
+		{
+			if (entry.offset >= m_backup.size())
+				m_backup.resize(entry.offset + 1, 0);
+			m_backup[entry.offset] = entry.value;
+			replayed++;
+		}
+	}
+	journal.Close();
+
+	if (replayed == 0)
+	{
+		if (!ResetJournal(m_journal, m_flush_data.journal_filename))
+			ERROR_LOG(SP1, "AM-BB: Could not write %s", m_flush_data.journal_filename.c_str());
+		return;
 	}
+
+	NOTICE_LOG(SP1, "AM-BB: Replayed %u backup writes from %s", replayed, m_flush_data.journal_filename.c_str());
+	m_flush_data.image = m_backup;
+	FlushThread(&m_flush_data);
+	m_flush_data.image.clear();
+	if (!m_journal.IsOpen())
+		m_journal.Open(m_flush_data.journal_filename, "ab");
+}
+
+void CEXIAMBaseboard::Flush(bool exiting)
+{
+	if (m_flush_thread.joinable())
+	{
+		m_flush_thread.join();
+		m_total_flush_us += m_flush_data.latency_us;
+		m_max_flush_us = std::max(m_max_flush_us, m_flush_data.latency_us);
+	}
+
+	if (m_pending.empty() && (!exiting || m_journal_size == 0))
+		return;
+
+	m_flush_data.entries.swap(m_pending);
+	m_pending.clear();
+	m_journal_size += (u32)m_flush_data.entries.size();
+
+	// On shutdown everything goes to the backup file
+	m_flush_data.image.clear();
+	if (exiting || m_journal_size >= COMPACT_ENTRIES)
+	{
+		m_flush_data.image = m_backup;
+		m_journal_size = 0;
+		m_num_compactions++;
+	}
+	m_num_flushes++;
+
+	m_flush_thread = std::thread(FlushThread, &m_flush_data);
+	if (exiting)
+	{
+		m_flush_thread.join();
+		m_total_flush_us += m_flush_data.latency_us;
+		m_max_flush_us = std::max(m_max_flush_us, m_flush_data.latency_us);
+	}
+}
+
+void CEXIAMBaseboard::WriteBackup(u8 value)
+{
+	if (m_backup_position >= BACKUP_MAX_SIZE)
+	{
+		WARN_LOG(SP1, "AM-BB: Backup write past the end: %08x", m_backup_position);
+		return;
+	}
+
+	if (m_backup_position >= m_backup.size())
+		m_backup.resize(m_backup_position + 1, 0);
+	m_backup[m_backup_position] = value;
+
+	JournalEntry entry = { m_backup_position, value, 0, JournalCheck(m_backup_position, value) };
+	m_pending.push_back(entry);
+	m_backup_position++;
+	m_num_writes++;
+
+	if (!CoreTiming::IsScheduled(et_flush))
+		CoreTiming::ScheduleEvent(SystemTimers::GetTicksPerSecond(), et_flush);
 }
 
 void CEXIAMBaseboard::SetCS(int cs)
@@ -75,13 +250,12 @@ void CEXIAMBaseboard::TransferByte(u8& _byte)
 			case 0x01:
 				m_backoffset = (m_command[1] << 8) | m_command[2];
 				DEBUG_LOG(SP1,"AM-BB COMMAND: Backup Offset:%04X", m_backoffset );
-				m_backup->Seek( m_backoffset, SEEK_SET );
+				m_backup_position = m_backoffset;
 				_byte = 0x01;
 				break;
 			case 0x02:
 				DEBUG_LOG(SP1,"AM-BB COMMAND: Backup Write:%04X-%02X", m_backoffset, m_command[1] );
-				m_backup->WriteBytes( &m_command[1], 1 );
-				m_backup->Flush();
+				WriteBackup(m_command[1]);
 				_byte = 0x01;
 				break;
 			case 0x03:
@@ -139,7 +313,10 @@ void CEXIAMBaseboard::TransferByte(u8& _byte)
 			{
 			// Read backup - 1 byte out
 			case 0x03:
-				m_backup->ReadBytes( &_byte, 1);
+				if (m_backup_position < m_backup.size())
+					_byte = m_backup[m_backup_position];
+				m_backup_position++;
+				m_num_reads++;
 				break;
 			// IMR - 2 byte out
 			case 0x82:
@@ -171,6 +348,46 @@ void CEXIAMBaseboard::TransferByte(u8& _byte)
 	m_position++;
 }
 
+// Once a backup read command is in, the rest of the transfer is a straight
+// copy out of the backup memory.
+bool CEXIAMBaseboard::IsBackupRead() const
+{
+	return m_position > 4 && m_command[0] == 0x03;
+}
+
+void CEXIAMBaseboard::ReadBackup(u8 *data, u32 size)
+{
+	DEBUG_LOG(SP1, "AM-BB: Backup read %04x-%04x", m_backup_position, m_backup_position + size - 1);
+	if (data && m_backup_position < m_backup.size())
+	{
+		u32 count = std::min<u32>(size, (u32)m_backup.size() - m_backup_position);
+		memcpy(data, &m_backup[m_backup_position], count);
+	}
+	m_backup_position += size;
+	m_position += size;
+	m_num_reads += size;
+}
+
+void CEXIAMBaseboard::BlockWrite(const u8 *_pData, u32 _uSize)
+{
+	for (; _uSize && !IsBackupRead(); _uSize--)
+	{
+		u8 byte = *_pData++;
+		TransferByte(byte);
+	}
+	// What comes back is thrown away
+	if (_uSize)
+		ReadBackup(NULL, _uSize);
+}
+
+void CEXIAMBaseboard::BlockRead(u8 *_pData, u32 _uSize)
+{
+	for (; _uSize && !IsBackupRead(); _uSize--)
+		TransferByte(*_pData++);
+	if (_uSize)
+		ReadBackup(_pData, _uSize);
+}
+
 bool CEXIAMBaseboard::IsInterruptSet()
 {
 	if (m_have_irq)
@@ -192,9 +409,19 @@ void CEXIAMBaseboard::DoState(PointerWrap &p)
 	p.Do(m_have_irq);
 	p.Do(m_command);
 }
+
 CEXIAMBaseboard::~CEXIAMBaseboard()
 {
-	m_backup->Close();
-	delete m_backup;
+	CoreTiming::RemoveEvent(et_flush);
+	Flush(true);
+	m_journal.Close();
+
+	const u32 elapsed_ms = std::max<u32>(Common::Timer::GetTimeMs() - m_start_time, 1);
+	if (m_num_flushes)
+	{
+		NOTICE_LOG(SP1, "AM-BB backup: %u reads, %u writes (%.1f/s), %u flushes (%u full), flush latency %u us average, %u us max",
+			m_num_reads, m_num_writes, m_num_writes * 1000.0 / elapsed_ms, m_num_flushes, m_num_compactions,
+			(u32)(m_total_flush_us / m_num_flushes), (u32)m_max_flush_us);
+	}
 }
 
@@ -5,6 +5,11 @@
 #ifndef _EXIDEVICE_AMBASEBOARD_H
 #define _EXIDEVICE_AMBASEBOARD_H
 
+#include <string>
+#include <vector>
+
+#include "Thread.h"
+
 class CEXIAMBaseboard : public IEXIDevice
 {
 public:
@@ -18,14 +23,70 @@ public:
 	~CEXIAMBaseboard();
 
 private:
+	// One byte written to the backup memory. The journal file is a header
+	// followed by these, in the order the game wrote them.
+	struct JournalEntry
+	{
+		u32 offset;
+		u8 value;
+		u8 pad;
+		u16 check;
+	};
+
+	// What the flush thread works on. Owned by the CPU thread while the
+	// thread isn't running.
+	struct FlushData
+	{
+		File::IOFile *journal;
+		std::string journal_filename;
+		std::string backup_filename;
+		std::vector<JournalEntry> entries;
+		std::vector<u8> image;	// Only set when compacting
+		u64 latency_us;
+	};
+
+	// Scheduled by the first backup write after a flush
+	static void FlushCallback(u64 userdata, int cyclesLate);
+	static void FlushThread(FlushData *data);
+
+	// Hands the pending writes to the flush thread. Every so often the
+	// whole backup is written out and the journal restarted.
+	void Flush(bool exiting = false);
+	void ReplayJournal();
+	void WriteBackup(u8 value);
+
 	virtual void TransferByte(u8& _uByte);
+	virtual void BlockWrite(const u8 *_pData, u32 _uSize);
+	virtual void BlockRead(u8 *_pData, u32 _uSize);
+	bool IsBackupRead() const;
+	void ReadBackup(u8 *data, u32 size);
+
 	int m_position;
 	bool m_have_irq;
 	u32 m_irq_timer;
 	u32 m_irq_status;
 	unsigned char m_command[4];
 	unsigned short m_backoffset;
-	File::IOFile *m_backup;
+
+	// Backup memory, with the writes not handed to the flush thread yet
+	std::vector<u8> m_backup;
+	u32 m_backup_position;
+	std::vector<JournalEntry> m_pending;
+	u32 m_journal_size;	// Entries since the last compaction
+	int et_flush;
+
+	File::IOFile m_journal;
+	FlushData m_flush_data;
+	std::thread m_flush_thread;
+
+	// Statistics, logged on shutdown
+	u32 m_start_time;
+	u32 m_num_reads;
+	u32 m_num_writes;
+	u32 m_num_flushes;
+	u32 m_num_compactions;
+	u64 m_total_flush_us;
+	u64 m_max_flush_us;
 };
 
 #endif
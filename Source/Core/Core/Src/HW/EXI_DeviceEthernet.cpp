@@ -2,11 +2,15 @@
 // Licensed under GPLv2
 // Refer to the license.txt file included.
 
+#include <algorithm>
+
 #include "Memmap.h"
+#include "EXI.h"
 #include "EXI_Device.h"
 #include "EXI_DeviceEthernet.h"
 #include "StringUtil.h"
 #include "../ConfigManager.h"
+#include "../CoreTiming.h"
 
 // XXX: The BBA stores multi-byte elements as little endian.
 // Multiple parts of this implementation depend on dolphin
@@ -58,6 +62,25 @@ CEXIETHERNET::CEXIETHERNET()
 	mRecvBuffer = new u8 [BBA_RECV_SIZE];
 	mRecvBufferLength = 0;
 
+	const std::string &backend = SConfig::GetInstance().m_bba_backend;
+	if (backend == "loopback")
+		mBackend = BACKEND_LOOPBACK;
+	else if (backend == "pcap")
+		mBackend = BACKEND_PCAP;
+	else
+		mBackend = BACKEND_TAP;
+
+	mRecvPending = 0;
+	mRecvEvent = CoreTiming::RegisterEvent("BBARecv", RecvCallback);
+	mStandInRecv = false;
+
+	mStartTime = Common::Timer::GetTimeMs();
+	mFramesSent = mFramesReceived = 0;
+	mBytesSent = mBytesReceived = 0;
+	mFramesDropped = 0;
+	mRecvBatches = 0;
+	mTotalRecvLatencyUs = mMaxRecvLatencyUs = 0;
+
 	MXHardReset();
 
 	// Parse MAC address from config, and generate a new one if it doesn't
@@ -119,7 +142,9 @@ CEXIETHERNET::CEXIETHERNET()
 
 CEXIETHERNET::~CEXIETHERNET()
 {
-	Deactivate();
+	NetDeactivate();
+	CoreTiming::RemoveEvent(mRecvEvent);
+	LogStats();
 
 	delete tx_fifo;
 	delete mBbaMem;
@@ -376,7 +401,7 @@ void CEXIETHERNET::MXCommandHandler(u32 data, u32 size)
 		{
 			DEBUG_LOG(SP1, "Software reset");
 			//MXSoftReset();
-			Activate();
+			NetActivate();
 		}
 
 		if ((mBbaMem[BBA_NCRA] & NCRA_SR) ^ (data & NCRA_SR))
@@ -384,9 +409,9 @@ void CEXIETHERNET::MXCommandHandler(u32 data, u32 size)
 			DEBUG_LOG(SP1, "%s rx", (data & NCRA_SR) ? "start" : "stop");
 
 			if (data & NCRA_SR)
-				RecvStart();
+				NetRecvStart();
 			else
-				RecvStop();
+				NetRecvStop();
 		}
 
 		// Only start transfer if there isn't one currently running
@@ -451,7 +476,7 @@ void CEXIETHERNET::DirectFIFOWrite(u8 *data, u32 size)
 
 void CEXIETHERNET::SendFromDirectFIFO()
 {
-	SendFrame(tx_fifo, *(u16 *)&mBbaMem[BBA_TXFIFOCNT]);
+	NetSendFrame(tx_fifo, *(u16 *)&mBbaMem[BBA_TXFIFOCNT]);
 }
 
 void CEXIETHERNET::SendFromPacketBuffer()
@@ -496,7 +521,7 @@ inline u8 CEXIETHERNET::HashIndex(u8 *dest_eth_addr)
 	return crc >> 26;
 }
 
-inline bool CEXIETHERNET::RecvMACFilter()
+inline bool CEXIETHERNET::RecvMACFilter(const u8 *frame)
 {
 	static u8 const broadcast[] = { 0xff, 0xff, 0xff, 0xff, 0xff, 0xff };
 
@@ -505,11 +530,11 @@ inline bool CEXIETHERNET::RecvMACFilter()
 		return true;
 
 	// Unicast?
-	if ((mRecvBuffer[0] & 0x01) == 0)
+	if ((frame[0] & 0x01) == 0)
 	{
-		return memcmp(mRecvBuffer, &mBbaMem[BBA_NAFR_PAR0], 6) == 0;
+		return memcmp(frame, &mBbaMem[BBA_NAFR_PAR0], 6) == 0;
 	}
-	else if (memcmp(mRecvBuffer, broadcast, 6) == 0)
+	else if (memcmp(frame, broadcast, 6) == 0)
 	{
 		// Accept broadcast?
 		return !!(mBbaMem[BBA_NCRB] & NCRB_AB);
@@ -522,7 +547,7 @@ inline bool CEXIETHERNET::RecvMACFilter()
 	else
 	{
 		// Lookup the dest eth address in the hashmap
-		u16 index = HashIndex(mRecvBuffer);
+		u16 index = HashIndex((u8 *)frame);
 		return !!(mBbaMem[BBA_NAFR_MAR0 + index / 8] & (1 << (index % 8)));
 	}
 }
@@ -539,7 +564,7 @@ inline void CEXIETHERNET::inc_rwp()
 
 // This function is on the critical path for receiving data.
 // Be very careful about calling into the logger and other slow things
-bool CEXIETHERNET::RecvHandlePacket()
+bool CEXIETHERNET::RecvHandlePacket(const u8 *frame, u32 size)
 {
 	u8 *write_ptr;
 	u8 *end_ptr;
@@ -548,12 +573,12 @@ bool CEXIETHERNET::RecvHandlePacket()
 	u32 status = 0;
 	u16 rwp_initial = page_ptr(BBA_RWP);
 
-	if (!RecvMACFilter())
-		goto wait_for_next;
+	if (!RecvMACFilter(frame))
+		return true;
 	
 #ifdef BBA_TRACK_PAGE_PTRS
-	WARN_LOG(SP1, "RecvHandlePacket %x\n%s", mRecvBufferLength,
-		ArrayToString(mRecvBuffer, mRecvBufferLength, 0x100).c_str());
+	WARN_LOG(SP1, "RecvHandlePacket %x\n%s", size,
+		ArrayToString(frame, size, 0x100).c_str());
 
 	WARN_LOG(SP1, "%x %x %x %x",
 		page_ptr(BBA_BP),
@@ -569,9 +594,9 @@ bool CEXIETHERNET::RecvHandlePacket()
 	descriptor = (Descriptor *)write_ptr;
 	write_ptr += 4;
 
-	for (u32 i = 0, off = 4; i < mRecvBufferLength; ++i, ++off)
+	for (u32 i = 0, off = 4; i < size; ++i, ++off)
 	{
-		*write_ptr++ = mRecvBuffer[i];
+		*write_ptr++ = frame[i];
 
 		if (off == 0xff)
 		{
@@ -602,7 +627,7 @@ bool CEXIETHERNET::RecvHandlePacket()
 	}
 
 	// Align up to next page
-	if ((mRecvBufferLength + 4) % 256)
+	if ((size + 4) % 256)
 		inc_rwp();
 
 #ifdef BBA_TRACK_PAGE_PTRS
@@ -614,7 +639,7 @@ bool CEXIETHERNET::RecvHandlePacket()
 #endif
 
 	// Is the current frame multicast?
-	if (mRecvBuffer[0] & 0x01)
+	if (frame[0] & 0x01)
 		status |= DESC_MF;
 
 	if (status & DESC_BF)
@@ -629,7 +654,7 @@ bool CEXIETHERNET::RecvHandlePacket()
 		}
 	}
 
-	descriptor->set(*(u16 *)&mBbaMem[BBA_RWP], 4 + mRecvBufferLength, status);
+	descriptor->set(*(u16 *)&mBbaMem[BBA_RWP], 4 + size, status);
 
 	mBbaMem[BBA_LRPS] = status;
 
@@ -646,9 +671,178 @@ bool CEXIETHERNET::RecvHandlePacket()
 		WARN_LOG(SP1, "NOT raising recv interrupt");
 	}
 
-wait_for_next:
-	if (mBbaMem[BBA_NCRA] & NCRA_SR)
-		RecvStart();
+	return true;
+}
+
+void CEXIETHERNET::RecvCallback(u64 userdata, int cyclesLate)
+{
+	CEXIETHERNET* self = (CEXIETHERNET*)ExpansionInterface::FindDevice(EXIDEVICE_ETH);
+	if (self)
+		self->RecvDrain();
+}
+
+void CEXIETHERNET::RecvNotify()
+{
+	if (Common::AtomicLoadAcquire(mRecvPending))
+		return;
+	Common::AtomicStoreRelease(mRecvPending, 1);
+	CoreTiming::ScheduleEvent_Threadsafe(0, mRecvEvent);
+}
+
+void CEXIETHERNET::RecvQueue(const u8 *frame, u32 size)
+{
+	u8 *buffer = mRecvRing.GetWriteBuffer();
+	if (!buffer)
+	{
+		Common::AtomicIncrement(mFramesDropped);
+		return;
+	}
+
+	size = std::min<u32>(size, BBA_RECV_SIZE);
+	memcpy(buffer, frame, size);
+	mRecvRing.Push(size);
+	RecvNotify();
+}
+
+void CEXIETHERNET::RecvDrain()
+{
+	// Cleared first, frames pushed from here on schedule another drain
+	Common::AtomicStoreRelease(mRecvPending, 0);
+
+	const u64 now = Common::Timer::GetTimeUs();
+	u32 count = 0;
+	u32 size;
+	u64 timestamp;
+	const u8 *frame;
+	while ((frame = mRecvRing.Peek(size, timestamp)) != NULL)
+	{
+		RecvHandlePacket(frame, size);
+		mRecvRing.Pop();
+
+		const u64 latency = now - std::min(now, timestamp);
+		mTotalRecvLatencyUs += latency;
+		mMaxRecvLatencyUs = std::max(mMaxRecvLatencyUs, latency);
+		mBytesReceived += size;
+		count++;
+	}
+
+	if (count)
+	{
+		mFramesReceived += count;
+		mRecvBatches++;
+		ExpansionInterface::UpdateInterrupts();
+	}
+}
+
+bool CEXIETHERNET::NetActivate()
+{
+	switch (mBackend)
+	{
+	case BACKEND_LOOPBACK:
+		return true;
+
+	case BACKEND_PCAP:
+		if (!mPcap.IsOpen())
+		{
+			std::string filename = SConfig::GetInstance().m_bba_pcap;
+			if (filename.empty())
+				filename = File::GetUserPath(D_DUMP_IDX) + "bba.pcap";
+
+			// Classic pcap, microsecond timestamps, Ethernet frames
+			const u32 header[6] = { 0xa1b2c3d4, 0x00040002, 0, 0, BBA_RECV_SIZE, 1 };
+			if (!mPcap.Open(filename, "wb") || !mPcap.WriteArray(header, 6))
+			{
+				ERROR_LOG(SP1, "Could not write %s", filename.c_str());
+				mPcap.Close();
+			}
+		}
+		return mPcap.IsOpen();
+
+	default:
+		return Activate();
+	}
+}
+
+void CEXIETHERNET::NetDeactivate()
+{
+	switch (mBackend)
+	{
+	case BACKEND_LOOPBACK:
+		mStandInRecv = false;
+		break;
+
+	case BACKEND_PCAP:
+		mStandInRecv = false;
+		mPcap.Close();
+		break;
+
+	default:
+		Deactivate();
+		break;
+	}
+}
+
+void CEXIETHERNET::WritePcapRecord(const u8 *frame, u32 size)
+{
+	const u64 now = Common::Timer::GetTimeUs();
+	const u32 record[4] = { (u32)(now / 1000000), (u32)(now % 1000000), size, size };
+	mPcap.WriteArray(record, 4);
+	mPcap.WriteBytes(frame, size);
+}
+
+bool CEXIETHERNET::NetSendFrame(u8 *frame, u32 size)
+{
+	switch (mBackend)
+	{
+	case BACKEND_LOOPBACK:
+		if (mStandInRecv)
+			RecvQueue(frame, size);
+		SendComplete();
+		break;
 
+	case BACKEND_PCAP:
+		WritePcapRecord(frame, size);
+		SendComplete();
+		break;
+
+	default:
+		if (!SendFrame(frame, size))
+			return false;
+		break;
+	}
+
+	mFramesSent++;
+	mBytesSent += size;
+	return true;
+}
+
+bool CEXIETHERNET::NetRecvStart()
+{
+	if (mBackend == BACKEND_TAP)
+		return RecvStart();
+
+	mStandInRecv = true;
 	return true;
 }
+
+void CEXIETHERNET::NetRecvStop()
+{
+	if (mBackend == BACKEND_TAP)
+		RecvStop();
+	else
+		mStandInRecv = false;
+}
+
+void CEXIETHERNET::LogStats()
+{
+	if (mFramesSent == 0 && mFramesReceived == 0)
+		return;
+
+	const u32 elapsed_ms = std::max<u32>(Common::Timer::GetTimeMs() - mStartTime, 1);
+	NOTICE_LOG(SP1, "BBA: sent %u frames (%.1f KB/s), received %u frames (%.1f KB/s) in %u batches, %u dropped",
+		mFramesSent, mBytesSent / 1.024 / elapsed_ms,
+		mFramesReceived, mBytesReceived / 1.024 / elapsed_ms, mRecvBatches, mFramesDropped);
+	if (mFramesReceived)
+		NOTICE_LOG(SP1, "BBA: receive latency %u us average, %u us max",
+			(u32)(mTotalRecvLatencyUs / mFramesReceived), (u32)mMaxRecvLatencyUs);
+}
@@ -9,7 +9,10 @@
 #include <Windows.h>
 #endif
 
+#include "Atomic.h"
+#include "FileUtil.h"
 #include "Thread.h"
+#include "Timer.h"
 
 // Network Control Register A
 enum NCRA
@@ -184,6 +187,65 @@ enum RecvStatus
 
 #define BBA_RECV_SIZE 0x800
 
+// Received frames on their way to the CPU thread. One producer (the TAP
+// reader thread, or the CPU thread itself for the stand-in backends) and
+// one consumer, the buffers are allocated once and frames are read straight
+// into them.
+class BBAFrameRing
+{
+public:
+	enum
+	{
+		NUM_FRAMES = 64
+	};
+
+	BBAFrameRing() : m_read(0), m_write(0) {}
+
+	// Returns NULL when the ring is full
+	u8 *GetWriteBuffer()
+	{
+		if (m_write - Common::AtomicLoadAcquire(m_read) == NUM_FRAMES)
+			return NULL;
+		return m_frames[m_write % NUM_FRAMES].data;
+	}
+
+	void Push(u32 size)
+	{
+		Frame &frame = m_frames[m_write % NUM_FRAMES];
+		frame.size = size;
+		frame.timestamp = Common::Timer::GetTimeUs();
+		Common::AtomicStoreRelease(m_write, m_write + 1);
+	}
+
+	// Returns NULL when the ring is empty
+	const u8 *Peek(u32 &size, u64 &timestamp)
+	{
+		if (Common::AtomicLoadAcquire(m_write) == m_read)
+			return NULL;
+		const Frame &frame = m_frames[m_read % NUM_FRAMES];
+		size = frame.size;
+		timestamp = frame.timestamp;
+		return frame.data;
+	}
+
+	void Pop()
+	{
+		Common::AtomicStoreRelease(m_read, m_read + 1);
+	}
+
+private:
+	struct Frame
+	{
+		u8 data[BBA_RECV_SIZE];
+		u32 size;
+		u64 timestamp;	// When the frame was pushed
+	};
+
+	Frame m_frames[NUM_FRAMES];
+	volatile u32 m_read;
+	volatile u32 m_write;
+};
+
 class CEXIETHERNET : public IEXIDevice
 {
 public:
@@ -296,13 +358,58 @@ public:
 	void SendFromPacketBuffer();
 	void SendComplete();
 	u8 HashIndex(u8 *dest_eth_addr);
-	bool RecvMACFilter();
+	bool RecvMACFilter(const u8 *frame);
 	void inc_rwp();
-	bool RecvHandlePacket();
+	bool RecvHandlePacket(const u8 *frame, u32 size);
+
+	// Received frames are handed to RecvHandlePacket in batches, from this
+	// event on the CPU thread
+	static void RecvCallback(u64 userdata, int cyclesLate);
+	void RecvDrain();
+	// Schedules RecvCallback unless it is pending already. Any thread.
+	void RecvNotify();
+	// Copies a frame into the ring, for backends that can't read into it
+	void RecvQueue(const u8 *frame, u32 size);
 
 	u8 *tx_fifo;
 	u8 *mBbaMem;
 
+	// Network backend. TAP is implemented per platform in BBA-TAP, the
+	// others are stand-ins for benchmarking without a TAP device: loopback
+	// sends every frame back, pcap writes them to a capture file.
+	enum Backend
+	{
+		BACKEND_TAP,
+		BACKEND_LOOPBACK,
+		BACKEND_PCAP
+	};
+
+	bool NetActivate();
+	void NetDeactivate();
+	bool NetSendFrame(u8 *frame, u32 size);
+	bool NetRecvStart();
+	void NetRecvStop();
+	void WritePcapRecord(const u8 *frame, u32 size);
+	void LogStats();
+
+	Backend mBackend;
+	BBAFrameRing mRecvRing;
+	volatile u32 mRecvPending;
+	int mRecvEvent;
+	volatile bool mStandInRecv;
+	File::IOFile mPcap;
+
+	// Statistics, logged when the device goes away
+	u32 mStartTime;
+	u32 mFramesSent;
+	u32 mFramesReceived;
+	u64 mBytesSent;
+	u64 mBytesReceived;
+	volatile u32 mFramesDropped;	// The ring was full
+	u32 mRecvBatches;
+	u64 mTotalRecvLatencyUs;
+	u64 mMaxRecvLatencyUs;
+
 	// TAP interface
 	bool Activate();
 	void Deactivate();
@@ -52,6 +52,10 @@ public:
 	void ImmReadWrite(u32 &_uData, u32 _uSize);
 
 private:
+	// Everything goes through ImmReadWrite, other transfers read zeroes
+	void BlockWrite(const u8 *_pData, u32 _uSize) {}
+	void BlockRead(u8 *_pData, u32 _uSize) {}
+
 	enum
 	{
 		CMD_LED_OFF	= 0x7,
@@ -322,15 +322,7 @@ void CEXIIPL::TransferByte(u8& _uByte)
 					// At the moment, we pre-decrypt the whole thing and
 					// ignore the "enabled" bit - see CEXIIPL::CEXIIPL
 					_uByte = m_pIPL[position];
-
-					if ((position >= 0x001AFF00) && (position <= 0x001FF474) && !m_FontsLoaded)
-					{
-						PanicAlertT(
-							"Error: Trying to access %s fonts but they are not loaded. "
-							"Games may not show fonts correctly, or crash.",
-							(position >= 0x001FCF00) ? "ANSI" : "SJIS");
-						m_FontsLoaded = true; // Don't be a nag :p
-					}
+					CheckFontAccess(position, 1);
 				}
 			}
 			else
@@ -347,6 +339,46 @@ void CEXIIPL::TransferByte(u8& _uByte)
 	m_uPosition++;
 }
 
+void CEXIIPL::CheckFontAccess(u32 position, u32 size)
+{
+	const u32 first = std::max<u32>(position, 0x001AFF00);
+	if (first <= 0x001FF474 && first < position + size && !m_FontsLoaded)
+	{
+		PanicAlertT(
+			"Error: Trying to access %s fonts but they are not loaded. "
+			"Games may not show fonts correctly, or crash.",
+			(first >= 0x001FCF00) ? "ANSI" : "SJIS");
+		m_FontsLoaded = true; // Don't be a nag :p
+	}
+}
+
+// ROM reads, the fonts for the most part, are copied in one go. Everything
+// else goes through TransferByte.
+void CEXIIPL::BlockRead(u8 *_pData, u32 _uSize)
+{
+	for (; _uSize && m_uPosition <= 3; _uSize--)
+		TransferByte(*_pData++);
+
+	if (_uSize && !IsWriteCommand() && (m_uAddress >> 6) < ROM_SIZE)
+	{
+		const u32 position = ((m_uAddress >> 6) & ROM_MASK) + m_uRWOffset;
+		if (position < ROM_SIZE)
+		{
+			const u32 count = std::min<u32>(_uSize, ROM_SIZE - position);
+			memcpy(_pData, m_pIPL + position, count);
+			CheckFontAccess(position, count);
+
+			m_uRWOffset += count;
+			m_uPosition += count;
+			_pData += count;
+			_uSize -= count;
+		}
+	}
+
+	for (; _uSize; _uSize--)
+		TransferByte(*_pData++);
+}
+
 u32 CEXIIPL::GetGCTime()
 {
 	u64 ltime = 0;
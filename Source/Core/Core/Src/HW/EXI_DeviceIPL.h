@@ -64,6 +64,8 @@ private:
 	bool m_FontsLoaded;
 
 	virtual void TransferByte(u8 &_uByte);
+	virtual void BlockRead(u8 *_pData, u32 _uSize);
+	void CheckFontAccess(u32 position, u32 size);
 	bool IsWriteCommand() const { return !!(m_uAddress & (1 << 31)); }
 	u32 CommandRegion() const { return (m_uAddress & ~(1 << 31)) >> 8; }
 
@@ -2,6 +2,8 @@
 // Licensed under GPLv2
 // Refer to the license.txt file included.
 
+#include <algorithm>
+
 #include "Common.h"
 #include "FileUtil.h"
 #include "StringUtil.h"
@@ -45,6 +47,10 @@ void CEXIMemoryCard::CmdDoneCallback(u64 userdata, int cyclesLate)
 CEXIMemoryCard::CEXIMemoryCard(const int index)
 	: card_index(index)
 	, m_bDirty(false)
+	, m_writer_exit(false)
+	, m_num_flushes(0)
+	, m_num_writes(0)
+	, m_blocks_written(0)
 {
 	m_strFilename = (card_index == 0) ? SConfig::GetInstance().m_strMemoryCardA : SConfig::GetInstance().m_strMemoryCardB;
 	if (Movie::IsPlayingInput() && Movie::IsConfigSaved() && Movie::IsUsingMemcard() && Movie::IsStartingFromClearSave())
@@ -100,35 +106,103 @@ CEXIMemoryCard::CEXIMemoryCard(const int index)
 		WARN_LOG(EXPANSIONINTERFACE, "No memory card found. Will create a new one.");
 	}
 	SetCardFlashID(memory_card_content, card_index);
+
+	// A new card has to be written out completely the first time
+	m_dirty_blocks.assign((memory_card_size + BLOCK_SIZE - 1) / BLOCK_SIZE, !pFile);
+	m_sync_mode = SConfig::GetInstance().m_MemcardSync;
+
+	m_writer_thread = std::thread(WriterThread, this);
 }
 
-void innerFlush(FlushData* data)
+void CEXIMemoryCard::WriterThread(CEXIMemoryCard *card)
 {
-	File::IOFile pFile(data->filename, "r+b");
-	if (!pFile)
+	Common::SetCurrentThreadName(card->card_index ? "Memcard B writer" : "Memcard A writer");
+
+	BlockMap blocks;
+	std::unique_lock<std::mutex> lk(card->m_writer_lock);
+	while (true)
 	{
-		std::string dir;
-		SplitPath(data->filename, &dir, 0, 0);
-		if (!File::IsDirectory(dir))
-			File::CreateFullPath(dir);
-		pFile.Open(data->filename, "wb");
+		while (card->m_writer_blocks.empty() && !card->m_writer_exit)
+			card->m_writer_wakeup.wait(lk);
+
+		if (card->m_writer_blocks.empty())
+			break;
+
+		blocks.swap(card->m_writer_blocks);
+		const bool exiting = card->m_writer_exit;
+		lk.unlock();
+
+		card->WriteBlocks(blocks);
+		if (!exiting)
+			Core::DisplayMessage(StringFromFormat("Wrote memory card %c contents to %s",
+				card->card_index ? 'B' : 'A', card->m_strFilename.c_str()).c_str(), 4000);
+		blocks.clear();
+
+		lk.lock();
 	}
+}
 
-	if (!pFile) // Note - pFile changed inside above if
+void CEXIMemoryCard::WriteBlocks(const BlockMap &blocks)
+{
+	if (!m_file.IsOpen())
 	{
-		PanicAlertT("Could not write memory card file %s.\n\n"
-			"Are you running Dolphin from a CD/DVD, or is the save file maybe write protected?\n\n"
-			"Are you receiving this after moving the emulator directory?\nIf so, then you may "
-			"need to re-specify your memory card location in the options.", data->filename.c_str());
-		return;
+		if (!m_file.Open(m_strFilename, "r+b"))
+		{
+			std::string dir;
+			SplitPath(m_strFilename, &dir, 0, 0);
+			if (!File::IsDirectory(dir))
+				File::CreateFullPath(dir);
+			m_file.Open(m_strFilename, "wb");
+		}
+
+		if (!m_file)
+		{
+			PanicAlertT("Could not write memory card file %s.\n\n"
+				"Are you running Dolphin from a CD/DVD, or is the save file maybe write protected?\n\n"
+				"Are you receiving this after moving the emulator directory?\nIf so, then you may "
+				"need to re-specify your memory card location in the options.", m_strFilename.c_str());
+			m_file.Close();
+			return;
+		}
+	}
+
+	// Gather each run of consecutive blocks and write it in one go
+	std::vector<u8> run;
+	BlockMap::const_iterator it = blocks.begin();
+	while (it != blocks.end())
+	{
+		const u32 first = it->first;
+		u32 next = first;
+		run.clear();
+		for (; it != blocks.end() && it->first == next; ++it, ++next)
+			run.insert(run.end(), it->second.begin(), it->second.end());
+
+		m_file.Seek((s64)first * BLOCK_SIZE, SEEK_SET);
+		m_file.WriteBytes(&run[0], run.size());
+		m_num_writes++;
+	}
+	m_blocks_written += (u32)blocks.size();
+
+	if (m_sync_mode == SYNC_FLUSH)
+		m_file.Sync();
+	else
+		m_file.Flush();
+
+	if (!m_file.IsGood())
+	{
+		ERROR_LOG(EXPANSIONINTERFACE, "Error writing memory card %s", m_strFilename.c_str());
+		m_file.Clear();
 	}
+}
 
-	pFile.WriteBytes(data->memcardContent, data->memcardSize);
+void CEXIMemoryCard::MarkDirty(u32 offset, u32 size)
+{
+	if (offset >= (u32)memory_card_size)
+		return;
 
-	if (!data->bExiting)
-		Core::DisplayMessage(StringFromFormat("Wrote memory card %c contents to %s",
-			data->memcardIndex ? 'B' : 'A', data->filename.c_str()).c_str(), 4000);
-	return;
+	const u32 end = std::min(offset + size, (u32)memory_card_size);
+	for (u32 block = offset / BLOCK_SIZE; block * BLOCK_SIZE < end; block++)
+		m_dirty_blocks[block] = true;
 }
 
 // Flush memory card contents to disc
@@ -140,24 +214,25 @@ void CEXIMemoryCard::Flush(bool exiting)
 	if (!Core::g_CoreStartupParameter.bEnableMemcardSaving)
 		return;
 
-	if (flushThread.joinable())
-	{
-		flushThread.join();
-	}
-
 	if(!exiting)
 		Core::DisplayMessage(StringFromFormat("Writing to memory card %c", card_index ? 'B' : 'A'), 1000);
 
-	flushData.filename = m_strFilename;
-	flushData.memcardContent = memory_card_content;
-	flushData.memcardIndex = card_index;
-	flushData.memcardSize = memory_card_size;
-	flushData.bExiting = exiting;
+	{
+		std::lock_guard<std::mutex> lk(m_writer_lock);
+		for (u32 block = 0; block < m_dirty_blocks.size(); block++)
+		{
+			if (!m_dirty_blocks[block])
+				continue;
 
-	flushThread = std::thread(innerFlush, &flushData);
-	if (exiting)
-		flushThread.join();
+			const u8 *data = memory_card_content + block * BLOCK_SIZE;
+			const u32 size = std::min<u32>(BLOCK_SIZE, memory_card_size - block * BLOCK_SIZE);
+			m_writer_blocks[block].assign(data, data + size);
+			m_dirty_blocks[block] = false;
+		}
+	}
+	m_writer_wakeup.notify_one();
 
+	m_num_flushes++;
 	m_bDirty = false;
 }
 
@@ -165,13 +240,26 @@ CEXIMemoryCard::~CEXIMemoryCard()
 {
 	CoreTiming::RemoveEvent(et_this_card);
 	Flush(true);
-	delete[] memory_card_content;
-	memory_card_content = NULL;
-	
-	if (flushThread.joinable())
+
+	{
+		std::lock_guard<std::mutex> lk(m_writer_lock);
+		m_writer_exit = true;
+	}
+	m_writer_wakeup.notify_one();
+	m_writer_thread.join();
+
+	if (m_sync_mode == SYNC_EXIT && m_file.IsOpen())
+		m_file.Sync();
+	m_file.Close();
+
+	if (m_num_flushes)
 	{
-		flushThread.join();
+		NOTICE_LOG(EXPANSIONINTERFACE, "Memory card %c: %u flushes, %u blocks (%u KiB) in %u writes",
+			card_index ? 'B' : 'A', m_num_flushes, m_blocks_written, m_blocks_written * (BLOCK_SIZE / 1024), m_num_writes);
 	}
+
+	delete[] memory_card_content;
+	memory_card_content = NULL;
 }
 
 bool CEXIMemoryCard::IsPresent() 
@@ -196,12 +284,6 @@ void CEXIMemoryCard::CmdDoneLater(u64 cycles)
 
 void CEXIMemoryCard::SetCS(int cs)
 {
-	// So that memory card won't be invalidated during flushing
-	if (flushThread.joinable())
-	{
-		flushThread.join();
-	}
-
 	if (cs)  // not-selected to selected
 	{
 		m_uPosition = 0;
@@ -214,6 +296,7 @@ void CEXIMemoryCard::SetCS(int cs)
 			if (m_uPosition > 2)
 			{
 				memset(memory_card_content + (address & (memory_card_size-1)), 0xFF, 0x2000);
+				MarkDirty(address & (memory_card_size-1), 0x2000);
 				status |= MC_STATUS_BUSY;
 				status &= ~MC_STATUS_READY;
 
@@ -227,6 +310,7 @@ void CEXIMemoryCard::SetCS(int cs)
 			if (m_uPosition > 2)
 			{
 				memset(memory_card_content, 0xFF, memory_card_size);
+				MarkDirty(0, memory_card_size);
 				status &= ~MC_STATUS_BUSY;
 				m_bDirty = true;
 			}
@@ -239,6 +323,7 @@ void CEXIMemoryCard::SetCS(int cs)
 				int i=0;
 				status &= ~0x80;
 
+				MarkDirty(address & ~0x1FF, 0x200);
 				while (count--)
 				{
 					memory_card_content[address] = programming_buffer[i++];
@@ -438,19 +523,6 @@ void CEXIMemoryCard::TransferByte(u8 &byte)
 	DEBUG_LOG(EXPANSIONINTERFACE, "EXI MEMCARD: < %02x", byte);
 }
 
-void CEXIMemoryCard::PauseAndLock(bool doLock, bool unpauseOnUnlock)
-{
-	if (doLock)
-	{
-		// we don't exactly have anything to pause,
-		// but let's make sure the flush thread isn't running.
-		if (flushThread.joinable())
-		{
-			flushThread.join();
-		}
-	}
-}
-
 void CEXIMemoryCard::DoState(PointerWrap &p)
 {
 	// for movie sync, we need to save/load memory card contents (and other data) in savestates.
@@ -476,6 +548,9 @@ void CEXIMemoryCard::DoState(PointerWrap &p)
 		p.Do(memory_card_size);
 		p.DoArray(memory_card_content, memory_card_size); 
 		p.Do(card_index);
+
+		if (p.GetMode() == PointerWrap::MODE_READ)
+			MarkDirty(0, memory_card_size);
 	}
 }
 
@@ -5,16 +5,11 @@
 #ifndef _EXI_DEVICEMEMORYCARD_H
 #define _EXI_DEVICEMEMORYCARD_H
 
-#include "Thread.h"
+#include <map>
+#include <vector>
 
-// Data structure to be passed to the flushing thread.
-struct FlushData
-{
-	bool bExiting;
-	std::string filename;
-	u8 *memcardContent;
-	int memcardSize, memcardIndex;
-};
+#include "FileUtil.h"
+#include "Thread.h"
 
 class CEXIMemoryCard : public IEXIDevice
 {
@@ -26,10 +21,24 @@ public:
 	bool IsInterruptSet();
 	bool IsPresent();
 	void DoState(PointerWrap &p);
-	void PauseAndLock(bool doLock, bool unpauseOnUnlock=true);
 	IEXIDevice* FindDevice(TEXIDevices device_type, int customIndex=-1);
 
 private:
+	enum
+	{
+		BLOCK_SIZE = 0x2000,	// Sector, the unit the card erases in
+	};
+
+	enum
+	{
+		SYNC_NONE = 0,
+		SYNC_FLUSH,
+		SYNC_EXIT,
+	};
+
+	// Copies of changed blocks, by block number
+	typedef std::map<u32, std::vector<u8> > BlockMap;
+
 	// This is scheduled whenever a page write is issued. The this pointer is passed
 	// through the userdata parameter, so that it can then call Flush on the right card.
 	static void FlushCallback(u64 userdata, int cyclesLate);
@@ -37,8 +46,15 @@ private:
 	// Scheduled when a command that required delayed end signaling is done.
 	static void CmdDoneCallback(u64 userdata, int cyclesLate);
 
-	// Flushes the memory card contents to disk.
+	// Hands copies of the changed blocks to the writer thread. Blocks
+	// flushed again before the thread got to them are only written once.
 	void Flush(bool exiting = false);
+	void MarkDirty(u32 offset, u32 size);
+
+	// Writer thread, runs as long as the card is inserted. Consecutive
+	// blocks are written with a single write.
+	static void WriterThread(CEXIMemoryCard *card);
+	void WriteBlocks(const BlockMap &blocks);
 
 	// Signals that the command that was previously executed is now done.
 	void CmdDone();
@@ -85,8 +101,20 @@ private:
 	int memory_card_size; //! in bytes, must be power of 2.
 	u8 *memory_card_content; 
 
-	FlushData flushData;
-	std::thread flushThread;
+	std::vector<bool> m_dirty_blocks;
+	int m_sync_mode;
+
+	std::thread m_writer_thread;
+	std::mutex m_writer_lock;
+	std::condition_variable m_writer_wakeup;
+	BlockMap m_writer_blocks;	// Protected by m_writer_lock
+	bool m_writer_exit;
+	File::IOFile m_file;		// Only used by the writer thread
+
+	// Statistics, logged when the card is removed
+	u32 m_num_flushes;
+	u32 m_num_writes;
+	u32 m_blocks_written;
 	
 protected:
 	virtual void TransferByte(u8 &byte);
@@ -2,6 +2,8 @@
 // Licensed under GPLv2
 // Refer to the license.txt file included.
 
+#include <algorithm>
+
 #include "GCMemcard.h"
 #include "ColorUtil.h"
 static void ByteSwap(u8 *valueA, u8 *valueB)
@@ -14,6 +16,7 @@ static void ByteSwap(u8 *valueA, u8 *valueB)
 GCMemcard::GCMemcard(const char *filename, bool forceCreation, bool sjis)
 	: m_valid(false)
 	, m_fileName(filename)
+	, m_fullSave(false)
 {
 	// Currently there is a string freeze. instead of adding a new message about needing r/w
 	// open file read only, if write is denied the error will be reported at that point
@@ -180,7 +183,8 @@ GCMemcard::GCMemcard(const char *filename, bool forceCreation, bool sjis)
 	}
 
 	mcdFile.Close();
-	
+	m_dirtyBlocks.assign(maxBlock - MC_FST_BLOCKS, false);
+
 	initDirBatPointers();
 }
 
@@ -206,6 +210,60 @@ void GCMemcard::initDirBatPointers()
 		CurrentBat = &bat_backup;
 		PreviousBat = &bat;
 	}
+
+	BuildIndex();
+}
+
+std::string GCMemcard::TitleKey(const DEntry &d)
+{
+	return std::string((const char*)d.Gamecode, 4) + std::string((const char*)d.Filename, DENTRY_STRLEN);
+}
+
+void GCMemcard::BuildIndex()
+{
+	m_titleIndex.clear();
+	m_fileIndices.clear();
+	m_freeBlocks.clear();
+
+	for (u8 i = 0; i < DIRLEN; i++)
+	{
+		if (BE32(CurrentDir->Dir[i].Gamecode) != 0xFFFFFFFF)
+		{
+			m_fileIndices.push_back(i);
+			// Keeps the first of duplicate titles, like the old linear search
+			m_titleIndex.insert(std::make_pair(TitleKey(CurrentDir->Dir[i]), i));
+		}
+	}
+
+	// The BAT covers more blocks than the smaller cards have
+	const u32 lastBlock = std::min<u32>(maxBlock, BAT_SIZE);
+	for (u32 i = MC_FST_BLOCKS; i < lastBlock; i++)
+	{
+		if (CurrentBat->Map[i - MC_FST_BLOCKS] == 0)
+			m_freeBlocks.insert(m_freeBlocks.end(), (u16)i);
+	}
+}
+
+u16 GCMemcard::FindFreeBlock(u16 StartingBlock) const
+{
+	std::set<u16>::const_iterator it = m_freeBlocks.lower_bound(StartingBlock);
+	if (it == m_freeBlocks.end())
+		it = m_freeBlocks.begin();
+	return it == m_freeBlocks.end() ? 0xFFFF : *it;
+}
+
+void GCMemcard::CommitDirectory(Directory &UpdatedDir)
+{
+	UpdatedDir.UpdateCounter = BE16(BE16(UpdatedDir.UpdateCounter) + 1);
+	*PreviousDir = UpdatedDir;
+	std::swap(CurrentDir, PreviousDir);
+}
+
+void GCMemcard::CommitBat(BlockAlloc &UpdatedBat)
+{
+	UpdatedBat.UpdateCounter = BE16(BE16(UpdatedBat.UpdateCounter) + 1);
+	*PreviousBat = UpdatedBat;
+	std::swap(CurrentBat, PreviousBat);
 }
 
 bool GCMemcard::IsAsciiEncoding() const
@@ -215,7 +273,10 @@ bool GCMemcard::IsAsciiEncoding() const
 
 bool GCMemcard::Save()
 {
-	File::IOFile mcdFile(m_fileName, "wb");
+	const bool inPlace = !m_fullSave && File::Exists(m_fileName) &&
+		File::GetSize(m_fileName) == (u64)maxBlock * BLOCK_SIZE;
+
+	File::IOFile mcdFile(m_fileName, inPlace ? "r+b" : "wb");
 	mcdFile.Seek(0, SEEK_SET);
 
 	mcdFile.WriteBytes(&hdr, BLOCK_SIZE);
@@ -225,10 +286,23 @@ bool GCMemcard::Save()
 	mcdFile.WriteBytes(&bat_backup, BLOCK_SIZE);
 	for (unsigned int i = 0; i < maxBlock - MC_FST_BLOCKS; ++i)
 	{
+		if (inPlace)
+		{
+			if (!m_dirtyBlocks[i])
+				continue;
+			// Only seek at the start of a run of changed blocks
+			if (i == 0 || !m_dirtyBlocks[i - 1])
+				mcdFile.Seek((u64)(MC_FST_BLOCKS + i) * BLOCK_SIZE, SEEK_SET);
+		}
 		mcdFile.WriteBytes(mc_data_blocks[i].block, BLOCK_SIZE);
 	}
 
-	return mcdFile.Close();
+	if (!mcdFile.Close())
+		return false;
+
+	m_dirtyBlocks.assign(maxBlock - MC_FST_BLOCKS, false);
+	m_fullSave = false;
+	return true;
 }
 
 void GCMemcard::calc_checksumsBE(u16 *buf, u32 length, u16 *csum, u16 *inv_csum)
@@ -302,32 +376,13 @@ u8 GCMemcard::GetNumFiles() const
 	if (!m_valid)
 		return 0;
 
-	u8 j = 0;
-	for (int i = 0; i < DIRLEN; i++)
-	{
-		if (BE32(CurrentDir->Dir[i].Gamecode)!= 0xFFFFFFFF)
-			 j++;
-	}
-	return j;
+	return (u8)m_fileIndices.size();
 }
 
 u8 GCMemcard::GetFileIndex(u8 fileNumber) const
 {
-	if (m_valid)
-	{
-		u8 j = 0;
-		for (u8 i = 0; i < DIRLEN; i++)
-		{
-			if (BE32(CurrentDir->Dir[i].Gamecode)!= 0xFFFFFFFF)
-			{
-				if (j == fileNumber)
-				{
-					return i;
-				}
-				j++;
-			}
-		}
-	}
+	if (m_valid && fileNumber < m_fileIndices.size())
+		return m_fileIndices[fileNumber];
 	return 0xFF;
 }
 
@@ -344,17 +399,8 @@ u8 GCMemcard::TitlePresent(DEntry d) const
 	if (!m_valid)
 		return DIRLEN;
 
-	u8 i = 0;
-	while(i < DIRLEN)
-	{
-		if ((BE32(CurrentDir->Dir[i].Gamecode) == BE32(d.Gamecode)) &&
-			(!memcmp(CurrentDir->Dir[i].Filename, d.Filename, 32)))
-		{
-			break;
-		}
-		i++;
-	}
-	return i;
+	std::unordered_map<std::string, u8>::const_iterator it = m_titleIndex.find(TitleKey(d));
+	return it == m_titleIndex.end() ? DIRLEN : it->second;
 }
 
 bool GCMemcard::GCI_FileName(u8 index, std::string &filename) const
@@ -565,7 +611,7 @@ u16 GCMemcard::BlockAlloc::NextFreeBlock(u16 StartingBlock) const
 	return 0xFFFF;
 }
 
-bool GCMemcard::BlockAlloc::ClearBlocks(u16 FirstBlock, u16 BlockCount)
+bool GCMemcard::BlockAlloc::ClearBlocks(u16 FirstBlock, u16 BlockCount, std::vector<u16> *freed)
 {
 	std::vector<u16> blocks;
 	while (FirstBlock != 0xFFFF && FirstBlock != 0)
@@ -583,6 +629,8 @@ bool GCMemcard::BlockAlloc::ClearBlocks(u16 FirstBlock, u16 BlockCount)
 		for (unsigned int i = 0; i < length; ++i)
 			Map[blocks.at(i)-MC_FST_BLOCKS] = 0;
 		FreeBlocks = BE16(BE16(FreeBlocks) + BlockCount);
+		if (freed)
+			freed->insert(freed->end(), blocks.begin(), blocks.end());
 
 		return true;
 	}
@@ -620,11 +668,25 @@ u32 GCMemcard::ImportFile(DEntry& direntry, std::vector<GCMBlock> &saveBlocks)
 	if (!m_valid)
 		return NOMEMCARD;
 
-	if (GetNumFiles() >= DIRLEN)
+	Directory UpdatedDir = *CurrentDir;
+	BlockAlloc UpdatedBat = *CurrentBat;
+	u32 ret = ImportFileInternal(direntry, saveBlocks, UpdatedDir, UpdatedBat);
+	if (ret != SUCCESS)
+		return ret;
+
+	CommitDirectory(UpdatedDir);
+	CommitBat(UpdatedBat);
+	return SUCCESS;
+}
+
+u32 GCMemcard::ImportFileInternal(DEntry& direntry, std::vector<GCMBlock> &saveBlocks, Directory &UpdatedDir, BlockAlloc &UpdatedBat)
+{
+	if (m_fileIndices.size() >= DIRLEN)
 	{
 		return OUTOFDIRENTRIES;
 	}
-	if (BE16(CurrentBat->FreeBlocks) < BE16(direntry.BlockCount))
+	int fileBlocks = BE16(direntry.BlockCount);
+	if (BE16(UpdatedBat.FreeBlocks) < fileBlocks || m_freeBlocks.size() < (size_t)fileBlocks)
 	{
 		return OUTOFBLOCKS;
 	}
@@ -634,70 +696,42 @@ u32 GCMemcard::ImportFile(DEntry& direntry, std::vector<GCMBlock> &saveBlocks)
 	}
 
 	// find first free data block
-	u16 firstBlock = CurrentBat->NextFreeBlock(BE16(CurrentBat->LastAllocated));
+	u16 firstBlock = FindFreeBlock(BE16(UpdatedBat.LastAllocated));
 	if (firstBlock == 0xFFFF)
 		return OUTOFBLOCKS;
-	Directory UpdatedDir = *CurrentDir;
-	
+
 	// find first free dir entry
-	for (int i=0; i < DIRLEN; i++)
-	{
-		if (BE32(UpdatedDir.Dir[i].Gamecode) == 0xFFFFFFFF)
-		{
-			UpdatedDir.Dir[i] = direntry;
-			*(u16*)&UpdatedDir.Dir[i].FirstBlock = BE16(firstBlock);
-			UpdatedDir.Dir[i].CopyCounter = UpdatedDir.Dir[i].CopyCounter+1;
-			break;
-		}
-	}
-	UpdatedDir.UpdateCounter = BE16(BE16(UpdatedDir.UpdateCounter) + 1);
-	*PreviousDir = UpdatedDir;
-	if (PreviousDir == &dir )
-	{
-		CurrentDir = &dir;
-		PreviousDir = &dir_backup;
-	}
-	else
-	{
-		CurrentDir = &dir_backup;
-		PreviousDir = &dir;
-	}
+	u8 index = 0;
+	while (index < DIRLEN && BE32(UpdatedDir.Dir[index].Gamecode) != 0xFFFFFFFF)
+		index++;
 
-	int fileBlocks = BE16(direntry.BlockCount);
+	UpdatedDir.Dir[index] = direntry;
+	*(u16*)&UpdatedDir.Dir[index].FirstBlock = BE16(firstBlock);
+	UpdatedDir.Dir[index].CopyCounter = UpdatedDir.Dir[index].CopyCounter+1;
+
+	m_fileIndices.insert(std::lower_bound(m_fileIndices.begin(), m_fileIndices.end(), index), index);
+	m_titleIndex.insert(std::make_pair(TitleKey(direntry), index));
 
 	FZEROGX_MakeSaveGameValid(direntry, saveBlocks);
 	PSO_MakeSaveGameValid(direntry, saveBlocks);
 
-	BlockAlloc UpdatedBat = *CurrentBat;
 	u16 nextBlock;
 	// keep assuming no freespace fragmentation, and copy over all the data
 	for (int i = 0; i < fileBlocks; ++i)
-	{ 
-		if (firstBlock == 0xFFFF)
-			PanicAlert("Fatal Error");
+	{
+		m_freeBlocks.erase(firstBlock);
 		mc_data_blocks[firstBlock - MC_FST_BLOCKS] = saveBlocks[i];
+		m_dirtyBlocks[firstBlock - MC_FST_BLOCKS] = true;
 		if (i == fileBlocks-1)
 			nextBlock = 0xFFFF;
 		else
-			nextBlock = UpdatedBat.NextFreeBlock(firstBlock+1);		
+			nextBlock = FindFreeBlock(firstBlock+1);
 		UpdatedBat.Map[firstBlock - MC_FST_BLOCKS] = BE16(nextBlock);
 		UpdatedBat.LastAllocated = BE16(firstBlock);
 		firstBlock = nextBlock;
 	}
-	
+
 	UpdatedBat.FreeBlocks = BE16(BE16(UpdatedBat.FreeBlocks)  - fileBlocks);
-	UpdatedBat.UpdateCounter = BE16(BE16(UpdatedBat.UpdateCounter) + 1);
-	*PreviousBat = UpdatedBat;
-	if (PreviousBat == &bat )
-	{
-		CurrentBat = &bat;
-		PreviousBat = &bat_backup;
-	}
-	else
-	{
-		CurrentBat = &bat_backup;
-		PreviousBat = &bat;
-	}
 
 	return SUCCESS;
 }
@@ -706,29 +740,35 @@ u32 GCMemcard::RemoveFile(u8 index) //index in the directory array
 {
 	if (!m_valid)
 		return NOMEMCARD;
-	if (index >= DIRLEN)
+
+	Directory UpdatedDir = *CurrentDir;
+	BlockAlloc UpdatedBat = *CurrentBat;
+	u32 ret = RemoveFileInternal(index, UpdatedDir, UpdatedBat);
+	if (ret != SUCCESS)
+		return ret;
+
+	CommitBat(UpdatedBat);
+	CommitDirectory(UpdatedDir);
+	return SUCCESS;
+}
+
+u32 GCMemcard::RemoveFileInternal(u8 index, Directory &UpdatedDir, BlockAlloc &UpdatedBat)
+{
+	if (index >= DIRLEN || BE32(UpdatedDir.Dir[index].Gamecode) == 0xFFFFFFFF)
 		return DELETE_FAIL;
 
-	u16 startingblock = BE16(dir.Dir[index].FirstBlock);
-	u16 numberofblocks = BE16(dir.Dir[index].BlockCount);
+	u16 startingblock = BE16(UpdatedDir.Dir[index].FirstBlock);
+	u16 numberofblocks = BE16(UpdatedDir.Dir[index].BlockCount);
 
-	BlockAlloc UpdatedBat = *CurrentBat;
-	if (!UpdatedBat.ClearBlocks(startingblock, numberofblocks))
+	std::vector<u16> freed;
+	if (!UpdatedBat.ClearBlocks(startingblock, numberofblocks, &freed))
 		return DELETE_FAIL;
-	UpdatedBat.UpdateCounter = BE16(BE16(UpdatedBat.UpdateCounter) + 1);
-	*PreviousBat = UpdatedBat;
-	if (PreviousBat == &bat )
+	for (size_t i = 0; i < freed.size(); ++i)
 	{
-		CurrentBat = &bat;
-		PreviousBat = &bat_backup;
-	}
-	else
-	{
-		CurrentBat = &bat_backup;
-		PreviousBat = &bat;
+		if (freed[i] < maxBlock)
+			m_freeBlocks.insert(freed[i]);
 	}
 
-	Directory UpdatedDir = *CurrentDir;
 	/*
 	// TODO: determine when this is used, even on the same memory card I have seen
 	// both update to broken file, and not updated
@@ -736,34 +776,53 @@ u32 GCMemcard::RemoveFile(u8 index) //index in the directory array
 	*(u16*)&UpdatedDir.Dir[index].Makercode = 0;
 	memset(UpdatedDir.Dir[index].Filename, 0, 0x20);
 	strcpy((char*)UpdatedDir.Dir[index].Filename, "Broken File000");
-	*(u16*)&UpdatedDir.UpdateCounter = BE16(BE16(UpdatedDir.UpdateCounter) + 1);
-
-	*PreviousDir = UpdatedDir;
-	if (PreviousDir == &dir )
-	{
-		CurrentDir = &dir;
-		PreviousDir = &dir_backup;
-	}
-	else
-	{
-		CurrentDir = &dir_backup;
-		PreviousDir = &dir;
-	}
 	*/
+	const std::string key = TitleKey(UpdatedDir.Dir[index]);
 	memset(&(UpdatedDir.Dir[index]), 0xFF, DENTRY_SIZE);
-	UpdatedDir.UpdateCounter = BE16(BE16(UpdatedDir.UpdateCounter) + 1);
-	*PreviousDir = UpdatedDir;
-	if (PreviousDir == &dir )
+
+	m_fileIndices.erase(std::find(m_fileIndices.begin(), m_fileIndices.end(), index));
+	std::unordered_map<std::string, u8>::iterator it = m_titleIndex.find(key);
+	if (it != m_titleIndex.end() && it->second == index)
 	{
-		CurrentDir = &dir;
-		PreviousDir = &dir_backup;
+		m_titleIndex.erase(it);
+		// A card written elsewhere can have the same title twice
+		for (size_t i = 0; i < m_fileIndices.size(); ++i)
+		{
+			if (TitleKey(UpdatedDir.Dir[m_fileIndices[i]]) == key)
+			{
+				m_titleIndex.insert(std::make_pair(key, m_fileIndices[i]));
+				break;
+			}
+		}
 	}
-	else
+
+	return SUCCESS;
+}
+
+u32 GCMemcard::RemoveFiles(const std::vector<u8> &indices, std::vector<u32> &results)
+{
+	results.assign(indices.size(), NOMEMCARD);
+	if (!m_valid)
+		return NOMEMCARD;
+
+	Directory UpdatedDir = *CurrentDir;
+	BlockAlloc UpdatedBat = *CurrentBat;
+	u32 firstError = SUCCESS;
+	bool changed = false;
+	for (size_t i = 0; i < indices.size(); ++i)
 	{
-		CurrentDir = &dir_backup;
-		PreviousDir = &dir;
+		results[i] = RemoveFileInternal(indices[i], UpdatedDir, UpdatedBat);
+		if (results[i] == SUCCESS)
+			changed = true;
+		else if (firstError == SUCCESS)
+			firstError = results[i];
 	}
 
+	if (!changed)
+		return firstError == SUCCESS ? DELETE_FAIL : firstError;
+
+	CommitBat(UpdatedBat);
+	CommitDirectory(UpdatedDir);
 	return SUCCESS;
 }
 
@@ -806,9 +865,8 @@ u32 GCMemcard::ImportGci(const char *inputFile, const std::string &outputFile)
 	return result;
 }
 
-u32 GCMemcard::ImportGciInternal(FILE* gcih, const char *inputFile, const std::string &outputFile)
+u32 GCMemcard::ReadGci(File::IOFile &gci, const char *inputFile, DEntry &tempDEntry, std::vector<GCMBlock> &saveData)
 {
-	File::IOFile gci(gcih);
 	unsigned int offset;
 	char tmp[0xD];
 	std::string fileType;
@@ -838,7 +896,6 @@ u32 GCMemcard::ImportGciInternal(FILE* gcih, const char *inputFile, const std::s
 	}
 	gci.Seek(offset, SEEK_SET);
 
-	DEntry tempDEntry;
 	gci.ReadBytes(&tempDEntry, DENTRY_SIZE);
 	const int fStart = (int)gci.Tell();
 	gci.Seek(0, SEEK_END);
@@ -853,7 +910,6 @@ u32 GCMemcard::ImportGciInternal(FILE* gcih, const char *inputFile, const std::s
 		return OPENFAIL;
 	
 	u32 size = BE16((tempDEntry.BlockCount));
-	std::vector<GCMBlock> saveData;
 	saveData.reserve(size);
 
 	for (unsigned int i = 0; i < size; ++i)
@@ -862,7 +918,18 @@ u32 GCMemcard::ImportGciInternal(FILE* gcih, const char *inputFile, const std::s
 		gci.ReadBytes(b.block, BLOCK_SIZE);
 		saveData.push_back(b);
 	}
-	u32 ret;
+	return SUCCESS;
+}
+
+u32 GCMemcard::ImportGciInternal(FILE* gcih, const char *inputFile, const std::string &outputFile)
+{
+	File::IOFile gci(gcih);
+	DEntry tempDEntry;
+	std::vector<GCMBlock> saveData;
+	u32 ret = ReadGci(gci, inputFile, tempDEntry, saveData);
+	if (ret != SUCCESS)
+		return ret;
+
 	if (!outputFile.empty())
 	{
 		File::IOFile gci2(outputFile, "wb");
@@ -895,6 +962,42 @@ u32 GCMemcard::ImportGciInternal(FILE* gcih, const char *inputFile, const std::s
 	return ret;
 }
 
+u32 GCMemcard::ImportGciBatch(const std::vector<std::string> &inputFiles, std::vector<u32> &results)
+{
+	results.assign(inputFiles.size(), NOMEMCARD);
+	if (!m_valid)
+		return NOMEMCARD;
+
+	Directory UpdatedDir = *CurrentDir;
+	BlockAlloc UpdatedBat = *CurrentBat;
+	u32 firstError = SUCCESS;
+	bool changed = false;
+	for (size_t i = 0; i < inputFiles.size(); ++i)
+	{
+		File::IOFile gci(inputFiles[i], "rb");
+		DEntry tempDEntry;
+		std::vector<GCMBlock> saveData;
+		if (!gci)
+			results[i] = OPENFAIL;
+		else
+			results[i] = ReadGci(gci, inputFiles[i].c_str(), tempDEntry, saveData);
+		if (results[i] == SUCCESS)
+			results[i] = ImportFileInternal(tempDEntry, saveData, UpdatedDir, UpdatedBat);
+
+		if (results[i] == SUCCESS)
+			changed = true;
+		else if (firstError == SUCCESS)
+			firstError = results[i];
+	}
+
+	if (!changed)
+		return firstError == SUCCESS ? FAIL : firstError;
+
+	CommitDirectory(UpdatedDir);
+	CommitBat(UpdatedBat);
+	return SUCCESS;
+}
+
 u32 GCMemcard::ExportGci(u8 index, const char *fileName, const std::string &directory) const
 {
 	File::IOFile gci;
@@ -980,6 +1083,22 @@ u32 GCMemcard::ExportGci(u8 index, const char *fileName, const std::string &dire
 		return WRITEFAIL;
 }
 
+u32 GCMemcard::ExportGciBatch(const std::vector<u8> &indices, const std::string &directory, std::vector<u32> &results) const
+{
+	results.assign(indices.size(), NOMEMCARD);
+	if (!m_valid)
+		return NOMEMCARD;
+
+	u32 firstError = SUCCESS;
+	for (size_t i = 0; i < indices.size(); ++i)
+	{
+		results[i] = ExportGci(indices[i], NULL, directory);
+		if (results[i] != SUCCESS && firstError == SUCCESS)
+			firstError = results[i];
+	}
+	return firstError;
+}
+
 void GCMemcard::Gcs_SavConvert(DEntry &tempDEntry, int saveType, int length)
 {
 	switch(saveType)
@@ -1237,12 +1356,9 @@ bool GCMemcard::Format(bool sjis, u16 SizeMb)
 
 	m_sizeMb = SizeMb;
 	maxBlock = (u32)m_sizeMb * MBIT_TO_BLOCKS;
-	mc_data_blocks.reserve(maxBlock - MC_FST_BLOCKS);
-	for (u32 i = 0; i < (maxBlock - MC_FST_BLOCKS); ++i)
-	{
-		GCMBlock b;
-		mc_data_blocks.push_back(b);
-	}
+	mc_data_blocks.assign(maxBlock - MC_FST_BLOCKS, GCMBlock());
+	m_dirtyBlocks.assign(maxBlock - MC_FST_BLOCKS, false);
+	m_fullSave = true;
 	
 	initDirBatPointers();
 	m_valid = true;
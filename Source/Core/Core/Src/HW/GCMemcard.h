@@ -5,8 +5,14 @@
 #ifndef __GCMEMCARD_h__
 #define __GCMEMCARD_h__
 
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
 #include "Common.h"
 #include "CommonPaths.h"
+#include "FileUtil.h"
 #include "Sram.h"
 #include "StringUtil.h"
 #include "EXI_DeviceIPL.h"
@@ -72,6 +78,10 @@ private:
 		u8 block[BLOCK_SIZE];
 	};
 	std::vector<GCMBlock> mc_data_blocks;
+	// Data blocks changed since the card was read or saved. Unless
+	// m_fullSave is set, Save only writes these and the system blocks.
+	std::vector<bool> m_dirtyBlocks;
+	bool m_fullSave;
 #pragma pack(push,1)
 	struct Header {			//Offset	Size	Description
 		 // Serial in libogc
@@ -157,7 +167,8 @@ private:
 		u16 Map[BAT_SIZE];		//0x000a	0x1ff8	Map of allocated Blocks
 		u16 GetNextBlock(u16 Block) const;
 		u16 NextFreeBlock(u16 StartingBlock=MC_FST_BLOCKS) const;
-		bool ClearBlocks(u16 StartingBlock, u16 Length);
+		// freed gets the blocks that were cleared, if given
+		bool ClearBlocks(u16 StartingBlock, u16 Length, std::vector<u16> *freed = NULL);
 	} bat,bat_backup;
 
 	BlockAlloc *CurrentBat, *PreviousBat;
@@ -169,6 +180,25 @@ private:
 	};
 #pragma pack(pop)
 
+	// Index of CurrentDir and CurrentBat, rebuilt by initDirBatPointers and
+	// kept up to date as files are added and removed
+	std::unordered_map<std::string, u8> m_titleIndex;	// TitleKey -> directory index
+	std::vector<u8> m_fileIndices;	// Directory indices in use, in order
+	std::set<u16> m_freeBlocks;		// Free data blocks the card actually has
+
+	static std::string TitleKey(const DEntry &d);
+	void BuildIndex();
+	// First free block at or after StartingBlock, wrapping around. 0xFFFF if full.
+	u16 FindFreeBlock(u16 StartingBlock) const;
+
+	// Work on copies of the directory and BAT, which CommitDirectory and
+	// CommitBat then make current. Batches commit once for all their files.
+	u32 ImportFileInternal(DEntry& direntry, std::vector<GCMBlock> &saveBlocks, Directory &UpdatedDir, BlockAlloc &UpdatedBat);
+	u32 RemoveFileInternal(u8 index, Directory &UpdatedDir, BlockAlloc &UpdatedBat);
+	void CommitDirectory(Directory &UpdatedDir);
+	void CommitBat(BlockAlloc &UpdatedBat);
+
+	static u32 ReadGci(File::IOFile &gci, const char *inputFile, DEntry &direntry, std::vector<GCMBlock> &saveData);
 	u32 ImportGciInternal(FILE* gcih, const char *inputFile, const std::string &outputFile);
 	static void FormatInternal(GCMC_Header &GCP);
 	void initDirBatPointers() ;
@@ -177,6 +207,8 @@ public:
 	GCMemcard(const char* fileName, bool forceCreation=false, bool sjis=false);
 	bool IsValid() const { return m_valid; }
 	bool IsAsciiEncoding() const;
+	// Writes the system blocks and the data blocks that changed in place,
+	// or the whole card if the file isn't there or doesn't match
 	bool Save();
 	bool Format(bool sjis = false, u16 SizeMb = MemCard2043Mb);
 	static bool Format(u8 * card_data, bool sjis = false, u16 SizeMb = MemCard2043Mb);
@@ -238,6 +270,16 @@ public:
 	// writes a .gci file to disk containing index
 	u32 ExportGci(u8 index, const char* fileName, const std::string &directory) const;
 
+	// Batch versions of ImportGci, RemoveFile and ExportGci. results gets
+	// the code of each file, files that fail are skipped and the rest go on.
+	// Imports and removals update the directory and BAT once for the batch.
+	// Return SUCCESS if anything changed (or everything exported), otherwise
+	// the first error.
+	u32 ImportGciBatch(const std::vector<std::string> &inputFiles, std::vector<u32> &results);
+	u32 RemoveFiles(const std::vector<u8> &indices, std::vector<u32> &results);
+	// Exports under the GCI_FileName names into directory
+	u32 ExportGciBatch(const std::vector<u8> &indices, const std::string &directory, std::vector<u32> &results) const;
+
 	// GCI files are untouched, SAV files are byteswapped
 	// GCS files have the block count set, default is 1 (For export as GCS)
 	static void Gcs_SavConvert(DEntry &tempDEntry, int saveType, int length = BLOCK_SIZE);
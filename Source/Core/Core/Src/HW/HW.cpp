@@ -12,6 +12,7 @@
 #include "EXI.h"
 #include "GPFifo.h"
 #include "Memmap.h"
+#include "MMIO.h"
 #include "ProcessorInterface.h"
 #include "SI.h"
 #include "AudioInterface.h"
@@ -22,6 +23,8 @@
 #include "SystemTimers.h"
 #include "../IPC_HLE/WII_IPC_HLE.h"
 #include "../State.h"
+#include "../Rewind.h"
+#include "../DesyncCheck.h"
 #include "../PowerPC/PPCAnalyst.h"
 
 namespace HW
@@ -43,6 +46,14 @@ namespace HW
 		DVDInterface::Init();
 		GPFifo::Init();
 		ExpansionInterface::Init();
+
+		// Before the CPU core, so the JIT sees the simple registers
+		MMIO::Clear();
+		VideoInterface::RegisterMMIO();
+		ProcessorInterface::RegisterMMIO();
+		SerialInterface::RegisterMMIO();
+		ExpansionInterface::RegisterMMIO();
+
 		CCPU::Init(SConfig::GetInstance().m_LocalCoreStartupParameter.iCPUCore);
 		SystemTimers::Init();
 
@@ -51,12 +62,21 @@ namespace HW
 			WII_IPCInterface::Init();
 			WII_IPC_HLE_Interface::Init();
 		}
+
+		// Both come straight from the ini, keep negative values from wrapping around
+		const SCoreStartupParameter& params = SConfig::GetInstance().m_LocalCoreStartupParameter;
+		Rewind::Init((u32)std::min<int>(std::max(params.iRewindSeconds, 0), Rewind::MAX_SECONDS),
+			(u32)std::min<int>(std::max(params.iRewindInterval, 1), Rewind::MAX_INTERVAL_FRAMES));
+		DesyncCheck::Init();
 	}
 
 	void Shutdown()
 	{
+		Rewind::Shutdown();
+		DesyncCheck::Shutdown();
 		SystemTimers::Shutdown();
 		CCPU::Shutdown();
+		MMIO::Clear();
 		ExpansionInterface::Shutdown();
 		DVDInterface::Shutdown();
 		DSP::Shutdown();
@@ -0,0 +1,80 @@
+// Copyright 2013 Dolphin Emulator Project
+// Licensed under GPLv2
+// Refer to the license.txt file included.
+
+#include <map>
+
+#include "MMIO.h"
+
+namespace MMIO
+{
+
+// Only looked up while compiling, so a map per access size is plenty.
+static std::map<u32, ReadHandler> s_read_handlers[3];
+static std::map<u32, WriteHandler> s_write_handlers[3];
+
+static int SizeIndex(int size)
+{
+	switch (size)
+	{
+	case 8:  return 0;
+	case 16: return 1;
+	case 32: return 2;
+	default:
+		_assert_msg_(MEMMAP, 0, "MMIO: bad access size %i", size);
+		return -1;
+	}
+}
+
+void Clear()
+{
+	for (int i = 0; i < 3; i++)
+	{
+		s_read_handlers[i].clear();
+		s_write_handlers[i].clear();
+	}
+}
+
+void RegisterRead(u32 address, int size, const ReadHandler& handler)
+{
+	int index = SizeIndex(size);
+	if (index >= 0)
+		s_read_handlers[index][address] = handler;
+}
+
+void RegisterWrite(u32 address, int size, const WriteHandler& handler)
+{
+	int index = SizeIndex(size);
+	if (index >= 0)
+		s_write_handlers[index][address] = handler;
+}
+
+ReadHandler GetReadHandler(u32 address, int size)
+{
+	int index = SizeIndex(size);
+	if (index >= 0)
+	{
+		std::map<u32, ReadHandler>::const_iterator it = s_read_handlers[index].find(address);
+		if (it != s_read_handlers[index].end())
+			return it->second;
+	}
+
+	ReadHandler complex = {HANDLER_COMPLEX, 0, NULL, 0xFFFFFFFF};
+	return complex;
+}
+
+WriteHandler GetWriteHandler(u32 address, int size)
+{
+	int index = SizeIndex(size);
+	if (index >= 0)
+	{
+		std::map<u32, WriteHandler>::const_iterator it = s_write_handlers[index].find(address);
+		if (it != s_write_handlers[index].end())
+			return it->second;
+	}
+
+	WriteHandler complex = {HANDLER_COMPLEX, NULL, 0xFFFFFFFF};
+	return complex;
+}
+
+} // namespace MMIO
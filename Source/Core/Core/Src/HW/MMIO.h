@@ -0,0 +1,81 @@
+// Copyright 2013 Dolphin Emulator Project
+// Licensed under GPLv2
+// Refer to the license.txt file included.
+
+#ifndef _MMIO_H_
+#define _MMIO_H_
+
+#include "Common.h"
+
+// Describes how simple hardware registers behave, so that the JIT can access
+// them directly instead of calling through Memory::Read_U32 and the hwRead
+// tables. The interpreter keeps using the tables; every register registered
+// here must behave exactly like its table handler for the given access size.
+// Registers with side effects are simply not registered and stay "complex".
+namespace MMIO
+{
+
+enum HandlerType
+{
+	HANDLER_COMPLEX = 0,	// Go through the normal read/write functions
+	HANDLER_CONSTANT,		// Reads always return the same value
+	HANDLER_DIRECT,			// Reads/writes touch a single host variable
+};
+
+struct ReadHandler
+{
+	HandlerType type;
+	u32 constant;
+	const volatile void* ptr;
+	u32 mask;				// Applied to the value read from ptr
+};
+
+struct WriteHandler
+{
+	HandlerType type;
+	volatile void* ptr;
+	u32 mask;				// Applied to the value before it is stored
+};
+
+void Clear();
+
+// Size is the access size in bits (8, 16 or 32) and must match the size of the
+// variable for direct handlers.
+void RegisterRead(u32 address, int size, const ReadHandler& handler);
+void RegisterWrite(u32 address, int size, const WriteHandler& handler);
+
+// Returns a handler of type HANDLER_COMPLEX when nothing was registered.
+ReadHandler GetReadHandler(u32 address, int size);
+WriteHandler GetWriteHandler(u32 address, int size);
+
+template <typename T>
+inline void RegisterReadConstant(u32 address, T value)
+{
+	ReadHandler handler = {HANDLER_CONSTANT, (u32)value, NULL, 0xFFFFFFFF};
+	RegisterRead(address, sizeof(T) * 8, handler);
+}
+
+template <typename T>
+inline void RegisterReadDirect(u32 address, const volatile T* ptr, u32 mask = 0xFFFFFFFF)
+{
+	ReadHandler handler = {HANDLER_DIRECT, 0, ptr, mask};
+	RegisterRead(address, sizeof(T) * 8, handler);
+}
+
+template <typename T>
+inline void RegisterWriteDirect(u32 address, volatile T* ptr, u32 mask = 0xFFFFFFFF)
+{
+	WriteHandler handler = {HANDLER_DIRECT, ptr, mask};
+	RegisterWrite(address, sizeof(T) * 8, handler);
+}
+
+template <typename T>
+inline void RegisterDirect(u32 address, volatile T* ptr, u32 mask = 0xFFFFFFFF)
+{
+	RegisterReadDirect(address, ptr);
+	RegisterWriteDirect(address, ptr, mask);
+}
+
+} // namespace MMIO
+
+#endif // _MMIO_H_
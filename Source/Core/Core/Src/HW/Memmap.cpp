@@ -71,6 +71,9 @@ u8 *m_pEXRAM;
 u8 *m_pFakeVMEM;
 //u8 *m_pEFB;
 
+// Installed by the JIT verifier around its interpreter runs
+WriteJournalFn m_WriteJournal = NULL;
+
 // 64-bit: Pointers to high-mem mirrors
 // 32-bit: Same as above
 u8 *m_pPhysicalRAM;
@@ -415,10 +418,15 @@ void WriteBigEData(const u8 *_pData, const u32 _Address, const size_t _iSize)
 	memcpy(GetPointer(_Address), _pData, _iSize);
 }
 
+void SetWriteJournal(WriteJournalFn journal)
+{
+	m_WriteJournal = journal;
+}
+
 void Memset(const u32 _Address, const u8 _iValue, const u32 _iLength)
 {
 	u8 *ptr = GetPointer(_Address);
-	if (ptr != NULL)
+	if (ptr != NULL && !m_WriteJournal)
 	{
 		memset(ptr,_iValue,_iLength);
 	}
@@ -169,6 +169,14 @@ void DMA_LCToMemory(const u32 _iMemAddr, const u32 _iCacheAddr, const u32 _iNumB
 void DMA_MemoryToLC(const u32 _iCacheAddr, const u32 _iMemAddr, const u32 _iNumBlocks);
 void Memset(const u32 _Address, const u8 _Data, const u32 _iLength);
 
+// Write journaling, used by the JIT verifier to run the interpreter on a
+// block and roll its side effects back. While a journal is installed every
+// store through Write_* and Memset reports the host bytes it is about to
+// overwrite, and accesses to hardware registers, the EFB or the GP FIFO are
+// not performed at all: they are reported with ptr == NULL and reads return 0.
+typedef void (*WriteJournalFn)(u8* ptr, u32 size, u32 em_address);
+void SetWriteJournal(WriteJournalFn journal);
+
 // TLB functions
 void SDRUpdated();
 enum XCheckTLBFlag
@@ -180,6 +188,8 @@ enum XCheckTLBFlag
 };
 u32 TranslateAddress(u32 _Address, XCheckTLBFlag _Flag);
 void InvalidateTLBEntry(u32 _Address);
+// Drops every cached translation, for SDR1, segment register and BAT writes
+void InvalidateTLB();
 void GenerateDSIException(u32 _EffectiveAdress, bool _bWrite);
 void GenerateISIException(u32 _EffectiveAdress);
 extern u32 pagetable_base;
@@ -60,6 +60,7 @@ extern u8 *m_pEFB;
 // Init
 extern bool m_IsInitialized;
 extern bool bFakeVMEM;
+extern WriteJournalFn m_WriteJournal;
 
 // Read and write shortcuts
 
@@ -88,6 +89,14 @@ inline u8 bswap(u8 val)   {return val;}
 inline u16 bswap(u16 val) {return Common::swap16(val);}
 inline u32 bswap(u32 val) {return Common::swap32(val);}
 inline u64 bswap(u64 val) {return Common::swap64(val);}
+
+template <typename T>
+inline void WriteToMemory(u8 *ptr, const T data, u32 em_address)
+{
+	if (m_WriteJournal)
+		m_WriteJournal(ptr, sizeof(T), em_address);
+	*(T*)ptr = bswap(data);
+}
 // =================
 
 
@@ -153,7 +162,12 @@ inline void ReadFromHardware(T &_var, const u32 em_address, const u32 effective_
 	// TODO: Figure out the fastest order of tests for both read and write (they are probably different).
 	if ((em_address & 0xC8000000) == 0xC8000000)
 	{
-		if (em_address < 0xcc000000)
+		if (m_WriteJournal)
+		{
+			m_WriteJournal(NULL, sizeof(T), em_address);
+			_var = 0;
+		}
+		else if (em_address < 0xcc000000)
 			_var = EFB_Read(em_address);
 		else if (em_address <= 0xcc009000)
 			hwRead(_var, em_address);
@@ -214,6 +228,12 @@ inline void ReadFromHardware(T &_var, const u32 em_address, const u32 effective_
 template <typename T>
 inline void WriteToHardware(u32 em_address, const T data, u32 effective_address, Memory::XCheckTLBFlag flag)
 {
+	if (m_WriteJournal && (em_address & 0xC8000000) == 0xC8000000)
+	{
+		m_WriteJournal(NULL, sizeof(T), em_address);
+		return;
+	}
+
 	// First, let's check for FIFO writes, since they are probably the most common
 	// reason we end up in this function:
 	if (em_address == 0xCC008000)
@@ -273,26 +293,26 @@ inline void WriteToHardware(u32 em_address, const T data, u32 effective_address,
 		((em_address & 0xF0000000) == 0xC0000000) ||
 		((em_address & 0xF0000000) == 0x00000000))
 	{
-		*(T*)&m_pRAM[em_address & RAM_MASK] = bswap(data);
+		WriteToMemory(&m_pRAM[em_address & RAM_MASK], data, em_address);
 		return;
 	}
 	else if (((em_address & 0xF0000000) == 0x90000000) ||
 		((em_address & 0xF0000000) == 0xD0000000) ||
 		((em_address & 0xF0000000) == 0x10000000))
 	{
-		*(T*)&m_pEXRAM[em_address & EXRAM_MASK] = bswap(data);
+		WriteToMemory(&m_pEXRAM[em_address & EXRAM_MASK], data, em_address);
 		return;
 	}
 	else if ((em_address >= 0xE0000000) && (em_address < (0xE0000000+L1_CACHE_SIZE)))
 	{
-		*(T*)&m_pL1Cache[em_address & L1_CACHE_MASK] = bswap(data);
+		WriteToMemory(&m_pL1Cache[em_address & L1_CACHE_MASK], data, em_address);
 		return;
 	}
 	else if ((bFakeVMEM && ((em_address &0xF0000000) == 0x70000000)) ||
 		(bFakeVMEM && ((em_address &0xF0000000) == 0x40000000)))
 	{
 		// fake VMEM
-		*(T*)&m_pFakeVMEM[em_address & FAKEVMEM_MASK] = bswap(data);
+		WriteToMemory(&m_pFakeVMEM[em_address & FAKEVMEM_MASK], data, em_address);
 	}
 	else
 	{
@@ -307,7 +327,7 @@ inline void WriteToHardware(u32 em_address, const T data, u32 effective_address,
 		}
 		else
 		{
-			*(T*)&m_pRAM[tlb_addr & RAM_MASK] = bswap(data);
+			WriteToMemory(&m_pRAM[tlb_addr & RAM_MASK], data, em_address);
 		}
 	}
 }
@@ -681,170 +701,78 @@ void SDRUpdated()
 	}
 	PowerPC::ppcState.pagetable_base = htaborg<<16;
 	PowerPC::ppcState.pagetable_hashmask = ((xx<<10)|0x3ff);
-} 
 
+	// Every cached translation came from the old table
+	InvalidateTLB();
+}
 
-// TLB cache
-//#define FAST_TLB_CACHE
-
-#define TLB_SIZE 128
-#define TLB_WAYS 2
-#define NUM_TLBS 2
 
-#define HW_PAGE_SIZE 4096
+// TLB cache
 #define HW_PAGE_INDEX_SHIFT 12
-#define HW_PAGE_INDEX_MASK 0x3f
-#define HW_PAGE_TAG_SHIFT 18
 
-#define TLB_FLAG_MOST_RECENT 0x01
-#define TLB_FLAG_INVALID 0x02
-
-typedef struct tlb_entry
+static inline PowerPC::TLBSet& GetTLBSet(const XCheckTLBFlag _Flag, const u32 vpa)
 {
-	u32 tag;
-	u32 paddr;
-	u8 flags;
-} tlb_entry;
-
-// TODO: tlb needs to be in ppcState for save-state purposes.
-#ifdef FAST_TLB_CACHE
-static tlb_entry tlb[NUM_TLBS][TLB_SIZE/TLB_WAYS][TLB_WAYS];
-#endif
+	const int tlb = (_Flag == FLAG_OPCODE) ? PowerPC::TLB_INSTRUCTION : PowerPC::TLB_DATA;
+	return PowerPC::ppcState.tlb[tlb][(vpa >> HW_PAGE_INDEX_SHIFT) & (PowerPC::TLB_SETS - 1)];
+}
 
 u32 LookupTLBPageAddress(const XCheckTLBFlag _Flag, const u32 vpa, u32 *paddr)
 {
-#ifdef FAST_TLB_CACHE
-	tlb_entry *tlbe = tlb[_Flag == FLAG_OPCODE][(vpa>>HW_PAGE_INDEX_SHIFT)&HW_PAGE_INDEX_MASK];
-	if(tlbe[0].tag == (vpa & ~0xfff) && !(tlbe[0].flags & TLB_FLAG_INVALID))
-	{
-		tlbe[0].flags |= TLB_FLAG_MOST_RECENT;
-		tlbe[1].flags &= ~TLB_FLAG_MOST_RECENT;
-		*paddr = tlbe[0].paddr | (vpa & 0xfff);
-		return 1;
-	}
-	if(tlbe[1].tag == (vpa & ~0xfff) && !(tlbe[1].flags & TLB_FLAG_INVALID))
-	{
-		tlbe[1].flags |= TLB_FLAG_MOST_RECENT;
-		tlbe[0].flags &= ~TLB_FLAG_MOST_RECENT;
-		*paddr = tlbe[1].paddr | (vpa & 0xfff);
-		return 1;
-	}
-	return 0;
-#else
-	u32 _Address = vpa;
-	if (_Flag == FLAG_OPCODE)
+	const PowerPC::TLBSet& set = GetTLBSet(_Flag, vpa);
+	const u32 tag = vpa >> HW_PAGE_INDEX_SHIFT;
+
+	for (int way = 0; way < PowerPC::TLB_WAYS; way++)
 	{
-		for (u32 i = (PowerPC::ppcState.itlb_last); i > (PowerPC::ppcState.itlb_last - 128); i--)
+		if (set.tag[way] == tag)
 		{
-			if ((_Address & ~0xfff) == (PowerPC::ppcState.itlb_va[i & 127]))
-			{
-				*paddr = PowerPC::ppcState.itlb_pa[i & 127] | (_Address & 0xfff);
-				PowerPC::ppcState.itlb_last = i;
-				return 1;
-			}
-		}
-	}
-	else
-	{
-		for (u32 i = (PowerPC::ppcState.dtlb_last); i > (PowerPC::ppcState.dtlb_last - 128); i--)
-		{
-			if ((_Address & ~0xfff) == (PowerPC::ppcState.dtlb_va[i & 127]))
-			{
-				*paddr = PowerPC::ppcState.dtlb_pa[i & 127] | (_Address & 0xfff);
-				PowerPC::ppcState.dtlb_last = i;
-				return 1;
-			}
+			*paddr = set.paddr[way] | (vpa & 0xfff);
+			return 1;
 		}
 	}
 	return 0;
-#endif
 }
 
 void UpdateTLBEntry(const XCheckTLBFlag _Flag, UPTE2 PTE2, const u32 vpa)
 {
-#ifdef FAST_TLB_CACHE
-	tlb_entry *tlbe = tlb[_Flag == FLAG_OPCODE][(vpa>>HW_PAGE_INDEX_SHIFT)&HW_PAGE_INDEX_MASK];
-	if((tlbe[0].flags & TLB_FLAG_MOST_RECENT) == 0)
-	{
-		tlbe[0].flags = TLB_FLAG_MOST_RECENT;
-		tlbe[1].flags &= ~TLB_FLAG_MOST_RECENT;
-		tlbe[0].paddr = PTE2.RPN << HW_PAGE_INDEX_SHIFT;
-		tlbe[0].tag = vpa & ~0xfff;
-	}
-	else
-	{
-		tlbe[1].flags = TLB_FLAG_MOST_RECENT;
-		tlbe[0].flags &= ~TLB_FLAG_MOST_RECENT;
-		tlbe[1].paddr = PTE2.RPN << HW_PAGE_INDEX_SHIFT;
-		tlbe[1].tag = vpa & ~0xfff;
-	}
-#else
-	if (_Flag == FLAG_OPCODE)
-	{
-		// ITLB cache
-		PowerPC::ppcState.itlb_last++;
-		PowerPC::ppcState.itlb_last &= 127;
-		PowerPC::ppcState.itlb_pa[PowerPC::ppcState.itlb_last] = PTE2.RPN << HW_PAGE_INDEX_SHIFT;
-		PowerPC::ppcState.itlb_va[PowerPC::ppcState.itlb_last] = vpa & ~0xfff;	
-	}
-	else
-	{
-		// DTLB cache
-		PowerPC::ppcState.dtlb_last++;
-		PowerPC::ppcState.dtlb_last &= 127;
-		PowerPC::ppcState.dtlb_pa[PowerPC::ppcState.dtlb_last] = PTE2.RPN << HW_PAGE_INDEX_SHIFT;
-		PowerPC::ppcState.dtlb_va[PowerPC::ppcState.dtlb_last] = vpa & ~0xfff;	
-	}
-#endif
+	PowerPC::TLBSet& set = GetTLBSet(_Flag, vpa);
+	set.tag[1] = set.tag[0];
+	set.paddr[1] = set.paddr[0];
+	set.tag[0] = vpa >> HW_PAGE_INDEX_SHIFT;
+	set.paddr[0] = PTE2.RPN << HW_PAGE_INDEX_SHIFT;
 }
 
 void InvalidateTLBEntry(u32 vpa)
 {
-#ifdef FAST_TLB_CACHE
-	tlb_entry *tlbe = tlb[0][(vpa>>HW_PAGE_INDEX_SHIFT)&HW_PAGE_INDEX_MASK];
-	if(tlbe[0].tag == (vpa & ~0xfff))
-	{
-		tlbe[0].flags |= TLB_FLAG_INVALID;
-	}
-	if(tlbe[1].tag == (vpa & ~0xfff))
-	{
-		tlbe[1].flags |= TLB_FLAG_INVALID;
-	}
-	tlb_entry *tlbe_i = tlb[1][(vpa>>HW_PAGE_INDEX_SHIFT)&HW_PAGE_INDEX_MASK];
-	if(tlbe_i[0].tag == (vpa & ~0xfff))
-	{
-		tlbe_i[0].flags |= TLB_FLAG_INVALID;
-	}
-	if(tlbe_i[1].tag == (vpa & ~0xfff))
-	{
-		tlbe_i[1].flags |= TLB_FLAG_INVALID;
-	}
-#else
-	u32 _Address = vpa;
-	for (int i = 0; i < 128; i++)
+	const u32 tag = vpa >> HW_PAGE_INDEX_SHIFT;
+	for (int tlb = 0; tlb < PowerPC::NUM_TLBS; tlb++)
 	{
-		if ((_Address & ~0xfff) == (PowerPC::ppcState.dtlb_va[(PowerPC::ppcState.dtlb_last + i) & 127]))
+		PowerPC::TLBSet& set = PowerPC::ppcState.tlb[tlb][tag & (PowerPC::TLB_SETS - 1)];
+		for (int way = 0; way < PowerPC::TLB_WAYS; way++)
 		{
-			PowerPC::ppcState.dtlb_pa[(PowerPC::ppcState.dtlb_last + i) & 127] = 0;
-			PowerPC::ppcState.dtlb_va[(PowerPC::ppcState.dtlb_last + i) & 127] = 0;
+			if (set.tag[way] == tag)
+				set.tag[way] = PowerPC::TLB_INVALID_TAG;
 		}
-		if ((_Address & ~0xfff) == (PowerPC::ppcState.itlb_va[(PowerPC::ppcState.itlb_last + i) & 127]))
+	}
+}
+
+void InvalidateTLB()
+{
+	for (int tlb = 0; tlb < PowerPC::NUM_TLBS; tlb++)
+	{
+		for (int i = 0; i < PowerPC::TLB_SETS; i++)
 		{
-			PowerPC::ppcState.itlb_pa[(PowerPC::ppcState.itlb_last + i) & 127] = 0;
-			PowerPC::ppcState.itlb_va[(PowerPC::ppcState.itlb_last + i) & 127] = 0;
+			for (int way = 0; way < PowerPC::TLB_WAYS; way++)
+			{
+				PowerPC::ppcState.tlb[tlb][i].tag[way] = PowerPC::TLB_INVALID_TAG;
+				PowerPC::ppcState.tlb[tlb][i].paddr[way] = 0;
+			}
 		}
 	}
-#endif
 }
 
 // Page Address Translation
 u32 TranslatePageAddress(const u32 _Address, const XCheckTLBFlag _Flag)
 {
-	// TLB cache
-	u32 translatedAddress = 0;
-	if (LookupTLBPageAddress(_Flag, _Address, &translatedAddress))
-		return translatedAddress;
-
 	u32 sr = PowerPC::ppcState.sr[EA_SR(_Address)]; 
 
 	u32 offset = EA_Offset(_Address);			// 12 bit 
@@ -999,7 +927,15 @@ u32 TranslateAddress(const u32 _Address, const XCheckTLBFlag _Flag)
 	// Check MSR[DR] bit before translating data addresses
 	//if (((_Flag == FLAG_READ) || (_Flag == FLAG_WRITE)) && !(MSR & (1 << (31 - 27)))) return _Address;
 
-	u32 tlb_addr = TranslateBlockAddress(_Address, _Flag);
+	// The TLB is checked before the BATs so hits skip the BAT scan too. It only
+	// ever holds pages no BAT covered, and BAT writes flush it. A BAT that only
+	// becomes valid through an MSR[PR] switch isn't noticed, nothing on the GC/Wii
+	// runs in user mode.
+	u32 tlb_addr = 0;
+	if (LookupTLBPageAddress(_Flag, _Address, &tlb_addr))
+		return tlb_addr;
+
+	tlb_addr = TranslateBlockAddress(_Address, _Flag);
 	if (tlb_addr == 0)
 	{
 		tlb_addr = TranslatePageAddress(_Address, _Flag);
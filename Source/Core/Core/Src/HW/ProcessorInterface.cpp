@@ -13,6 +13,7 @@
 #include "../CoreTiming.h"
 #include "ProcessorInterface.h"
 #include "GPFifo.h"
+#include "MMIO.h"
 #include "VideoBackendBase.h"
 
 namespace ProcessorInterface
@@ -90,6 +91,20 @@ void Init()
 	toggleResetButton = CoreTiming::RegisterEvent("ToggleResetButton", ToggleResetButtonCallback);
 }
 
+void RegisterMMIO()
+{
+	const u32 base = 0xCC003000;
+
+	// Writes to the cause and mask registers update the exception state
+	MMIO::RegisterReadDirect(base | PI_INTERRUPT_CAUSE, &m_InterruptCause);
+	MMIO::RegisterReadDirect(base | PI_INTERRUPT_MASK, &m_InterruptMask);
+	MMIO::RegisterDirect(base | PI_FIFO_BASE, &Fifo_CPUBase, 0xFFFFFFE0);
+	MMIO::RegisterDirect(base | PI_FIFO_END, &Fifo_CPUEnd, 0xFFFFFFE0);
+	MMIO::RegisterDirect(base | PI_FIFO_WPTR, &Fifo_CPUWritePointer, 0xFFFFFFE0);
+	MMIO::RegisterDirect(base | PI_RESET_CODE, &m_ResetCode);
+	MMIO::RegisterReadDirect(base | PI_FLIPPER_REV, &m_FlipperRev);
+}
+
 void Read16(u16& _uReturnValue, const u32 _iAddress)
 {
 	u32 word;
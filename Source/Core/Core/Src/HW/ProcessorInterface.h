@@ -42,6 +42,7 @@ extern u32 Fifo_CPUWritePointer;
 
 
 void Init();
+void RegisterMMIO();
 void DoState(PointerWrap &p);
 
 void Read16(u16& _uReturnValue, const u32 _iAddress);
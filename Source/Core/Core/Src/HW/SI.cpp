@@ -14,6 +14,7 @@
 #include "VideoInterface.h"
 
 #include "SI.h"
+#include "MMIO.h"
 #include "SI_DeviceGBA.h"
 
 namespace SerialInterface
@@ -287,6 +288,23 @@ void Shutdown()
 	GBAConnectionWaiter_Shutdown();
 }
 
+void RegisterMMIO()
+{
+	const u32 base = 0xCC006400;
+
+	// Reading the IN registers acknowledges RDST, so only OUT is direct
+	for (int i = 0; i < NUMBER_OF_CHANNELS; i++)
+		MMIO::RegisterDirect(base | (SI_CHANNEL_0_OUT + i * 0xC), &g_Channel[i].m_Out.Hex);
+
+	MMIO::RegisterDirect(base | SI_POLL, &g_Poll.Hex);
+	MMIO::RegisterReadDirect(base | SI_COM_CSR, &g_ComCSR.Hex);
+	MMIO::RegisterReadDirect(base | SI_STATUS_REG, &g_StatusReg.Hex);
+	MMIO::RegisterDirect(base | SI_EXI_CLOCK_COUNT, &g_EXIClockCount.Hex);
+
+	for (u32 i = 0; i < sizeof(g_SIBuffer); i += 4)
+		MMIO::RegisterDirect(base | (0x80 + i), (u32*)&g_SIBuffer[i]);
+}
+
 void Read32(u32& _uReturnValue, const u32 _iAddress)
 {
 	// SIBuffer
@@ -15,6 +15,7 @@ namespace SerialInterface
 
 void Init();
 void Shutdown();
+void RegisterMMIO();
 void DoState(PointerWrap &p);
 
 void UpdateDevices();
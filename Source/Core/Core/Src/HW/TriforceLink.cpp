@@ -0,0 +1,482 @@
+// Copyright 2013 Dolphin Emulator Project
+// Licensed under GPLv2
+// Refer to the license.txt file included.
+
+#include <deque>
+#include <map>
+
+#include "Common.h"
+#include "Atomic.h"
+#include "StringUtil.h"
+#include "Timer.h"
+#include "SFML/Network.hpp"
+
+#include "../ConfigManager.h"
+#include "TriforceLink.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#elif !defined(ANDROID)
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace TriforceLink
+{
+
+enum
+{
+	FRAME_MAGIC = 0x4B4E4C54,	// "TLNK"
+	// A missing packet is given up on once this many later ones are queued
+	REORDER_WINDOW = 64,
+};
+
+struct FrameHeader
+{
+	u32 magic;
+	u32 session;	// Changes when a node restarts
+	u32 sequence;
+	u16 size;
+	u8 source;
+	u8 pad;
+	u64 timestamp;	// Common::Timer::GetTimeUs() of the sender
+};
+
+// One ring per sender and receiver, so each of them has a single producer
+// and a single consumer and needs no locking. Frames are a u32 length
+// followed by the data, head and tail are free running byte counts.
+class SharedMemoryTransport : public Transport
+{
+public:
+	SharedMemoryTransport() : m_segment(NULL), m_node(0)
+#ifdef _WIN32
+		, m_mapping(NULL)
+#endif
+	{}
+
+	~SharedMemoryTransport()
+	{
+		if (!m_segment)
+			return;
+#ifdef _WIN32
+		UnmapViewOfFile(m_segment);
+		CloseHandle(m_mapping);
+#elif !defined(ANDROID)
+		munmap(m_segment, sizeof(Segment));
+#endif
+	}
+
+	bool Open(const std::string &name, u32 node)
+	{
+		m_node = node;
+#ifdef _WIN32
+		m_mapping = CreateFileMappingA(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE, 0, sizeof(Segment), ("Local\\" + name).c_str());
+		if (m_mapping == NULL)
+			return false;
+		m_segment = (Segment*)MapViewOfFile(m_mapping, FILE_MAP_ALL_ACCESS, 0, 0, sizeof(Segment));
+#elif defined(ANDROID)
+		return false;
+#else
+		int fd = shm_open(("/" + name).c_str(), O_RDWR | O_CREAT, S_IRUSR | S_IWUSR);
+		if (fd < 0)
+			return false;
+		void *base = NULL;
+		if (ftruncate(fd, sizeof(Segment)) == 0)
+			base = mmap(NULL, sizeof(Segment), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+		close(fd);
+		m_segment = (base == MAP_FAILED) ? NULL : (Segment*)base;
+#endif
+		if (!m_segment)
+			return false;
+
+		// The segment is zeroed when it is created, which is a valid empty
+		// state. Whatever was sent to the previous user of this node is dropped.
+		u32 version = Common::AtomicLoadAcquire(m_segment->version);
+		if (version != 0 && version != SEGMENT_VERSION)
+		{
+			ERROR_LOG(DVDINTERFACE, "Triforce link: %s is in use by an incompatible version", name.c_str());
+			return false;
+		}
+		Common::AtomicStoreRelease(m_segment->version, (u32)SEGMENT_VERSION);
+		for (u32 i = 0; i < MAX_NODES; i++)
+		{
+			Ring &ring = m_segment->rings[m_node][i];
+			Common::AtomicStoreRelease(ring.tail, Common::AtomicLoadAcquire(ring.head));
+		}
+		return true;
+	}
+
+	bool Send(u32 node, const u8 *data, u32 size)
+	{
+		Ring &ring = m_segment->rings[node][m_node];
+		const u32 head = ring.head;
+		const u32 tail = Common::AtomicLoadAcquire(ring.tail);
+		if (RING_SIZE - (head - tail) < size + 4)
+			return false;
+
+		Write(ring, head, (const u8*)&size, 4);
+		Write(ring, head + 4, data, size);
+		Common::AtomicStoreRelease(ring.head, head + 4 + size);
+		return true;
+	}
+
+	u32 Receive(u8 *data, u32 max_size)
+	{
+		// Checked in node order, the link sorts the frames out anyway
+		for (u32 i = 0; i < MAX_NODES; i++)
+		{
+			Ring &ring = m_segment->rings[m_node][i];
+			const u32 tail = ring.tail;
+			const u32 head = Common::AtomicLoadAcquire(ring.head);
+			if (head == tail)
+				continue;
+
+			u32 size;
+			Read(ring, tail, (u8*)&size, 4);
+			if (head - tail < 4 || size > head - tail - 4)
+			{
+				// Not a frame the sender could have written, start over at head
+				ERROR_LOG(DVDINTERFACE, "Triforce link: bad frame length %u from node %u, ring reset", size, i);
+				Common::AtomicStoreRelease(ring.tail, head);
+				continue;
+			}
+
+			// The whole frame is consumed even if it doesn't fit, so the next
+			// length is read from the right place
+			const bool fits = size <= max_size;
+			if (fits)
+				Read(ring, tail + 4, data, size);
+			Common::AtomicStoreRelease(ring.tail, tail + 4 + size);
+			if (!fits)
+			{
+				WARN_LOG(DVDINTERFACE, "Triforce link: dropped a %u byte frame from node %u", size, i);
+				continue;
+			}
+			if (size)
+				return size;
+		}
+		return 0;
+	}
+
+private:
+	enum
+	{
+		SEGMENT_VERSION = 1,
+		RING_SIZE = 0x8000,
+		RING_MASK = RING_SIZE - 1,
+	};
+
+	struct Ring
+	{
+		volatile u32 head;	// Written by the sender
+		u32 pad0[15];
+		volatile u32 tail;	// Written by the receiver
+		u32 pad1[15];
+		u8 data[RING_SIZE];
+	};
+
+	struct Segment
+	{
+		volatile u32 version;
+		u32 pad[15];
+		Ring rings[MAX_NODES][MAX_NODES];	// [receiver][sender]
+	};
+
+	static void Write(Ring &ring, u32 position, const u8 *data, u32 size)
+	{
+		const u32 offset = position & RING_MASK;
+		const u32 first = std::min<u32>(size, RING_SIZE - offset);
+		memcpy(ring.data + offset, data, first);
+		memcpy(ring.data, data + first, size - first);
+	}
+
+	static void Read(const Ring &ring, u32 position, u8 *data, u32 size)
+	{
+		const u32 offset = position & RING_MASK;
+		const u32 first = std::min<u32>(size, RING_SIZE - offset);
+		memcpy(data, ring.data + offset, first);
+		memcpy(data + first, ring.data, size - first);
+	}
+
+	Segment *m_segment;
+	u32 m_node;
+#ifdef _WIN32
+	HANDLE m_mapping;
+#endif
+};
+
+// Node n listens on base_port + n of the n-th host in the list
+class UDPTransport : public Transport
+{
+public:
+	bool Open(const std::string &hosts, u16 port, u32 node)
+	{
+		m_port = port;
+
+		std::vector<std::string> names;
+		SplitString(hosts, ',', names);
+		for (u32 i = 0; i < MAX_NODES; i++)
+		{
+			std::string name = (i < names.size()) ? StripSpaces(names[i]) : "";
+			m_hosts[i] = name.empty() ? sf::IPAddress::LocalHost : sf::IPAddress(name);
+		}
+
+		if (!m_socket.Bind(m_port + node))
+			return false;
+		m_socket.SetBlocking(false);
+		return true;
+	}
+
+	~UDPTransport()
+	{
+		m_socket.Close();
+	}
+
+	bool Send(u32 node, const u8 *data, u32 size)
+	{
+		return m_socket.Send((const char*)data, size, m_hosts[node], m_port + node) == sf::Socket::Done;
+	}
+
+	u32 Receive(u8 *data, u32 max_size)
+	{
+		std::size_t received = 0;
+		sf::IPAddress address;
+		unsigned short port;
+		if (m_socket.Receive((char*)data, max_size, received, address, port) != sf::Socket::Done)
+			return 0;
+		return (u32)received;
+	}
+
+private:
+	sf::SocketUDP m_socket;
+	sf::IPAddress m_hosts[MAX_NODES];
+	u16 m_port;
+};
+
+struct Source
+{
+	u32 session;
+	u32 next_sequence;
+	// Arrived ahead of next_sequence
+	std::map<u32, std::vector<u8> > early;
+	std::deque<std::vector<u8> > ready;
+};
+
+static Transport *s_transport;
+static u32 s_node;
+static u32 s_session;
+static u32 s_send_sequence[MAX_NODES];
+static Source s_sources[MAX_NODES];
+
+// Statistics, logged on shutdown
+static u32 s_start_time;
+static u32 s_packets_sent;
+static u32 s_packets_received;
+static u64 s_bytes_sent;
+static u64 s_bytes_received;
+static u32 s_send_failures;
+static u32 s_lost;
+static u32 s_duplicates;
+static u32 s_reordered;
+static u64 s_total_latency_us;
+static u64 s_max_latency_us;
+
+void Init()
+{
+	const SConfig &config = SConfig::GetInstance();
+
+	s_node = config.m_TriforceLinkNode;
+	s_session = (u32)Common::Timer::GetTimeUs() ^ (s_node << 24);
+	for (u32 i = 0; i < MAX_NODES; i++)
+	{
+		s_send_sequence[i] = 0;
+		s_sources[i].session = 0;
+		s_sources[i].next_sequence = 0;
+		s_sources[i].early.clear();
+		s_sources[i].ready.clear();
+	}
+
+	s_start_time = Common::Timer::GetTimeMs();
+	s_packets_sent = s_packets_received = 0;
+	s_bytes_sent = s_bytes_received = 0;
+	s_send_failures = s_lost = s_duplicates = s_reordered = 0;
+	s_total_latency_us = s_max_latency_us = 0;
+
+	if (config.m_TriforceLinkMode == LINK_NONE)
+		return;
+	if (s_node >= MAX_NODES)
+	{
+		ERROR_LOG(DVDINTERFACE, "Triforce link: node %u out of range, link disabled", s_node);
+		return;
+	}
+
+	if (config.m_TriforceLinkMode == LINK_SHARED_MEMORY)
+	{
+		SharedMemoryTransport *transport = new SharedMemoryTransport;
+		if (transport->Open(config.m_TriforceLinkName, s_node))
+			s_transport = transport;
+		else
+			delete transport;
+	}
+	else if (config.m_TriforceLinkMode == LINK_UDP)
+	{
+		UDPTransport *transport = new UDPTransport;
+		if (transport->Open(config.m_TriforceLinkHosts, config.m_TriforceLinkPort, s_node))
+			s_transport = transport;
+		else
+			delete transport;
+	}
+
+	if (s_transport)
+		NOTICE_LOG(DVDINTERFACE, "Triforce link: node %u, %s", s_node,
+			config.m_TriforceLinkMode == LINK_UDP ? "UDP" : "shared memory");
+	else
+		ERROR_LOG(DVDINTERFACE, "Triforce link: could not open the transport, link disabled");
+}
+
+void Shutdown()
+{
+	if (!s_transport)
+		return;
+
+	LogStats();
+	delete s_transport;
+	s_transport = NULL;
+}
+
+bool IsEnabled()
+{
+	return s_transport != NULL;
+}
+
+u32 GetNode()
+{
+	return s_node;
+}
+
+u32 GetMaxPayload()
+{
+	return MAX_PACKET_SIZE - sizeof(FrameHeader);
+}
+
+bool Send(u32 node, const u8 *data, u32 size)
+{
+	if (!s_transport || node >= MAX_NODES || node == s_node || size > GetMaxPayload())
+		return false;
+
+	u8 frame[MAX_PACKET_SIZE];
+	FrameHeader *header = (FrameHeader*)frame;
+	header->magic = FRAME_MAGIC;
+	header->session = s_session;
+	header->sequence = s_send_sequence[node];
+	header->size = (u16)size;
+	header->source = (u8)s_node;
+	header->pad = 0;
+	header->timestamp = Common::Timer::GetTimeUs();
+	memcpy(frame + sizeof(FrameHeader), data, size);
+
+	if (!s_transport->Send(node, frame, sizeof(FrameHeader) + size))
+	{
+		s_send_failures++;
+		return false;
+	}
+
+	s_send_sequence[node]++;
+	s_packets_sent++;
+	s_bytes_sent += size;
+	return true;
+}
+
+// Moves the packets that are next in sequence from early to ready
+static void Advance(Source &source)
+{
+	while (!source.early.empty())
+	{
+		std::map<u32, std::vector<u8> >::iterator it = source.early.begin();
+		if (it->first != source.next_sequence)
+		{
+			if (source.early.size() < REORDER_WINDOW)
+				break;
+			s_lost += it->first - source.next_sequence;
+		}
+		source.ready.push_back(std::vector<u8>());
+		source.ready.back().swap(it->second);
+		source.next_sequence = it->first + 1;
+		source.early.erase(it);
+	}
+}
+
+static void Poll()
+{
+	u8 frame[MAX_PACKET_SIZE];
+	u32 size;
+	while ((size = s_transport->Receive(frame, sizeof(frame))) != 0)
+	{
+		const FrameHeader *header = (const FrameHeader*)frame;
+		if (size < sizeof(FrameHeader) || header->magic != FRAME_MAGIC ||
+			header->source >= MAX_NODES || sizeof(FrameHeader) + header->size != size)
+		{
+			WARN_LOG(DVDINTERFACE, "Triforce link: dropped a malformed frame (%u bytes)", size);
+			continue;
+		}
+
+		Source &source = s_sources[header->source];
+		if (source.session != header->session)
+		{
+			source.session = header->session;
+			source.next_sequence = 0;
+			source.early.clear();
+		}
+
+		if (header->sequence < source.next_sequence || source.early.count(header->sequence))
+		{
+			s_duplicates++;
+			continue;
+		}
+		if (header->sequence != source.next_sequence)
+			s_reordered++;
+
+		const u64 latency = Common::Timer::GetTimeUs() - header->timestamp;
+		s_total_latency_us += latency;
+		s_max_latency_us = std::max(s_max_latency_us, latency);
+		s_packets_received++;
+		s_bytes_received += header->size;
+
+		source.early[header->sequence].assign(frame + sizeof(FrameHeader), frame + size);
+		Advance(source);
+	}
+}
+
+bool Receive(u32 &node, std::vector<u8> &data)
+{
+	if (!s_transport)
+		return false;
+
+	Poll();
+	for (u32 i = 0; i < MAX_NODES; i++)
+	{
+		if (!s_sources[i].ready.empty())
+		{
+			node = i;
+			data.swap(s_sources[i].ready.front());
+			s_sources[i].ready.pop_front();
+			return true;
+		}
+	}
+	return false;
+}
+
+void LogStats()
+{
+	const u32 elapsed_ms = std::max<u32>(Common::Timer::GetTimeMs() - s_start_time, 1);
+	NOTICE_LOG(DVDINTERFACE, "Triforce link: sent %u packets (%.1f KB/s), %u failed; received %u packets (%.1f KB/s)",
+		s_packets_sent, s_bytes_sent / 1.024 / elapsed_ms, s_send_failures,
+		s_packets_received, s_bytes_received / 1.024 / elapsed_ms);
+	NOTICE_LOG(DVDINTERFACE, "Triforce link: %u lost, %u duplicates, %u reordered, latency %u us average, %u us max",
+		s_lost, s_duplicates, s_reordered,
+		s_packets_received ? (u32)(s_total_latency_us / s_packets_received) : 0, (u32)s_max_latency_us);
+}
+
+}  // namespace
@@ -0,0 +1,64 @@
+// Copyright 2013 Dolphin Emulator Project
+// Licensed under GPLv2
+// Refer to the license.txt file included.
+
+// Network link between emulated Triforce media boards. Every emulator
+// instance is one cabinet (node), packets between them go through shared
+// memory on the local host or over UDP (TriforceLink* in the [Core] section
+// of Dolphin.ini). Packets from a node are handed out in the order they were
+// sent and the nodes are drained in ascending order, so the media board
+// sees the same sequence no matter how the transport interleaved them.
+
+#ifndef _TRIFORCELINK_H
+#define _TRIFORCELINK_H
+
+#include <vector>
+
+#include "CommonTypes.h"
+
+namespace TriforceLink
+{
+
+enum
+{
+	MAX_NODES = 8,
+	MAX_PACKET_SIZE = 0x800,	// Including the link header
+};
+
+enum LinkMode
+{
+	LINK_NONE = 0,
+	LINK_SHARED_MEMORY,
+	LINK_UDP,
+};
+
+// Moves frames between nodes. Frames may be dropped, duplicated or
+// reordered, the link sorts that out.
+class Transport
+{
+public:
+	virtual ~Transport() {}
+
+	virtual bool Send(u32 node, const u8 *data, u32 size) = 0;
+	// Returns the size of the frame copied to data, 0 if there is none
+	virtual u32 Receive(u8 *data, u32 max_size) = 0;
+};
+
+void Init();
+void Shutdown();
+
+bool IsEnabled();
+u32 GetNode();
+
+// Largest payload Send accepts
+u32 GetMaxPayload();
+
+bool Send(u32 node, const u8 *data, u32 size);
+// Returns the next packet in delivery order, false if there is none
+bool Receive(u32 &node, std::vector<u8> &data);
+
+void LogStats();
+
+}  // namespace
+
+#endif // _TRIFORCELINK_H
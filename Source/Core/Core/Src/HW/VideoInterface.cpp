@@ -10,7 +10,10 @@
 #include "ProcessorInterface.h"
 #include "VideoInterface.h"
 #include "Memmap.h"
+#include "MMIO.h"
 #include "../CoreTiming.h"
+#include "../DesyncCheck.h"
+#include "../Replay.h"
 #include "../HW/SystemTimers.h"
 #include "StringUtil.h"
 
@@ -182,6 +185,26 @@ void Init()
 	UpdateParameters();
 }
 
+void RegisterMMIO()
+{
+	const u32 base = 0xCC002000;
+
+	// Games spin on the beam position and the interrupt flags. Writes all have
+	// side effects, so only reads are registered.
+	MMIO::RegisterReadDirect(base | VI_VERTICAL_TIMING, &m_VerticalTimingRegister.Hex);
+	MMIO::RegisterReadDirect(base | VI_CONTROL_REGISTER, &m_DisplayControlRegister.Hex);
+	MMIO::RegisterReadDirect(base | VI_VERTICAL_BEAM_POSITION, &m_VBeamPos);
+	MMIO::RegisterReadDirect(base | VI_HORIZONTAL_BEAM_POSITION, &m_HBeamPos);
+
+	for (int i = 0; i < 4; i++)
+	{
+		const u32 address = base | (VI_PRERETRACE_HI + i * 4);
+		MMIO::RegisterReadDirect(address, &m_InterruptRegister[i].Hi);
+		MMIO::RegisterReadDirect(address + 2, &m_InterruptRegister[i].Lo);
+		MMIO::RegisterReadDirect(address, &m_InterruptRegister[i].Hex);
+	}
+}
+
 void SetRegionReg(char region)
 {
 	if (!Core::g_CoreStartupParameter.bForceNTSCJ)
@@ -835,12 +858,15 @@ static void BeginField(FieldType field)
 
 	if (xfbAddr)
 		g_video_backend->Video_BeginField(xfbAddr, fbWidth, fbHeight);
+	Replay::FieldBegan(xfbAddr, fbWidth, fbHeight);
 }
 
 static void EndField()
 {
 	g_video_backend->Video_EndField();
 	Core::VideoThrottle();
+	DesyncCheck::FieldEnded();
+	Replay::FieldEnded();
 }
 
 // Purpose: Send VI interrupt when triggered
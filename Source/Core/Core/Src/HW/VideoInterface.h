@@ -322,6 +322,7 @@ union UVIDTVStatus
 	void Preset(bool _bNTSC);
 
 	void Init();
+	void RegisterMMIO();
 	void SetRegionReg(char region);
 	void DoState(PointerWrap &p);
 
@@ -24,9 +24,11 @@
 #include "../../Common/Src/NandPaths.h"
 #include "polarssl/md5.h"
 #include "NetPlayProto.h"
+#include "DesyncCheck.h"
+#include "MovieJournal.h"
 
-// The chunk to allocate movie data in multiples of.
-#define DTM_BASE_LENGTH (1024)
+#include <map>
+#include <set>
 
 std::mutex cs_frameSkip;
 
@@ -43,8 +45,6 @@ u32 g_framesToSkip = 0, g_frameSkipCounter = 0;
 u8 g_numPads = 0;
 ControllerState g_padState;
 DTMHeader tmpHeader;
-u8* tmpInput = NULL;
-size_t tmpInputAllocated = 0;
 u64 g_currentByte = 0, g_totalBytes = 0;
 u64 g_currentFrame = 0, g_totalFrames = 0; // VI
 u64 g_currentLagCount = 0, g_totalLagCount = 0; // just stats
@@ -72,25 +72,121 @@ std::string g_InputDisplay[8];
 
 ManipFunction mfunc = NULL;
 
-void EnsureTmpInputSize(size_t bound)
+// Input of the current movie
+static MovieJournal s_journal;
+
+static bool IsMovieHeader(const DTMHeader &header)
+{
+	return header.filetype[0] == 'D' && header.filetype[1] == 'T' && header.filetype[2] == 'M' &&
+		(header.filetype[3] == 0x1A || header.filetype[3] == 0x1B);
+}
+
+// Journals this instance created, and the journal each movie it saved
+// refers to. Other instances share the state directory, their journals
+// are never touched.
+static std::set<std::string> s_created_journals;
+static std::map<std::string, std::string> s_saved_references;
+static std::mutex s_references_lock;
+
+// Name of the journal the movie in filename refers to, empty if it holds
+// its own input
+static std::string GetReferencedJournal(const std::string &filename)
 {
-	if (tmpInputAllocated >= bound)
+	File::IOFile file(filename, "rb");
+	DTMHeader header;
+	DTMChunkedHeader chunked;
+	if (!file.ReadArray(&header, 1) || !IsMovieHeader(header) || header.filetype[3] != 0x1B ||
+		!file.ReadArray(&chunked, 1) || !chunked.journalLength)
+		return "";
+
+	std::string journal(chunked.journalLength, '\0');
+	if (!file.ReadBytes(&journal[0], chunked.journalLength))
+		return "";
+	return journal;
+}
+
+// Deletes the journals this instance created that neither the movie nor a
+// movie it saved refers to anymore. Saved movies can also have been moved
+// around in the state directory (lastState.sav), so those are read too.
+static void DeleteUnusedJournals()
+{
+	std::lock_guard<std::mutex> lk(s_references_lock);
+	if (s_created_journals.empty())
 		return;
-	// The buffer expands in powers of two of DTM_BASE_LENGTH
-	// (standard exponential buffer growth).
-	size_t newAlloc = DTM_BASE_LENGTH;
-	while (newAlloc < bound)
-		newAlloc *= 2;
-	
-	u8* newTmpInput = new u8[newAlloc];
-	tmpInputAllocated = newAlloc;
-	if (tmpInput != NULL)
+
+	std::set<std::string> used;
+	used.insert(s_journal.GetFilename());
+	for (std::map<std::string, std::string>::iterator it = s_saved_references.begin(); it != s_saved_references.end(); )
+	{
+		if (File::Exists(it->first))
+			used.insert((it++)->second);
+		else
+			s_saved_references.erase(it++);
+	}
+
+	const std::string path = File::GetUserPath(D_STATESAVES_IDX);
+	File::FSTEntry directory;
+	File::ScanDirectoryTree(path, directory);
+	for (size_t i = 0; i < directory.children.size(); i++)
+	{
+		const std::string &name = directory.children[i].virtualName;
+		if (name.size() > 4 && name.compare(name.size() - 4, 4, ".dtm") == 0)
+			used.insert(GetReferencedJournal(path + name));
+	}
+
+	for (std::set<std::string>::iterator it = s_created_journals.begin(); it != s_created_journals.end(); )
+	{
+		if (!used.count(*it) && File::Delete(*it))
+			s_created_journals.erase(it++);
+		else
+			++it;
+	}
+}
+
+// A new journal for every recording or playback. They stay around as long as
+// movies in savestates point into them.
+static bool CreateJournal()
+{
+	s_journal.Close();
+	DeleteUnusedJournals();
+
+	const std::string path = File::GetUserPath(D_STATESAVES_IDX);
+	const u64 now = Common::Timer::GetLocalTimeSinceJan1970();
+	std::string filename;
+	for (int i = 0; filename.empty() || File::Exists(filename); i++)
+		filename = StringFromFormat("%smovie-%llu-%d.dtj", path.c_str(), (unsigned long long)now, i);
+
+	if (!s_journal.Create(filename))
+	{
+		PanicAlertT("Failed to create movie journal %s", filename.c_str());
+		return false;
+	}
+
+	std::lock_guard<std::mutex> lk(s_references_lock);
+	s_created_journals.insert(filename);
+	return true;
+}
+
+// Reads the input of the movie in file, right after its header
+static bool ReadMovieInput(File::IOFile &file, const std::string &filename, const DTMHeader &header, MovieJournal::Chain &chain)
+{
+	if (header.filetype[3] == 0x1A)
+		return s_journal.ImportRaw(file, file.GetSize() - sizeof(DTMHeader), chain);
+
+	DTMChunkedHeader chunked;
+	if (!file.ReadArray(&chunked, 1))
+		return false;
+
+	std::string journal = filename;
+	if (chunked.journalLength)
 	{
-		if (g_totalBytes > 0)
-			memcpy(newTmpInput, tmpInput, (size_t)g_totalBytes);
-		delete[] tmpInput;
+		journal.resize(chunked.journalLength);
+		if (!file.ReadBytes(&journal[0], chunked.journalLength))
+			return false;
 	}
-	tmpInput = newTmpInput;
+
+	return s_journal.ImportChunks(journal, chunked.inputTail, chain) &&
+		MovieJournal::GetChainSize(chain) == chunked.inputSize;
 }
 
 std::string GetInputDisplay()
@@ -449,9 +545,12 @@ bool BeginRecordingInput(int controllers)
 		md5thread.detach();
 		GetSettings();
 	}
+	if (!CreateJournal())
+		return false;
+
 	g_playMode = MODE_RECORDING;
 	author = SConfig::GetInstance().m_strMovieAuthor;
-	EnsureTmpInputSize(1);
+	DesyncCheck::ClearMovieHashes();
 
 	g_currentByte = g_totalBytes = 0;
 
@@ -644,8 +743,7 @@ void RecordInput(SPADStatus *PadStatus, int controllerID)
 		g_bDiscChange = false;
 	}
 
-	EnsureTmpInputSize((size_t)(g_currentByte + 8));
-	memcpy(&(tmpInput[g_currentByte]), &g_padState, 8);
+	s_journal.Write(g_currentByte, (const u8*)&g_padState, 8, g_currentFrame);
 	g_currentByte += 8;
 	g_totalBytes = g_currentByte;
 }
@@ -668,9 +766,8 @@ void RecordWiimote(int wiimote, u8 *data, u8 size)
 		return;
 
 	InputUpdate();
-	EnsureTmpInputSize((size_t)(g_currentByte + size + 1));
-	tmpInput[g_currentByte++] = size;
-	memcpy(&(tmpInput[g_currentByte]), data, size);
+	s_journal.Write(g_currentByte++, &size, 1, g_currentFrame);
+	s_journal.Write(g_currentByte, data, size, g_currentFrame);
 	g_currentByte += size;
 	g_totalBytes = g_currentByte;
 }
@@ -722,13 +819,24 @@ bool PlayInput(const char *filename)
 	if (!g_recordfd.Open(filename, "rb"))
 		return false;
 
+	MovieJournal::Chain chain;
+
 	g_recordfd.ReadArray(&tmpHeader, 1);
 	
-	if(tmpHeader.filetype[0] != 'D' || tmpHeader.filetype[1] != 'T' || tmpHeader.filetype[2] != 'M' || tmpHeader.filetype[3] != 0x1A) {
+	if(!IsMovieHeader(tmpHeader)) {
 		PanicAlertT("Invalid recording file");
 		goto cleanup;
 	}
 
+	if (!CreateJournal())
+		goto cleanup;
+	if (!ReadMovieInput(g_recordfd, filename, tmpHeader, chain))
+	{
+		PanicAlertT("Failed to read the input of %s", filename);
+		goto cleanup;
+	}
+	s_journal.SetChain(chain);
+
 	ReadHeader();
 	g_totalFrames = tmpHeader.frameCount;
 	g_totalLagCount = tmpHeader.lagCount;
@@ -739,12 +847,12 @@ bool PlayInput(const char *filename)
 
 	g_playMode = MODE_PLAYING;
 	
-	g_totalBytes = g_recordfd.GetSize() - 256;
-	EnsureTmpInputSize((size_t)g_totalBytes);
-	g_recordfd.ReadArray(tmpInput, (size_t)g_totalBytes);
+	g_totalBytes = s_journal.GetSize();
 	g_currentByte = 0;
 	g_recordfd.Close();
 
+	DesyncCheck::LoadMovieHashes(std::string(filename) + ".sync");
+
 	// Load savestate (and skip to frame data)
 	if(tmpHeader.bFromSaveState)
 	{
@@ -789,7 +897,9 @@ void LoadInput(const char *filename)
 
 	t_record.ReadArray(&tmpHeader, 1);
 
-	if(tmpHeader.filetype[0] != 'D' || tmpHeader.filetype[1] != 'T' || tmpHeader.filetype[2] != 'M' || tmpHeader.filetype[3] != 0x1A)
+	MovieJournal::Chain chain;
+	if (!IsMovieHeader(tmpHeader) || (!s_journal.IsOpen() && !CreateJournal()) ||
+		!ReadMovieInput(t_record, filename, tmpHeader, chain))
 	{
 		PanicAlertT("Savestate movie %s is corrupted, movie recording stopping...", filename);
 		EndPlayInput(false);
@@ -808,7 +918,7 @@ void LoadInput(const char *filename)
 	if (Core::g_CoreStartupParameter.bWii)
 		ChangeWiiPads(true);
 
-	u64 totalSavedBytes = t_record.GetSize() - 256;
+	u64 totalSavedBytes = MovieJournal::GetChainSize(chain);
 
 	bool afterEnd = false;
 	if (g_currentByte > totalSavedBytes)
@@ -817,18 +927,18 @@ void LoadInput(const char *filename)
 		afterEnd = true;
 	}
 
-	if (!g_bReadOnly || tmpInput == NULL)
+	if (!g_bReadOnly || g_playMode == MODE_NONE)
 	{
 		g_totalFrames = tmpHeader.frameCount;
 		g_totalLagCount = tmpHeader.lagCount;
 		g_totalInputCount = tmpHeader.inputCount;
 
-		EnsureTmpInputSize((size_t)totalSavedBytes);
+		s_journal.SetChain(chain);
 		g_totalBytes = totalSavedBytes;
-		t_record.ReadArray(tmpInput, (size_t)g_totalBytes);
 	}
 	else if (g_currentByte > 0)
 	{
+		u64 i;
 		if (g_currentByte > totalSavedBytes)
 		{
 		}
@@ -836,51 +946,43 @@ void LoadInput(const char *filename)
 		{
 			PanicAlertT("Warning: You loaded a save that's after the end of the current movie. (byte %u > %u) (frame %u > %u). You should load another save before continuing, or load this state with read-only mode off.", (u32)g_currentByte+256, (u32)g_totalBytes+256, (u32)g_currentFrame, (u32)g_totalFrames);
 		}
-		else if(g_currentByte > 0 && g_totalBytes > 0)
+		// verify identical from movie start to the save's current frame
+		else if (g_totalBytes > 0 && !s_journal.Compare(chain, g_currentByte, i))
 		{
-			// verify identical from movie start to the save's current frame
-			u32 len = (u32)g_currentByte;
-			u8* movInput = new u8[len];
-			t_record.ReadArray(movInput, (size_t)len);
-			for (u32 i = 0; i < len; ++i)
+			// this is a "you did something wrong" alert for the user's benefit.
+			// we'll try to say what's going on in excruciating detail, otherwise the user might not believe us.
+			if(IsUsingWiimote(0))
+			{ 
+				// TODO: more detail
+				PanicAlertT("Warning: You loaded a save whose movie mismatches on byte %d (0x%X). You should load another save before continuing, or load this state with read-only mode off. Otherwise you'll probably get a desync.", (int)i+256, (int)i+256);
+			}
+			else
 			{
-				if (movInput[i] != tmpInput[i])
-				{
-					// this is a "you did something wrong" alert for the user's benefit.
-					// we'll try to say what's going on in excruciating detail, otherwise the user might not believe us.
-					if(IsUsingWiimote(0))
-					{ 
-						// TODO: more detail
-						PanicAlertT("Warning: You loaded a save whose movie mismatches on byte %d (0x%X). You should load another save before continuing, or load this state with read-only mode off. Otherwise you'll probably get a desync.", i+256, i+256);
-						memcpy(tmpInput, movInput, g_currentByte);
-					}
-					else
-					{
-						int frame = i/8;
-						ControllerState curPadState;
-						memcpy(&curPadState, &(tmpInput[frame*8]), 8);
-						ControllerState movPadState;
-						memcpy(&movPadState, &(movInput[frame*8]), 8);
-						PanicAlertT("Warning: You loaded a save whose movie mismatches on frame %d. You should load another save before continuing, or load this state with read-only mode off. Otherwise you'll probably get a desync.\n\n"
-							"More information: The current movie is %d frames long and the savestate's movie is %d frames long.\n\n"
-							"On frame %d, the current movie presses:\n"
-							"Start=%d, A=%d, B=%d, X=%d, Y=%d, Z=%d, DUp=%d, DDown=%d, DLeft=%d, DRight=%d, L=%d, R=%d, LT=%d, RT=%d, AnalogX=%d, AnalogY=%d, CX=%d, CY=%d"
-							"\n\n"
-							"On frame %d, the savestate's movie presses:\n"
-							"Start=%d, A=%d, B=%d, X=%d, Y=%d, Z=%d, DUp=%d, DDown=%d, DLeft=%d, DRight=%d, L=%d, R=%d, LT=%d, RT=%d, AnalogX=%d, AnalogY=%d, CX=%d, CY=%d",
-							(int)frame,
-							(int)g_totalFrames, (int)tmpHeader.frameCount,
-							(int)frame,
-							(int)curPadState.Start, (int)curPadState.A, (int)curPadState.B, (int)curPadState.X, (int)curPadState.Y, (int)curPadState.Z, (int)curPadState.DPadUp, (int)curPadState.DPadDown, (int)curPadState.DPadLeft, (int)curPadState.DPadRight, (int)curPadState.L, (int)curPadState.R, (int)curPadState.TriggerL, (int)curPadState.TriggerR, (int)curPadState.AnalogStickX, (int)curPadState.AnalogStickY, (int)curPadState.CStickX, (int)curPadState.CStickY,
-							(int)frame,
-							(int)movPadState.Start, (int)movPadState.A, (int)movPadState.B, (int)movPadState.X, (int)movPadState.Y, (int)movPadState.Z, (int)movPadState.DPadUp, (int)movPadState.DPadDown, (int)movPadState.DPadLeft, (int)movPadState.DPadRight, (int)movPadState.L, (int)movPadState.R, (int)movPadState.TriggerL, (int)movPadState.TriggerR, (int)movPadState.AnalogStickX, (int)movPadState.AnalogStickY, (int)movPadState.CStickX, (int)movPadState.CStickY);
-
-						memcpy(tmpInput, movInput, g_currentByte);
-					}
-					break;
-				}
+				int frame = (int)(i/8);
+				ControllerState curPadState;
+				memset(&curPadState, 0, 8);
+				s_journal.Read(frame*8, (u8*)&curPadState, 8);
+				ControllerState movPadState;
+				memset(&movPadState, 0, 8);
+				s_journal.ReadChain(chain, frame*8, (u8*)&movPadState, 8);
+				PanicAlertT("Warning: You loaded a save whose movie mismatches on frame %d. You should load another save before continuing, or load this state with read-only mode off. Otherwise you'll probably get a desync.\n\n"
+					"More information: The current movie is %d frames long and the savestate's movie is %d frames long.\n\n"
+					"On frame %d, the current movie presses:\n"
+					"Start=%d, A=%d, B=%d, X=%d, Y=%d, Z=%d, DUp=%d, DDown=%d, DLeft=%d, DRight=%d, L=%d, R=%d, LT=%d, RT=%d, AnalogX=%d, AnalogY=%d, CX=%d, CY=%d"
+					"\n\n"
+					"On frame %d, the savestate's movie presses:\n"
+					"Start=%d, A=%d, B=%d, X=%d, Y=%d, Z=%d, DUp=%d, DDown=%d, DLeft=%d, DRight=%d, L=%d, R=%d, LT=%d, RT=%d, AnalogX=%d, AnalogY=%d, CX=%d, CY=%d",
+					(int)frame,
+					(int)g_totalFrames, (int)tmpHeader.frameCount,
+					(int)frame,
+					(int)curPadState.Start, (int)curPadState.A, (int)curPadState.B, (int)curPadState.X, (int)curPadState.Y, (int)curPadState.Z, (int)curPadState.DPadUp, (int)curPadState.DPadDown, (int)curPadState.DPadLeft, (int)curPadState.DPadRight, (int)curPadState.L, (int)curPadState.R, (int)curPadState.TriggerL, (int)curPadState.TriggerR, (int)curPadState.AnalogStickX, (int)curPadState.AnalogStickY, (int)curPadState.CStickX, (int)curPadState.CStickY,
+					(int)frame,
+					(int)movPadState.Start, (int)movPadState.A, (int)movPadState.B, (int)movPadState.X, (int)movPadState.Y, (int)movPadState.Z, (int)movPadState.DPadUp, (int)movPadState.DPadDown, (int)movPadState.DPadLeft, (int)movPadState.DPadRight, (int)movPadState.L, (int)movPadState.R, (int)movPadState.TriggerL, (int)movPadState.TriggerR, (int)movPadState.AnalogStickX, (int)movPadState.AnalogStickY, (int)movPadState.CStickX, (int)movPadState.CStickY);
 			}
-			delete [] movInput;
+
+			// Play on with the savestate's input, chunks can't be spliced
+			s_journal.SetChain(chain);
+			g_totalBytes = totalSavedBytes;
 		}
 	}
 	t_record.Close();
@@ -924,7 +1026,7 @@ void PlayController(SPADStatus *PadStatus, int controllerID)
 {
 	// Correct playback is entirely dependent on the emulator polling the controllers
 	// in the same order done during recording
-	if (!IsPlayingInput() || !IsUsingPad(controllerID) || tmpInput == NULL)
+	if (!IsPlayingInput() || !IsUsingPad(controllerID) || !s_journal.IsOpen())
 		return;
 
 	if (g_currentByte + 8 > g_totalBytes)
@@ -940,7 +1042,12 @@ void PlayController(SPADStatus *PadStatus, int controllerID)
 	PadStatus->err = e;
 
 
-	memcpy(&g_padState, &(tmpInput[g_currentByte]), 8);
+	if (!s_journal.Read(g_currentByte, (u8*)&g_padState, 8))
+	{
+		PanicAlertT("Failed to read movie input at byte %u", (u32)g_currentByte);
+		EndPlayInput(false);
+		return;
+	}
 	g_currentByte += 8;
 	
 	PadStatus->triggerLeft = g_padState.TriggerL;
@@ -1020,7 +1127,7 @@ void PlayController(SPADStatus *PadStatus, int controllerID)
 
 bool PlayWiimote(int wiimote, u8 *data, const WiimoteEmu::ReportFeatures& rptf, int irMode)
 {
-	if(!IsPlayingInput() || !IsUsingWiimote(wiimote) || tmpInput == NULL)
+	if(!IsPlayingInput() || !IsUsingWiimote(wiimote) || !s_journal.IsOpen())
 		return false;
 
 	if (g_currentByte > g_totalBytes)
@@ -1035,7 +1142,8 @@ bool PlayWiimote(int wiimote, u8 *data, const WiimoteEmu::ReportFeatures& rptf,
 	u8* const irData = rptf.ir?(data+rptf.ir):NULL;
 	u8 size = rptf.size;
 
-	u8 sizeInMovie = tmpInput[g_currentByte];
+	u8 sizeInMovie = 0;
+	s_journal.Read(g_currentByte, &sizeInMovie, 1);
 
 	if (size != sizeInMovie)
 	{
@@ -1054,7 +1162,12 @@ bool PlayWiimote(int wiimote, u8 *data, const WiimoteEmu::ReportFeatures& rptf,
 		return false;
 	}
 	
-	memcpy(data, &(tmpInput[g_currentByte]), size);
+	if (!s_journal.Read(g_currentByte, data, size))
+	{
+		PanicAlertT("Failed to read movie input at byte %u", (u32)g_currentByte);
+		EndPlayInput(false);
+		return false;
+	}
 	g_currentByte += size;
 	
 	SetWiiInputDisplayString(wiimote, coreData, accelData, irData);
@@ -1081,19 +1194,15 @@ void EndPlayInput(bool cont)
 		g_bRecordingFromSaveState = false;
 		// we don't clear these things because otherwise we can't resume playback if we load a movie state later
 		//g_totalFrames = g_totalBytes = 0;
-		//delete tmpInput;
-		//tmpInput = NULL;
+		//s_journal.Close();
 	}
 }
 
-void SaveRecording(const char *filename)
+static void GetHeader(DTMHeader &header)
 {
-	File::IOFile save_record(filename, "wb");
-	// Create the real header now and write it
-	DTMHeader header;
 	memset(&header, 0, sizeof(DTMHeader));
 	
-	header.filetype[0] = 'D'; header.filetype[1] = 'T'; header.filetype[2] = 'M'; header.filetype[3] = 0x1A;
+	header.filetype[0] = 'D'; header.filetype[1] = 'T'; header.filetype[2] = 'M'; header.filetype[3] = 0x1B;
 	strncpy((char *)header.gameID, Core::g_CoreStartupParameter.GetUniqueID().c_str(), 6);
 	header.bWii = Core::g_CoreStartupParameter.bWii;
 	header.numControllers = g_numPads & (Core::g_CoreStartupParameter.bWii ? 0xFF : 0x0F);
@@ -1133,10 +1242,30 @@ void SaveRecording(const char *filename)
 	// TODO
 	header.uniqueID = 0; 
 	// header.audioEmulator;
+}
+
+void SaveRecording(const char *filename)
+{
+	File::IOFile save_record(filename, "wb");
+	// Create the real header now and write it
+	DTMHeader header;
+	GetHeader(header);
 
+	// The chunks follow, their offsets are only known once they're written
+	DTMChunkedHeader chunked = { 0, s_journal.GetSize(), 0 };
 	save_record.WriteArray(&header, 1);
+	save_record.WriteArray(&chunked, 1);
 
-	bool success = save_record.WriteArray(tmpInput, (size_t)g_totalBytes);
+	bool success = s_journal.Export(save_record, chunked.inputTail);
+	if (success)
+	{
+		save_record.Seek(sizeof(DTMHeader), SEEK_SET);
+		success = save_record.WriteArray(&chunked, 1);
+	}
+	save_record.Close();
+
+	if (success)
+		success = DesyncCheck::SaveMovieHashes(std::string(filename) + ".sync");
 
 	if (success && g_bRecordingFromSaveState)
 	{
@@ -1151,6 +1280,40 @@ void SaveRecording(const char *filename)
 		Core::DisplayMessage(StringFromFormat("Failed to save %s", filename).c_str(), 2000);
 }
 
+void GetReference(Reference &reference)
+{
+	GetHeader(reference.header);
+
+	reference.journal = s_journal.GetFilename();
+	reference.chunked.inputTail = s_journal.Flush();
+	reference.chunked.inputSize = s_journal.GetSize();
+	reference.chunked.journalLength = (u32)reference.journal.size();
+}
+
+void SaveReference(const char *filename, const Reference &reference)
+{
+	bool saved;
+	{
+		// Written under the lock, so the journal isn't deleted in between
+		std::lock_guard<std::mutex> lk(s_references_lock);
+		s_saved_references[filename] = reference.journal;
+
+		File::IOFile save_record(filename, "wb");
+		saved = save_record.WriteArray(&reference.header, 1) && save_record.WriteArray(&reference.chunked, 1) &&
+			save_record.WriteBytes(reference.journal.data(), reference.journal.size());
+	}
+
+	if (!saved)
+		PanicAlertT("Failed to save %s", filename);
+}
+
+void SaveReference(const char *filename)
+{
+	Reference reference;
+	GetReference(reference);
+	SaveReference(filename, reference);
+}
+
 void SetInputManip(ManipFunction func)
 {
 	mfunc = func;
@@ -1232,8 +1395,7 @@ void GetMD5()
 void Shutdown()
 {
 	g_currentInputCount = g_totalInputCount = g_totalFrames = g_totalBytes = 0;
-	delete [] tmpInput;
-	tmpInput = NULL;
-	tmpInputAllocated = 0;
+	s_journal.Close();
+	DeleteUnusedJournals();
 }
 };
@@ -68,7 +68,7 @@ extern u32 g_rerecords;
 
 #pragma pack(push,1)
 struct DTMHeader {
-	u8 filetype[4];			// Unique Identifier (always "DTM"0x1A)
+	u8 filetype[4];			// Unique Identifier ("DTM"0x1A, "DTM"0x1B if the input is chunked)
 
 	u8 gameID[6];			// The Game ID
 	bool bWii;				// Wii game
@@ -115,6 +115,15 @@ struct DTMHeader {
 };
 static_assert(sizeof(DTMHeader) == 256, "DTMHeader should be 256 bytes");
 
+// Follows the header in chunked movies. The input is the chain of
+// MovieJournal chunks ending at inputTail, either in the journal named after
+// this or, if there is no name, in this file.
+struct DTMChunkedHeader {
+	u64 inputTail;			// File offset of the last chunk, 0 if there is no input
+	u64 inputSize;			// Bytes of input
+	u32 journalLength;		// Length of the journal name that follows
+};
+
 #pragma pack(pop)
 
 void FrameUpdate();
@@ -169,6 +178,18 @@ void PlayController(SPADStatus *PadStatus, int controllerID);
 bool PlayWiimote(int wiimote, u8* data, const struct WiimoteEmu::ReportFeatures& rptf, int irMode);
 void EndPlayInput(bool cont);
 void SaveRecording(const char *filename);
+// A movie that refers to the journal instead of holding the input, for
+// savestates. Taken while the core is paused, it can be saved from any thread.
+struct Reference
+{
+	DTMHeader header;
+	DTMChunkedHeader chunked;
+	std::string journal;
+};
+void GetReference(Reference &reference);
+void SaveReference(const char *filename, const Reference &reference);
+// Both of the above at once, the core must be paused
+void SaveReference(const char *filename);
 void DoState(PointerWrap &p);
 void CheckMD5();
 void GetMD5();
@@ -0,0 +1,448 @@
+// Copyright 2013 Dolphin Emulator Project
+// Licensed under GPLv2
+// Refer to the license.txt file included.
+
+#include <algorithm>
+
+#include "Common.h"
+#include "Hash.h"
+#include "MovieJournal.h"
+
+#include <lzo/lzo1x.h>
+
+// Start of a journal file, so no chunk is ever at offset 0
+#pragma pack(push,1)
+struct JournalHeader
+{
+	u8 filetype[4];		// "DTJ"0x1A
+	u32 version;
+	u64 reserved;
+};
+#pragma pack(pop)
+static const u32 JOURNAL_VERSION = 1;
+
+static const size_t NO_CHUNK = (size_t)-1;
+
+MovieJournal::MovieJournal()
+	: m_end(0), m_open_start(0), m_open_frame(0), m_last_frame(NO_FRAME), m_cache_index(NO_CHUNK)
+{
+}
+
+MovieJournal::~MovieJournal()
+{
+	Close();
+}
+
+bool MovieJournal::Create(const std::string &filename)
+{
+	Close();
+
+	if (lzo_init() != LZO_E_OK)
+		return false;
+
+	if (!m_file.Open(filename, "w+b"))
+	{
+		ERROR_LOG(COMMON, "Movie journal: can't create %s", filename.c_str());
+		return false;
+	}
+
+	JournalHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.filetype, "DTJ\x1A", 4);
+	header.version = JOURNAL_VERSION;
+	if (!m_file.WriteArray(&header, 1))
+	{
+		m_file.Close();
+		return false;
+	}
+
+	m_filename = filename;
+	m_end = sizeof(header);
+	m_wrkmem.resize((LZO1X_1_MEM_COMPRESS + sizeof(u64) - 1) / sizeof(u64));
+	return true;
+}
+
+void MovieJournal::Close()
+{
+	m_file.Close();
+	m_filename.clear();
+	m_end = 0;
+	m_chain.clear();
+	m_open.clear();
+	m_open_start = 0;
+	m_open_frame = 0;
+	m_last_frame = NO_FRAME;
+	m_cache.clear();
+	m_cache_index = NO_CHUNK;
+}
+
+u64 MovieJournal::GetChainSize(const Chain &chain)
+{
+	if (chain.empty())
+		return 0;
+	return chain.back().header.start_byte + chain.back().header.raw_size;
+}
+
+size_t MovieJournal::FindChunk(const Chain &chain, u64 offset)
+{
+	size_t first = 0, last = chain.size();
+	while (last - first > 1)
+	{
+		const size_t middle = (first + last) / 2;
+		if (chain[middle].header.start_byte <= offset)
+			first = middle;
+		else
+			last = middle;
+	}
+	return first;
+}
+
+bool MovieJournal::AppendChunk(const u8 *data, u32 size, u64 parent, u64 start_byte, u64 frame, Chunk &chunk)
+{
+	m_compressed.resize(size + size / 16 + 64 + 3);
+	lzo_uint out_len = 0;
+	const u8 *payload = &m_compressed[0];
+	if (lzo1x_1_compress(data, size, &m_compressed[0], &out_len, &m_wrkmem[0]) != LZO_E_OK || out_len >= size)
+	{
+		payload = data;
+		out_len = size;
+	}
+
+	chunk.offset = m_end;
+	chunk.header.magic = CHUNK_MAGIC;
+	chunk.header.raw_size = size;
+	chunk.header.compressed_size = (u32)out_len;
+	chunk.header.checksum = HashCRC32C(payload, out_len);
+	chunk.header.parent = parent;
+	chunk.header.start_byte = start_byte;
+	chunk.header.start_frame = frame;
+
+	m_file.Seek(m_end, SEEK_SET);
+	if (!m_file.WriteArray(&chunk.header, 1) || !m_file.WriteBytes(payload, out_len))
+	{
+		ERROR_LOG(COMMON, "Movie journal: writing to %s failed", m_filename.c_str());
+		m_file.Clear();
+		return false;
+	}
+
+	m_end += sizeof(ChunkHeader) + out_len;
+	m_file.Flush();
+	return true;
+}
+
+bool MovieJournal::CopyChunk(File::IOFile &src, const Chunk &chunk, File::IOFile &dst, u64 dst_offset, u64 parent, Chunk &copy)
+{
+	m_compressed.resize(chunk.header.compressed_size);
+	src.Seek(chunk.offset + sizeof(ChunkHeader), SEEK_SET);
+	if (chunk.header.compressed_size && !src.ReadBytes(&m_compressed[0], chunk.header.compressed_size))
+		return false;
+	if (HashCRC32C(m_compressed.empty() ? NULL : &m_compressed[0], m_compressed.size()) != chunk.header.checksum)
+	{
+		ERROR_LOG(COMMON, "Movie journal: chunk at %llx is corrupted", (unsigned long long)chunk.offset);
+		return false;
+	}
+
+	copy = chunk;
+	copy.offset = dst_offset;
+	copy.header.parent = parent;
+
+	dst.Seek(dst_offset, SEEK_SET);
+	return dst.WriteArray(&copy.header, 1) &&
+		(m_compressed.empty() || dst.WriteBytes(&m_compressed[0], m_compressed.size()));
+}
+
+bool MovieJournal::LoadChunk(File::IOFile &file, const Chunk &chunk, std::vector<u8> &data)
+{
+	const ChunkHeader &header = chunk.header;
+	m_compressed.resize(header.compressed_size);
+	file.Seek(chunk.offset + sizeof(ChunkHeader), SEEK_SET);
+	if (header.compressed_size && !file.ReadBytes(&m_compressed[0], header.compressed_size))
+	{
+		file.Clear();
+		return false;
+	}
+	if (HashCRC32C(m_compressed.empty() ? NULL : &m_compressed[0], m_compressed.size()) != header.checksum)
+	{
+		ERROR_LOG(COMMON, "Movie journal: chunk at %llx is corrupted", (unsigned long long)chunk.offset);
+		return false;
+	}
+
+	if (header.compressed_size == header.raw_size)
+	{
+		data = m_compressed;
+		return true;
+	}
+
+	data.resize(header.raw_size);
+	lzo_uint out_len = header.raw_size;
+	return lzo1x_decompress_safe(&m_compressed[0], header.compressed_size, &data[0], &out_len, NULL) == LZO_E_OK &&
+		out_len == header.raw_size;
+}
+
+bool MovieJournal::ReadChainHeaders(File::IOFile &file, u64 tail, Chain &chain)
+{
+	chain.clear();
+
+	// Parents always come earlier in the file
+	for (u64 offset = tail; offset; )
+	{
+		Chunk chunk;
+		chunk.offset = offset;
+		file.Seek(offset, SEEK_SET);
+		if (!file.ReadArray(&chunk.header, 1) || chunk.header.magic != CHUNK_MAGIC || chunk.header.parent >= offset)
+		{
+			file.Clear();
+			return false;
+		}
+		chain.push_back(chunk);
+		offset = chunk.header.parent;
+	}
+	std::reverse(chain.begin(), chain.end());
+
+	u64 start_byte = 0;
+	for (size_t i = 0; i < chain.size(); i++)
+	{
+		if (chain[i].header.start_byte != start_byte)
+			return false;
+		start_byte += chain[i].header.raw_size;
+	}
+	return true;
+}
+
+bool MovieJournal::ReadChunks(const Chain &chain, u64 offset, u8 *data, u32 size, std::vector<u8> &cache, size_t &cache_index)
+{
+	while (size)
+	{
+		size_t index = cache_index;
+		if (index == NO_CHUNK || index >= chain.size() || offset < chain[index].header.start_byte ||
+			offset >= chain[index].header.start_byte + chain[index].header.raw_size)
+		{
+			index = FindChunk(chain, offset);
+			cache_index = NO_CHUNK;
+			if (!LoadChunk(m_file, chain[index], cache))
+				return false;
+			cache_index = index;
+		}
+
+		const ChunkHeader &header = chain[index].header;
+		const u32 position = (u32)(offset - header.start_byte);
+		const u32 count = std::min(size, header.raw_size - position);
+		memcpy(data, &cache[position], count);
+		data += count;
+		offset += count;
+		size -= count;
+	}
+	return true;
+}
+
+bool MovieJournal::Read(u64 offset, u8 *data, u32 size)
+{
+	if (offset + size > GetSize())
+		return false;
+
+	if (offset < m_open_start)
+	{
+		const u32 count = (u32)std::min<u64>(size, m_open_start - offset);
+		if (!ReadChunks(m_chain, offset, data, count, m_cache, m_cache_index))
+			return false;
+		data += count;
+		offset += count;
+		size -= count;
+	}
+
+	if (size)
+		memcpy(data, &m_open[(size_t)(offset - m_open_start)], size);
+	return true;
+}
+
+bool MovieJournal::ReadChain(const Chain &chain, u64 offset, u8 *data, u32 size)
+{
+	if (offset + size > GetChainSize(chain))
+		return false;
+
+	size_t index = NO_CHUNK;
+	return ReadChunks(chain, offset, data, size, m_scratch, index);
+}
+
+void MovieJournal::Truncate(u64 offset)
+{
+	if (offset >= m_open_start)
+	{
+		m_open.resize((size_t)(offset - m_open_start));
+		return;
+	}
+
+	// The start of the chunk holding offset becomes the chunk being recorded
+	const size_t index = FindChunk(m_chain, offset);
+	const Chunk chunk = m_chain[index];
+	std::vector<u8> data;
+	if (!LoadChunk(m_file, chunk, data))
+		data.assign(chunk.header.raw_size, 0);
+
+	m_open.assign(data.begin(), data.begin() + (size_t)(offset - chunk.header.start_byte));
+	m_open_start = chunk.header.start_byte;
+	m_open_frame = chunk.header.start_frame;
+	m_chain.resize(index);
+	m_cache_index = NO_CHUNK;
+}
+
+bool MovieJournal::Write(u64 offset, const u8 *data, u32 size, u64 frame)
+{
+	if (offset > GetSize())
+		return false;
+	if (offset < GetSize())
+	{
+		// Going back, what frame the input before offset belongs to is unknown
+		Truncate(offset);
+		m_last_frame = NO_FRAME;
+	}
+
+	// A full chunk is only written once the next frame starts
+	const bool new_frame = m_last_frame != NO_FRAME && frame != m_last_frame;
+	if (m_open.size() >= CHUNK_SIZE && new_frame)
+		Flush();
+
+	if (m_open.empty())
+		m_open_frame = (GetSize() == 0 || new_frame) ? frame : NO_FRAME;
+	m_open.insert(m_open.end(), data, data + size);
+	m_last_frame = frame;
+	return true;
+}
+
+u64 MovieJournal::Flush()
+{
+	if (!m_open.empty())
+	{
+		Chunk chunk;
+		const u64 parent = m_chain.empty() ? 0 : m_chain.back().offset;
+		if (AppendChunk(&m_open[0], (u32)m_open.size(), parent, m_open_start, m_open_frame, chunk))
+		{
+			m_chain.push_back(chunk);
+			m_open_start += m_open.size();
+			m_open.clear();
+		}
+	}
+
+	return m_chain.empty() ? 0 : m_chain.back().offset;
+}
+
+bool MovieJournal::Export(File::IOFile &file, u64 &tail)
+{
+	Flush();
+	if (!m_open.empty())
+		return false;
+
+	u64 offset = file.Tell();
+	tail = 0;
+	for (size_t i = 0; i < m_chain.size(); i++)
+	{
+		Chunk copy;
+		if (!CopyChunk(m_file, m_chain[i], file, offset, tail, copy))
+			return false;
+		tail = copy.offset;
+		offset += sizeof(ChunkHeader) + copy.header.compressed_size;
+	}
+	return true;
+}
+
+bool MovieJournal::ImportChunks(const std::string &filename, u64 tail, Chain &chain)
+{
+	if (filename == m_filename)
+		return ReadChainHeaders(m_file, tail, chain);
+
+	File::IOFile src(filename, "rb");
+	Chain source;
+	if (!src || !ReadChainHeaders(src, tail, source))
+	{
+		ERROR_LOG(COMMON, "Movie journal: no movie at %llx in %s", (unsigned long long)tail, filename.c_str());
+		return false;
+	}
+
+	chain.clear();
+	u64 parent = 0;
+	for (size_t i = 0; i < source.size(); i++)
+	{
+		Chunk copy;
+		if (!CopyChunk(src, source[i], m_file, m_end, parent, copy))
+		{
+			m_file.Clear();
+			return false;
+		}
+		m_end += sizeof(ChunkHeader) + copy.header.compressed_size;
+		chain.push_back(copy);
+		parent = copy.offset;
+	}
+	m_file.Flush();
+	return true;
+}
+
+bool MovieJournal::ImportRaw(File::IOFile &file, u64 size, Chain &chain)
+{
+	chain.clear();
+	m_scratch.resize(CHUNK_SIZE);
+
+	u64 parent = 0;
+	for (u64 position = 0; position < size; )
+	{
+		const u32 count = (u32)std::min<u64>(CHUNK_SIZE, size - position);
+		Chunk chunk;
+		// Only where the movie starts is known to be on a frame
+		if (!file.ReadBytes(&m_scratch[0], count) ||
+			!AppendChunk(&m_scratch[0], count, parent, position, position ? NO_FRAME : 0, chunk))
+			return false;
+		chain.push_back(chunk);
+		parent = chunk.offset;
+		position += count;
+	}
+	return true;
+}
+
+void MovieJournal::SetChain(const Chain &chain)
+{
+	m_chain = chain;
+	m_open.clear();
+	m_open_start = GetChainSize(chain);
+	m_last_frame = NO_FRAME;
+	m_cache_index = NO_CHUNK;
+}
+
+bool MovieJournal::Compare(const Chain &chain, u64 size, u64 &mismatch)
+{
+	std::vector<u8> ours(CHUNK_SIZE), theirs(CHUNK_SIZE);
+
+	for (u64 position = 0; position < size; )
+	{
+		u64 end = std::min<u64>(size, position + CHUNK_SIZE);
+
+		// Both share the chunk, nothing to compare
+		if (position < m_open_start)
+		{
+			const Chunk &a = m_chain[FindChunk(m_chain, position)];
+			const Chunk &b = chain[FindChunk(chain, position)];
+			const u64 chunk_end = a.header.start_byte + a.header.raw_size;
+			if (a.offset == b.offset && a.header.start_byte == b.header.start_byte)
+			{
+				position = std::min(size, chunk_end);
+				continue;
+			}
+			end = std::min(end, chunk_end);
+		}
+
+		const u32 count = (u32)(end - position);
+		if (!Read(position, &ours[0], count) || !ReadChain(chain, position, &theirs[0], count))
+		{
+			mismatch = position;
+			return false;
+		}
+		for (u32 i = 0; i < count; i++)
+		{
+			if (ours[i] != theirs[i])
+			{
+				mismatch = position + i;
+				return false;
+			}
+		}
+		position = end;
+	}
+	return true;
+}
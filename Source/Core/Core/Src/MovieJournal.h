@@ -0,0 +1,134 @@
+// Copyright 2013 Dolphin Emulator Project
+// Licensed under GPLv2
+// Refer to the license.txt file included.
+
+// Append-only store for the input of a movie.
+// Input is collected into chunks of about CHUNK_SIZE bytes, each one is LZO
+// compressed and appended to the journal file once it is full and the next
+// frame starts, so a chunk's start_frame tells where that frame's input
+// begins. Every
+// chunk links to the one before it, so a movie is identified by its last
+// chunk: a savestate only needs the journal name and that offset instead
+// of a copy of all the input. Going back to an earlier point while
+// recording starts a new branch from there, chunks already written are
+// never touched again. Only the chunk being recorded and the last one read
+// are kept in memory.
+//
+// Chunks can live in any file, exported movies carry their own after the
+// DTM header (see Movie.cpp).
+
+#ifndef _MOVIEJOURNAL_H_
+#define _MOVIEJOURNAL_H_
+
+#include <string>
+#include <vector>
+
+#include "CommonTypes.h"
+#include "FileUtil.h"
+
+class MovieJournal
+{
+public:
+	enum
+	{
+		CHUNK_SIZE = 0x10000,
+		CHUNK_MAGIC = 0x4B4E4843,	// "CHNK"
+	};
+	// start_frame of chunks that don't start with the first input of a frame
+	static const u64 NO_FRAME = ~0ULL;
+
+#pragma pack(push,1)
+	struct ChunkHeader
+	{
+		u32 magic;
+		u32 raw_size;
+		u32 compressed_size;	// Same as raw_size if stored uncompressed
+		u32 checksum;			// HashCRC32C of what follows the header
+		u64 parent;				// File offset of the previous chunk, 0 for the first
+		u64 start_byte;			// Offset of the first byte in the movie's input
+		u64 start_frame;		// Frame whose input the chunk starts with, or NO_FRAME
+	};
+#pragma pack(pop)
+
+	struct Chunk
+	{
+		u64 offset;
+		ChunkHeader header;
+	};
+	// Chunks of one movie, first to last. Also the index for seeking.
+	typedef std::vector<Chunk> Chain;
+
+	MovieJournal();
+	~MovieJournal();
+
+	// Starts a new journal file with no input in it
+	bool Create(const std::string &filename);
+	void Close();
+	bool IsOpen() { return m_file.IsOpen(); }
+	const std::string &GetFilename() const { return m_filename; }
+
+	// Bytes of input in the movie
+	u64 GetSize() const { return m_open_start + m_open.size(); }
+
+	bool Read(u64 offset, u8 *data, u32 size);
+	// Drops everything from offset on, then appends data recorded on frame
+	bool Write(u64 offset, const u8 *data, u32 size, u64 frame);
+
+	// Writes out the chunk being recorded and returns the offset of the last
+	// chunk, what a reference to this movie needs. 0 if there is no input.
+	u64 Flush();
+	// Copies the movie's chunks to file, linked to each other at their new
+	// offsets. Returns the offset of the last one in file.
+	bool Export(File::IOFile &file, u64 &tail);
+
+	// Brings the movie ending at tail in filename into this journal. Nothing
+	// is copied if it already is in here.
+	bool ImportChunks(const std::string &filename, u64 tail, Chain &chain);
+	// Input stored the old way, uncompressed and in one piece
+	bool ImportRaw(File::IOFile &file, u64 size, Chain &chain);
+
+	// Makes chain the movie, replacing whatever was recorded
+	void SetChain(const Chain &chain);
+	const Chain &GetChain() const { return m_chain; }
+	static u64 GetChainSize(const Chain &chain);
+
+	// Compares the first size bytes of the movie with chain. Returns false
+	// and the offset of the first difference if they differ.
+	bool Compare(const Chain &chain, u64 size, u64 &mismatch);
+	// Reads from a chain that isn't the movie, without caching
+	bool ReadChain(const Chain &chain, u64 offset, u8 *data, u32 size);
+
+private:
+	bool AppendChunk(const u8 *data, u32 size, u64 parent, u64 start_byte, u64 frame, Chunk &chunk);
+	bool CopyChunk(File::IOFile &src, const Chunk &chunk, File::IOFile &dst, u64 dst_offset, u64 parent, Chunk &copy);
+	bool LoadChunk(File::IOFile &file, const Chunk &chunk, std::vector<u8> &data);
+	// Reads through cache, which holds the chunk with index cache_index
+	bool ReadChunks(const Chain &chain, u64 offset, u8 *data, u32 size, std::vector<u8> &cache, size_t &cache_index);
+	// Index of the chunk holding offset, which must be in the chain
+	static size_t FindChunk(const Chain &chain, u64 offset);
+	static bool ReadChainHeaders(File::IOFile &file, u64 tail, Chain &chain);
+	void Truncate(u64 offset);
+
+	File::IOFile m_file;
+	std::string m_filename;
+	u64 m_end;
+
+	Chain m_chain;
+
+	// The chunk being recorded, not in the file yet
+	std::vector<u8> m_open;
+	u64 m_open_start;
+	u64 m_open_frame;
+	// Frame of the last write, NO_FRAME if unknown
+	u64 m_last_frame;
+
+	// Last chunk read
+	std::vector<u8> m_cache;
+	size_t m_cache_index;
+
+	std::vector<u8> m_compressed;
+	std::vector<u8> m_scratch;
+	std::vector<u64> m_wrkmem;	// LZO work memory, u64 for its alignment
+};
+
+#endif // _MOVIEJOURNAL_H_
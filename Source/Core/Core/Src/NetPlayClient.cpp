@@ -60,7 +60,11 @@ NetPlayClient::~NetPlayClient()
 }
 
 // called from ---GUI--- thread
-NetPlayClient::NetPlayClient(const std::string& address, const u16 port, NetPlayUI* dialog, const std::string& name) : m_dialog(dialog), m_is_running(false), m_do_loop(true)
+NetPlayClient::NetPlayClient(const std::string& address, const u16 port, NetPlayUI* dialog, const std::string& name)
+	: m_dialog(dialog), m_is_running(false), m_do_loop(true)
+	, m_server_address(address), m_server_port(port)
+	, m_udp_pads(false), m_udp_active(false), m_udp_bound(false)
+	, m_udp_ack_pending(false), m_udp_sequence(0), m_udp_last_send(0)
 {
 	m_target_buffer_size = 20;
 	ClearBuffers();
@@ -269,6 +273,10 @@ unsigned int NetPlayClient::OnData(sf::Packet& packet)
 			packet >> g_NetPlaySettings.m_DSPEnableJIT;
 			packet >> g_NetPlaySettings.m_DSPHLE;
 			packet >> g_NetPlaySettings.m_WriteToMemcard;
+			packet >> g_NetPlaySettings.m_UDPPads;
+			m_udp_pads = g_NetPlaySettings.m_UDPPads;
+			packet >> g_NetPlaySettings.m_DesyncCheckInterval;
+			packet >> g_NetPlaySettings.m_DesyncCheckRanges;
 			int tmp;
 			packet >> tmp;
 			g_NetPlaySettings.m_EXIDevice[0] = (TEXIDevices) tmp;
@@ -292,6 +300,7 @@ unsigned int NetPlayClient::OnData(sf::Packet& packet)
 			std::lock_guard<std::recursive_mutex> lkg(m_crit.game);
 			m_is_running = false;
 			NetPlay_Disable();
+			StopUDP();
 		}
 		break;
 
@@ -324,6 +333,22 @@ unsigned int NetPlayClient::OnData(sf::Packet& packet)
 		}
 		break;
 
+	case NP_MSG_DESYNC :
+		{
+			u32 field, mask;
+			PlayerId pid, other_pid;
+			packet >> field >> mask >> pid >> other_pid;
+
+			// don't need lock to read in this thread
+			const std::string message = StringFromFormat("Desync at field %u between %s[%d] and %s[%d]: %s",
+				field, m_players[pid].name.c_str(), pid, m_players[other_pid].name.c_str(), other_pid,
+				DesyncCheck::DescribeRegions(field, mask).c_str());
+			ERROR_LOG(NETPLAY, "%s", message.c_str());
+			Core::DisplayMessage(message, 10000);
+			m_dialog->AppendChat(" *** " + message);
+		}
+		break;
+
 	default :
 		PanicAlertT("Unknown message received with id : %d", mid);
 		break;
@@ -338,7 +363,8 @@ void NetPlayClient::ThreadFunc()
 {
 	while (m_do_loop)
 	{
-		if (m_selector.Wait(0.01f))
+		// Poll faster while pad data comes in over UDP
+		if (m_selector.Wait(m_udp_active ? 0.001f : 0.01f))
 		{
 			sf::Packet rpac;
 			switch (m_socket.Receive(rpac))
@@ -351,15 +377,20 @@ void NetPlayClient::ThreadFunc()
 			default :
 				m_is_running = false;
 				NetPlay_Disable();
+				StopUDP();
 				m_dialog->AppendChat("< LOST CONNECTION TO SERVER >");
 				PanicAlertT("Lost connection to server!");
 				m_do_loop = false;
 				break;
 			}
 		}
+
+		if (m_udp_active)
+			UpdateUDP();
 	}
 
 	m_socket.Close();
+	m_udp_socket.Close();
 
 	return;
 }
@@ -428,6 +459,16 @@ void NetPlayClient::SendChatMessage(const std::string& msg)
 // called from ---CPU--- thread
 void NetPlayClient::SendPadState(const PadMapping in_game_pad, const NetPad& np)
 {
+	{
+	std::lock_guard<std::recursive_mutex> lks(m_crit.send);
+	if (m_udp_active)
+	{
+		// Sent by the caller together with the other new states
+		m_udp_sent[in_game_pad].Push(np);
+		return;
+	}
+	}
+
 	// send to server
 	sf::Packet spac;
 	spac << (MessageId)NP_MSG_PAD_DATA;
@@ -438,6 +479,19 @@ void NetPlayClient::SendPadState(const PadMapping in_game_pad, const NetPad& np)
 	m_socket.Send(spac);
 }
 
+// called from ---CPU--- thread
+void NetPlayClient::SendSyncHash(const DesyncCheck::Record& record)
+{
+	sf::Packet spac;
+	spac << (MessageId)NP_MSG_SYNC_HASH;
+	spac << record.field;
+	for (int i = 0; i < DesyncCheck::NUM_REGIONS; i++)
+		spac << record.hashes[i];
+
+	std::lock_guard<std::recursive_mutex> lks(m_crit.send);
+	m_socket.Send(spac);
+}
+
 // called from ---CPU--- thread
 void NetPlayClient::SendWiimoteState(const PadMapping in_game_pad, const NetWiimote& nw)
 {
@@ -480,6 +534,8 @@ bool NetPlayClient::StartGame(const std::string &path)
 	NetPlay_Enable(this);
 
 	ClearBuffers();
+	if (m_udp_pads)
+		StartUDP();
 
 	if (m_dialog->IsRecording())
 	{
@@ -531,6 +587,166 @@ bool NetPlayClient::ChangeGame(const std::string&)
 	return true;
 }
 
+// called from ---GUI--- thread
+void NetPlayClient::StartUDP()
+{
+	std::lock_guard<std::recursive_mutex> lks(m_crit.send);
+
+	// Each player gets its own port, so several clients can run on one machine
+	if (!m_udp_bound && !(m_udp_bound = m_udp_socket.Bind(m_server_port + m_pid)))
+	{
+		PanicAlertT("Could not open UDP port %d, pad data will go over TCP.", m_server_port + m_pid);
+		return;
+	}
+
+	for (unsigned int i = 0; i < 4; ++i)
+	{
+		m_udp_sent[i].Reset();
+		m_udp_received[i] = 0;
+	}
+	m_udp_ack_pending = false;
+	m_udp_stats.Reset();
+	m_udp_active = true;
+
+	// Let the server know where to send to
+	SendUDP();
+}
+
+// called from ---GUI--- thread and ---NETPLAY--- thread
+void NetPlayClient::StopUDP()
+{
+	std::lock_guard<std::recursive_mutex> lks(m_crit.send);
+
+	if (!m_udp_active)
+		return;
+
+	m_udp_active = false;
+	NOTICE_LOG(NETPLAY, "UDP pad data from server: %s", m_udp_stats.ToString().c_str());
+}
+
+// called from ---NETPLAY--- thread
+void NetPlayClient::UpdateUDP()
+{
+	std::lock_guard<std::recursive_mutex> lks(m_crit.send);
+
+	if (!m_udp_active)
+		return;
+
+	sf::Packet packet;
+	sf::IPAddress address;
+	u16 port;
+	while (m_udp_socket.Receive(packet, address, port))
+		OnUDPData(packet);
+
+	bool unacked = m_udp_ack_pending;
+	for (unsigned int i = 0; i < 4; ++i)
+		unacked |= m_udp_sent[i].Begin() != m_udp_sent[i].End();
+
+	const u32 elapsed = NetPlayUDP::GetTime() - m_udp_last_send;
+	if ((unacked && elapsed >= NetPlayUDP::RESEND_INTERVAL_US) || elapsed >= NetPlayUDP::KEEPALIVE_INTERVAL_US)
+		SendUDP();
+
+	m_udp_socket.Update();
+}
+
+// called from ---CPU--- thread and ---NETPLAY--- thread
+void NetPlayClient::SendUDP()
+{
+	const u32 now = NetPlayUDP::GetTime();
+
+	NetPlayUDP::Header header;
+	header.game = m_current_game;
+	header.pid = m_pid;
+	header.sequence = m_udp_sequence++;
+	header.timestamp = now;
+	m_udp_stats.SetEcho(header, now);
+
+	sf::Packet packet;
+	NetPlayUDP::WriteHeader(packet, header);
+
+	// Tell the server which states of the other pads we have
+	u8 num_acks = 0;
+	for (PadMapping i = 0; i < 4; ++i)
+	{
+		if (m_pad_map[i] > 0 && m_pad_map[i] != m_pid)
+			num_acks++;
+	}
+	packet << num_acks;
+	for (PadMapping i = 0; i < 4; ++i)
+	{
+		if (m_pad_map[i] > 0 && m_pad_map[i] != m_pid)
+			packet << i << m_udp_received[i];
+	}
+
+	// and repeat ours until it has them
+	u8 num_runs = 0;
+	for (PadMapping i = 0; i < 4; ++i)
+	{
+		if (m_udp_sent[i].Begin() != m_udp_sent[i].End())
+			num_runs++;
+	}
+	packet << num_runs;
+	for (PadMapping i = 0; i < 4; ++i)
+	{
+		if (m_udp_sent[i].Begin() != m_udp_sent[i].End())
+			NetPlayUDP::WritePadRun(packet, i, m_udp_sent[i], m_udp_sent[i].Begin());
+	}
+
+	m_udp_socket.Send(packet, m_server_address, m_server_port);
+	m_udp_last_send = now;
+	m_udp_ack_pending = false;
+}
+
+// called from ---NETPLAY--- thread
+void NetPlayClient::OnUDPData(sf::Packet& packet)
+{
+	NetPlayUDP::Header header;
+	if (!NetPlayUDP::ReadHeader(packet, header) || header.game != m_current_game || header.pid != 0)
+		return;
+
+	if (!m_udp_stats.OnReceive(header, NetPlayUDP::GetTime()))
+		return;
+
+	// States the server got from us
+	u8 num_acks = 0;
+	packet >> num_acks;
+	for (u8 n = 0; n < num_acks; ++n)
+	{
+		PadMapping map = 0;
+		FrameNum next = 0;
+		packet >> map >> next;
+		if (!packet || map < 0 || map >= 4)
+			return;
+		if (m_pad_map[map] == m_pid && (s32)(m_udp_sent[map].End() - next) >= 0)
+			m_udp_sent[map].DropBefore(next);
+	}
+
+	// States of the other players. Only the next expected one of each pad
+	// goes into the buffer, the rest was either seen or needs the gap filled.
+	u8 num_runs = 0;
+	packet >> num_runs;
+	std::vector<NetPad> states;
+	for (u8 n = 0; n < num_runs; ++n)
+	{
+		PadMapping map = 0;
+		FrameNum first = 0;
+		if (!NetPlayUDP::ReadPadRun(packet, map, first, states))
+			return;
+		if (m_pad_map[map] == m_pid)
+			continue;
+
+		for (u32 i = 0; i < states.size(); ++i)
+		{
+			if (first + i == m_udp_received[map])
+			{
+				m_pad_buffer[map].Push(states[i]);
+				m_udp_received[map]++;
+				m_udp_ack_pending = true;
+			}
+		}
+	}
+}
+
 // called from ---NETPLAY--- thread
 void NetPlayClient::UpdateDevices()
 {
@@ -593,6 +809,7 @@ bool NetPlayClient::GetNetPads(const u8 pad_nb, const SPADStatus* const pad_stat
 
 		// adjust the buffer either up or down
 		// inserting multiple padstates or dropping states
+		bool sent = false;
 		while (m_pad_buffer[in_game_num].Size() <= m_target_buffer_size)
 		{
 			// add to buffer
@@ -600,6 +817,13 @@ bool NetPlayClient::GetNetPads(const u8 pad_nb, const SPADStatus* const pad_stat
 
 			// send
 			SendPadState(in_game_num, np);
+			sent = true;
+		}
+
+		if (sent && m_udp_active)
+		{
+			std::lock_guard<std::recursive_mutex> lks(m_crit.send);
+			SendUDP();
 		}
 	}
 
@@ -749,6 +973,7 @@ bool NetPlayClient::StopGame()
 
 	m_is_running = false;
 	NetPlay_Disable();
+	StopUDP();
 
 	// stop game
 	m_dialog->StopGame();
@@ -909,6 +1134,15 @@ bool NetPlay::IsNetPlayRunning()
 	return netplay_client != NULL;
 }
 
+// called from ---CPU--- thread
+void NetPlay::SendSyncHash(const DesyncCheck::Record &record)
+{
+	std::lock_guard<std::mutex> lk(crit_netplay_client);
+
+	if (netplay_client)
+		netplay_client->SendSyncHash(record);
+}
+
 void NetPlay_Enable(NetPlayClient* const np)
 {
 	std::lock_guard<std::mutex> lk(crit_netplay_client);
@@ -13,6 +13,7 @@
 #include <SFML/Network.hpp>
 
 #include "NetPlayProto.h"
+#include "NetPlayUDP.h"
 #include "GCPadStatus.h"
 
 #include <functional>
@@ -22,16 +23,6 @@
 
 #include "FifoQueue.h"
 
-class NetPad
-{
-public:
-	NetPad();
-	NetPad(const SPADStatus* const);
-
-	u32 nHi;
-	u32 nLo;
-};
-
 class NetPlayUI
 {
 public:
@@ -86,6 +77,8 @@ public:
 
 	u8 LocalWiimoteToInGameWiimote(u8 local_pad);
 
+	void SendSyncHash(const DesyncCheck::Record& record);
+
 protected:
 	void ClearBuffers();
 
@@ -125,8 +118,29 @@ private:
 	void SendWiimoteState(const PadMapping in_game_pad, const NetWiimote& nw);
 	unsigned int OnData(sf::Packet& packet);
 
+	// UDP pad transport, all under m_crit.send
+	void StartUDP();
+	void StopUDP();
+	void UpdateUDP();
+	void SendUDP();
+	void OnUDPData(sf::Packet& packet);
+
 	PlayerId		m_pid;
 	std::map<PlayerId, Player>	m_players;
+
+	sf::IPAddress	m_server_address;
+	u16		m_server_port;
+
+	bool		m_udp_pads;		// Set by the server for each game
+	volatile bool	m_udp_active;
+	NetPlayUDP::Socket	m_udp_socket;
+	bool		m_udp_bound;
+	NetPlayUDP::PadHistory	m_udp_sent[4];	// Our states the server doesn't have yet
+	FrameNum	m_udp_received[4];	// Next state expected for the other pads
+	bool		m_udp_ack_pending;
+	u32		m_udp_sequence;
+	u32		m_udp_last_send;
+	NetPlayUDP::PeerStats	m_udp_stats;
 };
 
 void NetPlay_Enable(NetPlayClient* const np);
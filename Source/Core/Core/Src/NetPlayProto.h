@@ -8,6 +8,10 @@
 #include "Common.h"
 #include "CommonTypes.h"
 #include "HW/EXI_Device.h"
+#include "GCPadStatus.h"
+#include "DesyncCheck.h"
+
+#include <string>
 
 struct NetSettings
 {
@@ -15,6 +19,9 @@ struct NetSettings
 	bool m_DSPHLE;
 	bool m_DSPEnableJIT;
 	bool m_WriteToMemcard;
+	bool m_UDPPads;		// Pad data over UDP, see NetPlayUDP.h
+	u32 m_DesyncCheckInterval;	// See DesyncCheck.h
+	std::string m_DesyncCheckRanges;
 	TEXIDevices m_EXIDevice[2];
 };
 
@@ -27,7 +34,17 @@ struct Rpt : public std::vector<u8>
 
 typedef std::vector<u8> NetWiimote;
 
-#define NETPLAY_VERSION		"Dolphin NetPlay 2013-09-22"
+class NetPad
+{
+public:
+	NetPad();
+	NetPad(const SPADStatus* const);
+
+	u32 nHi;
+	u32 nLo;
+};
+
+#define NETPLAY_VERSION		"Dolphin NetPlay 2013-10-27"
 
 const int NETPLAY_INITIAL_GCTIME = 1272737767;
 
@@ -52,6 +69,9 @@ enum
 	NP_MSG_STOP_GAME		= 0xA2,
 	NP_MSG_DISABLE_GAME		= 0xA3,
 
+	NP_MSG_SYNC_HASH		= 0xB0,
+	NP_MSG_DESYNC			= 0xB1,
+
 	NP_MSG_READY			= 0xD0,
 	NP_MSG_NOT_READY		= 0xD1,
 
@@ -74,6 +94,8 @@ enum
 
 namespace NetPlay {
 	bool IsNetPlayRunning();
+	// called from ---CPU--- thread
+	void SendSyncHash(const DesyncCheck::Record &record);
 };
 
 #endif
@@ -22,12 +22,18 @@ NetPlayServer::~NetPlayServer()
 }
 
 // called from ---GUI--- thread
-NetPlayServer::NetPlayServer(const u16 port) : is_connected(false), m_is_running(false)
+NetPlayServer::NetPlayServer(const u16 port)
+	: is_connected(false), m_is_running(false), m_adaptive_buffer(false)
+	, m_port(port), m_udp_pads(false), m_udp_bound(false), m_desync_reported(false)
 {
 	memset(m_pad_map, -1, sizeof(m_pad_map));
 	memset(m_wiimote_map, -1, sizeof(m_wiimote_map));
 	if (m_socket.Listen(port))
 	{
+		m_udp_bound = m_udp_socket.Bind(port);
+		if (!m_udp_bound)
+			WARN_LOG(NETPLAY, "Could not open UDP port %d, pad data will go over TCP.", port);
+
 		is_connected = true;
 		m_do_loop = true;
 		m_selector.Add(m_socket);
@@ -59,8 +65,16 @@ void NetPlayServer::ThreadFunc()
 			m_update_pings = false;
 		}
 
-		// check which sockets need attention
-		const unsigned int num = m_selector.Wait(0.01f);
+		if (m_adaptive_buffer && m_adaptive_timer.GetTimeElapsed() > 1000)
+		{
+			UpdateBufferSize();
+			m_adaptive_timer.Start();
+		}
+
+		// check which sockets need attention, quickly while pad data
+		// comes in over UDP
+		const bool udp = m_is_running && m_udp_pads;
+		const unsigned int num = m_selector.Wait(udp ? 0.001f : 0.01f);
 		for (unsigned int i=0; i<num; ++i)
 		{
 			sf::SocketTCP ready_socket = m_selector.GetSocketReady(i);
@@ -69,12 +83,13 @@ void NetPlayServer::ThreadFunc()
 			if (ready_socket == m_socket)
 			{
 				sf::SocketTCP accept_socket;
-				m_socket.Accept(accept_socket);
+				sf::IPAddress address;
+				m_socket.Accept(accept_socket, &address);
 
 				unsigned int error;
 				{
 				std::lock_guard<std::recursive_mutex> lkg(m_crit.game);
-				error = OnConnect(accept_socket);
+				error = OnConnect(accept_socket, address);
 				}
 
 				if (error)
@@ -109,6 +124,9 @@ void NetPlayServer::ThreadFunc()
 				}
 			}
 		}
+
+		if (udp)
+			UpdateUDP();
 	}
 
 	// close listening socket and client sockets
@@ -119,12 +137,13 @@ void NetPlayServer::ThreadFunc()
 	for ( ; i!=e; ++i)
 		i->second.socket.Close();
 	}
+	m_udp_socket.Close();
 
 	return;
 }
 
 // called from ---NETPLAY--- thread
-unsigned int NetPlayServer::OnConnect(sf::SocketTCP& socket)
+unsigned int NetPlayServer::OnConnect(sf::SocketTCP& socket, const sf::IPAddress& address)
 {
 	sf::Packet rpac;
 	// TODO: make this not hang / check if good packet
@@ -149,6 +168,17 @@ unsigned int NetPlayServer::OnConnect(sf::SocketTCP& socket)
 
 	Client player;
 	player.socket = socket;
+	player.address = address;
+	player.ping = 0;
+	player.current_game = 0;
+	player.udp_port = 0;
+	player.udp_tcp_pads = false;
+	for (unsigned int i = 0; i < 4; ++i)
+		player.udp_acked[i] = 0;
+	player.udp_ack_pending = false;
+	player.udp_new_data = false;
+	player.udp_sequence = 0;
+	player.udp_last_send = 0;
 	rpac >> player.revision;
 	rpac >> player.name;
 
@@ -342,6 +372,290 @@ void NetPlayServer::AdjustPadBufferSize(unsigned int size)
 	SendToClients(spac);
 }
 
+// called from ---GUI--- thread
+void NetPlayServer::SetAdaptiveBuffer(bool enable)
+{
+	m_adaptive_buffer = enable;
+	m_adaptive_timer.Start();
+}
+
+// called from ---NETPLAY--- thread
+void NetPlayServer::UpdateBufferSize()
+{
+	u32 rtt = 0, jitter = 0;
+	{
+	std::lock_guard<std::recursive_mutex> lkp(m_crit.players);
+	std::map<sf::SocketTCP, Client>::const_iterator
+		i = m_players.begin(),
+		e = m_players.end();
+	for ( ; i!=e; ++i)
+	{
+		const NetPlayUDP::PeerStats& stats = i->second.udp_stats;
+		if (m_udp_pads && stats.HasRTT())
+		{
+			rtt = std::max(rtt, stats.GetRTT());
+			jitter = std::max(jitter, stats.GetJitter());
+		}
+		else
+		{
+			rtt = std::max(rtt, i->second.ping);
+		}
+	}
+	}
+
+	// A pad state goes from one client through us to another one, about the
+	// round trip time of the slower of the two. Pads are read about once a
+	// frame, and the jitter of both legs has to fit in as well.
+	const u32 needed = std::min<u32>((rtt + 4 * jitter) * 60 / 1000 + 1, 200);
+
+	// Grow at once, shrink slowly so a single good second doesn't cause stalls
+	if (needed > m_target_buffer_size)
+		AdjustPadBufferSize(needed);
+	else if (needed + 2 < m_target_buffer_size)
+		AdjustPadBufferSize(m_target_buffer_size - 1);
+}
+
+// called from ---GUI--- thread
+void NetPlayServer::ResetUDP()
+{
+	for (unsigned int i = 0; i < 4; ++i)
+		m_udp_history[i].Reset();
+
+	std::map<sf::SocketTCP, Client>::iterator
+		i = m_players.begin(),
+		e = m_players.end();
+	for ( ; i!=e; ++i)
+	{
+		Client& client = i->second;
+		for (unsigned int j = 0; j < 4; ++j)
+			client.udp_acked[j] = 0;
+		client.udp_port = 0;
+		client.udp_tcp_pads = false;
+		client.udp_ack_pending = false;
+		client.udp_new_data = false;
+		client.udp_stats.Reset();
+	}
+}
+
+// called from ---NETPLAY--- thread
+void NetPlayServer::UpdateUDP()
+{
+	std::lock_guard<std::recursive_mutex> lkp(m_crit.players);
+	std::lock_guard<std::recursive_mutex> lks(m_crit.send);
+
+	sf::Packet packet;
+	sf::IPAddress address;
+	u16 port;
+	while (m_udp_socket.Receive(packet, address, port))
+		OnUDPData(packet, address, port);
+
+	const u32 now = NetPlayUDP::GetTime();
+	std::map<sf::SocketTCP, Client>::iterator
+		i = m_players.begin(),
+		e = m_players.end();
+	for ( ; i!=e; ++i)
+	{
+		Client& client = i->second;
+		if (!client.udp_port)
+			continue;
+
+		bool unacked = client.udp_ack_pending;
+		for (PadMapping p = 0; p < 4; ++p)
+		{
+			if (!client.udp_tcp_pads && m_pad_map[p] > 0 && m_pad_map[p] != client.pid)
+				unacked |= client.udp_acked[p] != m_udp_history[p].End();
+		}
+
+		// New states are passed on right away
+		const u32 elapsed = now - client.udp_last_send;
+		if (client.udp_new_data || (unacked && elapsed >= NetPlayUDP::RESEND_INTERVAL_US) ||
+			elapsed >= NetPlayUDP::KEEPALIVE_INTERVAL_US)
+			SendUDP(client);
+	}
+
+	m_udp_socket.Update();
+}
+
+// called from ---NETPLAY--- thread
+void NetPlayServer::SendUDP(Client& client)
+{
+	const u32 now = NetPlayUDP::GetTime();
+
+	NetPlayUDP::Header header;
+	header.game = m_current_game;
+	header.pid = 0;
+	header.sequence = client.udp_sequence++;
+	header.timestamp = now;
+	client.udp_stats.SetEcho(header, now);
+
+	sf::Packet packet;
+	NetPlayUDP::WriteHeader(packet, header);
+
+	// Acknowledge the client's own pads
+	u8 num_acks = 0;
+	for (PadMapping p = 0; p < 4; ++p)
+	{
+		if (m_pad_map[p] == client.pid)
+			num_acks++;
+	}
+	packet << num_acks;
+	for (PadMapping p = 0; p < 4; ++p)
+	{
+		if (m_pad_map[p] == client.pid)
+			packet << p << m_udp_history[p].End();
+	}
+
+	// Everything of the other pads the client doesn't have yet, unless those
+	// go over TCP
+	bool needs_run[4];
+	u8 num_runs = 0;
+	for (PadMapping p = 0; p < 4; ++p)
+	{
+		needs_run[p] = !client.udp_tcp_pads && m_pad_map[p] > 0 && m_pad_map[p] != client.pid &&
+			client.udp_acked[p] != m_udp_history[p].End();
+		if (needs_run[p])
+			num_runs++;
+	}
+	packet << num_runs;
+	for (PadMapping p = 0; p < 4; ++p)
+	{
+		if (needs_run[p])
+			NetPlayUDP::WritePadRun(packet, p, m_udp_history[p], client.udp_acked[p]);
+	}
+
+	m_udp_socket.Send(packet, client.address, client.udp_port);
+	client.udp_last_send = now;
+	client.udp_ack_pending = false;
+	client.udp_new_data = false;
+}
+
+// called from ---NETPLAY--- thread
+void NetPlayServer::OnUDPData(sf::Packet& packet, const sf::IPAddress& address, u16 port)
+{
+	NetPlayUDP::Header header;
+	if (!NetPlayUDP::ReadHeader(packet, header) || header.game != m_current_game)
+		return;
+
+	// Only accept datagrams from where the player is connected from
+	Client* sender = NULL;
+	std::map<sf::SocketTCP, Client>::iterator
+		i = m_players.begin(),
+		e = m_players.end();
+	for ( ; i!=e; ++i)
+	{
+		if (i->second.pid == header.pid)
+			sender = &i->second;
+	}
+	if (!sender || sender->address != address || sender->current_game != m_current_game)
+		return;
+
+	Client& client = *sender;
+	client.udp_port = port;
+	if (!client.udp_stats.OnReceive(header, NetPlayUDP::GetTime()))
+		return;
+
+	// States of the other pads the client has
+	u8 num_acks = 0;
+	packet >> num_acks;
+	for (u8 n = 0; n < num_acks; ++n)
+	{
+		PadMapping map = 0;
+		FrameNum next = 0;
+		packet >> map >> next;
+		if (!packet || map < 0 || map >= 4)
+			return;
+		if (m_pad_map[map] > 0 && m_pad_map[map] != client.pid &&
+			(s32)(next - client.udp_acked[map]) > 0 && (s32)(m_udp_history[map].End() - next) >= 0)
+			client.udp_acked[map] = next;
+	}
+
+	// New states of the client's pads
+	u8 num_runs = 0;
+	packet >> num_runs;
+	std::vector<NetPad> states;
+	bool new_data = false;
+	for (u8 n = 0; n < num_runs; ++n)
+	{
+		PadMapping map = 0;
+		FrameNum first = 0;
+		if (!NetPlayUDP::ReadPadRun(packet, map, first, states))
+			return;
+		// Same as over TCP, but a spoofed datagram shouldn't kick anyone
+		if (m_pad_map[map] != client.pid)
+			continue;
+
+		for (u32 s = 0; s < states.size(); ++s)
+		{
+			if (first + s == m_udp_history[map].End())
+			{
+				m_udp_history[map].Push(states[s]);
+				client.udp_ack_pending = true;
+				new_data = true;
+				RelayOverTCP(client.pid, map, states[s]);
+			}
+		}
+	}
+
+	for (i = m_players.begin(); i!=e; ++i)
+	{
+		if (new_data && i->second.pid != client.pid)
+			i->second.udp_new_data = true;
+	}
+
+	// Forget the states every client has
+	for (PadMapping p = 0; p < 4; ++p)
+	{
+		if (m_pad_map[p] <= 0)
+			continue;
+
+		FrameNum oldest = m_udp_history[p].End();
+		for (i = m_players.begin(); i!=e; ++i)
+		{
+			if (i->second.pid != m_pad_map[p] && !i->second.udp_tcp_pads &&
+				(s32)(oldest - i->second.udp_acked[p]) > 0)
+				oldest = i->second.udp_acked[p];
+		}
+		m_udp_history[p].DropBefore(oldest);
+	}
+}
+
+// called from ---NETPLAY--- thread
+void NetPlayServer::RelayOverTCP(PlayerId sender, PadMapping map, const NetPad& np)
+{
+	sf::Packet spac;
+	spac << (MessageId)NP_MSG_PAD_DATA;
+	spac << map << np.nHi << np.nLo;
+
+	std::map<sf::SocketTCP, Client>::iterator
+		i = m_players.begin(),
+		e = m_players.end();
+	for ( ; i!=e; ++i)
+	{
+		Client& other = i->second;
+		if (other.pid == sender)
+			continue;
+
+		// Decided once per game, switching later would lose or repeat states
+		if (!other.udp_port)
+			other.udp_tcp_pads = true;
+		if (other.udp_tcp_pads)
+			other.socket.Send(spac);
+	}
+}
+
+// called from ---NETPLAY--- thread
+void NetPlayServer::LogUDPStats()
+{
+	std::map<sf::SocketTCP, Client>::const_iterator
+		i = m_players.begin(),
+		e = m_players.end();
+	for ( ; i!=e; ++i)
+	{
+		NOTICE_LOG(NETPLAY, "UDP pad data from %s[%d]: %s",
+			i->second.name.c_str(), i->second.pid, i->second.udp_stats.ToString().c_str());
+	}
+}
+
 // called from ---NETPLAY--- thread
 unsigned int NetPlayServer::OnData(sf::Packet& packet, sf::SocketTCP& socket)
 {
@@ -458,6 +772,57 @@ unsigned int NetPlayServer::OnData(sf::Packet& packet, sf::SocketTCP& socket)
 		}
 		break;
 
+	case NP_MSG_SYNC_HASH :
+		{
+			if (player.current_game != m_current_game)
+				break;
+
+			DesyncCheck::Record record;
+			packet >> record.field;
+			for (int i = 0; i < DesyncCheck::NUM_REGIONS; i++)
+				packet >> record.hashes[i];
+
+			std::lock_guard<std::recursive_mutex> lkg(m_crit.game);
+			std::map<u32, SyncHash>::iterator it = m_sync_hashes.find(record.field);
+			if (it == m_sync_hashes.end())
+			{
+				// the first one to arrive is what the others are compared to
+				SyncHash& first = m_sync_hashes[record.field];
+				first.record = record;
+				first.pid = player.pid;
+				first.count = 0;
+
+				// players that left never send theirs
+				if (m_sync_hashes.size() > MAX_PENDING_SYNC_HASHES)
+					m_sync_hashes.erase(m_sync_hashes.begin());
+				it = m_sync_hashes.find(record.field);
+				if (it == m_sync_hashes.end())
+					break;
+			}
+			else
+			{
+				const u32 mask = DesyncCheck::Compare(it->second.record, record);
+				if (mask && !m_desync_reported)
+				{
+					m_desync_reported = true;
+					ERROR_LOG(NETPLAY, "Desync at field %u between players %d and %d",
+						record.field, it->second.pid, player.pid);
+
+					sf::Packet spac;
+					spac << (MessageId)NP_MSG_DESYNC;
+					spac << record.field << mask << it->second.pid << player.pid;
+
+					std::lock_guard<std::recursive_mutex> lkp(m_crit.players);
+					std::lock_guard<std::recursive_mutex> lks(m_crit.send);
+					SendToClients(spac);
+				}
+			}
+
+			if (++it->second.count >= m_players.size())
+				m_sync_hashes.erase(it);
+		}
+		break;
+
 	case NP_MSG_STOP_GAME:
 		{
 			// tell clients to stop game
@@ -468,6 +833,8 @@ unsigned int NetPlayServer::OnData(sf::Packet& packet, sf::SocketTCP& socket)
 			std::lock_guard<std::recursive_mutex> lks(m_crit.send);
 			SendToClients(spac);
 
+			if (m_is_running && m_udp_pads)
+				LogUDPStats();
 			m_is_running = false;
 		}
 		break;
@@ -525,10 +892,14 @@ bool NetPlayServer::StartGame(const std::string &path)
 {
 	std::lock_guard<std::recursive_mutex> lkg(m_crit.game);
 	m_current_game = Common::Timer::GetTimeMs();
+	m_sync_hashes.clear();
+	m_desync_reported = false;
 
 	// no change, just update with clients
 	AdjustPadBufferSize(m_target_buffer_size);
 
+	m_settings.m_UDPPads = m_settings.m_UDPPads && m_udp_bound;
+
 	// tell clients to start game
 	sf::Packet spac;
 	spac << (MessageId)NP_MSG_START_GAME;
@@ -537,11 +908,16 @@ bool NetPlayServer::StartGame(const std::string &path)
 	spac << m_settings.m_DSPEnableJIT;
 	spac << m_settings.m_DSPHLE;
 	spac << m_settings.m_WriteToMemcard;
+	spac << m_settings.m_UDPPads;
+	spac << m_settings.m_DesyncCheckInterval;
+	spac << m_settings.m_DesyncCheckRanges;
 	spac << m_settings.m_EXIDevice[0];
 	spac << m_settings.m_EXIDevice[1];
 
 	std::lock_guard<std::recursive_mutex> lkp(m_crit.players);
 	std::lock_guard<std::recursive_mutex> lks(m_crit.send);
+	m_udp_pads = m_settings.m_UDPPads;
+	ResetUDP();
 	SendToClients(spac);
 
 	m_is_running = true;
@@ -692,6 +1068,12 @@ bool NetPlayServer::UPnPMapPort(const std::string& addr, const u16 port)
 	if(result != 0)
 		return false;
 
+	// Pad data, not fatal if it fails
+	UPNP_AddPortMapping(m_upnp_urls.controlURL, m_upnp_data.first.servicetype,
+	                    port_str, port_str, addr.c_str(),
+	                    (std::string("dolphin-emu UDP on ") + addr).c_str(),
+	                    "UDP", NULL, NULL);
+
 	m_upnp_mapped = port;
 
 	return true;
@@ -712,6 +1094,8 @@ bool NetPlayServer::UPnPUnmapPort(const u16 port)
 	sprintf(port_str, "%d", port);
 	UPNP_DeletePortMapping(m_upnp_urls.controlURL, m_upnp_data.first.servicetype,
 	                       port_str, "TCP", NULL);
+	UPNP_DeletePortMapping(m_upnp_urls.controlURL, m_upnp_data.first.servicetype,
+	                       port_str, "UDP", NULL);
 
 	return true;
 }
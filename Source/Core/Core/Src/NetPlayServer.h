@@ -13,6 +13,7 @@
 #include <SFML/Network.hpp>
 
 #include "NetPlayProto.h"
+#include "NetPlayUDP.h"
 
 #include <functional>
 #include <map>
@@ -41,6 +42,8 @@ public:
 	void SetWiimoteMapping(const PadMapping map[]);
 
 	void AdjustPadBufferSize(unsigned int size);
+	// Sizes the pad buffer from the measured latency and jitter
+	void SetAdaptiveBuffer(bool enable);
 
 	bool is_connected;
 
@@ -57,16 +60,48 @@ private:
 		std::string		revision;
 
 		sf::SocketTCP	socket;
+		sf::IPAddress	address;
 		u32 ping;
 		u32 current_game;
+
+		// UDP pad data
+		u16 udp_port;		// 0 until the first datagram arrived
+		// Gets the other pads over TCP: it had sent no datagram by the time
+		// the first state came in over UDP, e.g. because it couldn't bind
+		bool udp_tcp_pads;
+		FrameNum udp_acked[4];	// Next state of each pad the client needs
+		bool udp_ack_pending;
+		bool udp_new_data;
+		u32 udp_sequence;
+		u32 udp_last_send;
+		NetPlayUDP::PeerStats udp_stats;
 	};
 
 	void SendToClients(sf::Packet& packet, const PlayerId skip_pid = 0);
-	unsigned int OnConnect(sf::SocketTCP& socket);
+	unsigned int OnConnect(sf::SocketTCP& socket, const sf::IPAddress& address);
 	unsigned int OnDisconnect(sf::SocketTCP& socket);
 	unsigned int OnData(sf::Packet& packet, sf::SocketTCP& socket);
 	void UpdatePadMapping();
 	void UpdateWiimoteMapping();
+	void UpdateBufferSize();
+
+	// UDP pad transport, under m_crit.players and m_crit.send
+	void ResetUDP();
+	void UpdateUDP();
+	void SendUDP(Client& client);
+	// Passes a state that came in over UDP on to the clients that get pads over TCP
+	void RelayOverTCP(PlayerId sender, PadMapping map, const NetPad& np);
+	void OnUDPData(sf::Packet& packet, const sf::IPAddress& address, u16 port);
+	void LogUDPStats();
+
+	// Desync check hashes of one field, until every player sent theirs
+	struct SyncHash
+	{
+		DesyncCheck::Record record;
+		PlayerId pid;
+		u32 count;
+	};
+	enum { MAX_PENDING_SYNC_HASHES = 64 };
 
 	NetSettings     m_settings;
 
@@ -77,6 +112,8 @@ private:
 	bool            m_update_pings;
 	u32		m_current_game;
 	unsigned int	m_target_buffer_size;
+	bool		m_adaptive_buffer;
+	Common::Timer	m_adaptive_timer;
 	PadMapping      m_pad_map[4];
 	PadMapping      m_wiimote_map[4];
 
@@ -95,6 +132,15 @@ private:
 	std::thread m_thread;
 	sf::Selector<sf::SocketTCP> m_selector;
 
+	u16		m_port;
+	bool		m_udp_pads;		// Current game uses UDP
+	NetPlayUDP::Socket	m_udp_socket;
+	bool		m_udp_bound;
+	NetPlayUDP::PadHistory	m_udp_history[4];	// States not every client has yet
+
+	std::map<u32, SyncHash>	m_sync_hashes;	// By field
+	bool		m_desync_reported;	// Only the first desync of a game is reported
+
 #ifdef USE_UPNP
 	static void mapPortThread(const u16 port);
 	static void unmapPortThread();
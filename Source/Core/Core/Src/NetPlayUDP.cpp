@@ -0,0 +1,267 @@
+// Copyright 2013 Dolphin Emulator Project
+// Licensed under GPLv2
+// Refer to the license.txt file included.
+
+#include <algorithm>
+#include <stdlib.h>
+
+#include "StringUtil.h"
+#include "Timer.h"
+
+#include "ConfigManager.h"
+#include "NetPlayUDP.h"
+
+namespace NetPlayUDP
+{
+
+u32 GetTime()
+{
+	return (u32)Common::Timer::GetTimeUs();
+}
+
+void PadHistory::DropBefore(FrameNum frame)
+{
+	while ((s32)(frame - m_base) > 0 && !m_states.empty())
+	{
+		m_states.pop_front();
+		m_base++;
+	}
+}
+
+void WriteHeader(sf::Packet &packet, const Header &header)
+{
+	packet << header.game << header.pid << header.sequence;
+	packet << header.timestamp << header.echo << header.echo_delay;
+}
+
+bool ReadHeader(sf::Packet &packet, Header &header)
+{
+	packet >> header.game >> header.pid >> header.sequence;
+	packet >> header.timestamp >> header.echo >> header.echo_delay;
+	return packet;
+}
+
+static void PadBytes(const NetPad &state, u8 bytes[8])
+{
+	for (int i = 0; i < 4; i++)
+	{
+		bytes[i] = (u8)(state.nHi >> (i * 8));
+		bytes[i + 4] = (u8)(state.nLo >> (i * 8));
+	}
+}
+
+void WritePadRun(sf::Packet &packet, PadMapping pad, const PadHistory &history, FrameNum first)
+{
+	const FrameNum end = std::min<FrameNum>(history.End(), first + PAD_REDUNDANCY);
+	packet << pad << first << (u8)(end - first);
+
+	// The first state is sent relative to a centered pad
+	u8 previous[8];
+	PadBytes(NetPad(), previous);
+	for (FrameNum frame = first; frame != end; ++frame)
+	{
+		u8 bytes[8];
+		PadBytes(history.Get(frame), bytes);
+
+		u8 mask = 0;
+		for (int i = 0; i < 8; i++)
+		{
+			if (bytes[i] != previous[i])
+				mask |= 1 << i;
+		}
+
+		packet << mask;
+		for (int i = 0; i < 8; i++)
+		{
+			if (mask & (1 << i))
+				packet << bytes[i];
+		}
+		memcpy(previous, bytes, sizeof(bytes));
+	}
+}
+
+bool ReadPadRun(sf::Packet &packet, PadMapping &pad, FrameNum &first, std::vector<NetPad> &states)
+{
+	u8 count = 0;
+	packet >> pad >> first >> count;
+	if (!packet || pad < 0 || pad >= 4 || count > PAD_REDUNDANCY)
+		return false;
+
+	u8 bytes[8];
+	PadBytes(NetPad(), bytes);
+	states.clear();
+	for (u8 n = 0; n < count; n++)
+	{
+		u8 mask = 0;
+		packet >> mask;
+		for (int i = 0; i < 8; i++)
+		{
+			if (mask & (1 << i))
+				packet >> bytes[i];
+		}
+
+		NetPad state;
+		state.nHi = (u32)bytes[0] | ((u32)bytes[1] << 8) | ((u32)bytes[2] << 16) | ((u32)bytes[3] << 24);
+		state.nLo = (u32)bytes[4] | ((u32)bytes[5] << 8) | ((u32)bytes[6] << 16) | ((u32)bytes[7] << 24);
+		states.push_back(state);
+	}
+
+	return packet;
+}
+
+void PeerStats::Reset()
+{
+	m_received = 0;
+	m_out_of_order = 0;
+	m_first_sequence = 0;
+	m_last_sequence = 0;
+	m_last_timestamp = 0;
+	m_last_receive_time = 0;
+	m_rtt_samples = 0;
+	m_rtt_us = 0;
+	m_min_rtt_us = 0xFFFFFFFF;
+	m_max_rtt_us = 0;
+	m_jitter_us = 0;
+	m_last_transit = 0;
+}
+
+bool PeerStats::OnReceive(const Header &header, u32 now)
+{
+	// Everything in an older datagram was repeated in the newer ones
+	if (m_received && (s32)(header.sequence - m_last_sequence) <= 0)
+	{
+		m_out_of_order++;
+		return false;
+	}
+
+	if (!m_received)
+		m_first_sequence = header.sequence;
+	m_last_sequence = header.sequence;
+	m_received++;
+
+	// Interarrival jitter as in RFC 3550. The clocks aren't synchronized,
+	// only the differences in transit time count.
+	const u32 transit = now - header.timestamp;
+	if (m_received > 1)
+	{
+		const s32 d = abs((s32)(transit - m_last_transit));
+		m_jitter_us = (u32)((s32)m_jitter_us + (d - (s32)m_jitter_us) / 16);
+	}
+	m_last_transit = transit;
+
+	m_last_timestamp = header.timestamp;
+	m_last_receive_time = now;
+
+	if (header.echo)
+	{
+		const s32 rtt = (s32)(now - header.echo - header.echo_delay);
+		if (rtt >= 0)
+		{
+			if (m_rtt_samples)
+				m_rtt_us = (u32)((s32)m_rtt_us + (rtt - (s32)m_rtt_us) / 8);
+			else
+				m_rtt_us = rtt;
+			m_min_rtt_us = std::min<u32>(m_min_rtt_us, rtt);
+			m_max_rtt_us = std::max<u32>(m_max_rtt_us, rtt);
+			m_rtt_samples++;
+		}
+	}
+
+	return true;
+}
+
+void PeerStats::SetEcho(Header &header, u32 now) const
+{
+	header.echo = m_last_timestamp;
+	header.echo_delay = m_received ? now - m_last_receive_time : 0;
+}
+
+std::string PeerStats::ToString() const
+{
+	const u32 expected = m_received ? m_last_sequence - m_first_sequence + 1 : 0;
+	const u32 lost = expected - std::min(expected, m_received + m_out_of_order);
+
+	std::string result = StringFromFormat("%u datagrams, %u lost, %u out of order", m_received, lost, m_out_of_order);
+	if (m_rtt_samples)
+	{
+		result += StringFromFormat(", rtt %u ms (min %u, max %u), jitter %.1f ms",
+			m_rtt_us / 1000, m_min_rtt_us / 1000, m_max_rtt_us / 1000, m_jitter_us / 1000.0f);
+	}
+	return result;
+}
+
+Socket::Socket()
+{
+	const SConfig &config = SConfig::GetInstance();
+	m_latency_us = config.m_NetPlaySimulatedLatency * 1000;
+	m_jitter_us = config.m_NetPlaySimulatedJitter * 1000;
+	m_loss_percent = config.m_NetPlaySimulatedLoss;
+}
+
+bool Socket::Bind(u16 port)
+{
+	if (!m_socket.Bind(port))
+		return false;
+
+	m_socket.SetBlocking(false);
+	return true;
+}
+
+void Socket::Close()
+{
+	m_delayed.clear();
+	m_socket.Close();
+}
+
+void Socket::SendNow(const char *data, size_t size, const sf::IPAddress &address, u16 port)
+{
+	m_socket.Send(data, size, address, port);
+}
+
+void Socket::Send(const sf::Packet &packet, const sf::IPAddress &address, u16 port)
+{
+	if (m_loss_percent && (u32)(rand() % 100) < m_loss_percent)
+		return;
+
+	if (!m_latency_us && !m_jitter_us)
+	{
+		SendNow(packet.GetData(), packet.GetDataSize(), address, port);
+		return;
+	}
+
+	u64 release = Common::Timer::GetTimeUs() + m_latency_us;
+	if (m_jitter_us)
+		release += rand() % (m_jitter_us + 1);
+
+	Datagram &datagram = m_delayed.insert(std::make_pair(release, Datagram()))->second;
+	datagram.data.assign(packet.GetData(), packet.GetData() + packet.GetDataSize());
+	datagram.address = address;
+	datagram.port = port;
+}
+
+void Socket::Update()
+{
+	const u64 now = Common::Timer::GetTimeUs();
+	while (!m_delayed.empty() && m_delayed.begin()->first <= now)
+	{
+		const Datagram &datagram = m_delayed.begin()->second;
+		SendNow(&datagram.data[0], datagram.data.size(), datagram.address, datagram.port);
+		m_delayed.erase(m_delayed.begin());
+	}
+}
+
+bool Socket::Receive(sf::Packet &packet, sf::IPAddress &address, u16 &port)
+{
+	char buffer[MAX_DATAGRAM_SIZE];
+	std::size_t size = 0;
+	unsigned short sender_port = 0;
+	if (m_socket.Receive(buffer, sizeof(buffer), size, address, sender_port) != sf::Socket::Done)
+		return false;
+
+	port = sender_port;
+	packet.Clear();
+	packet.Append(buffer, size);
+	return true;
+}
+
+}  // namespace
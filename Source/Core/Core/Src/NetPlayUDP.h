@@ -0,0 +1,165 @@
+// Copyright 2013 Dolphin Emulator Project
+// Licensed under GPLv2
+// Refer to the license.txt file included.
+
+// Pad data transport for NetPlay games started with m_UDPPads. Lobby, chat,
+// mappings and wiimote data keep using the TCP connection to the server.
+//
+// Every pad state gets a frame number. Each datagram repeats all the states
+// the other side hasn't acknowledged yet (up to PAD_REDUNDANCY of them), so
+// a lost datagram is covered by the next one instead of stalling the stream
+// like a TCP retransmit would. Consecutive states are delta encoded, only
+// the bytes that changed are sent.
+//
+// Datagram layout:
+//   u32 game, u8 pid, u32 sequence, u32 timestamp, u32 echo, u32 echo_delay
+//   u8 num_acks,  { u8 pad, u32 next_frame } ...
+//   u8 num_runs,  { u8 pad, u32 first_frame, u8 count, states... } ...
+// where each state is a mask of the changed bytes followed by those bytes.
+
+#ifndef _NETPLAY_UDP_H
+#define _NETPLAY_UDP_H
+
+#include "Common.h"
+#include "CommonTypes.h"
+
+#include <SFML/Network.hpp>
+
+#include "NetPlayProto.h"
+
+#include <deque>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace NetPlayUDP
+{
+
+enum
+{
+	PAD_REDUNDANCY = 32,		// States per pad and datagram at most
+	MAX_DATAGRAM_SIZE = 1400,
+	RESEND_INTERVAL_US = 8000,	// Unacknowledged states are repeated this often
+	KEEPALIVE_INTERVAL_US = 100000,
+};
+
+// Pad states of one in-game pad, by frame number
+class PadHistory
+{
+public:
+	PadHistory() : m_base(0) {}
+
+	void Reset() { m_base = 0; m_states.clear(); }
+
+	FrameNum Begin() const { return m_base; }
+	FrameNum End() const { return m_base + (FrameNum)m_states.size(); }
+	const NetPad &Get(FrameNum frame) const { return m_states[frame - m_base]; }
+
+	void Push(const NetPad &state) { m_states.push_back(state); }
+
+	// Forgets the states everyone has
+	void DropBefore(FrameNum frame);
+
+private:
+	FrameNum m_base;
+	std::deque<NetPad> m_states;
+};
+
+// Datagram header
+struct Header
+{
+	u32 game;
+	PlayerId pid;
+	u32 sequence;
+	u32 timestamp;		// Sender clock, microseconds
+	u32 echo;			// Last timestamp received from the other side, 0 if none
+	u32 echo_delay;		// How long ago that was received
+};
+
+void WriteHeader(sf::Packet &packet, const Header &header);
+bool ReadHeader(sf::Packet &packet, Header &header);
+
+// Writes the states [first, end) of history, at most PAD_REDUNDANCY of them
+void WritePadRun(sf::Packet &packet, PadMapping pad, const PadHistory &history, FrameNum first);
+// Reads one run written by WritePadRun
+bool ReadPadRun(sf::Packet &packet, PadMapping &pad, FrameNum &first, std::vector<NetPad> &states);
+
+// Latency, jitter and loss of the datagrams from one peer
+class PeerStats
+{
+public:
+	PeerStats() { Reset(); }
+
+	void Reset();
+
+	// Called for every datagram from the peer. Returns false if it's older
+	// than one seen already.
+	bool OnReceive(const Header &header, u32 now);
+	// Fills in the echo fields of a datagram going to the peer
+	void SetEcho(Header &header, u32 now) const;
+
+	bool HasRTT() const { return m_rtt_samples != 0; }
+	u32 GetRTT() const { return m_rtt_us / 1000; }			// Smoothed, ms
+	u32 GetJitter() const { return m_jitter_us / 1000; }	// ms
+
+	std::string ToString() const;
+
+private:
+	u32 m_received;
+	u32 m_out_of_order;
+	u32 m_first_sequence;
+	u32 m_last_sequence;
+
+	// For the echo to the peer
+	u32 m_last_timestamp;
+	u32 m_last_receive_time;
+
+	u32 m_rtt_samples;
+	u32 m_rtt_us;
+	u32 m_min_rtt_us;
+	u32 m_max_rtt_us;
+	u32 m_jitter_us;
+	u32 m_last_transit;
+};
+
+// Non-blocking UDP socket. Outgoing datagrams can be delayed, reordered
+// and dropped to try NetPlay over loopback under bad conditions
+// (NetPlay/SimulatedLatency, SimulatedJitter and SimulatedLoss in
+// Dolphin.ini).
+class Socket
+{
+public:
+	Socket();
+
+	bool Bind(u16 port);
+	void Close();
+
+	void Send(const sf::Packet &packet, const sf::IPAddress &address, u16 port);
+	bool Receive(sf::Packet &packet, sf::IPAddress &address, u16 &port);
+
+	// Sends the delayed datagrams that are due
+	void Update();
+
+private:
+	struct Datagram
+	{
+		std::vector<char> data;
+		sf::IPAddress address;
+		u16 port;
+	};
+
+	void SendNow(const char *data, size_t size, const sf::IPAddress &address, u16 port);
+
+	sf::SocketUDP m_socket;
+	u32 m_latency_us;
+	u32 m_jitter_us;
+	u32 m_loss_percent;
+	std::multimap<u64, Datagram> m_delayed;
+};
+
+// Microseconds, wraps around
+u32 GetTime();
+
+}  // namespace
+
+#endif
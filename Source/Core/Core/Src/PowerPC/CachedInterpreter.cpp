@@ -0,0 +1,219 @@
+// Copyright 2013 Dolphin Emulator Project
+// Licensed under GPLv2
+// Refer to the license.txt file included.
+
+#include "Common.h"
+#include "Atomic.h"
+
+#include "CachedInterpreter.h"
+#include "PPCTables.h"
+#include "../ConfigManager.h"
+#include "../CoreTiming.h"
+#include "../PatchEngine.h"
+#include "../HLE/HLE.h"
+
+void CachedInterpreter::Init()
+{
+	// Only used by the shared JIT code paths, kept in sync with Jit64
+	jo.enableBlocklink = false;
+	js.memcheck = Core::g_CoreStartupParameter.bMMU;
+
+	m_code = new Instruction[CODE_SIZE];
+	m_code_pos = 0;
+	m_block_cache.Init();
+}
+
+void CachedInterpreter::Shutdown()
+{
+	m_block_cache.Shutdown();
+	delete[] m_code;
+	m_code = NULL;
+	m_code_pos = 0;
+}
+
+void CachedInterpreter::ClearCache()
+{
+	m_block_cache.Clear();
+	m_code_pos = 0;
+}
+
+void CachedInterpreter::Jit(u32 em_address)
+{
+	CompileBlock(em_address);
+}
+
+int CachedInterpreter::CompileBlock(u32 em_address)
+{
+	if (CODE_SIZE - m_code_pos < (u32)m_code_buffer.GetSize() || m_block_cache.IsFull() ||
+		Core::g_CoreStartupParameter.bJITNoBlockCache)
+	{
+		ClearCache();
+	}
+
+	if (em_address == 0)
+		return -1;
+	if (Core::g_CoreStartupParameter.bMMU && (em_address & JIT_ICACHE_VMEM_BIT) &&
+		!Memory::TranslateAddress(em_address, Memory::FLAG_OPCODE))
+	{
+		return -1;
+	}
+
+	u32 merged_addresses[32];
+	const int capacity_of_merged_addresses = sizeof(merged_addresses) / sizeof(merged_addresses[0]);
+	int size_of_merged_addresses = 0;
+	int size = 0;
+	bool broken_block = false;
+	PPCAnalyst::Flatten(em_address, &size, &js.st, &js.gpa, &js.fpa, broken_block, &m_code_buffer,
+		m_code_buffer.GetSize(), merged_addresses, capacity_of_merged_addresses, size_of_merged_addresses);
+
+	// The first instruction couldn't be fetched, let the interpreter raise the ISI
+	if (size == 0)
+		return -1;
+
+	const PPCAnalyst::CodeOp *ops = m_code_buffer.codebuffer;
+	Instruction* code = &m_code[m_code_pos];
+	for (int i = 0; i < size; i++)
+	{
+		Instruction& op = code[i];
+		op.func = GetInterpreterOp(ops[i].inst);
+		op.inst = ops[i].inst;
+		op.address = ops[i].address;
+		op.cycles = ops[i].opinfo->numCyclesMinusOne + 1;
+		op.flags = PPCTables::UsesFPU(ops[i].inst) ? FLAG_CHECK_FPU : 0;
+
+		op.hle_function = HLE::GetFunctionIndex(ops[i].address);
+		if (op.hle_function != 0)
+		{
+			int type = HLE::GetFunctionTypeByIndex(op.hle_function);
+			if (type != HLE::HLE_HOOK_START && type != HLE::HLE_HOOK_REPLACE)
+				op.hle_function = 0;
+		}
+	}
+	code[size - 1].flags |= FLAG_LAST;
+
+	if (!Core::g_CoreStartupParameter.bEnableDebugging)
+	{
+		for (int i = 0; i < size_of_merged_addresses; ++i)
+			code[0].cycles += PatchEngine::GetSpeedhackCycles(merged_addresses[i]);
+	}
+
+	int block_num = m_block_cache.AllocateBlock(em_address);
+	JitBlock *b = m_block_cache.GetBlock(block_num);
+	b->checkedEntry = (const u8*)code;
+	b->normalEntry = (const u8*)code;
+	b->runCount = 0;
+	b->flags = 0;
+	b->codeSize = size * sizeof(Instruction);
+	b->originalSize = size;
+	m_code_pos += size;
+
+	m_block_cache.FinalizeBlock(block_num, false, b->normalEntry);
+	return block_num;
+}
+
+// Mirrors Interpreter::SingleStepInner for every instruction of the block,
+// leaving PC pointing at the next instruction to run.
+int CachedInterpreter::ExecuteBlock(const Instruction* code)
+{
+	int cycles = 0;
+	Interpreter::m_EndBlock = false;
+
+	for (;; ++code)
+	{
+		PC = code->address;
+		cycles += code->cycles;
+
+		if (code->hle_function != 0)
+		{
+			int flags = HLE::GetFunctionFlagsByIndex(code->hle_function);
+			if (HLE::IsEnabled(flags))
+			{
+				Interpreter::HLEFunction(code->hle_function);
+				Interpreter::m_EndBlock = false;
+				if (HLE::GetFunctionTypeByIndex(code->hle_function) == HLE::HLE_HOOK_REPLACE)
+				{
+					PC = NPC;
+					return cycles;
+				}
+			}
+		}
+
+		NPC = PC + sizeof(UGeckoInstruction);
+
+		if ((code->flags & FLAG_CHECK_FPU) && !((UReg_MSR&)MSR).FP)
+		{
+			Common::AtomicOr(PowerPC::ppcState.Exceptions, EXCEPTION_FPU_UNAVAILABLE);
+			PowerPC::CheckExceptions();
+			PC = NPC;
+			return cycles;
+		}
+
+		code->func(code->inst);
+
+		if (PowerPC::ppcState.Exceptions & EXCEPTION_DSI)
+		{
+			PowerPC::CheckExceptions();
+			PC = NPC;
+			return cycles;
+		}
+
+		if (code->flags & FLAG_LAST)
+			break;
+
+		// Followed branches continue in the same block as long as they went
+		// where Flatten expected them to.
+		if (Interpreter::m_EndBlock)
+		{
+			Interpreter::m_EndBlock = false;
+			if (NPC != code[1].address)
+				break;
+		}
+	}
+
+	PC = NPC;
+	return cycles;
+}
+
+void CachedInterpreter::Run()
+{
+	// Breakpoints and stepping are only handled by the plain interpreter
+	if (Core::g_CoreStartupParameter.bEnableDebugging)
+	{
+		Interpreter::getInstance()->Run();
+		return;
+	}
+
+	const u8 **code_pointers = m_block_cache.GetCodePointers();
+	while (!PowerPC::GetState())
+	{
+		while (CoreTiming::downcount > 0)
+		{
+			int block_num = m_block_cache.GetBlockNumberFromStartAddress(PC);
+			if (block_num < 0)
+				block_num = CompileBlock(PC);
+
+			if (block_num < 0)
+			{
+				Interpreter::m_EndBlock = true;
+				CoreTiming::downcount -= Interpreter::getInstance()->SingleStepInner();
+			}
+			else
+			{
+				CoreTiming::downcount -= ExecuteBlock((const Instruction*)code_pointers[block_num]);
+			}
+		}
+
+		CoreTiming::Advance();
+
+		if (PowerPC::ppcState.Exceptions)
+		{
+			PowerPC::CheckExceptions();
+			PC = NPC;
+		}
+	}
+}
+
+void CachedInterpreter::SingleStep()
+{
+	Interpreter::getInstance()->SingleStep();
+}
@@ -0,0 +1,82 @@
+// Copyright 2013 Dolphin Emulator Project
+// Licensed under GPLv2
+// Refer to the license.txt file included.
+
+// A portable CPU core that sits between the interpreter and the JITs. Blocks
+// are analyzed once with PPCAnalyst::Flatten and stored as arrays of decoded
+// interpreter handlers, so running them skips the opcode fetch, the table
+// walk and the per-instruction bookkeeping of Interpreter::SingleStepInner.
+// Block lookup and invalidation (icbi, savestates) reuse JitBaseBlockCache.
+
+#ifndef _CACHEDINTERPRETER_H
+#define _CACHEDINTERPRETER_H
+
+#include "JitCommon/JitBase.h"
+#include "JitCommon/JitCache.h"
+#include "Interpreter/Interpreter.h"
+#include "PPCAnalyst.h"
+
+class CachedInterpreter : public JitBase
+{
+public:
+	CachedInterpreter() : m_code(NULL), m_code_pos(0), m_code_buffer(32000) {}
+	~CachedInterpreter() {}
+
+	void Init();
+	void Shutdown();
+
+	void Jit(u32 em_address);
+
+	JitBaseBlockCache *GetBlockCache() { return &m_block_cache; }
+
+	void ClearCache();
+
+	void Run();
+	void SingleStep();
+
+	const char *GetName() { return "Cached Interpreter"; }
+
+	const u8 *BackPatch(u8 *codePtr, u32 em_address, void *ctx) { return NULL; }
+	const CommonAsmRoutinesBase *GetAsmRoutines() { return NULL; }
+	bool IsInCodeSpace(u8 *ptr) { return false; }
+
+private:
+	struct Instruction
+	{
+		Interpreter::_interpreterInstruction func;
+		UGeckoInstruction inst;
+		u32 address;
+		u32 hle_function;	// 0 when the address isn't patched
+		u16 cycles;
+		u16 flags;
+	};
+
+	enum
+	{
+		FLAG_CHECK_FPU = 1,		// Raise FPU unavailable when MSR.FP is clear
+		FLAG_LAST = 2,			// Last instruction of the block
+	};
+
+	enum
+	{
+		CODE_SIZE = 0x80000	// Instructions
+	};
+
+	// Blocks never jump to each other, so there is nothing to patch.
+	class BlockCache : public JitBaseBlockCache
+	{
+	private:
+		void WriteLinkBlock(u8* location, const u8* address) {}
+		void WriteDestroyBlock(const u8* location, u32 address) {}
+	};
+
+	int CompileBlock(u32 em_address);
+	int ExecuteBlock(const Instruction* code);
+
+	BlockCache m_block_cache;
+	Instruction* m_code;
+	u32 m_code_pos;
+	PPCAnalyst::CodeBuffer m_code_buffer;
+};
+
+#endif // _CACHEDINTERPRETER_H
@@ -183,6 +183,7 @@ void Interpreter::mtmsr(UGeckoInstruction _inst)
 static void SetSR(int index, u32 value) {
 	DEBUG_LOG(POWERPC, "%08x: MMU: Segment register %i set to %08x", PowerPC::ppcState.pc, index, value);
 	PowerPC::ppcState.sr[index] = value;
+	Memory::InvalidateTLB();
 }
 
 void Interpreter::mtsr(UGeckoInstruction _inst)
@@ -376,6 +377,15 @@ void Interpreter::mtspr(UGeckoInstruction _inst)
 	case SPR_SDR:
 		Memory::SDRUpdated();
 		break;
+
+	// Translations cached in the TLB may now be covered by a BAT
+	case SPR_IBAT0U: case SPR_IBAT0L: case SPR_IBAT1U: case SPR_IBAT1L:
+	case SPR_IBAT2U: case SPR_IBAT2L: case SPR_IBAT3U: case SPR_IBAT3L:
+	case SPR_DBAT0U: case SPR_DBAT0L: case SPR_DBAT1U: case SPR_DBAT1L:
+	case SPR_DBAT2U: case SPR_DBAT2L: case SPR_DBAT3U: case SPR_DBAT3L:
+		if (m_GPR[_inst.RD] != oldValue)
+			Memory::InvalidateTLB();
+		break;
 	}
 }
 
@@ -18,6 +18,7 @@
 #include "JitRegCache.h"
 #include "Jit64_Tables.h"
 #include "HW/ProcessorInterface.h"
+#include "../JitCommon/JitVerifier.h"
 #if defined(_DEBUG) || defined(DEBUGFAST)
 #include "PowerPCDisasm.h"
 #endif
@@ -167,6 +168,15 @@ void Jit64::Init()
 		else
 			jo.enableBlocklink = !Core::g_CoreStartupParameter.bMMU;
 	}
+
+	// Every block has to go back through the dispatcher to be checked, and
+	// idle skipping would make the JIT run code the interpreter never sees.
+	JitVerifier::Init();
+	if (JitVerifier::IsEnabled())
+	{
+		jo.enableBlocklink = false;
+		Core::g_CoreStartupParameter.bSkipIdle = false;
+	}
 	jo.fpAccurateFcmp = Core::g_CoreStartupParameter.bEnableFPRF;
 	jo.optimizeGatherPipe = true;
 	jo.fastInterrupts = false;
@@ -176,6 +186,9 @@ void Jit64::Init()
 	gpr.SetEmitter(this);
 	fpr.SetEmitter(this);
 
+	memset(&totalStats, 0, sizeof(totalStats));
+	ResetBranchProfile();
+
 	trampolines.Init();
 	AllocCodeSpace(CODE_SIZE);
 
@@ -197,6 +210,19 @@ void Jit64::Shutdown()
 	blocks.Shutdown();
 	trampolines.Shutdown();
 	asm_routines.Shutdown();
+
+	JitVerifier::Shutdown();
+
+	if (totalStats.numBlocks)
+	{
+		NOTICE_LOG(DYNA_REC, "JIT64: %u blocks, %u instructions: GPR %u loads, %u stores (%u skipped), "
+			"FPR %u loads, %u stores (%u skipped), %u flushes, %u exit-only flushes, %u CR0 and %u CA updates skipped",
+			totalStats.numBlocks, totalStats.numInstructions,
+			totalStats.gpr.numLoads, totalStats.gpr.numStores, totalStats.gpr.numStoresSkipped,
+			totalStats.fpr.numLoads, totalStats.fpr.numStores, totalStats.fpr.numStoresSkipped,
+			totalStats.gpr.numFlushes, totalStats.gpr.numExitFlushes,
+			totalStats.numCRUpdatesSkipped, totalStats.numCAUpdatesSkipped);
+	}
 }
 
 // This is only called by Default() in this file. It will execute an instruction with the interpreter functions.
@@ -276,27 +302,51 @@ void Jit64::Cleanup()
 		ABI_CallFunctionCCC((void *)&PowerPC::UpdatePerformanceMonitor, js.downcountAmount, jit->js.numLoadStoreInst, jit->js.numFloatingPointInst);
 }
 
-void Jit64::WriteExit(u32 destination, int exit_num)
+void Jit64::WriteBranchExit(u32 branch_address, u32 destination)
+{
+	// A busy wait loop going around again can't see anything new before
+	// the next event, so skip to it. Other exits to the loop's start, like
+	// a breakpoint on it, must not.
+	if (js.isIdleLoop && branch_address == js.idleLoopBranch && destination == js.blockStart)
+	{
+		MOV(32, M(&PC), Imm32(destination));
+		ABI_CallFunction((void *)&CoreTiming::Idle);
+		WriteExceptionExit();
+		return;
+	}
+
+	WriteExit(destination);
+}
+
+void Jit64::WriteExit(u32 destination)
 {
 	Cleanup();
 
 	SUB(32, M(&CoreTiming::downcount), js.downcountAmount > 127 ? Imm32(js.downcountAmount) : Imm8(js.downcountAmount));
 
-	//If nobody has taken care of this yet (this can be removed when all branches are done)
+	// Exits are numbered in the order they are written. Past the last
+	// linkable one they always go through the dispatcher.
 	JitBlock *b = js.curBlock;
-	b->exitAddress[exit_num] = destination;
-	b->exitPtrs[exit_num] = GetWritableCodePtr();
-	
-	// Link opportunity!
-	if (jo.enableBlocklink)
+	int exit_num = 0;
+	while (exit_num < MAX_BLOCK_EXITS && b->exitPtrs[exit_num])
+		exit_num++;
+
+	if (exit_num < MAX_BLOCK_EXITS)
 	{
-		int block = blocks.GetBlockNumberFromStartAddress(destination);
-		if (block >= 0)
+		b->exitAddress[exit_num] = destination;
+		b->exitPtrs[exit_num] = GetWritableCodePtr();
+
+		// Link opportunity!
+		if (jo.enableBlocklink)
 		{
-			// It exists! Joy of joy!
-			JMP(blocks.GetBlock(block)->checkedEntry, true);
-			b->linkStatus[exit_num] = true;
-			return;
+			int block = blocks.GetBlockNumberFromStartAddress(destination);
+			if (block >= 0)
+			{
+				// It exists! Joy of joy!
+				JMP(blocks.GetBlock(block)->checkedEntry, true);
+				b->linkStatus[exit_num] = true;
+				return;
+			}
 		}
 	}
 	MOV(32, M(&PC), Imm32(destination));
@@ -450,10 +500,14 @@ const u8* Jit64::DoJit(u32 em_address, PPCAnalyst::CodeBuffer *code_buf, JitBloc
 	if (!memory_exception)
 	{
 		// If there is a memory exception inside a block (broken_block==true), compile up to that instruction.
-		nextPC = PPCAnalyst::Flatten(em_address, &size, &js.st, &js.gpa, &js.fpa, broken_block, code_buf, blockSize, merged_addresses, capacity_of_merged_addresses, size_of_merged_addresses);
+		nextPC = PPCAnalyst::Flatten(em_address, &size, &js.st, &js.gpa, &js.fpa, broken_block, code_buf, blockSize, merged_addresses, capacity_of_merged_addresses, size_of_merged_addresses, &GetBranchHint);
 	}
 
 	PPCAnalyst::CodeOp *ops = code_buf->codebuffer;
+	MarkBlockExits(ops, size);
+	js.isIdleLoop = Core::g_CoreStartupParameter.bSkipIdle && HLE::GetFunctionIndex(em_address) == 0 &&
+		PPCAnalyst::IsBusyWaitLoop(ops, size, em_address);
+	js.idleLoopBranch = js.isIdleLoop ? ops[size - 1].address : 0;
 
 	const u8 *start = AlignCode4(); // TODO: Test if this or AlignCode16 make a difference from GetCodePtr
 	b->checkedEntry = start;
@@ -471,6 +525,9 @@ const u8* Jit64::DoJit(u32 em_address, PPCAnalyst::CodeBuffer *code_buf, JitBloc
 	if (ImHereDebug)
 		ABI_CallFunction((void *)&ImHere); //Used to get a trace of the last few blocks before a crash, sometimes VERY useful
 
+	if (JitVerifier::IsEnabled() && JitVerifier::RegisterBlock(em_address, ops, size))
+		ABI_CallFunctionC((void *)&JitVerifier::BeginBlock, js.blockStart);
+
 	// Conditionally add profiling code.
 	if (Profiler::g_ProfileBlocks) {
 		ADD(32, M(&b->runCount), Imm8(1));
@@ -493,6 +550,8 @@ const u8* Jit64::DoJit(u32 em_address, PPCAnalyst::CodeBuffer *code_buf, JitBloc
 	// They use the information in gpa/fpa to preload commonly used registers.
 	gpr.Start(js.gpa);
 	fpr.Start(js.fpa);
+	blockStats.numCRUpdatesSkipped = 0;
+	blockStats.numCAUpdatesSkipped = 0;
 
 	js.downcountAmount = 0;
 	if (!Core::g_CoreStartupParameter.bEnableDebugging)
@@ -573,13 +632,14 @@ const u8* Jit64::DoJit(u32 em_address, PPCAnalyst::CodeBuffer *code_buf, JitBloc
 		{
 			if ((opinfo->flags & FL_USE_FPU) && !js.firstFPInstructionFound)
 			{
-				gpr.Flush(FLUSH_ALL);
-				fpr.Flush(FLUSH_ALL);
-
 				//This instruction uses FPU - needs to add FP exception bailout
 				TEST(32, M(&PowerPC::ppcState.msr), Imm32(1 << 13)); // Test FP enabled bit
 				FixupBranch b1 = J_CC(CC_NZ, true);
 
+				// Only the exception path needs the registers in memory
+				gpr.Flush(FLUSH_MAINTAIN_STATE);
+				fpr.Flush(FLUSH_MAINTAIN_STATE);
+
 				// If a FPU exception occurs, the exception handler will read
 				// from PC.  Update PC with the latest value in case that happens.
 				MOV(32, M(&PC), Imm32(ops[i].address));
@@ -594,9 +654,6 @@ const u8* Jit64::DoJit(u32 em_address, PPCAnalyst::CodeBuffer *code_buf, JitBloc
 			// Add an external exception check if the instruction writes to the FIFO.
 			if (jit->js.fifoWriteAddresses.find(ops[i].address) != jit->js.fifoWriteAddresses.end())
 			{
-				gpr.Flush(FLUSH_ALL);
-				fpr.Flush(FLUSH_ALL);
-
 				TEST(32, M((void *)&PowerPC::ppcState.Exceptions), Imm32(EXCEPTION_ISI | EXCEPTION_PROGRAM | EXCEPTION_SYSCALL | EXCEPTION_FPU_UNAVAILABLE | EXCEPTION_DSI | EXCEPTION_ALIGNMENT));
 				FixupBranch clearInt = J_CC(CC_NZ, true);
 				TEST(32, M((void *)&PowerPC::ppcState.Exceptions), Imm32(EXCEPTION_EXTERNAL_INT));
@@ -606,6 +663,9 @@ const u8* Jit64::DoJit(u32 em_address, PPCAnalyst::CodeBuffer *code_buf, JitBloc
 				TEST(32, M((void *)&ProcessorInterface::m_InterruptCause), Imm32(ProcessorInterface::INT_CAUSE_CP | ProcessorInterface::INT_CAUSE_PE_TOKEN | ProcessorInterface::INT_CAUSE_PE_FINISH));
 				FixupBranch noCPInt = J_CC(CC_Z, true);
 
+				gpr.Flush(FLUSH_MAINTAIN_STATE);
+				fpr.Flush(FLUSH_MAINTAIN_STATE);
+
 				MOV(32, M(&PC), Imm32(ops[i].address));
 				WriteExternalExceptionExit();
 
@@ -625,7 +685,7 @@ const u8* Jit64::DoJit(u32 em_address, PPCAnalyst::CodeBuffer *code_buf, JitBloc
 				TEST(32, M((void*)PowerPC::GetStatePtr()), Imm32(0xFFFFFFFF));
 				FixupBranch noBreakpoint = J_CC(CC_Z);
 
-				WriteExit(ops[i].address, 0);
+				WriteExit(ops[i].address);
 				SetJumpTarget(noBreakpoint);
 			}
 
@@ -633,13 +693,13 @@ const u8* Jit64::DoJit(u32 em_address, PPCAnalyst::CodeBuffer *code_buf, JitBloc
 
 			if (js.memcheck && (opinfo->flags & FL_LOADSTORE))
 			{
-				// In case we are about to jump to the dispatcher, flush regs
-				gpr.Flush(FLUSH_ALL);
-				fpr.Flush(FLUSH_ALL);
-
 				TEST(32, M((void *)&PowerPC::ppcState.Exceptions), Imm32(EXCEPTION_DSI));
 				FixupBranch noMemException = J_CC(CC_Z, true);
 
+				// In case we are about to jump to the dispatcher, flush regs
+				gpr.Flush(FLUSH_MAINTAIN_STATE);
+				fpr.Flush(FLUSH_MAINTAIN_STATE);
+
 				// If a memory exception occurs, the exception handler will read
 				// from PC.  Update PC with the latest value in case that happens.
 				MOV(32, M(&PC), Imm32(ops[i].address));
@@ -707,13 +767,15 @@ const u8* Jit64::DoJit(u32 em_address, PPCAnalyst::CodeBuffer *code_buf, JitBloc
 	{
 		gpr.Flush(FLUSH_ALL);
 		fpr.Flush(FLUSH_ALL);
-		WriteExit(nextPC, 0);
+		WriteExit(nextPC);
 	}
 
 	b->flags = js.block_flags;
 	b->codeSize = (u32)(GetCodePtr() - normalEntry);
 	b->originalSize = size;
 
+	LogBlockStats(b, size);
+
 #ifdef JIT_LOG_X86
 	LogGeneratedX86(size, code_buf, normalEntry, b);
 #endif
@@ -721,6 +783,63 @@ const u8* Jit64::DoJit(u32 em_address, PPCAnalyst::CodeBuffer *code_buf, JitBloc
 	return normalEntry;
 }
 
+// Exits the JIT adds on top of the ones PPCAnalyst knows about. The flags
+// must be in memory when leaving through them.
+void Jit64::MarkBlockExits(PPCAnalyst::CodeOp *ops, int size)
+{
+	bool changed = false;
+	for (int i = 0; i < size; i++)
+	{
+		const u32 address = ops[i].address;
+		if (ops[i].canEndBlock)
+			continue;
+		if (js.fifoWriteAddresses.find(address) != js.fifoWriteAddresses.end() ||
+			HLE::GetFunctionIndex(address) != 0 ||
+			(Core::g_CoreStartupParameter.bEnableDebugging && breakpoints.IsAddressBreakPoint(address)))
+		{
+			ops[i].canEndBlock = true;
+			changed = true;
+		}
+	}
+	if (changed)
+		PPCAnalyst::ComputeFlagLiveness(ops, size);
+}
+
+static void AddRegCacheStats(RegCacheStats &total, const RegCacheStats &block)
+{
+	total.numLoads += block.numLoads;
+	total.numStores += block.numStores;
+	total.numStoresSkipped += block.numStoresSkipped;
+	total.numFlushes += block.numFlushes;
+	total.numExitFlushes += block.numExitFlushes;
+}
+
+void Jit64::LogBlockStats(JitBlock *b, int size)
+{
+	blockStats.numBlocks = 1;
+	blockStats.numInstructions = size;
+	blockStats.gpr = gpr.GetStats();
+	blockStats.fpr = fpr.GetStats();
+
+	const CodeGenStats &s = blockStats;
+	b->regLoads = s.gpr.numLoads + s.fpr.numLoads;
+	b->regStores = s.gpr.numStores + s.fpr.numStores;
+	b->regStoresSkipped = s.gpr.numStoresSkipped + s.fpr.numStoresSkipped;
+
+	DEBUG_LOG(DYNA_REC, "Block %08x: %d instructions, GPR %u loads, %u stores (%u skipped), "
+		"FPR %u loads, %u stores (%u skipped), %u flushes, %u exit-only flushes, %u CR0 and %u CA updates skipped",
+		b->originalAddress, size, s.gpr.numLoads, s.gpr.numStores, s.gpr.numStoresSkipped,
+		s.fpr.numLoads, s.fpr.numStores, s.fpr.numStoresSkipped, s.gpr.numFlushes, s.gpr.numExitFlushes,
+		s.numCRUpdatesSkipped, s.numCAUpdatesSkipped);
+
+	totalStats.numBlocks += s.numBlocks;
+	totalStats.numInstructions += s.numInstructions;
+	AddRegCacheStats(totalStats.gpr, s.gpr);
+	AddRegCacheStats(totalStats.fpr, s.fpr);
+	totalStats.numCRUpdatesSkipped += s.numCRUpdatesSkipped;
+	totalStats.numCAUpdatesSkipped += s.numCAUpdatesSkipped;
+}
+
 u32 Jit64::RegistersInUse()
 {
 #ifdef _M_X64
@@ -58,6 +58,31 @@ private:
 	PPCAnalyst::CodeBuffer code_buffer;
 	Jit64AsmRoutineManager asm_routines;
 
+	// What the register caches and the flag liveness saved, per block and
+	// for the whole session
+	struct CodeGenStats
+	{
+		u32 numBlocks;
+		u32 numInstructions;
+		RegCacheStats gpr;
+		RegCacheStats fpr;
+		u32 numCRUpdatesSkipped;
+		u32 numCAUpdatesSkipped;
+	};
+	CodeGenStats blockStats;
+	CodeGenStats totalStats;
+
+	void MarkBlockExits(PPCAnalyst::CodeOp *ops, int size);
+	void LogBlockStats(JitBlock *b, int size);
+
+	// Conditional branches that end a block count which way they go until
+	// one direction was seen often enough. If it dominates, the block is
+	// recompiled to continue in that direction. See Jit_Branch.cpp.
+	void WriteBranchProfile(u32 address, u32 target, bool taken);
+	static PPCAnalyst::BranchHint GetBranchHint(u32 address);
+	static void PromoteBlock(u32 block_address, u32 branch_address);
+	static void ResetBranchProfile();
+
 public:
 	Jit64() : code_buffer(32000) {}
 	~Jit64() {}
@@ -99,7 +124,9 @@ public:
 
 	// Utilities for use by opcodes
 
-	void WriteExit(u32 destination, int exit_num);
+	void WriteExit(u32 destination);
+	// Exit taken by the branch at branch_address
+	void WriteBranchExit(u32 branch_address, u32 destination);
 	void WriteExitDestInEAX();
 	void WriteExceptionExit();
 	void WriteExternalExceptionExit();
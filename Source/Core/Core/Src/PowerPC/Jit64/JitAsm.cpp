@@ -6,6 +6,7 @@
 
 #include "Jit.h"
 #include "JitAsm.h"
+#include "../JitCommon/JitVerifier.h"
 
 using namespace Gen;
 
@@ -52,7 +53,18 @@ void Jit64AsmRoutineManager::Generate()
 		dispatcher = GetCodePtr();
 			// The result of slice decrementation should be in flags if somebody jumped here
 			// IMPORTANT - We jump on negative, not carry!!!
-			FixupBranch bail = J_CC(CC_BE, true);
+			FixupBranch bail;
+			if (JitVerifier::IsEnabled())
+			{
+				// The call trashes the flags, test the downcount again
+				ABI_CallFunction(reinterpret_cast<void *>(&JitVerifier::EndBlock));
+				CMP(32, M(&CoreTiming::downcount), Imm8(0));
+				bail = J_CC(CC_LE, true);
+			}
+			else
+			{
+				bail = J_CC(CC_BE, true);
+			}
 
 			if (Core::g_CoreStartupParameter.bEnableDebugging)
 			{
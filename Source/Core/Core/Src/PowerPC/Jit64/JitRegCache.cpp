@@ -19,10 +19,12 @@ RegCache::RegCache() : emit(0)
 	memset(xregs, 0, sizeof(xregs));
 	memset(saved_regs, 0, sizeof(saved_regs));
 	memset(saved_xregs, 0, sizeof(saved_xregs));
+	memset(&stats, 0, sizeof(stats));
 }
 
 void RegCache::Start(PPCAnalyst::BlockRegStats &stats)
 {
+	memset(&this->stats, 0, sizeof(this->stats));
 	for (int i = 0; i < NUMXREGS; i++)
 	{
 		xregs[i].free = true;
@@ -264,7 +266,10 @@ void GPRRegCache::BindToRegister(int i, bool doLoad, bool makeDirty)
 		xregs[xr].dirty = makeDirty || regs[i].location.IsImm();
 		OpArg newloc = ::Gen::R(xr);
 		if (doLoad)
+		{
 			emit->MOV(32, newloc, regs[i].location);
+			stats.numLoads++;
+		}
 		for (int j = 0; j < 32; j++)
 		{
 			if (i != j && regs[j].location.IsSimpleReg() && regs[j].location.GetSimpleReg() == xr)
@@ -306,14 +311,21 @@ void GPRRegCache::StoreFromRegister(int i)
 			//must be immediate - do nothing
 			doStore = true;
 		}
-		OpArg newLoc = GetDefaultLocation(i);
 		if (doStore)
-			emit->MOV(32, newLoc, regs[i].location);
-		regs[i].location = newLoc;
+			EmitStore(i);
+		else
+			stats.numStoresSkipped++;
+		regs[i].location = GetDefaultLocation(i);
 		regs[i].away = false;
 	}
 }
 
+void GPRRegCache::EmitStore(int preg)
+{
+	emit->MOV(32, GetDefaultLocation(preg), regs[preg].location);
+	stats.numStores++;
+}
+
 void FPURegCache::BindToRegister(int i, bool doLoad, bool makeDirty)
 {
 	_assert_msg_(DYNA_REC, !regs[i].location.IsImm(), "WTF - load - imm");
@@ -333,6 +345,7 @@ void FPURegCache::BindToRegister(int i, bool doLoad, bool makeDirty)
 				PanicAlert("WARNING - misaligned fp register location %i", i);
 			}
 			emit->MOVAPD(xr, regs[i].location);
+			stats.numLoads++;
 		}
 		regs[i].location = newloc;
 		regs[i].away = true;
@@ -351,12 +364,15 @@ void FPURegCache::StoreFromRegister(int i)
 	{
 		X64Reg xr = regs[i].location.GetSimpleReg();
 		_assert_msg_(DYNA_REC, xr < NUMXREGS, "WTF - store - invalid reg");
+		// Registers that were only read still match the register file
+		if (xregs[xr].dirty)
+			EmitStore(i);
+		else
+			stats.numStoresSkipped++;
 		xregs[xr].free = true;
 		xregs[xr].dirty = false;
 		xregs[xr].ppcReg = -1;
-		OpArg newLoc = GetDefaultLocation(i);
-		emit->MOVAPD(newLoc, xr);
-		regs[i].location = newLoc;
+		regs[i].location = GetDefaultLocation(i);
 		regs[i].away = false;
 	}
 	else
@@ -365,13 +381,36 @@ void FPURegCache::StoreFromRegister(int i)
 	}
 }
 
+void FPURegCache::EmitStore(int preg)
+{
+	emit->MOVAPD(GetDefaultLocation(preg), regs[preg].location.GetSimpleReg());
+	stats.numStores++;
+}
+
 void RegCache::Flush(FlushMode mode)
 {
+	if (mode == FLUSH_MAINTAIN_STATE)
+	{
+		for (int i = 0; i < 32; i++)
+		{
+			if (!regs[i].away)
+				continue;
+			if (regs[i].location.IsImm() ||
+				(regs[i].location.IsSimpleReg() && xregs[RX(i)].dirty))
+			{
+				EmitStore(i);
+			}
+		}
+		stats.numExitFlushes++;
+		return;
+	}
+
 	for (int i = 0; i < NUMXREGS; i++)
 	{
 		if (xlocks[i])
 			PanicAlert("Someone forgot to unlock X64 reg %i.", i);
 	}
+	stats.numFlushes++;
 
 	for (int i = 0; i < 32; i++)
 	{
@@ -10,7 +10,11 @@
 using namespace Gen;
 enum FlushMode
 {
-	FLUSH_ALL
+	FLUSH_ALL,
+	// Write back dirty registers and immediates without changing what is
+	// cached. For exits taken on a conditional branch, so that the code after
+	// the branch can keep using the cached values.
+	FLUSH_MAINTAIN_STATE,
 };
 
 enum GrabMode
@@ -36,6 +40,16 @@ struct X64CachedReg
 typedef int XReg;
 typedef int PReg;
 
+// Code generation counters, reset by Start()
+struct RegCacheStats
+{
+	u32 numLoads;          // guest registers loaded into host registers
+	u32 numStores;         // guest registers written back
+	u32 numStoresSkipped;  // write-backs not needed because the register was clean
+	u32 numFlushes;
+	u32 numExitFlushes;    // FLUSH_MAINTAIN_STATE, which keep the cache intact
+};
+
 #ifdef _M_X64
 #define NUMXREGS 16
 #elif _M_IX86
@@ -58,8 +72,12 @@ protected:
 	X64CachedReg saved_xregs[NUMXREGS];
 
 	virtual const int *GetAllocationOrder(int &count) = 0;
+	// Emits the write back of preg to its default location, without
+	// touching the cache state
+	virtual void EmitStore(int preg) = 0;
 	
 	XEmitter *emit;
+	RegCacheStats stats;
 
 public:
 	RegCache();
@@ -116,6 +134,8 @@ public:
 
 	void SaveState();
 	void LoadState();
+
+	const RegCacheStats &GetStats() const {return stats;}
 };
 
 class GPRRegCache : public RegCache
@@ -127,6 +147,9 @@ public:
 	OpArg GetDefaultLocation(int reg) const;
 	const int *GetAllocationOrder(int &count);
 	void SetImmediate32(int preg, u32 immValue);
+
+protected:
+	void EmitStore(int preg);
 };
 
 
@@ -138,6 +161,9 @@ public:
 	void StoreFromRegister(int preg);
 	const int *GetAllocationOrder(int &count);
 	OpArg GetDefaultLocation(int reg) const;
+
+protected:
+	void EmitStore(int preg);
 };
 
 #endif  // _JIT64REGCACHE_H
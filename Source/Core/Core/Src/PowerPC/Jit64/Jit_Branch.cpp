@@ -21,6 +21,69 @@
 
 using namespace Gen;
 
+enum
+{
+	BRANCH_PROFILE_SIZE = 0x1000,
+	// Times one direction has to be seen before the block is recompiled
+	BRANCH_PROFILE_THRESHOLD = 256,
+	// The other direction has to be rarer than 1 in BRANCH_PROFILE_BIAS
+	BRANCH_PROFILE_BIAS = 16,
+};
+
+// Not taken and taken counts of the conditional branches that end blocks,
+// indexed by address. Collisions only make the hints less accurate.
+static u32 s_branch_profile[BRANCH_PROFILE_SIZE][2];
+
+static u32 *GetBranchCounters(u32 address)
+{
+	return s_branch_profile[(address >> 2) & (BRANCH_PROFILE_SIZE - 1)];
+}
+
+void Jit64::ResetBranchProfile()
+{
+	memset(s_branch_profile, 0, sizeof(s_branch_profile));
+}
+
+PPCAnalyst::BranchHint Jit64::GetBranchHint(u32 address)
+{
+	const u32 *counters = GetBranchCounters(address);
+	if (counters[1] >= BRANCH_PROFILE_THRESHOLD && counters[0] * BRANCH_PROFILE_BIAS <= counters[1])
+		return PPCAnalyst::BRANCH_HINT_TAKEN;
+	if (counters[0] >= BRANCH_PROFILE_THRESHOLD && counters[1] * BRANCH_PROFILE_BIAS <= counters[0])
+		return PPCAnalyst::BRANCH_HINT_NOT_TAKEN;
+	return PPCAnalyst::BRANCH_HINT_NONE;
+}
+
+void Jit64::PromoteBlock(u32 block_address, u32 branch_address)
+{
+	if (GetBranchHint(branch_address) == PPCAnalyst::BRANCH_HINT_NONE)
+		return;
+
+	// The next dispatch to the block compiles it again, past the branch
+	DEBUG_LOG(DYNA_REC, "Recompiling block %08x to follow the branch at %08x", block_address, branch_address);
+	jit->GetBlockCache()->InvalidateICache(block_address, 4);
+}
+
+void Jit64::WriteBranchProfile(u32 address, u32 target, bool taken)
+{
+	// Loops back to the start are never followed, and once a direction
+	// reached the threshold the hint won't change anymore.
+	const u32 *counters = GetBranchCounters(address);
+	if (!Core::g_CoreStartupParameter.bMergeBlocks || Core::g_CoreStartupParameter.bEnableDebugging ||
+		target == js.blockStart ||
+		counters[0] >= BRANCH_PROFILE_THRESHOLD || counters[1] >= BRANCH_PROFILE_THRESHOLD)
+	{
+		return;
+	}
+
+	const u32 *counter = &counters[taken ? 1 : 0];
+	ADD(32, M((void *)counter), Imm8(1));
+	CMP(32, M((void *)counter), Imm32(BRANCH_PROFILE_THRESHOLD));
+	FixupBranch notYet = J_CC(CC_NE);
+	ABI_CallFunctionCC((void *)&PromoteBlock, js.blockStart, address);
+	SetJumpTarget(notYet);
+}
+
 void Jit64::sc(UGeckoInstruction inst)
 {
 	INSTRUCTION_START
@@ -91,7 +154,7 @@ void Jit64::bx(UGeckoInstruction inst)
 		// make idle loops go faster
 		js.downcountAmount += 8;
 	}
-	WriteExit(destination, 0);
+	WriteBranchExit(js.compilerPC, destination);
 }
 
 // TODO - optimize to hell and beyond
@@ -103,19 +166,31 @@ void Jit64::bcx(UGeckoInstruction inst)
 	JITDISABLE(bJITBranchOff)
 
 	// USES_CR
-	_assert_msg_(DYNA_REC, js.isLastInstruction, "bcx not last instruction of block");
 
-	gpr.Flush(FLUSH_ALL);
-	fpr.Flush(FLUSH_ALL);
+	u32 destination;
+	if(inst.AA)
+		destination = SignExt16(inst.BD << 2);
+	else
+		destination = js.compilerPC + SignExt16(inst.BD << 2);
 
+	// PPCAnalyst continued the block in the likely direction, only the
+	// other one leaves it
+	const bool followed = !js.isLastInstruction;
+	if (!followed)
+	{
+		gpr.Flush(FLUSH_ALL);
+		fpr.Flush(FLUSH_ALL);
+	}
+
+	// The exit in between can be long with the flushes and the profiling
 	FixupBranch pCTRDontBranch;
 	if ((inst.BO & BO_DONT_DECREMENT_FLAG) == 0)  // Decrement and test CTR
 	{
 		SUB(32, M(&CTR), Imm8(1));
 		if (inst.BO & BO_BRANCH_IF_CTR_0)
-			pCTRDontBranch = J_CC(CC_NZ);
+			pCTRDontBranch = J_CC(CC_NZ, true);
 		else
-			pCTRDontBranch = J_CC(CC_Z);
+			pCTRDontBranch = J_CC(CC_Z, true);
 	}
 
 	FixupBranch pConditionDontBranch;
@@ -123,26 +198,50 @@ void Jit64::bcx(UGeckoInstruction inst)
 	{
 		TEST(8, M(&PowerPC::ppcState.cr_fast[inst.BI >> 2]), Imm8(8 >> (inst.BI & 3)));
 		if (inst.BO & BO_BRANCH_IF_TRUE)  // Conditional branch 
-			pConditionDontBranch = J_CC(CC_Z);
+			pConditionDontBranch = J_CC(CC_Z, true);
 		else
-			pConditionDontBranch = J_CC(CC_NZ);
+			pConditionDontBranch = J_CC(CC_NZ, true);
 	}
 	
+	if (followed && js.next_compilerPC == destination)
+	{
+		FixupBranch taken = J(true);
+
+		if ((inst.BO & BO_DONT_CHECK_CONDITION) == 0)
+			SetJumpTarget( pConditionDontBranch );
+		if ((inst.BO & BO_DONT_DECREMENT_FLAG) == 0)
+			SetJumpTarget( pCTRDontBranch );
+		gpr.Flush(FLUSH_MAINTAIN_STATE);
+		fpr.Flush(FLUSH_MAINTAIN_STATE);
+		WriteExit(js.compilerPC + 4);
+
+		SetJumpTarget(taken);
+		return;
+	}
+
+	if (followed)
+	{
+		gpr.Flush(FLUSH_MAINTAIN_STATE);
+		fpr.Flush(FLUSH_MAINTAIN_STATE);
+	}
+
 	if (inst.LK)
 		MOV(32, M(&LR), Imm32(js.compilerPC + 4));
 
-	u32 destination;
-	if(inst.AA)
-		destination = SignExt16(inst.BD << 2);
-	else
-		destination = js.compilerPC + SignExt16(inst.BD << 2);
-	WriteExit(destination, 0);
+	if (!followed && !inst.LK)
+		WriteBranchProfile(js.compilerPC, destination, true);
+	WriteBranchExit(js.compilerPC, destination);
 
 	if ((inst.BO & BO_DONT_CHECK_CONDITION) == 0)
 		SetJumpTarget( pConditionDontBranch );
 	if ((inst.BO & BO_DONT_DECREMENT_FLAG) == 0)
 		SetJumpTarget( pCTRDontBranch );
-	WriteExit(js.compilerPC + 4, 1);
+	if (followed)
+		return;
+
+	if (!inst.LK)
+		WriteBranchProfile(js.compilerPC, destination, false);
+	WriteExit(js.compilerPC + 4);
 }
 
 void Jit64::bcctrx(UGeckoInstruction inst)
@@ -190,7 +289,7 @@ void Jit64::bcctrx(UGeckoInstruction inst)
 		WriteExitDestInEAX();
 		// Would really like to continue the block here, but it ends. TODO.
 		SetJumpTarget(b);
-		WriteExit(js.compilerPC + 4, 1);
+		WriteExit(js.compilerPC + 4);
 	}
 }
 
@@ -245,5 +344,5 @@ void Jit64::bclrx(UGeckoInstruction inst)
 		SetJumpTarget( pConditionDontBranch );
 	if ((inst.BO & BO_DONT_DECREMENT_FLAG) == 0)
 		SetJumpTarget( pCTRDontBranch );
-	WriteExit(js.compilerPC + 4, 1);
+	WriteExit(js.compilerPC + 4);
 }
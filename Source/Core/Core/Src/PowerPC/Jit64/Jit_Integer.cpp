@@ -36,6 +36,12 @@ void Jit64::GenerateOverflow()
 void Jit64::FinalizeCarryOverflow(bool oe, bool inv)
 {
 	// USES_XER
+	if (!oe && !js.op->wantsCA)
+	{
+		blockStats.numCAUpdatesSkipped++;
+		return;
+	}
+
 	if (oe)
 	{
 		FixupBranch jno = J_CC(CC_NO);
@@ -106,6 +112,12 @@ void Jit64::FinalizeCarryGenerateOverflowEAX(bool oe, bool inv)
 void Jit64::GenerateCarry()
 {
 	// USES_XER
+	if (!js.op->wantsCA)
+	{
+		blockStats.numCAUpdatesSkipped++;
+		return;
+	}
+
 	FixupBranch pNoCarry = J_CC(CC_NC);
 	OR(32, M(&PowerPC::ppcState.spr[SPR_XER]), Imm32(XER_CA_MASK));
 	FixupBranch pContinue = J();
@@ -117,6 +129,12 @@ void Jit64::GenerateCarry()
 // Assumes that Sign and Zero flags were set by the last operation. Preserves all flags and registers.
 void Jit64::GenerateRC()
 {
+	if (!js.op->wantsCR0)
+	{
+		blockStats.numCRUpdatesSkipped++;
+		return;
+	}
+
 	FixupBranch pZero  = J_CC(CC_Z);
 	FixupBranch pNegative = J_CC(CC_S);
 	MOV(8, M(&PowerPC::ppcState.cr_fast[0]), Imm8(0x4)); // Result > 0
@@ -135,6 +153,13 @@ void Jit64::GenerateRC()
 
 void Jit64::ComputeRC(const Gen::OpArg & arg)
 {
+	// Overwritten before anything reads it
+	if (!js.op->wantsCR0)
+	{
+		blockStats.numCRUpdatesSkipped++;
+		return;
+	}
+
 	if( arg.IsImm() )
 	{
 		s32 value = (s32)arg.offset;
@@ -316,9 +341,11 @@ void Jit64::cmpXX(UGeckoInstruction inst)
 		((js.next_inst.OPCD == 19) && (js.next_inst.SUBOP10 == 528) /* bcctrx */) ||
 		((js.next_inst.OPCD == 19) && (js.next_inst.SUBOP10 == 16) /* bclrx */)) &&
 		(js.next_inst.BO & BO_DONT_DECREMENT_FLAG) &&
-		!(js.next_inst.BO & BO_DONT_CHECK_CONDITION)) {
+		!(js.next_inst.BO & BO_DONT_CHECK_CONDITION) &&
+		js.instructionNumber + 2 == js.blockSize) {
 			// Looks like a decent conditional branch that we can merge with.
-			// It only test CR, not CTR.
+			// It only test CR, not CTR. Branches PPCAnalyst continued the
+			// block after are left to bcx.
 			if (test_crf == crf) {
 				merge_branch = true;
 			}
@@ -400,7 +427,7 @@ void Jit64::cmpXX(UGeckoInstruction inst)
 						destination = SignExt16(js.next_inst.BD << 2);
 					else
 						destination = js.next_compilerPC + SignExt16(js.next_inst.BD << 2);
-					WriteExit(destination, 0);
+					WriteBranchExit(js.next_compilerPC, destination);
 				}
 				else if ((js.next_inst.OPCD == 19) && (js.next_inst.SUBOP10 == 528)) // bcctrx
 				{
@@ -424,7 +451,7 @@ void Jit64::cmpXX(UGeckoInstruction inst)
 			}
 			else
 			{
-				WriteExit(js.next_compilerPC + 4, 0);
+				WriteExit(js.next_compilerPC + 4);
 			}
 
 			js.cancel = true;
@@ -475,6 +502,15 @@ void Jit64::cmpXX(UGeckoInstruction inst)
 			js.downcountAmount++;
 			int test_bit = 8 >> (js.next_inst.BI & 3);
 			bool condition = (js.next_inst.BO & BO_BRANCH_IF_TRUE) ? false : true;
+
+			u32 destination = 0;
+			if (js.next_inst.OPCD == 16) // bcx
+			{
+				if (js.next_inst.AA)
+					destination = SignExt16(js.next_inst.BD << 2);
+				else
+					destination = js.next_compilerPC + SignExt16(js.next_inst.BD << 2);
+			}
 			
 			// Test swapping (in the future, will be used to inline across branches the right way)
 			// if (rand() & 1)
@@ -485,29 +521,25 @@ void Jit64::cmpXX(UGeckoInstruction inst)
 			FixupBranch pLesser  = J_CC(less_than);
 			FixupBranch pGreater = J_CC(greater_than);
 			MOV(8, M(&PowerPC::ppcState.cr_fast[crf]), Imm8(0x2));  //  == 0
-			FixupBranch continue1 = J();
+			FixupBranch continue1 = J(true);
 
 			SetJumpTarget(pGreater);
 			MOV(8, M(&PowerPC::ppcState.cr_fast[crf]), Imm8(0x4));  //  > 0
-			FixupBranch continue2 = J();
+			FixupBranch continue2 = J(true);
 
 			SetJumpTarget(pLesser);
 			MOV(8, M(&PowerPC::ppcState.cr_fast[crf]), Imm8(0x8));  //  < 0
 			FixupBranch continue3;
-			if (!!(8 & test_bit) == condition) continue3 = J();
+			if (!!(8 & test_bit) == condition) continue3 = J(true);
 			if (!!(4 & test_bit) != condition) SetJumpTarget(continue2);
 			if (!!(2 & test_bit) != condition) SetJumpTarget(continue1);
 			if (js.next_inst.OPCD == 16) // bcx
 			{
 				if (js.next_inst.LK)
 					MOV(32, M(&LR), Imm32(js.compilerPC + 4));
-
-				u32 destination;
-				if (js.next_inst.AA)
-					destination = SignExt16(js.next_inst.BD << 2);
 				else
-					destination = js.next_compilerPC + SignExt16(js.next_inst.BD << 2);
-				WriteExit(destination, 0);
+					WriteBranchProfile(js.next_compilerPC, destination, true);
+				WriteBranchExit(js.next_compilerPC, destination);
 			}
 			else if ((js.next_inst.OPCD == 19) && (js.next_inst.SUBOP10 == 528)) // bcctrx
 			{
@@ -534,7 +566,9 @@ void Jit64::cmpXX(UGeckoInstruction inst)
 			if (!!(4 & test_bit) == condition) SetJumpTarget(continue2);
 			if (!!(2 & test_bit) == condition) SetJumpTarget(continue1);
 
-			WriteExit(js.next_compilerPC + 4, 1);
+			if (js.next_inst.OPCD == 16 && !js.next_inst.LK)
+				WriteBranchProfile(js.next_compilerPC, destination, false);
+			WriteExit(js.next_compilerPC + 4);
 
 			js.cancel = true;
 		}
@@ -870,7 +904,23 @@ void Jit64::subfic(UGeckoInstruction inst)
 	gpr.Lock(a, d);
 	gpr.BindToRegister(d, a == d, true);
 	int imm = inst.SIMM_16;
-	if (d == a)
+	if (!js.op->wantsCA)
+	{
+		// Only the difference is needed
+		if (d == a)
+		{
+			NEG(32, gpr.R(d));
+			if (imm != 0)
+				ADD(32, gpr.R(d), Imm32(imm));
+		}
+		else
+		{
+			MOV(32, gpr.R(d), Imm32(imm));
+			SUB(32, gpr.R(d), gpr.R(a));
+		}
+		blockStats.numCAUpdatesSkipped++;
+	}
+	else if (d == a)
 	{
 		if (imm == 0)
 		{
@@ -921,7 +971,8 @@ void Jit64::subfcx(UGeckoInstruction inst)
 	gpr.Lock(a, b, d);
 	gpr.BindToRegister(d, (d == a || d == b), true);
 
-	JitClearCAOV(inst.OE);
+	if (inst.OE || js.op->wantsCA)
+		JitClearCAOV(inst.OE);
 	if (d == b)
 	{
 		SUB(32, gpr.R(d), gpr.R(a));
@@ -1576,7 +1627,8 @@ void Jit64::addcx(UGeckoInstruction inst)
 		int operand = ((d == a) ? b : a);
 		gpr.Lock(a, b, d);
 		gpr.BindToRegister(d, true);
-		JitClearCAOV(inst.OE);
+		if (inst.OE || js.op->wantsCA)
+			JitClearCAOV(inst.OE);
 		ADD(32, gpr.R(d), gpr.R(operand));
 		if (inst.Rc)
 		{
@@ -1589,7 +1641,8 @@ void Jit64::addcx(UGeckoInstruction inst)
 	{
 		gpr.Lock(a, b, d);
 		gpr.BindToRegister(d, false);
-		JitClearCAOV(inst.OE);
+		if (inst.OE || js.op->wantsCA)
+			JitClearCAOV(inst.OE);
 		MOV(32, gpr.R(d), gpr.R(a)); 
 		ADD(32, gpr.R(d), gpr.R(b));
 		if (inst.Rc)
@@ -2090,6 +2143,19 @@ void Jit64::srawix(UGeckoInstruction inst)
 	{
 		gpr.Lock(a, s);
 		gpr.BindToRegister(a, a == s, true);
+		if (!js.op->wantsCA)
+		{
+			if (a != s)
+				MOV(32, gpr.R(a), gpr.R(s));
+			SAR(32, gpr.R(a), Imm8(amount));
+			if (inst.Rc)
+			{
+				GenerateRC();
+			}
+			blockStats.numCAUpdatesSkipped++;
+			gpr.UnlockAll();
+			return;
+		}
 		JitClearCA();
 		MOV(32, R(EAX), gpr.R(s));
 		if (a != s)
@@ -2221,5 +2287,5 @@ void Jit64::twx(UGeckoInstruction inst)
 	SetJumpTarget(exit3);
 	SetJumpTarget(exit4);
 	SetJumpTarget(exit5);
-	WriteExit(js.compilerPC + 4, 1);
+	WriteExit(js.compilerPC + 4);
 }
@@ -58,6 +58,8 @@ protected:
 		bool memcheck;
 		bool skipnext;
 		bool broken_block;
+		bool isIdleLoop;  // see PPCAnalyst::IsBusyWaitLoop
+		u32 idleLoopBranch;  // the loop's branch back to its start
 		int block_flags;
 
 		int fifoBytesThisBlock;
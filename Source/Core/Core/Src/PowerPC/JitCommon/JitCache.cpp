@@ -167,12 +167,13 @@ using namespace Gen;
 		JitBlock &b = blocks[num_blocks];
 		b.invalid = false;
 		b.originalAddress = em_address;
-		b.exitAddress[0] = INVALID_EXIT;
-		b.exitAddress[1] = INVALID_EXIT;
-		b.exitPtrs[0] = 0;
-		b.exitPtrs[1] = 0;
-		b.linkStatus[0] = false;
-		b.linkStatus[1] = false;
+		b.regLoads = b.regStores = b.regStoresSkipped = 0;
+		for (int e = 0; e < MAX_BLOCK_EXITS; e++)
+		{
+			b.exitAddress[e] = INVALID_EXIT;
+			b.exitPtrs[e] = 0;
+			b.linkStatus[e] = false;
+		}
 		num_blocks++; //commit the current block
 		return num_blocks - 1;
 	}
@@ -193,7 +194,7 @@ using namespace Gen;
 		block_map[std::make_pair(pAddr + 4 * b.originalSize - 1, pAddr)] = block_num;
 		if (block_link)
 		{
-			for (int i = 0; i < 2; i++)
+			for (int i = 0; i < MAX_BLOCK_EXITS; i++)
 			{
 				if (b.exitAddress[i] != INVALID_EXIT) 
 					links_to.insert(std::pair<u32, int>(b.exitAddress[i], block_num));
@@ -275,7 +276,7 @@ using namespace Gen;
 			// This block is dead. Don't relink it.
 			return;
 		}
-		for (int e = 0; e < 2; e++)
+		for (int e = 0; e < MAX_BLOCK_EXITS; e++)
 		{
 			if (b.exitAddress[e] != INVALID_EXIT && !b.linkStatus[e])
 			{
@@ -316,7 +317,7 @@ using namespace Gen;
 			return;
 		for (multimap<u32, int>::iterator iter = ppp.first; iter != ppp.second; ++iter) {
 			JitBlock &sourceBlock = blocks[iter->second];
-			for (int e = 0; e < 2; e++)
+			for (int e = 0; e < MAX_BLOCK_EXITS; e++)
 			{
 				if (sourceBlock.exitAddress[e] == b.originalAddress)
 					sourceBlock.linkStatus[e] = false;
@@ -30,13 +30,17 @@
 #define JIT_ICACHE_INVALID_BYTE 0x80
 #define JIT_ICACHE_INVALID_WORD 0x80808080
 
+// Blocks that continue past conditional branches have a side exit for each
+// of them on top of the two exits of the final branch.
+#define MAX_BLOCK_EXITS 8
+
 struct JitBlock
 {
 	const u8 *checkedEntry;
 	const u8 *normalEntry;
 
-	u8 *exitPtrs[2];     // to be able to rewrite the exit jum
-	u32 exitAddress[2];  // 0xFFFFFFFF == unknown
+	u8 *exitPtrs[MAX_BLOCK_EXITS];     // to be able to rewrite the exit jum
+	u32 exitAddress[MAX_BLOCK_EXITS];  // 0xFFFFFFFF == unknown
 
 	u32 originalAddress;
 	u32 codeSize; 
@@ -44,8 +48,13 @@ struct JitBlock
 	int runCount;  // for profiling.
 	int flags;
 
+	// Register cache work in the block, for profiling. Only Jit64 counts it.
+	u32 regLoads;
+	u32 regStores;
+	u32 regStoresSkipped;
+
 	bool invalid;
-	bool linkStatus[2];
+	bool linkStatus[MAX_BLOCK_EXITS];
 
 #ifdef _WIN32
 	// we don't really need to save start and stop
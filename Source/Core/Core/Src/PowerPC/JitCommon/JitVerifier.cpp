@@ -0,0 +1,470 @@
+// Copyright 2013 Dolphin Emulator Project
+// Licensed under GPLv2
+// Refer to the license.txt file included.
+
+#include <map>
+#include <set>
+#include <vector>
+
+#include "Common.h"
+#include "Atomic.h"
+
+#include "JitVerifier.h"
+#include "../PowerPC.h"
+#include "../PPCTables.h"
+#include "../Interpreter/Interpreter.h"
+#include "../../ConfigManager.h"
+#include "../../HLE/HLE.h"
+#include "../../HW/Memmap.h"
+#include "PowerPCDisasm.h"
+
+namespace JitVerifier
+{
+
+// Exceptions raised by the instructions themselves. The others are posted
+// by the hardware at any time, possibly from another thread.
+static const u32 SYNC_EXCEPTIONS = EXCEPTION_ISI | EXCEPTION_DSI | EXCEPTION_ALIGNMENT |
+	EXCEPTION_PROGRAM | EXCEPTION_SYSCALL | EXCEPTION_FPU_UNAVAILABLE;
+static const u32 ASYNC_EXCEPTIONS = EXCEPTION_EXTERNAL_INT | EXCEPTION_DECREMENTER |
+	EXCEPTION_PERFORMANCE_MONITOR;
+
+// The part of ppcState that a block can change. Copying the whole structure
+// would drag the instruction cache along.
+struct CPUState
+{
+	u32 gpr[32];
+	u64 ps[32][2];
+	u32 pc;
+	u32 npc;
+	u8 cr_fast[8];
+	u32 msr;
+	u32 fpscr;
+	u32 exceptions;
+	u32 sr[16];
+	u32 spr[1024];
+};
+
+struct Op
+{
+	UGeckoInstruction inst;
+	u32 address;
+	bool uses_fpu;
+};
+
+struct JournalEntry
+{
+	u8 *ptr;
+	u32 em_address;
+	u32 size;
+	u8 before[8];
+	u8 after[8];
+};
+
+static bool s_enabled;
+static std::map<u32, std::vector<Op> > s_blocks;
+static std::set<u32> s_reported;
+
+static bool s_pending;
+static u32 s_pending_address;
+static CPUState s_expected;
+
+static std::vector<JournalEntry> s_journal;
+static bool s_tainted;
+
+static u32 s_num_verified;
+static u32 s_num_diverged;
+static u32 s_num_skipped;
+static u32 s_num_unverifiable;
+
+static void SaveCPUState(CPUState &state)
+{
+	PowerPC::PowerPCState &ppc = PowerPC::ppcState;
+	memcpy(state.gpr, ppc.gpr, sizeof(state.gpr));
+	memcpy(state.ps, ppc.ps, sizeof(state.ps));
+	state.pc = ppc.pc;
+	state.npc = ppc.npc;
+	memcpy(state.cr_fast, ppc.cr_fast, sizeof(state.cr_fast));
+	state.msr = ppc.msr;
+	state.fpscr = ppc.fpscr;
+	state.exceptions = ppc.Exceptions;
+	memcpy(state.sr, ppc.sr, sizeof(state.sr));
+	memcpy(state.spr, ppc.spr, sizeof(state.spr));
+}
+
+static void LoadCPUState(const CPUState &state)
+{
+	PowerPC::PowerPCState &ppc = PowerPC::ppcState;
+	memcpy(ppc.gpr, state.gpr, sizeof(state.gpr));
+	memcpy(ppc.ps, state.ps, sizeof(state.ps));
+	ppc.pc = state.pc;
+	ppc.npc = state.npc;
+	memcpy(ppc.cr_fast, state.cr_fast, sizeof(state.cr_fast));
+	ppc.msr = state.msr;
+	ppc.fpscr = state.fpscr;
+	memcpy(ppc.sr, state.sr, sizeof(state.sr));
+	memcpy(ppc.spr, state.spr, sizeof(state.spr));
+
+	// Don't lose an interrupt posted while the interpreter was running
+	Common::AtomicAnd(ppc.Exceptions, ~SYNC_EXCEPTIONS);
+	Common::AtomicOr(ppc.Exceptions, state.exceptions & SYNC_EXCEPTIONS);
+}
+
+static void Journal(u8 *ptr, u32 size, u32 em_address)
+{
+	if (ptr == NULL)
+	{
+		s_tainted = true;
+		return;
+	}
+
+	JournalEntry entry;
+	entry.ptr = ptr;
+	entry.em_address = em_address;
+	entry.size = size;
+	memcpy(entry.before, ptr, size);
+	s_journal.push_back(entry);
+}
+
+// Instructions whose effects can't be rolled back, or which the JIT and the
+// interpreter legitimately handle differently.
+static bool IsVerifiable(UGeckoInstruction inst)
+{
+	switch (inst.OPCD)
+	{
+	case 4:
+		return inst.SUBOP10 != 1014;	// dcbz_l
+	case 31:
+		switch (inst.SUBOP10)
+		{
+		case 20:	// lwarx
+		case 150:	// stwcx.
+		case 54:	// dcbst
+		case 86:	// dcbf
+		case 470:	// dcbi
+		case 982:	// icbi
+		case 146:	// mtmsr
+		case 210:	// mtsr
+		case 242:	// mtsrin
+		case 306:	// tlbie
+		case 310:	// eciwx
+		case 438:	// ecowx
+			return false;
+		case 467:	// mtspr
+			switch ((inst.SPRU << 5) | (inst.SPRL & 0x1F))
+			{
+			case SPR_XER:
+			case SPR_LR:
+			case SPR_CTR:
+			case SPR_SRR0:
+			case SPR_SRR1:
+			case SPR_SPRG0: case SPR_SPRG1: case SPR_SPRG2: case SPR_SPRG3:
+			case SPR_GQR0: case SPR_GQR0 + 1: case SPR_GQR0 + 2: case SPR_GQR0 + 3:
+			case SPR_GQR0 + 4: case SPR_GQR0 + 5: case SPR_GQR0 + 6: case SPR_GQR0 + 7:
+				return true;
+			default:
+				return false;
+			}
+		default:
+			return true;
+		}
+	case 63:
+		switch (inst.SUBOP10)
+		{
+		case 38:	// mtfsb1
+		case 70:	// mtfsb0
+		case 134:	// mtfsfi
+		case 711:	// mtfsf
+			return false;
+		default:
+			return true;
+		}
+	default:
+		return true;
+	}
+}
+
+void Init()
+{
+	s_enabled = Core::g_CoreStartupParameter.bJITVerify && !Core::g_CoreStartupParameter.bMMU;
+	if (Core::g_CoreStartupParameter.bJITVerify && !s_enabled)
+		WARN_LOG(DYNA_REC, "JIT verifier doesn't support MMU emulation, disabled");
+
+	s_blocks.clear();
+	s_reported.clear();
+	s_journal.clear();
+	s_pending = false;
+	s_num_verified = 0;
+	s_num_diverged = 0;
+	s_num_skipped = 0;
+	s_num_unverifiable = 0;
+}
+
+void Shutdown()
+{
+	if (!s_enabled)
+		return;
+
+	if (s_num_diverged)
+		ERROR_LOG(DYNA_REC, "JIT verifier: %u of %u block runs diverged from the interpreter",
+			s_num_diverged, s_num_verified);
+	else
+		NOTICE_LOG(DYNA_REC, "JIT verifier: %u block runs matched the interpreter", s_num_verified);
+	NOTICE_LOG(DYNA_REC, "JIT verifier: %u runs skipped (hardware access), %u blocks not verifiable",
+		s_num_skipped, s_num_unverifiable);
+
+	s_blocks.clear();
+	s_reported.clear();
+	s_journal.clear();
+	s_pending = false;
+	s_enabled = false;
+}
+
+bool IsEnabled()
+{
+	return s_enabled;
+}
+
+bool RegisterBlock(u32 address, const PPCAnalyst::CodeOp *ops, int size)
+{
+	s_blocks.erase(address);
+
+	bool verifiable = size > 0;
+	for (int i = 0; i < size && verifiable; i++)
+	{
+		if (!IsVerifiable(ops[i].inst) || HLE::GetFunctionIndex(ops[i].address) != 0)
+			verifiable = false;
+	}
+
+	if (!verifiable)
+	{
+		s_num_unverifiable++;
+		return false;
+	}
+
+	std::vector<Op> &block = s_blocks[address];
+	block.resize(size);
+	for (int i = 0; i < size; i++)
+	{
+		block[i].inst = ops[i].inst;
+		block[i].address = ops[i].address;
+		block[i].uses_fpu = PPCTables::UsesFPU(ops[i].inst);
+	}
+	return true;
+}
+
+// Mirrors Interpreter::SingleStepInner, and the exception checks the JIT
+// does on its way out of a block.
+static void InterpretBlock(const std::vector<Op> &block)
+{
+	Interpreter::m_EndBlock = false;
+	bool last_was_rfi = false;
+
+	for (size_t i = 0; i < block.size(); i++)
+	{
+		const Op &op = block[i];
+		PC = op.address;
+		NPC = PC + sizeof(UGeckoInstruction);
+
+		if (op.uses_fpu && !((UReg_MSR&)MSR).FP)
+		{
+			Common::AtomicOr(PowerPC::ppcState.Exceptions, EXCEPTION_FPU_UNAVAILABLE);
+			PowerPC::CheckExceptions();
+			return;
+		}
+
+		GetInterpreterOp(op.inst)(op.inst);
+		last_was_rfi = op.inst.OPCD == 19 && op.inst.SUBOP10 == 50;
+
+		if (PowerPC::ppcState.Exceptions & EXCEPTION_DSI)
+		{
+			PowerPC::CheckExceptions();
+			return;
+		}
+
+		if (i + 1 == block.size())
+			break;
+
+		if (Interpreter::m_EndBlock)
+		{
+			Interpreter::m_EndBlock = false;
+			if (NPC != block[i + 1].address)
+				break;
+		}
+	}
+	Interpreter::m_EndBlock = false;
+
+	PC = NPC;
+	if (last_was_rfi)
+		PowerPC::CheckExceptions();
+}
+
+void BeginBlock(u32 address)
+{
+	EndBlock();
+
+	std::map<u32, std::vector<Op> >::const_iterator iter = s_blocks.find(address);
+	if (iter == s_blocks.end())
+		return;
+
+	// The JIT may take these on exits the interpreter doesn't have
+	if (PowerPC::ppcState.Exceptions & ASYNC_EXCEPTIONS)
+	{
+		s_num_skipped++;
+		return;
+	}
+
+	CPUState before;
+	SaveCPUState(before);
+
+	s_journal.clear();
+	s_tainted = false;
+	Memory::SetWriteJournal(&Journal);
+	InterpretBlock(iter->second);
+	Memory::SetWriteJournal(NULL);
+
+	SaveCPUState(s_expected);
+	for (size_t i = 0; i < s_journal.size(); i++)
+		memcpy(s_journal[i].after, s_journal[i].ptr, s_journal[i].size);
+	for (size_t i = s_journal.size(); i-- > 0; )
+		memcpy(s_journal[i].ptr, s_journal[i].before, s_journal[i].size);
+	LoadCPUState(before);
+
+	if (s_tainted)
+	{
+		s_num_skipped++;
+		return;
+	}
+
+	s_pending = true;
+	s_pending_address = address;
+}
+
+static bool FindDivergence(char *description, size_t size)
+{
+	const PowerPC::PowerPCState &ppc = PowerPC::ppcState;
+	const CPUState &exp = s_expected;
+
+	if (ppc.pc != exp.pc)
+	{
+		snprintf(description, size, "pc: jit %08x, interpreter %08x", ppc.pc, exp.pc);
+		return true;
+	}
+	for (int i = 0; i < 32; i++)
+	{
+		if (ppc.gpr[i] != exp.gpr[i])
+		{
+			snprintf(description, size, "r%d: jit %08x, interpreter %08x", i, ppc.gpr[i], exp.gpr[i]);
+			return true;
+		}
+	}
+	for (int i = 0; i < 32; i++)
+	{
+		for (int j = 0; j < 2; j++)
+		{
+			if (ppc.ps[i][j] != exp.ps[i][j])
+			{
+				snprintf(description, size, "f%d ps%d: jit %016llx, interpreter %016llx", i, j,
+					(unsigned long long)ppc.ps[i][j], (unsigned long long)exp.ps[i][j]);
+				return true;
+			}
+		}
+	}
+	for (int i = 0; i < 8; i++)
+	{
+		if (ppc.cr_fast[i] != exp.cr_fast[i])
+		{
+			snprintf(description, size, "cr%d: jit %x, interpreter %x", i, ppc.cr_fast[i], exp.cr_fast[i]);
+			return true;
+		}
+	}
+	if (ppc.msr != exp.msr)
+	{
+		snprintf(description, size, "msr: jit %08x, interpreter %08x", ppc.msr, exp.msr);
+		return true;
+	}
+	// The JIT only keeps FPSCR up to date when FPRF emulation is on
+	if (Core::g_CoreStartupParameter.bEnableFPRF && ppc.fpscr != exp.fpscr)
+	{
+		snprintf(description, size, "fpscr: jit %08x, interpreter %08x", ppc.fpscr, exp.fpscr);
+		return true;
+	}
+	if ((ppc.Exceptions & SYNC_EXCEPTIONS) != (exp.exceptions & SYNC_EXCEPTIONS))
+	{
+		snprintf(description, size, "exceptions: jit %08x, interpreter %08x",
+			ppc.Exceptions & SYNC_EXCEPTIONS, exp.exceptions & SYNC_EXCEPTIONS);
+		return true;
+	}
+	for (int i = 0; i < 16; i++)
+	{
+		if (ppc.sr[i] != exp.sr[i])
+		{
+			snprintf(description, size, "sr%d: jit %08x, interpreter %08x", i, ppc.sr[i], exp.sr[i]);
+			return true;
+		}
+	}
+	for (int i = 0; i < 1024; i++)
+	{
+		// Timers are read from the host clock
+		if (i == SPR_DEC || i == SPR_TL || i == SPR_TU)
+			continue;
+		if (ppc.spr[i] != exp.spr[i])
+		{
+			snprintf(description, size, "spr %d: jit %08x, interpreter %08x", i, ppc.spr[i], exp.spr[i]);
+			return true;
+		}
+	}
+
+	// Later entries win, they hold the final value of overlapping writes
+	for (size_t i = s_journal.size(); i-- > 0; )
+	{
+		const JournalEntry &entry = s_journal[i];
+		for (u32 j = 0; j < entry.size; j++)
+		{
+			if (entry.ptr[j] != entry.after[j])
+			{
+				snprintf(description, size, "memory %08x: jit %02x, interpreter %02x",
+					entry.em_address + j, entry.ptr[j], entry.after[j]);
+				return true;
+			}
+		}
+	}
+
+	return false;
+}
+
+void EndBlock()
+{
+	if (!s_pending)
+		return;
+	s_pending = false;
+
+	// Posted while the block ran, the JIT may have taken it
+	if (PowerPC::ppcState.Exceptions & ASYNC_EXCEPTIONS)
+	{
+		s_num_skipped++;
+		return;
+	}
+
+	s_num_verified++;
+
+	char description[128];
+	if (!FindDivergence(description, sizeof(description)))
+		return;
+
+	s_num_diverged++;
+	if (!s_reported.insert(s_pending_address).second)
+		return;
+
+	ERROR_LOG(DYNA_REC, "JIT verifier: block %08x diverged from the interpreter, first difference in %s",
+		s_pending_address, description);
+
+	const std::vector<Op> &block = s_blocks[s_pending_address];
+	for (size_t i = 0; i < block.size(); i++)
+	{
+		char disasm[256];
+		DisassembleGekko(block[i].inst.hex, block[i].address, disasm, 256);
+		ERROR_LOG(DYNA_REC, "  %08x %08x %s", block[i].address, block[i].inst.hex, disasm);
+	}
+}
+
+}  // namespace
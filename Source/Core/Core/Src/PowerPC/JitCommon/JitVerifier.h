@@ -0,0 +1,45 @@
+// Copyright 2013 Dolphin Emulator Project
+// Licensed under GPLv2
+// Refer to the license.txt file included.
+
+// Differential checking of the JIT against the interpreter. When enabled
+// (JITVerify in the [Core] section of Dolphin.ini), every verifiable block
+// is first run by the interpreter on the live state, with memory writes
+// journaled. The results are recorded, everything is rolled back and the
+// JIT'd code runs for real. When the block exits, the registers and the
+// bytes the interpreter wrote are compared, and the first difference is
+// logged together with the disassembly of the block.
+//
+// Blocks that touch hardware registers, the EFB or the GP FIFO, HLE-patched
+// functions, or instructions with side effects outside of the CPU state
+// (reservations, cache control, timers, DMA, FPU rounding mode) are not
+// checked. MMU emulation is not supported.
+
+#ifndef _JITVERIFIER_H
+#define _JITVERIFIER_H
+
+#include "Common.h"
+#include "../PPCAnalyst.h"
+
+namespace JitVerifier
+{
+
+void Init();
+void Shutdown();
+
+bool IsEnabled();
+
+// Called when a block is compiled. Returns false if the block can't be
+// verified, in which case the JIT doesn't need to call BeginBlock for it.
+bool RegisterBlock(u32 address, const PPCAnalyst::CodeOp *ops, int size);
+
+// Called from the entry of a registered block, before any of its code ran.
+void BeginBlock(u32 address);
+
+// Called when control is back in the dispatcher. Compares the state left by
+// the last block with the interpreter's.
+void EndBlock();
+
+}  // namespace
+
+#endif // _JITVERIFIER_H
@@ -7,11 +7,13 @@
 #include "CPUDetect.h"
 #include "JitBase.h"
 #include "Jit_Util.h"
+#include "../../HW/MMIO.h"
 
 using namespace Gen;
 
 static const u8 GC_ALIGNED16(pbswapShuffle1x4[16]) = {3, 2, 1, 0, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15};
 static u32 GC_ALIGNED16(float_buffer);
+static const PowerPC::TLBSet* const data_tlb = PowerPC::ppcState.tlb[PowerPC::TLB_DATA];
 
 void EmuCodeBlock::UnsafeLoadRegToReg(X64Reg reg_addr, X64Reg reg_value, int accessSize, s32 offset, bool signExtend)
 {
@@ -117,8 +119,110 @@ u8 *EmuCodeBlock::UnsafeLoadToReg(X64Reg reg_value, Gen::OpArg opAddress, int ac
 	return result;
 }
 
+FixupBranch EmuCodeBlock::TLBLookup(X64Reg reg_addr)
+{
+#ifdef _M_X64
+	const X64Reg tag = reg_addr == RCX ? RSI : RCX;
+	const X64Reg set = reg_addr == RDX ? RSI : RDX;
+
+	PUSH(64, R(tag));
+	PUSH(64, R(set));
+
+	MOV(32, R(tag), R(reg_addr));
+	SHR(32, R(tag), Imm8(12));
+	MOV(32, R(set), R(tag));
+	AND(32, R(set), Imm32(PowerPC::TLB_SETS - 1));
+	static_assert(sizeof(PowerPC::TLBSet) == 16, "set index is scaled by 16");
+	SHL(32, R(set), Imm8(4)); // sizeof(TLBSet)
+	ADD(64, R(set), M((void *)&data_tlb));
+
+	CMP(32, R(tag), MDisp(set, offsetof(PowerPC::TLBSet, tag[0])));
+	FixupBranch way0 = J_CC(CC_E);
+	CMP(32, R(tag), MDisp(set, offsetof(PowerPC::TLBSet, tag[1])));
+	FixupBranch miss = J_CC(CC_NE);
+	MOV(32, R(tag), MDisp(set, offsetof(PowerPC::TLBSet, paddr[1])));
+	FixupBranch found = J();
+	SetJumpTarget(way0);
+	MOV(32, R(tag), MDisp(set, offsetof(PowerPC::TLBSet, paddr[0])));
+	SetJumpTarget(found);
+
+	// Only MEM1 can be accessed inline, MEM2, the EFB and hardware registers
+	// take the slow path like a miss. Pages don't straddle the end of RAM.
+	CMP(32, R(tag), Imm32(Memory::RAM_SIZE));
+	FixupBranch not_ram = J_CC(CC_AE);
+
+	AND(32, R(reg_addr), Imm32(0xFFF));
+	OR(32, R(reg_addr), R(tag));
+	POP(64, R(set));
+	POP(64, R(tag));
+	FixupBranch hit = J(true);
+
+	SetJumpTarget(miss);
+	SetJumpTarget(not_ram);
+	POP(64, R(set));
+	POP(64, R(tag));
+	return hit;
+#else
+	PanicAlert("TLBLookup is only implemented for x64");
+	return J(true);
+#endif
+}
+
+bool EmuCodeBlock::MMIOLoadToReg(X64Reg reg_value, u32 address, int accessSize, bool signExtend)
+{
+	MMIO::ReadHandler handler = MMIO::GetReadHandler(address, accessSize);
+	if (handler.type == MMIO::HANDLER_COMPLEX)
+		return false;
+
+	u32 size_mask = accessSize == 32 ? 0xFFFFFFFF : (1 << accessSize) - 1;
+	if (handler.type == MMIO::HANDLER_CONSTANT)
+	{
+		u32 value = handler.constant & size_mask;
+		if (signExtend && accessSize < 32)
+			value = accessSize == 16 ? (u32)(s32)(s16)value : (u32)(s32)(s8)value;
+		MOV(32, R(reg_value), Imm32(value));
+		return true;
+	}
+
+#ifdef _M_X64
+	MOV(64, R(reg_value), Imm64((u64)handler.ptr));
+	MOVZX(32, accessSize, reg_value, MatR(reg_value));
+#else
+	MOVZX(32, accessSize, reg_value, M((void *)handler.ptr));
+#endif
+	if ((handler.mask & size_mask) != size_mask)
+		AND(32, R(reg_value), Imm32(handler.mask & size_mask));
+	if (signExtend && accessSize < 32)
+		MOVSX(32, accessSize, reg_value, R(reg_value));
+	return true;
+}
+
+bool EmuCodeBlock::MMIOWriteRegToConstAddress(X64Reg reg_value, u32 address, int accessSize, X64Reg scratch)
+{
+	MMIO::WriteHandler handler = MMIO::GetWriteHandler(address, accessSize);
+	if (handler.type != MMIO::HANDLER_DIRECT)
+		return false;
+
+	u32 size_mask = accessSize == 32 ? 0xFFFFFFFF : (1 << accessSize) - 1;
+	if ((handler.mask & size_mask) != size_mask)
+		AND(32, R(reg_value), Imm32(handler.mask & size_mask));
+#ifdef _M_X64
+	MOV(64, R(scratch), Imm64((u64)handler.ptr));
+	MOV(accessSize, MatR(scratch), R(reg_value));
+#else
+	MOV(accessSize, M((void *)handler.ptr), R(reg_value));
+#endif
+	return true;
+}
+
 void EmuCodeBlock::SafeLoadToReg(X64Reg reg_value, const Gen::OpArg & opAddress, int accessSize, s32 offset, u32 registersInUse, bool signExtend)
 {
+	if (opAddress.IsImm() && !jit->js.memcheck &&
+		MMIOLoadToReg(reg_value, (u32)opAddress.offset + offset, accessSize, signExtend))
+	{
+		return;
+	}
+
 	if (!jit->js.memcheck)
 	{
 		registersInUse &= ~(1 << RAX | 1 << reg_value);
@@ -185,13 +289,23 @@ void EmuCodeBlock::SafeLoadToReg(X64Reg reg_value, const Gen::OpArg & opAddress,
 		}
 		else
 		{
-			if (offset)
+#ifdef _M_X64
+			const bool probe_tlb = Core::g_CoreStartupParameter.bMMU;
+#else
+			const bool probe_tlb = false;
+#endif
+			if (offset || probe_tlb)
 			{
 				MOV(32, R(EAX), opAddress);
-				ADD(32, R(EAX), Imm32(offset));
+				if (offset)
+					ADD(32, R(EAX), Imm32(offset));
 				TEST(32, R(EAX), Imm32(mem_mask));
 				FixupBranch fast = J_CC(CC_Z, true);
 
+				FixupBranch tlb_hit;
+				if (probe_tlb)
+					tlb_hit = TLBLookup(EAX);
+
 				ABI_PushRegistersAndAdjustStack(registersInUse, false);
 				switch (accessSize)
 				{
@@ -217,6 +331,8 @@ void EmuCodeBlock::SafeLoadToReg(X64Reg reg_value, const Gen::OpArg & opAddress,
 
 				FixupBranch exit = J();
 				SetJumpTarget(fast);
+				if (probe_tlb)
+					SetJumpTarget(tlb_hit);
 				UnsafeLoadToReg(reg_value, R(EAX), accessSize, 0, signExtend);
 				SetJumpTarget(exit);
 			}
@@ -323,6 +439,16 @@ void EmuCodeBlock::SafeWriteRegToReg(X64Reg reg_value, X64Reg reg_addr, int acce
 	FixupBranch fast = J_CC(CC_Z, true);
 	bool noProlog = flags & SAFE_WRITE_NO_PROLOG;
 	bool swap = !(flags & SAFE_WRITE_NO_SWAP);
+
+#ifdef _M_X64
+	const bool probe_tlb = Core::g_CoreStartupParameter.bMMU;
+#else
+	const bool probe_tlb = false;
+#endif
+	FixupBranch tlb_hit;
+	if (probe_tlb)
+		tlb_hit = TLBLookup(reg_addr);
+
 	ABI_PushRegistersAndAdjustStack(registersInUse, noProlog);
 	switch (accessSize)
 	{
@@ -333,6 +459,8 @@ void EmuCodeBlock::SafeWriteRegToReg(X64Reg reg_value, X64Reg reg_addr, int acce
 	ABI_PopRegistersAndAdjustStack(registersInUse, noProlog);
 	FixupBranch exit = J();
 	SetJumpTarget(fast);
+	if (probe_tlb)
+		SetJumpTarget(tlb_hit);
 	UnsafeWriteRegToReg(reg_value, reg_addr, accessSize, 0, swap);
 	SetJumpTarget(exit);
 }
@@ -37,6 +37,18 @@ public:
 	};
 	void SafeWriteRegToReg(Gen::X64Reg reg_value, Gen::X64Reg reg_addr, int accessSize, s32 offset, u32 registersInUse, int flags = 0);
 
+	// MMU only: probes the data TLB for the effective address in reg_addr. On a
+	// hit in MEM1 reg_addr becomes the physical address and the returned branch
+	// is taken. On a miss, or a hit anywhere else, nothing changes and the code
+	// falls through to the slow path. Every other register is preserved.
+	Gen::FixupBranch TLBLookup(Gen::X64Reg reg_addr);
+
+	// Inline accesses to hardware registers registered with MMIO. They return
+	// false, emitting nothing, when the register needs the generic slow path.
+	bool MMIOLoadToReg(Gen::X64Reg reg_value, u32 address, int accessSize, bool signExtend);
+	// Masks reg_value in place; scratch is trashed on x64.
+	bool MMIOWriteRegToConstAddress(Gen::X64Reg reg_value, u32 address, int accessSize, Gen::X64Reg scratch);
+
 	// Trashes both inputs and EAX.
 	void SafeWriteFloatToReg(Gen::X64Reg xmm_value, Gen::X64Reg reg_addr, u32 registersInUse, int flags = 0);
 
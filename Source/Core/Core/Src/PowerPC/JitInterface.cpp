@@ -10,6 +10,7 @@
 
 #include "JitInterface.h"
 #include "JitCommon/JitBase.h"
+#include "CachedInterpreter.h"
 
 #ifndef _M_GENERIC
 #include "Jit64IL/JitIL.h"
@@ -72,6 +73,11 @@ namespace JitInterface
 				break;
 			}
 			#endif
+			case 5:
+			{
+				ptr = new CachedInterpreter();
+				break;
+			}
 			default:
 			{
 				PanicAlert("Unrecognizable cpu_core: %d", core);
@@ -112,6 +118,11 @@ namespace JitInterface
 				break;
 			}
 			#endif
+			case 5:
+			{
+				// Uses the interpreter tables
+				break;
+			}
 			default:
 			{
 				PanicAlert("Unrecognizable cpu_core: %d", core);
@@ -161,7 +172,7 @@ namespace JitInterface
 			PanicAlert("Failed to open %s", filename);
 			return;
 		}
-		fprintf(f.GetHandle(), "origAddr\tblkName\tcost\ttimeCost\tpercent\ttimePercent\tOvAllinBlkTime(ms)\tblkCodeSize\n");
+		fprintf(f.GetHandle(), "origAddr\tblkName\tcost\ttimeCost\tpercent\ttimePercent\tOvAllinBlkTime(ms)\tblkCodeSize\tregLoads\tregStores\tregStoresSkipped\n");
 		for (unsigned int i = 0; i < stats.size(); i++)
 		{
 			const JitBlock *block = jit->GetBlockCache()->GetBlock(stats[i].blockNum);
@@ -171,13 +182,15 @@ namespace JitInterface
 				double percent = 100.0 * (double)stats[i].cost / (double)cost_sum;
 	#ifdef _WIN32 
 				double timePercent = 100.0 * (double)block->ticCounter / (double)timecost_sum;
-				fprintf(f.GetHandle(), "%08x\t%s\t%llu\t%llu\t%.2lf\t%llf\t%lf\t%i\n", 
+				fprintf(f.GetHandle(), "%08x\t%s\t%llu\t%llu\t%.2lf\t%llf\t%lf\t%i\t%u\t%u\t%u\n", 
 						block->originalAddress, name.c_str(), stats[i].cost,
 						block->ticCounter, percent, timePercent,
-						(double)block->ticCounter*1000.0/(double)countsPerSec, block->codeSize);
+						(double)block->ticCounter*1000.0/(double)countsPerSec, block->codeSize,
+						block->regLoads, block->regStores, block->regStoresSkipped);
 	#else
-				fprintf(f.GetHandle(), "%08x\t%s\t%llu\t???\t%.2lf\t???\t???\t%i\n", 
-						block->originalAddress, name.c_str(), stats[i].cost,  percent, block->codeSize);
+				fprintf(f.GetHandle(), "%08x\t%s\t%llu\t???\t%.2lf\t???\t???\t%i\t%u\t%u\t%u\n", 
+						block->originalAddress, name.c_str(), stats[i].cost,  percent, block->codeSize,
+						block->regLoads, block->regStores, block->regStoresSkipped);
 	#endif
 			}
 		}
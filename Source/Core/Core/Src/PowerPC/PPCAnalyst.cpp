@@ -34,6 +34,8 @@ using namespace std;
 static const int CODEBUFFER_SIZE = 32000;
 // 0 does not perform block merging
 static const int FUNCTION_FOLLOWING_THRESHOLD = 16;
+// Each followed conditional branch adds a side exit to the block
+static const int CONDITIONAL_FOLLOWING_THRESHOLD = 4;
 
 CodeBuffer::CodeBuffer(int size)
 {
@@ -269,12 +271,159 @@ bool CanSwapAdjacentOps(const CodeOp &a, const CodeOp &b)
 	return true;
 }
 
+// Integer, load/store and floating point instructions don't look at the
+// condition register. Be conservative about everything else.
+static bool ReadsCR(const CodeOp &op)
+{
+	switch (op.opinfo->type)
+	{
+	case OPTYPE_INTEGER:
+	case OPTYPE_LOAD:
+	case OPTYPE_STORE:
+	case OPTYPE_LOADFP:
+	case OPTYPE_STOREFP:
+	case OPTYPE_FPU:
+	case OPTYPE_PS:
+		return false;
+	case OPTYPE_BRANCH:
+		return op.inst.OPCD != 18;	// bx
+	default:
+		return true;
+	}
+}
+
+static bool ReadsCA(const CodeOp &op)
+{
+	switch (op.opinfo->type)
+	{
+	case OPTYPE_INTEGER:
+		return (op.opinfo->flags & FL_READ_CA) != 0;
+	case OPTYPE_LOAD:
+	case OPTYPE_STORE:
+	case OPTYPE_LOADFP:
+	case OPTYPE_STOREFP:
+	case OPTYPE_FPU:
+	case OPTYPE_PS:
+	case OPTYPE_BRANCH:
+		return false;
+	default:
+		return true;	// mfspr XER, mcrxr...
+	}
+}
+
+void ComputeFlagLiveness(CodeOp *code, int size)
+{
+	// Everything is live when the block ends
+	bool wantsCR0 = true;
+	bool wantsCR1 = true;
+	bool wantsPS1 = true;
+	bool wantsCA = true;
+	for (int i = size - 1; i >= 0; i--)
+	{
+		CodeOp &op = code[i];
+		if (op.canEndBlock)
+		{
+			wantsCR0 = wantsCR1 = wantsPS1 = wantsCA = true;
+		}
+		op.wantsCR0 = wantsCR0;
+		op.wantsCR1 = wantsCR1;
+		op.wantsPS1 = wantsPS1;
+		op.wantsCA = wantsCA;
+
+		if (op.outputCR0)
+			wantsCR0 = false;
+		if (op.outputCR1)
+			wantsCR1 = false;
+		if (op.outputPS1)
+			wantsPS1 = false;
+		if (op.outputCA)
+			wantsCA = false;
+
+		if (op.canEndBlock || ReadsCR(op))
+			wantsCR0 = wantsCR1 = true;
+		if (op.canEndBlock || ReadsCA(op))
+			wantsCA = true;
+		// Nothing tracks PS1 reads yet
+		wantsPS1 = true;
+	}
+}
+
+bool IsBusyWaitLoop(const CodeOp *code, int size, u32 address)
+{
+	if (size == 0)
+		return false;
+
+	const CodeOp &last = code[size - 1];
+	u32 target;
+	if (last.inst.OPCD == 18)
+		target = last.inst.AA ? SignExt26(last.inst.LI << 2) : last.address + SignExt26(last.inst.LI << 2);
+	else if (last.inst.OPCD == 16)
+		target = last.inst.AA ? SignExt16(last.inst.BD << 2) : last.address + SignExt16(last.inst.BD << 2);
+	else
+		return false;
+	if (target != address)
+		return false;
+
+	u32 loopWrites = 0;
+	for (int i = 0; i < size; i++)
+	{
+		for (int j = 0; j < 2; j++)
+		{
+			if (code[i].regsOut[j] >= 0)
+				loopWrites |= 1 << code[i].regsOut[j];
+		}
+	}
+
+	// Every iteration has to compute the same thing from the same memory,
+	// so registers must be written before they are read.
+	u32 written = 0;
+	for (int i = 0; i < size; i++)
+	{
+		const CodeOp &op = code[i];
+		const int flags = op.opinfo->flags;
+		switch (op.opinfo->type)
+		{
+		case OPTYPE_LOAD:
+			if (flags & FL_EVIL)
+				return false;
+			break;
+		case OPTYPE_INTEGER:
+			if (flags & (FL_SET_CA | FL_READ_CA | FL_EVIL))
+				return false;
+			break;
+		case OPTYPE_BRANCH:
+			// Followed branches and the final one, no link register or CTR updates
+			if (op.inst.OPCD == 18 && !op.inst.LK)
+				break;
+			if (op.inst.OPCD == 16 && !op.inst.LK && (op.inst.BO & BO_DONT_DECREMENT_FLAG))
+				break;
+			return false;
+		default:
+			return false;
+		}
+
+		for (int j = 0; j < 3; j++)
+		{
+			const int reg = op.regsIn[j];
+			if (reg >= 0 && (loopWrites & (1 << reg)) && !(written & (1 << reg)))
+				return false;
+		}
+		for (int j = 0; j < 2; j++)
+		{
+			if (op.regsOut[j] >= 0)
+				written |= 1 << op.regsOut[j];
+		}
+	}
+	return true;
+}
+
 // Does not yet perform inlining - although there are plans for that.
 // Returns the exit address of the next PC
 u32 Flatten(u32 address, int *realsize, BlockStats *st, BlockRegStats *gpa,
 			BlockRegStats *fpa, bool &broken_block, CodeBuffer *buffer,
 			int blockSize, u32* merged_addresses,
-			int capacity_of_merged_addresses, int& size_of_merged_addresses)
+			int capacity_of_merged_addresses, int& size_of_merged_addresses,
+			BranchHintFn branch_hint)
 {
 	if (capacity_of_merged_addresses < FUNCTION_FOLLOWING_THRESHOLD) {
 		PanicAlert("Capacity of merged_addresses is too small!");
@@ -306,10 +455,13 @@ u32 Flatten(u32 address, int *realsize, BlockStats *st, BlockRegStats *gpa,
 
 	int num_inst = 0;
 	int numFollows = 0;
+	int numConditionalFollows = 0;
 	int numCycles = 0;
 
 	CodeOp *code = buffer->codebuffer;
 	bool foundExit = false;
+	bool foundFPU = false;
+	const bool bMMU = SConfig::GetInstance().m_LocalCoreStartupParameter.bMMU;
 
 	u32 returnAddress = 0;
 
@@ -377,9 +529,22 @@ u32 Flatten(u32 address, int *realsize, BlockStats *st, BlockRegStats *gpa,
 			code[i].wantsCR0 = false;
 			code[i].wantsCR1 = false;
 			code[i].wantsPS1 = false;
+			code[i].wantsCA = false;
 
 			int flags = opinfo->flags;
 
+			code[i].outputCA = (flags & FL_SET_CA) ? true : false;
+
+			// Exceptions taken in the middle of the block
+			code[i].canEndBlock = (flags & (FL_CHECKEXCEPTIONS | FL_EVIL)) ||
+				(bMMU && (flags & FL_LOADSTORE));
+			if ((flags & FL_USE_FPU) && !foundFPU)
+			{
+				// FPU unavailable is checked before the first FPU instruction
+				code[i].canEndBlock = true;
+				foundFPU = true;
+			}
+
 			if (flags & FL_USE_FPU)
 				fpa->any = true;
 
@@ -474,6 +639,7 @@ u32 Flatten(u32 address, int *realsize, BlockStats *st, BlockRegStats *gpa,
 			}
 
 			bool follow = false;
+			bool conditional = false;
 			u32 destination = 0;
 			if (inst.OPCD == 18 && blockSize > 1)
 			{
@@ -497,6 +663,36 @@ u32 Flatten(u32 address, int *realsize, BlockStats *st, BlockRegStats *gpa,
 				if (inst.LK)
 					returnAddress = address + 4;
 			}
+			else if (inst.OPCD == 16 && !inst.LK && branch_hint != NULL && blockSize > 1 &&
+				numConditionalFollows < CONDITIONAL_FOLLOWING_THRESHOLD)
+			{
+				// bcx - continue in the likely direction, the JIT leaves
+				// the block in the middle when the branch goes the other way
+				u32 target;
+				if (inst.AA)
+					target = SignExt16(inst.BD << 2);
+				else
+					target = address + SignExt16(inst.BD << 2);
+
+				// Loops back to the start are linked to the block itself
+				if (target != blockstart)
+				{
+					switch (branch_hint(address))
+					{
+					case BRANCH_HINT_TAKEN:
+						follow = true;
+						destination = target;
+						break;
+					case BRANCH_HINT_NOT_TAKEN:
+						follow = true;
+						destination = address + 4;
+						break;
+					default:
+						break;
+					}
+					conditional = follow;
+				}
+			}
 			else if (inst.OPCD == 31 && inst.SUBOP10 == 467)
 			{
 				// mtspr
@@ -527,11 +723,20 @@ u32 Flatten(u32 address, int *realsize, BlockStats *st, BlockRegStats *gpa,
 			{
 				if (opinfo->flags & FL_ENDBLOCK) //right now we stop early
 				{
+					code[i].canEndBlock = true;
 					foundExit = true;
 					break;
 				}
 				address += 4;
 			}
+			else if (conditional)
+			{
+				code[i].canEndBlock = true;
+				numConditionalFollows++;
+				if (destination != address + 4)
+					merged_addresses[size_of_merged_addresses++] = destination;
+				address = destination;
+			}
 			else
 			{
 				// We don't "code[i].skip = true" here
@@ -579,26 +784,7 @@ u32 Flatten(u32 address, int *realsize, BlockStats *st, BlockRegStats *gpa,
 		broken_block = true;
 	}
 	
-	// Scan for CR0 dependency
-	// assume next block wants CR0 to be safe
-	bool wantsCR0 = true;
-	bool wantsCR1 = true;
-	bool wantsPS1 = true;
-	for (int i = num_inst - 1; i >= 0; i--)
-	{
-		if (code[i].outputCR0)
-			wantsCR0 = false;
-		if (code[i].outputCR1)
-			wantsCR1 = false;
-		if (code[i].outputPS1)
-			wantsPS1 = false;
-		wantsCR0 |= code[i].wantsCR0;
-		wantsCR1 |= code[i].wantsCR1;
-		wantsPS1 |= code[i].wantsPS1;
-		code[i].wantsCR0 = wantsCR0;
-		code[i].wantsCR1 = wantsCR1;
-		code[i].wantsPS1 = wantsPS1;
-	}
+	ComputeFlagLiveness(code, num_inst);
 
 	*realsize = num_inst;
 	// ...
@@ -33,12 +33,17 @@ struct CodeOp //16B
 	s8 fregOut;
 	s8 fregsIn[3];
 	bool isBranchTarget;
+	// wantsX: the value of X left by this instruction may be read later, see
+	// ComputeFlagLiveness. When false the instruction doesn't need to set it.
 	bool wantsCR0;
 	bool wantsCR1;
 	bool wantsPS1;
+	bool wantsCA;
 	bool outputCR0;
 	bool outputCR1;
 	bool outputPS1;
+	bool outputCA;
+	bool canEndBlock;  // the block may be left right before or after this instruction
 	bool skip;  // followed BL-s for example
 };
 
@@ -96,10 +101,31 @@ public:
 
 };
 
+// Tells Flatten which way a conditional branch is likely to go. JITs that
+// can leave a block in the middle through a conditional branch pass one to
+// Flatten, which then continues the block in the likely direction.
+enum BranchHint
+{
+	BRANCH_HINT_NONE,		// Unknown or unbiased, end the block at the branch
+	BRANCH_HINT_TAKEN,
+	BRANCH_HINT_NOT_TAKEN,
+};
+typedef BranchHint (*BranchHintFn)(u32 address);
+
 u32 Flatten(u32 address, int *realsize, BlockStats *st, BlockRegStats *gpa,
 			BlockRegStats *fpa, bool &broken_block, CodeBuffer *buffer,
 			int blockSize, u32* merged_addresses,
-			int capacity_of_merged_addresses, int& size_of_merged_addresses);
+			int capacity_of_merged_addresses, int& size_of_merged_addresses,
+			BranchHintFn branch_hint = NULL);
+// Recomputes the wants* flags of a flattened block from the output*
+// and canEndBlock flags. Done by Flatten, JITs that add exits of their own
+// mark them with canEndBlock and call this again.
+void ComputeFlagLiveness(CodeOp *code, int size);
+// True if the block starting at address loops back to its start without
+// writing memory or carrying any register over to the next iteration. Such
+// a loop polls memory or MMIO and can't get anywhere until an event changes
+// what it reads, so the JITs may skip ahead to the next event instead.
+bool IsBusyWaitLoop(const CodeOp *code, int size, u32 address);
 void LogFunctionCall(u32 addr);
 void FindFunctions(u32 startAddr, u32 endAddr, PPCSymbolDB *func_db);
 bool AnalyzeFunction(u32 startAddr, Symbol &func, int max_size = 0);
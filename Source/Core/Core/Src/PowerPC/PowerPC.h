@@ -25,6 +25,26 @@ enum CoreMode
 	MODE_JIT,
 };
 
+// Software TLB for page table translations, one for data and one for
+// instruction fetches. Sets are 2-way, a fill moves way 0 to way 1, hits
+// don't touch anything, so the JIT can probe it inline.
+enum
+{
+	TLB_DATA = 0,
+	TLB_INSTRUCTION = 1,
+	NUM_TLBS = 2,
+	TLB_SETS = 128,
+	TLB_WAYS = 2,
+};
+
+static const u32 TLB_INVALID_TAG = 0xFFFFFFFF; // tags are effective page numbers, never this
+
+struct TLBSet
+{
+	u32 tag[TLB_WAYS];   // effective address >> 12
+	u32 paddr[TLB_WAYS]; // physical page address
+};
+
 // This contains the entire state of the emulated PowerPC "Gekko" CPU.
 struct GC_ALIGNED64(PowerPCState)
 {
@@ -56,13 +76,7 @@ struct GC_ALIGNED64(PowerPCState)
 	// also for power management, but we don't care about that.
 	u32 spr[1024];
 
-	u32 dtlb_last;
-	u32 dtlb_va[128];
-	u32 dtlb_pa[128];
-
-	u32 itlb_last;
-	u32 itlb_va[128];
-	u32 itlb_pa[128];
+	TLBSet tlb[NUM_TLBS][TLB_SETS];
 
 	u32 pagetable_base;
 	u32 pagetable_hashmask;
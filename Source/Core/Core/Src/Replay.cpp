@@ -0,0 +1,364 @@
+// Copyright 2013 Dolphin Emulator Project
+// Licensed under GPLv2
+// Refer to the license.txt file included.
+
+#include <algorithm>
+#include <vector>
+
+#include "Common.h"
+#include "FileUtil.h"
+#include "Hash.h"
+#include "StringUtil.h"
+#include "Timer.h"
+
+#include "ConfigManager.h"
+#include "Core.h"
+#include "DesyncCheck.h"
+#include "Host.h"
+#include "Movie.h"
+#include "Replay.h"
+#include "VideoBackendBase.h"
+#include "HW/Memmap.h"
+#include "HW/VideoInterface.h"
+
+namespace Replay
+{
+
+enum
+{
+	LINE_STATE = 0,
+	LINE_XFB,
+	LINE_AUDIO,
+	NUM_LINE_HASHES
+};
+
+static const u32 MEM2_BASE = 0x10000000;
+
+struct Line
+{
+	u32 field;
+	u64 frame;
+	u32 mask;	// HASH_ flags of the hashes present
+	u32 hashes[NUM_LINE_HASHES];
+};
+
+static const char *const s_hash_names[NUM_LINE_HASHES] = { "state", "xfb", "audio" };
+
+static bool s_active = false;
+static Settings s_settings;
+static File::IOFile s_hash_file;
+static std::vector<Line> s_reference;
+
+// Touched on the CPU thread while the core runs
+static bool s_finished;
+static bool s_reached_end;
+static std::string s_difference;
+static u32 s_field;
+static u32 s_xfb_address;
+static u32 s_xfb_size;
+static u32 s_audio;
+static u64 s_start_us;
+static u64 s_end_us;
+
+// Settings overridden while replaying
+static unsigned int s_framelimit;
+static std::string s_audio_backend;
+
+// NULL unless [address, address + size) is all in MEM1 or all in MEM2
+static const u8 *GetRange(u32 address, u32 size)
+{
+	const u32 physical = address & 0x3FFFFFFF;
+	if (physical < Memory::REALRAM_SIZE && size <= Memory::REALRAM_SIZE - physical)
+		return Memory::m_pRAM + physical;
+	if (Core::g_CoreStartupParameter.bWii && physical >= MEM2_BASE &&
+		physical - MEM2_BASE < Memory::EXRAM_SIZE && size <= Memory::EXRAM_SIZE - (physical - MEM2_BASE))
+		return Memory::m_pEXRAM + (physical - MEM2_BASE);
+	return NULL;
+}
+
+bool ParseHashes(const std::string &text, u32 &hashes)
+{
+	std::vector<std::string> names;
+	SplitString(text, ',', names);
+
+	hashes = 0;
+	for (size_t i = 0; i < names.size(); i++)
+	{
+		const std::string name = StripSpaces(names[i]);
+		if (name == "all")
+		{
+			hashes |= HASH_ALL;
+			continue;
+		}
+
+		int j = 0;
+		while (j < NUM_LINE_HASHES && name != s_hash_names[j])
+			j++;
+		if (j == NUM_LINE_HASHES)
+			return false;
+		hashes |= 1 << j;
+	}
+	return hashes != 0;
+}
+
+static std::string FormatLine(const Line &line)
+{
+	std::string text = StringFromFormat("%u %llu", line.field, (unsigned long long)line.frame);
+	for (int i = 0; i < NUM_LINE_HASHES; i++)
+		text += (line.mask & (1 << i)) ? StringFromFormat(" %08x", line.hashes[i]) : " -";
+	return text;
+}
+
+static bool ParseLine(const char *text, Line &line)
+{
+	char hashes[NUM_LINE_HASHES][16];
+	unsigned long long frame;
+	if (sscanf(text, "%u %llu %15s %15s %15s", &line.field, &frame, hashes[0], hashes[1], hashes[2]) != 5)
+		return false;
+
+	line.frame = frame;
+	line.mask = 0;
+	for (int i = 0; i < NUM_LINE_HASHES; i++)
+	{
+		line.hashes[i] = 0;
+		if (strcmp(hashes[i], "-") == 0)
+			continue;
+		if (sscanf(hashes[i], "%x", &line.hashes[i]) != 1)
+			return false;
+		line.mask |= 1 << i;
+	}
+	return true;
+}
+
+static bool FieldLess(const Line &a, const Line &b)
+{
+	return a.field < b.field;
+}
+
+static bool LoadReference(const std::string &filename)
+{
+	s_reference.clear();
+
+	File::IOFile file(filename, "r");
+	if (!file)
+		return false;
+
+	char text[256];
+	while (fgets(text, sizeof(text), file.GetHandle()))
+	{
+		if (text[0] == '#' || text[0] == '\n')
+			continue;
+
+		Line line;
+		if (!ParseLine(text, line))
+		{
+			ERROR_LOG(COMMON, "Replay: bad line in %s: %s", filename.c_str(), text);
+			return false;
+		}
+		s_reference.push_back(line);
+	}
+
+	std::stable_sort(s_reference.begin(), s_reference.end(), FieldLess);
+	return true;
+}
+
+bool Start(const Settings &settings)
+{
+	if (s_active || settings.m_Interval == 0)
+		return false;
+
+	s_settings = settings;
+	s_finished = false;
+	s_reached_end = false;
+	s_difference.clear();
+	s_field = 0;
+	s_xfb_address = 0;
+	s_xfb_size = 0;
+	s_audio = 0;
+	s_start_us = s_end_us = 0;
+
+	if (!s_settings.m_ReferenceFile.empty() && !LoadReference(s_settings.m_ReferenceFile))
+	{
+		PanicAlertT("Failed to read the hashes in %s", s_settings.m_ReferenceFile.c_str());
+		return false;
+	}
+
+	if (!s_settings.m_HashFile.empty())
+	{
+		if (!s_hash_file.Open(s_settings.m_HashFile, "w"))
+		{
+			PanicAlertT("Failed to create %s", s_settings.m_HashFile.c_str());
+			return false;
+		}
+		fprintf(s_hash_file.GetHandle(), "# %s, every %u fields\n# field frame state xfb audio\n",
+			s_settings.m_Movie.c_str(), s_settings.m_Interval);
+	}
+
+	Movie::SetReadOnly(true);
+	if (!Movie::PlayInput(s_settings.m_Movie.c_str()))
+	{
+		s_hash_file.Close();
+		return false;
+	}
+
+	s_framelimit = SConfig::GetInstance().m_Framelimit;
+	s_audio_backend = SConfig::GetInstance().sBackend;
+	s_active = true;
+	return true;
+}
+
+bool Stop()
+{
+	if (!s_active)
+		return false;
+
+	if (!s_finished)
+		s_end_us = Common::Timer::GetTimeUs();
+
+	s_hash_file.Close();
+	SConfig::GetInstance().m_Framelimit = s_framelimit;
+	SConfig::GetInstance().sBackend = s_audio_backend;
+	s_active = false;
+
+	NOTICE_LOG(COMMON, "Replay: %s", GetReport().c_str());
+	return s_reached_end && s_difference.empty();
+}
+
+bool IsActive()
+{
+	return s_active;
+}
+
+std::string GetReport()
+{
+	const double seconds = s_field && s_end_us > s_start_us ? (s_end_us - s_start_us) / 1000000.0 : 0;
+	const double fps = seconds ? s_field / seconds : 0;
+	const double realtime = VideoInterface::TargetRefreshRate ? fps * 100 / VideoInterface::TargetRefreshRate : 0;
+
+	std::string report = StringFromFormat("%u fields (%llu frames) in %.2f s, %.1f fields/s, %.0f%% of real time",
+		s_field, (unsigned long long)Movie::g_currentFrame, seconds, fps, realtime);
+
+	if (!s_difference.empty())
+		report += "\nDiffers from the reference at " + s_difference;
+	else if (!s_reached_end)
+		report += "\nStopped before the end of the movie";
+	else if (!s_reference.empty())
+		report += StringFromFormat("\nMatches the reference (%u hashes)", (u32)s_reference.size());
+	return report;
+}
+
+void ApplyConfig()
+{
+	if (!s_active)
+		return;
+
+	SConfig::GetInstance().m_Framelimit = 0;
+	SConfig::GetInstance().sBackend = BACKEND_NULLSOUND;
+}
+
+void FieldBegan(u32 xfbAddr, u32 fbWidth, u32 fbHeight)
+{
+	if (!s_active)
+		return;
+
+	s_xfb_address = xfbAddr;
+	s_xfb_size = 2 * fbWidth * fbHeight;
+}
+
+void AudioDMA(u32 address, u32 size)
+{
+	if (!s_active || !(s_settings.m_Hashes & HASH_AUDIO))
+		return;
+
+	const u8 *data = GetRange(address, size);
+	if (data)
+		s_audio = HashCRC32C(data, size, s_audio);
+}
+
+static void Finish(bool reached_end)
+{
+	s_finished = true;
+	s_reached_end = reached_end;
+	s_end_us = Common::Timer::GetTimeUs();
+	Host_Message(WM_USER_STOP);
+}
+
+static u32 HashState()
+{
+	u32 h = DesyncCheck::HashCPU();
+	h = HashCRC32C(Memory::m_pRAM, Memory::REALRAM_SIZE, h);
+	if (Core::g_CoreStartupParameter.bWii)
+		h = HashCRC32C(Memory::m_pEXRAM, Memory::EXRAM_SIZE, h);
+	return h;
+}
+
+static u32 HashXFB()
+{
+	const u8 *data = s_xfb_address ? GetRange(s_xfb_address, s_xfb_size) : NULL;
+	return data ? HashCRC32C(data, s_xfb_size) : 0;
+}
+
+static void Compare(const Line &line)
+{
+	std::vector<Line>::const_iterator it = std::lower_bound(s_reference.begin(), s_reference.end(), line, FieldLess);
+	if (it == s_reference.end() || it->field != line.field)
+		return;
+
+	std::string regions;
+	for (int i = 0; i < NUM_LINE_HASHES; i++)
+	{
+		if ((line.mask & it->mask & (1 << i)) && line.hashes[i] != it->hashes[i])
+			regions += std::string(regions.empty() ? "" : ", ") + s_hash_names[i];
+	}
+	if (it->frame != line.frame)
+		regions += std::string(regions.empty() ? "" : ", ") + "frame count";
+
+	if (!regions.empty())
+	{
+		s_difference = StringFromFormat("field %u (frame %llu): %s", line.field, (unsigned long long)line.frame, regions.c_str());
+		ERROR_LOG(COMMON, "Replay: differs at %s", s_difference.c_str());
+		Finish(false);
+	}
+}
+
+void FieldEnded()
+{
+	if (!s_active || s_finished)
+		return;
+
+	if (s_field++ == 0)
+	{
+		s_start_us = Common::Timer::GetTimeUs();
+		if (!s_settings.m_Render)
+			g_video_backend->Video_SetRendering(false);
+	}
+
+	if (!Movie::IsPlayingInput())
+	{
+		if (!s_reference.empty() && s_reference.back().field > s_field)
+		{
+			s_difference = StringFromFormat("field %u: the movie ended, the reference goes on to field %u",
+				s_field, s_reference.back().field);
+		}
+		Finish(true);
+		return;
+	}
+
+	if (s_field % s_settings.m_Interval)
+		return;
+
+	Line line;
+	line.field = s_field;
+	line.frame = Movie::g_currentFrame;
+	line.mask = s_settings.m_Hashes;
+	line.hashes[LINE_STATE] = (line.mask & HASH_STATE) ? HashState() : 0;
+	line.hashes[LINE_XFB] = (line.mask & HASH_XFB) ? HashXFB() : 0;
+	line.hashes[LINE_AUDIO] = s_audio;
+
+	if (s_hash_file)
+		fprintf(s_hash_file.GetHandle(), "%s\n", FormatLine(line).c_str());
+	if (!s_reference.empty())
+		Compare(line);
+}
+
+}  // namespace
@@ -0,0 +1,70 @@
+// Copyright 2013 Dolphin Emulator Project
+// Licensed under GPLv2
+// Refer to the license.txt file included.
+
+// Fast-forward movie replay for regression testing.
+// The movie is played read-only with the frame limit off and no audio
+// output, optionally without drawing anything, and emulation stops when
+// its input runs out. Every interval VI fields a line is written with
+//   field frame state xfb audio
+// state: HashCRC32C of the CPU registers and all of RAM
+// xfb:   the XFB being scanned out, in RAM. Only the CPU and Real XFB write
+//        there, and with dual core what the GPU got to is up to timing.
+// audio: running hash of all the audio DMA'd to the AI so far
+// Given the hashes of an earlier run, the replay stops at the first line
+// that differs.
+
+#ifndef _REPLAY_H_
+#define _REPLAY_H_
+
+#include <string>
+
+#include "CommonTypes.h"
+
+namespace Replay
+{
+
+enum
+{
+	HASH_STATE	= 1 << 0,
+	HASH_XFB	= 1 << 1,
+	HASH_AUDIO	= 1 << 2,
+	HASH_ALL	= HASH_STATE | HASH_XFB | HASH_AUDIO,
+};
+
+struct Settings
+{
+	Settings() : m_Interval(60), m_Hashes(HASH_ALL), m_Render(true) {}
+
+	std::string m_Movie;
+	std::string m_HashFile;			// Where to write the hashes, none if empty
+	std::string m_ReferenceFile;	// Hashes to compare with, none if empty
+	u32 m_Interval;					// VI fields
+	u32 m_Hashes;
+	bool m_Render;
+};
+
+// "state,xfb,audio" to HASH_ flags, false if something isn't known
+bool ParseHashes(const std::string &text, u32 &hashes);
+
+// Starts playing the movie, call before booting
+bool Start(const Settings &settings);
+// Call after the core has stopped. False if the replay didn't reach the
+// end of the movie or differed from the reference.
+bool Stop();
+bool IsActive();
+
+// Fields emulated, speed, and the first difference
+std::string GetReport();
+
+// Called from BootManager after the game's settings are applied
+void ApplyConfig();
+
+// Called from VideoInterface and DSP, on the CPU thread
+void FieldBegan(u32 xfbAddr, u32 fbWidth, u32 fbHeight);
+void FieldEnded();
+void AudioDMA(u32 address, u32 size);
+
+}  // namespace
+
+#endif // _REPLAY_H_
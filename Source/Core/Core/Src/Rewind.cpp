@@ -0,0 +1,320 @@
+// Copyright 2013 Dolphin Emulator Project
+// Licensed under GPLv2
+// Refer to the license.txt file included.
+
+#include "Common.h"
+#include "StringUtil.h"
+#include "Thread.h"
+#include "Timer.h"
+#include "Rewind.h"
+#include "State.h"
+#include "Core.h"
+#include "Movie.h"
+#include "CoreTiming.h"
+#include "Atomic.h"
+
+#include <lzo/lzo1x.h>
+
+namespace Rewind
+{
+
+// VI rate is close enough for sizing the ring
+static const u32 FRAMES_PER_SECOND = 60;
+
+struct Entry
+{
+	std::vector<u8> data; // LZO compressed XOR against the next newer state
+	u32 size;             // size of the state this entry restores
+	u64 frame;
+};
+
+static std::vector<Entry> s_ring;
+static u32 s_newest;
+static u32 s_count;
+
+static std::vector<u8> s_current;
+static u64 s_current_frame;
+static bool s_has_current;
+static bool s_at_current;
+
+// Scratch buffers, they grow to the largest state seen and stay there
+static std::vector<u8> s_xor;
+static std::vector<u8> s_compressed;
+static std::vector<lzo_align_t> s_wrkmem;
+
+// Written by the CPU thread while s_capture_pending is 0, read by the
+// encoder while it is 1
+static std::vector<u8> s_capture;
+static u64 s_capture_frame;
+static u32 s_capture_us;
+static u32 s_capture_generation;
+static volatile u32 s_capture_pending;
+// What s_capture holds on to, for GetStats
+static size_t s_capture_capacity;
+
+// Guards the ring, s_current and the stats against the encoder
+static std::mutex s_lock;
+static std::thread s_thread;
+static Common::Event s_capture_event;
+static volatile bool s_running = false;
+static int s_event;
+static u32 s_interval;
+static volatile u32 s_frames;
+// Bumped by StepBack, captures from before a load are dropped
+static volatile u32 s_generation;
+// The frame of the newest capture or load. The CPU thread owns it, StepBack
+// only writes it with the core paused
+static u64 s_last_frame;
+
+static Stats s_stats;
+static u64 s_captures;
+static u64 s_total_capture_us;
+static u64 s_total_encode_us;
+
+// dst = a ^ b, the shorter one padded with zeroes
+static void XorStates(const std::vector<u8>& a, const std::vector<u8>& b, std::vector<u8>& dst)
+{
+	const size_t common = std::min(a.size(), b.size());
+	const std::vector<u8>& longer = a.size() > b.size() ? a : b;
+
+	dst.resize(longer.size());
+	for (size_t i = 0; i < common; i++)
+		dst[i] = a[i] ^ b[i];
+	if (longer.size() > common)
+		memcpy(&dst[common], &longer[common], longer.size() - common);
+}
+
+// called from ---CPU--- thread
+static void CaptureCallback(u64 userdata, int cyclesLate)
+{
+	// The encoder isn't done with the last capture yet, or nothing ran since
+	if (!s_running || Common::AtomicLoadAcquire(s_capture_pending) || Movie::g_currentFrame == s_last_frame)
+		return;
+
+	const u64 start = Common::Timer::GetTimeUs();
+	const u32 generation = s_generation;
+	u64 frame;
+	// Another thread is pausing the core, try again next interval
+	if (!State::TrySaveToBuffer(s_capture, &frame))
+		return;
+
+	s_last_frame = frame;
+	s_capture_frame = frame;
+	s_capture_generation = generation;
+	s_capture_us = (u32)(Common::Timer::GetTimeUs() - start);
+	Common::AtomicStoreRelease(s_capture_pending, 1u);
+	s_capture_event.Set();
+}
+
+// called from ---Rewind--- thread
+static void Encode()
+{
+	std::lock_guard<std::mutex> lk(s_lock);
+
+	if (s_capture.empty() || s_capture_generation != s_generation)
+		return;
+
+	const u64 start = Common::Timer::GetTimeUs();
+	u32 entry_bytes = 0;
+	if (s_has_current)
+	{
+		XorStates(s_current, s_capture, s_xor);
+
+		s_compressed.resize(s_xor.size() + s_xor.size() / 16 + 64 + 3);
+		lzo_uint out_len = 0;
+		if (lzo1x_1_compress(&s_xor[0], s_xor.size(), &s_compressed[0], &out_len, &s_wrkmem[0]) != LZO_E_OK)
+		{
+			ERROR_LOG(COMMON, "Rewind: compression failed, dropping history");
+			s_count = 0;
+		}
+		else
+		{
+			s_newest = (s_newest + 1) % s_ring.size();
+			if (s_count < s_ring.size())
+				s_count++;
+
+			// assign() keeps the capacity the slot had last time around
+			Entry& e = s_ring[s_newest];
+			e.data.assign(s_compressed.begin(), s_compressed.begin() + out_len);
+			e.size = (u32)s_current.size();
+			e.frame = s_current_frame;
+			entry_bytes = (u32)out_len;
+		}
+	}
+
+	// The CPU thread gets the old current state's buffer to capture into
+	s_current.swap(s_capture);
+	s_capture_capacity = s_capture.capacity();
+	s_current_frame = s_capture_frame;
+	s_has_current = true;
+	s_at_current = false;
+
+	const u32 encode_us = (u32)(Common::Timer::GetTimeUs() - start);
+	s_captures++;
+	s_total_capture_us += s_capture_us;
+	s_total_encode_us += encode_us;
+	s_stats.last_entry_bytes = entry_bytes;
+	s_stats.last_capture_us = s_capture_us;
+	s_stats.last_encode_us = encode_us;
+	s_stats.avg_capture_us = (u32)(s_total_capture_us / s_captures);
+	s_stats.avg_encode_us = (u32)(s_total_encode_us / s_captures);
+}
+
+static void RewindThread()
+{
+	Common::SetCurrentThreadName("Rewind thread");
+
+	while (true)
+	{
+		s_capture_event.Wait();
+		if (!s_running)
+			break;
+		if (Common::AtomicLoadAcquire(s_capture_pending))
+		{
+			Encode();
+			Common::AtomicStoreRelease(s_capture_pending, 0u);
+		}
+	}
+}
+
+void Init(u32 seconds, u32 interval_frames)
+{
+	if (seconds == 0)
+		return;
+
+	s_interval = std::max(1u, interval_frames);
+	s_ring.clear();
+	s_ring.resize(std::max(1u, seconds * FRAMES_PER_SECOND / s_interval));
+	s_newest = 0;
+	s_count = 0;
+	s_has_current = false;
+	s_at_current = false;
+	s_frames = 0;
+	s_generation = 0;
+	s_capture_pending = 0;
+	s_capture_capacity = 0;
+	s_last_frame = (u64)-1;
+	s_captures = 0;
+	s_total_capture_us = 0;
+	s_total_encode_us = 0;
+	memset(&s_stats, 0, sizeof(s_stats));
+	s_wrkmem.resize((LZO1X_1_MEM_COMPRESS + sizeof(lzo_align_t) - 1) / sizeof(lzo_align_t));
+
+	s_event = CoreTiming::RegisterEvent("RewindCapture", CaptureCallback);
+	s_running = true;
+	s_thread = std::thread(RewindThread);
+}
+
+void Shutdown()
+{
+	if (!s_running)
+		return;
+
+	s_running = false;
+	s_capture_event.Set();
+	s_thread.join();
+
+	// swap with empty vectors to actually give the memory back
+	std::vector<Entry>().swap(s_ring);
+	std::vector<u8>().swap(s_current);
+	std::vector<u8>().swap(s_capture);
+	std::vector<u8>().swap(s_xor);
+	std::vector<u8>().swap(s_compressed);
+	std::vector<lzo_align_t>().swap(s_wrkmem);
+}
+
+bool IsEnabled()
+{
+	return s_running;
+}
+
+void FrameAdvanced()
+{
+	if (!s_running)
+		return;
+
+	if (++s_frames >= s_interval)
+	{
+		s_frames = 0;
+		// Serialised on the CPU thread, the encoder only sees the finished buffer
+		CoreTiming::ScheduleEvent_Threadsafe(0, s_event);
+	}
+}
+
+static bool StepBackPaused(u64 *frame)
+{
+	std::lock_guard<std::mutex> lk(s_lock);
+
+	if (!s_has_current)
+		return false;
+
+	if (s_at_current)
+	{
+		if (s_count == 0)
+			return false;
+
+		// Undo the newest XOR, the entry becomes the current state
+		const Entry& e = s_ring[s_newest];
+		s_xor.resize(std::max<size_t>(e.size, s_current.size()));
+		lzo_uint out_len = s_xor.size();
+		if (lzo1x_decompress(&e.data[0], e.data.size(), &s_xor[0], &out_len, NULL) != LZO_E_OK)
+		{
+			ERROR_LOG(COMMON, "Rewind: decompression failed");
+			return false;
+		}
+
+		s_current.resize(out_len, 0);
+		for (size_t i = 0; i < out_len; i++)
+			s_current[i] ^= s_xor[i];
+		s_current.resize(e.size);
+		s_current_frame = e.frame;
+
+		s_newest = (s_newest + s_ring.size() - 1) % s_ring.size();
+		s_count--;
+	}
+
+	State::LoadFromBuffer(s_current);
+	s_at_current = true;
+
+	// A capture the encoder hasn't taken yet belongs to the abandoned future
+	s_generation++;
+	s_last_frame = s_current_frame;
+	// Give the player a full interval before the next capture
+	s_frames = 0;
+	*frame = s_current_frame;
+	return true;
+}
+
+bool StepBack()
+{
+	if (!s_running)
+		return false;
+
+	// Keeps the CPU thread out of CaptureCallback until the load is done
+	bool wasUnpaused = Core::PauseAndLock(true);
+	u64 frame;
+	bool stepped = StepBackPaused(&frame);
+	Core::PauseAndLock(false, wasUnpaused);
+
+	if (stepped)
+		Core::DisplayMessage(StringFromFormat("Rewound to frame %llu", (unsigned long long)frame).c_str(), 1000);
+	return stepped;
+}
+
+Stats GetStats()
+{
+	std::lock_guard<std::mutex> lk(s_lock);
+
+	Stats stats = s_stats;
+	stats.entries = s_count + (s_has_current ? 1 : 0);
+	stats.newest_frame = s_current_frame;
+	stats.oldest_frame = s_count ? s_ring[(s_newest + s_ring.size() - s_count + 1) % s_ring.size()].frame : s_current_frame;
+
+	stats.memory_bytes = s_current.capacity() + s_capture_capacity + s_xor.capacity() + s_compressed.capacity();
+	for (size_t i = 0; i < s_ring.size(); i++)
+		stats.memory_bytes += s_ring[i].data.capacity();
+
+	return stats;
+}
+
+}  // namespace
@@ -0,0 +1,54 @@
+// Copyright 2013 Dolphin Emulator Project
+// Licensed under GPLv2
+// Refer to the license.txt file included.
+
+// In-memory rewind.
+// Every interval frames a CoreTiming event saves a state on the CPU thread,
+// the rewind thread then encodes it. The newest state is kept raw, every
+// older one only as the LZO compressed XOR against its successor, so
+// stepping back walks the ring from the newest entry. All buffers are
+// reused once the ring has filled up.
+
+#ifndef _REWIND_H_
+#define _REWIND_H_
+
+#include "CommonTypes.h"
+
+namespace Rewind
+{
+
+struct Stats
+{
+	u32 entries;        // states that can be stepped back to
+	u64 memory_bytes;   // everything the ring holds on to
+	u64 oldest_frame;
+	u64 newest_frame;
+	u32 last_entry_bytes;
+	u32 last_capture_us; // emulation paused for TrySaveToBuffer
+	u32 last_encode_us;  // XOR + compression, emulation running
+	u32 avg_capture_us;
+	u32 avg_encode_us;
+};
+
+// Init clamps to these, the ring grows with seconds
+const u32 MAX_SECONDS = 600;
+const u32 MAX_INTERVAL_FRAMES = 600;
+
+// seconds == 0 disables rewind
+void Init(u32 seconds, u32 interval_frames);
+void Shutdown();
+bool IsEnabled();
+
+// Called once per frame from Core
+void FrameAdvanced();
+
+// Loads the newest snapshot, or the one before it when the newest was just
+// loaded and no new capture has been taken since. False if there is nothing
+// to go back to.
+bool StepBack();
+
+Stats GetStats();
+
+}  // namespace
+
+#endif // _REWIND_H_
@@ -9,8 +9,10 @@
 #include "ConfigManager.h"
 #include "StringUtil.h"
 #include "Thread.h"
+#include "Hash.h"
 #include "CoreTiming.h"
 #include "Movie.h"
+#include "DesyncCheck.h"
 #include "HW/Wiimote.h"
 #include "HW/DSP.h"
 #include "HW/HW.h"
@@ -19,6 +21,7 @@
 #include "VideoBackendBase.h"
 
 #include <lzo/lzo1x.h>
+#include <memory>
 #include "HW/Memmap.h"
 #include "HW/VideoInterface.h"
 #include "HW/SystemTimers.h"
@@ -36,12 +39,20 @@ static const u32 IN_LEN = 128 * 1024u;
 
 static const u32 OUT_LEN = IN_LEN + (IN_LEN / 16) + 64 + 3;
 
-static unsigned char __LZO_MMODEL out[OUT_LEN];
-
-#define HEAP_ALLOC(var, size) \
-	lzo_align_t __LZO_MMODEL var[((size) + (sizeof(lzo_align_t) - 1)) / sizeof(lzo_align_t)]
-
-static HEAP_ALLOC(wrkmem, LZO1X_1_MEM_COMPRESS);
+// Compressed bodies start with an index so loading can find every chunk
+// without walking the stream: [u32 INDEX_MAGIC][u32 chunk count]
+// [u32 chunk size][u32 compressed size per chunk], then the chunks back to
+// back. Older states are a plain [u32 length][LZO data] stream.
+static const u32 INDEX_MAGIC = 0x58444953; // 'SIDX', larger than any valid chunk length
+
+// Incremental states: the slot file only holds the pages that differ from
+// "<slot>.base", which is rewritten every INCREMENTAL_REBASE_INTERVAL saves
+// or when the delta grows past half of the full state. Dirty pages are found
+// by hashing on the save thread: fastmem code writes guest RAM without
+// passing any hook, so there is nothing cheaper to track writes with.
+static const u32 DELTA_PAGE_SIZE = 4096;
+static const u32 DELTA_MAGIC = 0x41544C44; // 'DLTA', never a valid chunk length or state cookie
+static const u32 INCREMENTAL_REBASE_INTERVAL = 30;
 
 static std::string g_last_filename;
 
@@ -59,7 +70,7 @@ static Common::Event g_compressAndDumpStateSyncEvent;
 static std::thread g_save_thread;
 
 // Don't forget to increase this after doing changes on the savestate system
-static const u32 STATE_VERSION = 20;
+static const u32 STATE_VERSION = 22;
 
 enum
 {
@@ -69,12 +80,30 @@ enum
 };
 
 static bool g_use_compression = true;
+static bool g_use_incremental = false;
+
+// What each slot's base looks like, keyed by the base's filename. Only
+// touched on the save thread.
+struct IncrementalBase
+{
+	std::vector<u64> page_hashes;
+	double time;
+	u32 saves;
+};
+static std::map<std::string, IncrementalBase> g_incremental_bases;
 
 void EnableCompression(bool compression)
 {
 	g_use_compression = compression;
 }
 
+void EnableIncremental(bool incremental)
+{
+	Flush();
+	g_use_incremental = incremental;
+	g_incremental_bases.clear();
+}
+
 void DoState(PointerWrap &p)
 {
 	u32 version = STATE_VERSION;
@@ -101,7 +130,7 @@ void DoState(PointerWrap &p)
 	p.DoMarker("video_backend");
 
 	if (Core::g_CoreStartupParameter.bWii)
-		Wiimote::DoState(p.GetPPtr(), p.GetMode());
+		Wiimote::DoState(p);
 	p.DoMarker("Wiimote");
 
 	PowerPC::DoState(p);
@@ -112,6 +141,8 @@ void DoState(PointerWrap &p)
 	p.DoMarker("CoreTiming");
 	Movie::DoState(p);
 	p.DoMarker("Movie");
+	DesyncCheck::DoState(p);
+	p.DoMarker("DesyncCheck");
 }
 
 void LoadFromBuffer(std::vector<u8>& buffer)
@@ -129,18 +160,26 @@ void SaveToBuffer(std::vector<u8>& buffer)
 {
 	bool wasUnpaused = Core::PauseAndLock(true);
 
-	u8* ptr = NULL;
-	PointerWrap p(&ptr, PointerWrap::MODE_MEASURE);
-
+	PointerWrap p(buffer);
 	DoState(p);
-	const size_t buffer_size = reinterpret_cast<size_t>(ptr);
-	buffer.resize(buffer_size);
-	
-	ptr = &buffer[0];
-	p.SetMode(PointerWrap::MODE_WRITE);
+	p.FinishArena();
+
+	Core::PauseAndLock(false, wasUnpaused);
+}
+
+bool TrySaveToBuffer(std::vector<u8>& buffer, u64 *frame)
+{
+	bool wasUnpaused;
+	if (!Core::TryPauseAndLock(wasUnpaused))
+		return false;
+
+	PointerWrap p(buffer);
 	DoState(p);
+	p.FinishArena();
+	*frame = Movie::g_currentFrame;
 
 	Core::PauseAndLock(false, wasUnpaused);
+	return true;
 }
 
 void VerifyBuffer(std::vector<u8>& buffer)
@@ -202,85 +241,427 @@ struct CompressAndDumpState_args
 	std::mutex* buffer_mutex;
 	std::string filename;
 	bool wait;
+	// The movie as it was when saving, the CPU thread goes on recording
+	bool has_movie;
+	bool save_movie;
+	Movie::Reference movie;
 };
 
-void CompressAndDumpState(CompressAndDumpState_args save_args)
+struct CompressJob
 {
-	std::lock_guard<std::mutex> lk(*save_args.buffer_mutex);
-	if (!save_args.wait)
-		g_compressAndDumpStateSyncEvent.Set();
+	const u8* data;
+	size_t size;
+	std::vector<std::vector<u8> > chunks;
+	volatile bool failed;
+};
 
-	const u8* const buffer_data = &(*(save_args.buffer_vector))[0];
-	const size_t buffer_size = (save_args.buffer_vector)->size();
-	std::string& filename = save_args.filename;
+static void CompressWorker(CompressJob* job, u32 first, u32 step)
+{
+	std::vector<lzo_align_t> wrkmem((LZO1X_1_MEM_COMPRESS + sizeof(lzo_align_t) - 1) / sizeof(lzo_align_t));
 
-	// For easy debugging
-	Common::SetCurrentThreadName("SaveState thread");
+	for (u32 c = first; c < job->chunks.size(); c += step)
+	{
+		const size_t offset = (size_t)c * IN_LEN;
+		const lzo_uint32 cur_len = (lzo_uint32)std::min<size_t>(IN_LEN, job->size - offset);
+		std::vector<u8>& chunk = job->chunks[c];
+		lzo_uint out_len = 0;
+
+		chunk.resize(OUT_LEN);
+		if (lzo1x_1_compress(job->data + offset, cur_len, &chunk[0], &out_len, &wrkmem[0]) != LZO_E_OK)
+			job->failed = true;
+		chunk.resize(out_len);
+	}
+}
 
-	// Moving to last overwritten save-state
-	if (File::Exists(filename))
+// Compresses IN_LEN sized chunks on all cores and writes them as an indexed body
+static void WriteCompressed(File::IOFile& f, const u8* data, size_t size)
+{
+	CompressJob job;
+	job.data = data;
+	job.size = size;
+	job.chunks.resize((size + IN_LEN - 1) / IN_LEN);
+	job.failed = false;
+
+	const u32 num_threads = std::max(1u, std::min((u32)std::thread::hardware_concurrency(), (u32)job.chunks.size()));
+	std::vector<std::thread> workers;
+	for (u32 t = 1; t < num_threads; t++)
+		workers.push_back(std::thread(CompressWorker, &job, t, num_threads));
+	CompressWorker(&job, 0, num_threads);
+	for (u32 t = 0; t < workers.size(); t++)
+		workers[t].join();
+
+	if (job.failed)
+		PanicAlertT("Internal LZO Error - compression failed");
+
+	std::vector<u32> index;
+	index.push_back(INDEX_MAGIC);
+	index.push_back((u32)job.chunks.size());
+	index.push_back(IN_LEN);
+	for (u32 c = 0; c < job.chunks.size(); c++)
+		index.push_back((u32)job.chunks[c].size());
+	f.WriteArray(&index[0], index.size());
+
+	for (u32 c = 0; c < job.chunks.size(); c++)
+		f.WriteBytes(&job.chunks[c][0], job.chunks[c].size());
+}
+
+// Decompresses the chunks of an indexed body straight from the mapped file
+// into their place in the state buffer, on all cores. Chunks are handed out
+// front to back, so DoState can read the start of the state while the rest
+// is still being decompressed.
+class IndexedLoader
+{
+public:
+	IndexedLoader() : m_dest(NULL) {}
+
+	bool Parse(const u8* body, size_t body_size, u32 state_size)
 	{
-		if (File::Exists(File::GetUserPath(D_STATESAVES_IDX) + "lastState.sav"))
-			File::Delete((File::GetUserPath(D_STATESAVES_IDX) + "lastState.sav"));
-		if (File::Exists(File::GetUserPath(D_STATESAVES_IDX) + "lastState.sav.dtm"))
-			File::Delete((File::GetUserPath(D_STATESAVES_IDX) + "lastState.sav.dtm"));
+		u32 head[3];
+		if (body_size < sizeof(head))
+			return false;
+		memcpy(head, body, sizeof(head));
+
+		const u32 count = head[1];
+		m_chunk_size = head[2];
+		m_state_size = state_size;
+		if (head[0] != INDEX_MAGIC || m_chunk_size == 0 ||
+			count != (state_size + (u64)m_chunk_size - 1) / m_chunk_size ||
+			body_size < sizeof(head) + (u64)count * sizeof(u32))
+			return false;
+
+		m_sizes.resize(count);
+		if (count)
+			memcpy(&m_sizes[0], body + sizeof(head), count * sizeof(u32));
+
+		size_t offset = sizeof(head) + count * sizeof(u32);
+		m_offsets.resize(count);
+		for (u32 c = 0; c < count; c++)
+		{
+			m_offsets[c] = offset;
+			offset += m_sizes[c];
+			if (offset > body_size)
+				return false;
+		}
 
-		if (!File::Rename(filename, File::GetUserPath(D_STATESAVES_IDX) + "lastState.sav"))
-			Core::DisplayMessage("Failed to move previous state to state undo backup", 1000);
-		else 
-			File::Rename(filename + ".dtm", File::GetUserPath(D_STATESAVES_IDX) + "lastState.sav.dtm");
+		m_body = body;
+		return true;
 	}
 
-	if ((Movie::IsRecordingInput() || Movie::IsPlayingInput()) && !Movie::IsJustStartingRecordingInputFromSaveState())
-		Movie::SaveRecording((filename + ".dtm").c_str());
-	else if (!Movie::IsRecordingInput() && !Movie::IsPlayingInput())
-		File::Delete(filename + ".dtm");
+	void Start(u8* dest)
+	{
+		m_dest = dest;
+		m_done.assign(m_sizes.size(), false);
+		m_next = 0;
+		m_ready = 0;
+		m_failed = false;
+
+		const u32 num_threads = std::max(1u, std::min((u32)std::thread::hardware_concurrency(), (u32)m_sizes.size()));
+		for (u32 t = 0; t < num_threads; t++)
+			m_workers.push_back(std::thread(Worker, this));
+	}
 
-	File::IOFile f(filename, "wb");
-	if (!f)
+	// Blocks until everything before needed is decompressed. Returns how far
+	// the buffer can be read now, NULL if needed can't be reached.
+	u8* WaitFor(u8* needed)
 	{
-		Core::DisplayMessage("Could not save state", 2000);
-		g_compressAndDumpStateSyncEvent.Set();
-		return;
+		std::unique_lock<std::mutex> lk(m_lock);
+		while (!m_failed && m_ready < m_sizes.size() && ReadyEnd() < needed)
+			m_cond.wait(lk);
+
+		if (m_failed || ReadyEnd() < needed)
+			return NULL;
+		return ReadyEnd();
+	}
+
+	static u8* ReadWait(void* userdata, u8* needed)
+	{
+		return static_cast<IndexedLoader*>(userdata)->WaitFor(needed);
+	}
+
+	// Stops handing out chunks and joins the workers. False if any chunk was corrupt.
+	bool Finish()
+	{
+		{
+			std::lock_guard<std::mutex> lk(m_lock);
+			m_next = (u32)m_sizes.size();
+		}
+		for (u32 t = 0; t < m_workers.size(); t++)
+			m_workers[t].join();
+		m_workers.clear();
+
+		if (m_failed)
+			PanicAlertT("Internal LZO Error - decompression failed");
+		return !m_failed;
+	}
+
+private:
+	u8* ReadyEnd() const
+	{
+		return m_dest + std::min<u64>((u64)m_ready * m_chunk_size, m_state_size);
+	}
+
+	static void Worker(IndexedLoader* loader)
+	{
+		while (true)
+		{
+			u32 c;
+			{
+				std::lock_guard<std::mutex> lk(loader->m_lock);
+				if (loader->m_failed || loader->m_next >= loader->m_sizes.size())
+					return;
+				c = loader->m_next++;
+			}
+
+			const size_t offset = (size_t)c * loader->m_chunk_size;
+			const lzo_uint expected = std::min<size_t>(loader->m_chunk_size, loader->m_state_size - offset);
+			lzo_uint out_len = expected;
+			const int res = lzo1x_decompress_safe(loader->m_body + loader->m_offsets[c], loader->m_sizes[c],
+				loader->m_dest + offset, &out_len, NULL);
+
+			std::lock_guard<std::mutex> lk(loader->m_lock);
+			if (res != LZO_E_OK || out_len != expected)
+			{
+				ERROR_LOG(COMMON, "State chunk %u failed to decompress (%d)", c, res);
+				loader->m_failed = true;
+			}
+			else
+			{
+				loader->m_done[c] = true;
+				while (loader->m_ready < loader->m_done.size() && loader->m_done[loader->m_ready])
+					loader->m_ready++;
+			}
+			loader->m_cond.notify_all();
+		}
+	}
+
+	const u8* m_body;
+	std::vector<u32> m_sizes;
+	std::vector<size_t> m_offsets;
+	u32 m_chunk_size;
+	u32 m_state_size;
+
+	u8* m_dest;
+	std::vector<bool> m_done;
+	u32 m_next;
+	u32 m_ready; // chunks [0, m_ready) are all done
+	bool m_failed;
+
+	std::mutex m_lock;
+	std::condition_variable m_cond;
+	std::vector<std::thread> m_workers;
+};
+
+static void HashPages(const u8* data, size_t size, std::vector<u64>& hashes)
+{
+	hashes.resize((size + DELTA_PAGE_SIZE - 1) / DELTA_PAGE_SIZE);
+	for (size_t page = 0; page < hashes.size(); page++)
+	{
+		const size_t offset = page * DELTA_PAGE_SIZE;
+		hashes[page] = GetMurmurHash3(data + offset, (int)std::min<size_t>(DELTA_PAGE_SIZE, size - offset), 0);
+	}
+}
+
+// Delta layout: [u32 full size] then [u32 page index][page data] for each
+// page whose hash differs from base_hashes. The last page may be short.
+static void MakeDelta(const std::vector<u64>& base_hashes, const std::vector<u64>& hashes,
+	const u8* data, size_t size, std::vector<u8>& delta)
+{
+	delta.clear();
+	const u32 full_size = (u32)size;
+	delta.insert(delta.end(), (const u8*)&full_size, (const u8*)&full_size + sizeof(u32));
+
+	for (size_t page = 0; page < hashes.size(); page++)
+	{
+		if (page < base_hashes.size() && base_hashes[page] == hashes[page])
+			continue;
+
+		const size_t offset = page * DELTA_PAGE_SIZE;
+		const size_t len = std::min<size_t>(DELTA_PAGE_SIZE, size - offset);
+		const u32 index = (u32)page;
+		delta.insert(delta.end(), (const u8*)&index, (const u8*)&index + sizeof(u32));
+		delta.insert(delta.end(), data + offset, data + offset + len);
+	}
+}
+
+static bool ApplyDelta(const std::vector<u8>& delta, std::vector<u8>& buffer)
+{
+	if (delta.size() < sizeof(u32))
+		return false;
+
+	u32 full_size;
+	memcpy(&full_size, &delta[0], sizeof(u32));
+	buffer.resize(full_size);
+
+	size_t pos = sizeof(u32);
+	while (pos < delta.size())
+	{
+		u32 page;
+		if (pos + sizeof(u32) > delta.size())
+			return false;
+		memcpy(&page, &delta[pos], sizeof(u32));
+		pos += sizeof(u32);
+
+		const size_t offset = (size_t)page * DELTA_PAGE_SIZE;
+		if (offset >= full_size)
+			return false;
+		const size_t len = std::min<size_t>(DELTA_PAGE_SIZE, full_size - offset);
+		if (pos + len > delta.size())
+			return false;
+		memcpy(&buffer[offset], &delta[pos], len);
+		pos += len;
 	}
+	return true;
+}
+
+static bool WriteStateFile(const std::string& filename, const u8* data, size_t size,
+	double* time = NULL, const u8* delta_base_time = NULL)
+{
+	File::IOFile f(filename, "wb");
+	if (!f)
+		return false;
 
 	// Setting up the header
 	StateHeader header;
 	memcpy(header.gameID, SConfig::GetInstance().m_LocalCoreStartupParameter.GetUniqueID().c_str(), 6);
-	header.size = g_use_compression ? buffer_size : 0;
+	header.size = g_use_compression ? (u32)size : 0;
 	header.time = Common::Timer::GetDoubleTime();
 
 	f.WriteArray(&header, 1);
+	if (time)
+		*time = header.time;
+
+	if (delta_base_time)
+	{
+		f.WriteArray(&DELTA_MAGIC, 1);
+		f.WriteBytes(delta_base_time, sizeof(double));
+	}
 
 	if (0 != header.size)	// non-zero header size means the state is compressed
+		WriteCompressed(f, data, size);
+	else	// uncompressed
+		f.WriteBytes(data, size);
+
+	return f.IsGood();
+}
+
+// Writes filename as a delta against filename.base, rewriting the base when needed
+static bool WriteIncremental(const std::string& filename, const u8* data, size_t size)
+{
+	const std::string base_filename = filename + ".base";
+	std::vector<u64> hashes;
+	std::vector<u8> delta;
+	HashPages(data, size, hashes);
+
+	std::map<std::string, IncrementalBase>::iterator it = g_incremental_bases.find(base_filename);
+	bool rebase = it == g_incremental_bases.end() ||
+		it->second.saves >= INCREMENTAL_REBASE_INTERVAL ||
+		!File::Exists(base_filename);
+
+	if (!rebase)
 	{
-		lzo_uint i = 0;
-		while (true)
-		{
-			lzo_uint32 cur_len = 0;
-			lzo_uint out_len = 0;
+		MakeDelta(it->second.page_hashes, hashes, data, size, delta);
+		rebase = delta.size() > size / 2;
+	}
 
-			if ((i + IN_LEN) >= buffer_size)
-				cur_len = buffer_size - i;
-			else
-				cur_len = IN_LEN;
+	if (rebase)
+	{
+		g_incremental_bases.erase(base_filename);
+		double time;
+		if (!WriteStateFile(base_filename, data, size, &time))
+			return false;
+
+		it = g_incremental_bases.insert(std::make_pair(base_filename, IncrementalBase())).first;
+		it->second.page_hashes.swap(hashes);
+		it->second.time = time;
+		it->second.saves = 0;
+
+		// Nothing differs from the base we just wrote
+		const u32 full_size = (u32)size;
+		delta.resize(sizeof(u32));
+		memcpy(&delta[0], &full_size, sizeof(u32));
+	}
 
-			if (lzo1x_1_compress(buffer_data + i, cur_len, out, &out_len, wrkmem) != LZO_E_OK)
-				PanicAlertT("Internal LZO Error - compression failed");
+	it->second.saves++;
+	return WriteStateFile(filename, &delta[0], delta.size(), NULL, (const u8*)&it->second.time);
+}
 
-			// The size of the data to write is 'out_len'
-			f.WriteArray((lzo_uint32*)&out_len, 1);
-			f.WriteBytes(out, out_len);
+// An incremental slot moved to the undo backup still needs its base. The slot
+// keeps using (and may rebase over) its own, so the backup gets a copy. That
+// only happens when the base changed since it was last copied.
+static void BackupBase(const std::string& base_filename, const std::string& backup_filename)
+{
+	StateHeader base_header, backup_header;
+	if (!File::Exists(base_filename) || !ReadHeader(base_filename, base_header))
+	{
+		if (File::Exists(backup_filename))
+			File::Delete(backup_filename);
+		return;
+	}
 
-			if (cur_len != IN_LEN)
-				break;
+	if (File::Exists(backup_filename) && ReadHeader(backup_filename, backup_header) &&
+		backup_header.time == base_header.time)
+	{
+		return;
+	}
+
+	if (!File::Copy(base_filename, backup_filename))
+		Core::DisplayMessage("Failed to copy the base state to the state undo backup", 1000);
+}
+
+void CompressAndDumpState(CompressAndDumpState_args save_args)
+{
+	std::lock_guard<std::mutex> lk(*save_args.buffer_mutex);
+	if (!save_args.wait)
+		g_compressAndDumpStateSyncEvent.Set();
 
-			i += cur_len;
+	const u8* const buffer_data = &(*(save_args.buffer_vector))[0];
+	const size_t buffer_size = (save_args.buffer_vector)->size();
+	std::string& filename = save_args.filename;
+
+	// For easy debugging
+	Common::SetCurrentThreadName("SaveState thread");
+
+	// Moving to last overwritten save-state
+	if (File::Exists(filename))
+	{
+		const std::string last_filename = File::GetUserPath(D_STATESAVES_IDX) + "lastState.sav";
+		if (File::Exists(last_filename))
+			File::Delete(last_filename);
+		if (File::Exists(last_filename + ".dtm"))
+			File::Delete(last_filename + ".dtm");
+
+		if (!File::Rename(filename, last_filename))
+			Core::DisplayMessage("Failed to move previous state to state undo backup", 1000);
+		else 
+		{
+			File::Rename(filename + ".dtm", last_filename + ".dtm");
+			BackupBase(filename + ".base", last_filename + ".base");
 		}
 	}
-	else	// uncompressed
+
+	if (save_args.save_movie)
+		Movie::SaveReference((filename + ".dtm").c_str(), save_args.movie);
+	else if (!save_args.has_movie)
+		File::Delete(filename + ".dtm");
+
+	bool saved;
+	if (g_use_incremental)
+	{
+		saved = WriteIncremental(filename, buffer_data, buffer_size);
+	}
+	else
+	{
+		saved = WriteStateFile(filename, buffer_data, buffer_size);
+		g_incremental_bases.erase(filename + ".base");
+		if (File::Exists(filename + ".base"))
+			File::Delete(filename + ".base");
+	}
+
+	if (!saved)
 	{
-		f.WriteBytes(buffer_data, buffer_size);
+		Core::DisplayMessage("Could not save state", 2000);
+		g_compressAndDumpStateSyncEvent.Set();
+		return;
 	}
 
 	Core::DisplayMessage(StringFromFormat("Saved State to %s",
@@ -293,22 +674,15 @@ void SaveAs(const std::string& filename, bool wait)
 	// Pause the core while we save the state
 	bool wasUnpaused = Core::PauseAndLock(true);
 
-	// Measure the size of the buffer.
-	u8 *ptr = NULL;
-	PointerWrap p(&ptr, PointerWrap::MODE_MEASURE);
-	DoState(p);
-	const size_t buffer_size = reinterpret_cast<size_t>(ptr);
-
-	// Then actually do the write.
+	bool written;
 	{
 		std::lock_guard<std::mutex> lk(g_cs_current_buffer);
-		g_current_buffer.resize(buffer_size);
-		ptr = &g_current_buffer[0];
-		p.SetMode(PointerWrap::MODE_WRITE);
+		PointerWrap p(g_current_buffer);
 		DoState(p);
+		written = p.FinishArena() != 0;
 	}
 
-	if (p.GetMode() == PointerWrap::MODE_WRITE)
+	if (written)
 	{
 		Core::DisplayMessage("Saving State...", 1000);
 
@@ -317,6 +691,10 @@ void SaveAs(const std::string& filename, bool wait)
 		save_args.buffer_mutex = &g_cs_current_buffer;
 		save_args.filename = filename;
 		save_args.wait = wait;
+		save_args.has_movie = Movie::IsRecordingInput() || Movie::IsPlayingInput();
+		save_args.save_movie = save_args.has_movie && !Movie::IsJustStartingRecordingInputFromSaveState();
+		if (save_args.save_movie)
+			Movie::GetReference(save_args.movie);
 
 		Flush();
 		g_save_thread = std::thread(CompressAndDumpState, save_args);
@@ -348,72 +726,166 @@ bool ReadHeader(const std::string filename, StateHeader& header)
 	return true;
 }
 
-void LoadFileStateData(const std::string& filename, std::vector<u8>& ret_data)
+struct StateFile
+{
+	File::MappedFile file;
+	StateHeader header;
+	const u8* body; // after the header and the delta tag
+	size_t body_size;
+	bool delta;
+	double delta_base_time;
+};
+
+// Maps filename and checks that it belongs to the running game
+static bool OpenStateFile(const std::string& filename, StateFile& state)
 {
 	Flush();
-	File::IOFile f(filename, "rb");
-	if (!f)
+	if (!state.file.Open(filename))
 	{
 		Core::DisplayMessage("State not found", 2000);
-		return;
+		return false;
 	}
 
-	StateHeader header;
-	f.ReadArray(&header, 1);
-	
-	if (memcmp(SConfig::GetInstance().m_LocalCoreStartupParameter.GetUniqueID().c_str(), header.gameID, 6)) 
+	const u8* data = state.file.GetData();
+	const size_t size = (size_t)state.file.GetSize();
+	if (size < sizeof(StateHeader))
+	{
+		Core::DisplayMessage("State file is truncated", 2000);
+		return false;
+	}
+	memcpy(&state.header, data, sizeof(StateHeader));
+
+	if (memcmp(SConfig::GetInstance().m_LocalCoreStartupParameter.GetUniqueID().c_str(), state.header.gameID, 6))
 	{
 		Core::DisplayMessage(StringFromFormat("State belongs to a different game (ID %.*s)",
-			6, header.gameID), 2000);
-		return;
+			6, state.header.gameID), 2000);
+		return false;
 	}
 
-	std::vector<u8> buffer;
+	size_t pos = sizeof(StateHeader);
+	u32 magic = 0;
+	if (size >= pos + sizeof(u32))
+		memcpy(&magic, data + pos, sizeof(u32));
 
-	if (0 != header.size)	// non-zero size means the state is compressed
+	state.delta = magic == DELTA_MAGIC && size >= pos + sizeof(u32) + sizeof(double);
+	if (state.delta)
 	{
-		Core::DisplayMessage("Decompressing State...", 500);
+		memcpy(&state.delta_base_time, data + pos + sizeof(u32), sizeof(double));
+		pos += sizeof(u32) + sizeof(double);
+	}
 
-		buffer.resize(header.size);
+	state.body = data + pos;
+	state.body_size = size - pos;
+	return true;
+}
 
-		lzo_uint i = 0;
-		while (true)
-		{
-			lzo_uint32 cur_len = 0;  // number of bytes to read
-			lzo_uint new_len = 0;  // number of bytes to write
+// Legacy [u32 length][LZO data] stream
+static bool ReadChunkStream(const u8* body, size_t body_size, std::vector<u8>& buffer)
+{
+	size_t pos = 0;
+	lzo_uint i = 0;
+	while (pos + sizeof(u32) <= body_size)
+	{
+		lzo_uint32 cur_len = 0;  // number of bytes to read
+		lzo_uint new_len = buffer.size() - i;  // number of bytes to write
 
-			if (!f.ReadArray(&cur_len, 1))
-				break;
+		memcpy(&cur_len, body + pos, sizeof(u32));
+		pos += sizeof(u32);
 
-			f.ReadBytes(out, cur_len);
-			const int res = lzo1x_decompress(out, cur_len, &buffer[i], &new_len, NULL);
-			if (res != LZO_E_OK)
-			{
-				// This doesn't seem to happen anymore.
-				PanicAlertT("Internal LZO Error - decompression failed (%d) (%li, %li) \n"
-					"Try loading the state again", res, i, new_len);
-				return;
-			}
-	
-			i += new_len;
+		if (cur_len == 0)
+			continue;
+
+		int res = LZO_E_INPUT_OVERRUN;
+		if (pos + cur_len <= body_size)
+			res = lzo1x_decompress_safe(body + pos, cur_len, &buffer[i], &new_len, NULL);
+		if (res != LZO_E_OK)
+		{
+			// This doesn't seem to happen anymore.
+			PanicAlertT("Internal LZO Error - decompression failed (%d) (%li, %li) \n"
+				"Try loading the state again", res, i, new_len);
+			return false;
 		}
+
+		pos += cur_len;
+		i += new_len;
+	}
+
+	return true;
+}
+
+static bool ReadStateBody(const StateFile& state, std::vector<u8>& buffer)
+{
+	if (0 != state.header.size)	// non-zero size means the state is compressed
+	{
+		Core::DisplayMessage("Decompressing State...", 500);
+
+		buffer.resize(state.header.size);
+
+		IndexedLoader loader;
+		if (!loader.Parse(state.body, state.body_size, state.header.size))
+			return ReadChunkStream(state.body, state.body_size, buffer);
+
+		loader.Start(&buffer[0]);
+		const bool complete = loader.WaitFor(&buffer[0] + buffer.size()) != NULL;
+		return loader.Finish() && complete;
 	}
 	else	// uncompressed
 	{
-		const size_t size = (size_t)(f.GetSize() - sizeof(StateHeader));
-		buffer.resize(size);
+		buffer.assign(state.body, state.body + state.body_size);
+		return true;
+	}
+}
 
-		if (!f.ReadBytes(&buffer[0], size))
-		{
-			PanicAlert("wtf? reading bytes: %i", (int)size);
+void LoadFileStateData(const std::string& filename, std::vector<u8>& ret_data);
+
+static void ReadStateFile(const std::string& filename, const StateFile& state, std::vector<u8>& ret_data)
+{
+	if (!state.delta)
+	{
+		std::vector<u8> buffer;
+		if (!ReadStateBody(state, buffer))
 			return;
-		}
+
+		// all good
+		ret_data.swap(buffer);
+		return;
+	}
+
+	// Incremental state, rebuild it on top of its base
+	const std::string base_filename = filename + ".base";
+	StateHeader base_header;
+	if (!File::Exists(base_filename) || !ReadHeader(base_filename, base_header) || base_header.time != state.delta_base_time)
+	{
+		Core::DisplayMessage(StringFromFormat("Base state %s is missing or does not match",
+			base_filename.c_str()), 2000);
+		return;
+	}
+
+	std::vector<u8> delta;
+	if (!ReadStateBody(state, delta))
+		return;
+
+	std::vector<u8> buffer;
+	LoadFileStateData(base_filename, buffer);
+	if (buffer.empty())
+		return;
+
+	if (!ApplyDelta(delta, buffer))
+	{
+		Core::DisplayMessage("Incremental state is corrupt", 2000);
+		return;
 	}
 
-	// all good
 	ret_data.swap(buffer);
 }
 
+void LoadFileStateData(const std::string& filename, std::vector<u8>& ret_data)
+{
+	StateFile state;
+	if (OpenStateFile(filename, state))
+		ReadStateFile(filename, state, ret_data);
+}
+
 void LoadAs(const std::string& filename)
 {
 	// Stop the core while we load the state
@@ -437,7 +909,7 @@ void LoadAs(const std::string& filename)
 		std::lock_guard<std::mutex> lk(g_cs_undo_load_buffer);
 		SaveToBuffer(g_undo_load_buffer);
 		if (Movie::IsRecordingInput() || Movie::IsPlayingInput())
-			Movie::SaveRecording("undo.dtm");
+			Movie::SaveReference("undo.dtm");
 		else if (File::Exists("undo.dtm"))
 			File::Delete("undo.dtm");
 	}
@@ -445,18 +917,42 @@ void LoadAs(const std::string& filename)
 	bool loaded = false;
 	bool loadedSuccessfully = false;
 
-	// brackets here are so buffer gets freed ASAP
+	// brackets here are so buffer and the mapping get freed ASAP
 	{
-		std::vector<u8> buffer;
-		LoadFileStateData(filename, buffer);
-
-		if (!buffer.empty())
+		StateFile state;
+		if (OpenStateFile(filename, state))
 		{
-			u8 *ptr = &buffer[0];
-			PointerWrap p(&ptr, PointerWrap::MODE_READ);
-			DoState(p);
-			loaded = true;
-			loadedSuccessfully = (p.GetMode() == PointerWrap::MODE_READ);
+			IndexedLoader loader;
+			if (!state.delta && 0 != state.header.size && loader.Parse(state.body, state.body_size, state.header.size))
+			{
+				// DoState reads each chunk as soon as it is decompressed, so the
+				// big RAM and ARAM copies overlap with decompressing the rest
+				std::unique_ptr<u8[]> buffer(new u8[state.header.size]);
+				loader.Start(buffer.get());
+
+				u8 *ptr = buffer.get();
+				PointerWrap p(&ptr, PointerWrap::MODE_READ);
+				p.SetReadFence(ptr, IndexedLoader::ReadWait, &loader);
+				DoState(p);
+
+				const bool complete = loader.Finish();
+				loaded = true;
+				loadedSuccessfully = complete && (p.GetMode() == PointerWrap::MODE_READ);
+			}
+			else
+			{
+				std::vector<u8> buffer;
+				ReadStateFile(filename, state, buffer);
+
+				if (!buffer.empty())
+				{
+					u8 *ptr = &buffer[0];
+					PointerWrap p(&ptr, PointerWrap::MODE_READ);
+					DoState(p);
+					loaded = true;
+					loadedSuccessfully = (p.GetMode() == PointerWrap::MODE_READ);
+				}
+			}
 		}
 	}
 
@@ -528,6 +1024,8 @@ void Init()
 {
 	if (lzo_init() != LZO_E_OK)
 		PanicAlertT("Internal LZO Error - lzo_init() failed");
+
+	EnableIncremental(SConfig::GetInstance().m_LocalCoreStartupParameter.bIncrementalStates);
 }
 
 void Shutdown()
@@ -545,6 +1043,8 @@ void Shutdown()
 		std::lock_guard<std::mutex> lk(g_cs_undo_load_buffer);
 		std::vector<u8>().swap(g_undo_load_buffer);
 	}
+
+	g_incremental_bases.clear();
 }
 
 static std::string MakeStateFilename(int number)
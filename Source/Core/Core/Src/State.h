@@ -30,6 +30,9 @@ void Shutdown();
 
 void EnableCompression(bool compression);
 
+// Save slots as a delta of changed pages against "<slot>.base"
+void EnableIncremental(bool incremental);
+
 bool ReadHeader(const std::string filename, StateHeader& header);
 
 // These don't happen instantly - they get scheduled as events.
@@ -46,6 +49,10 @@ void LoadAs(const std::string &filename);
 void VerifyAt(const std::string &filename);
 
 void SaveToBuffer(std::vector<u8>& buffer);
+// SaveToBuffer for the CPU thread, from a CoreTiming event. Gives up and
+// returns false instead of waiting when another thread is pausing the core.
+// frame gets the movie frame of the saved state.
+bool TrySaveToBuffer(std::vector<u8>& buffer, u64 *frame);
 void LoadFromBuffer(std::vector<u8>& buffer);
 void VerifyBuffer(std::vector<u8>& buffer);
 
@@ -34,6 +34,9 @@
 #include "Debugger/Debugger_SymbolMap.h"
 #include "PowerPC/PPCAnalyst.h"
 #include "PowerPC/Profiler.h"
+#include "DSP/DSPProfiler.h"
+#include "DSP/LabelMap.h"
+#include "HW/DSPLLE/DSPSymbols.h"
 #include "PowerPC/PPCSymbolDB.h"
 #include "PowerPC/SignatureDB.h"
 #include "PowerPC/PPCTables.h"
@@ -161,6 +164,9 @@ void CCodeWindow::CreateMenuSymbols(wxMenuBar *pMenuBar)
 	pProfilerMenu->Append(IDM_PROFILEBLOCKS, _("&Profile blocks"), wxEmptyString, wxITEM_CHECK);
 	pProfilerMenu->AppendSeparator();
 	pProfilerMenu->Append(IDM_WRITEPROFILE, _("&Write to profile.txt, show"));
+	pProfilerMenu->AppendSeparator();
+	pProfilerMenu->Append(IDM_PROFILEDSPBLOCKS, _("Profile &DSP LLE blocks"), wxEmptyString, wxITEM_CHECK);
+	pProfilerMenu->Append(IDM_WRITEDSPPROFILE, _("Write DSP profile to dsp_profiler.txt"));
 	pMenuBar->Append(pProfilerMenu, _("&Profiler"));
 }
 
@@ -202,6 +208,27 @@ void CCodeWindow::OnProfilerMenu(wxCommandEvent& event)
 			}
 		}
 		break;
+	case IDM_PROFILEDSPBLOCKS:
+		{
+			bool wasUnpaused = Core::PauseAndLock(true);
+			DSPProfiler::SetEnabled(GetMenuBar()->IsChecked(IDM_PROFILEDSPBLOCKS));
+			Core::PauseAndLock(false, wasUnpaused);
+		}
+		break;
+	case IDM_WRITEDSPPROFILE:
+		if (Core::GetState() == Core::CORE_RUN)
+			Core::SetState(Core::CORE_PAUSE);
+
+		if (Core::GetState() == Core::CORE_PAUSE && DSPProfiler::IsEnabled())
+		{
+			std::string filename = File::GetUserPath(D_DUMP_IDX) + "Debug/dsp_profiler.txt";
+			File::CreateFullPath(filename);
+
+			LabelMap labels;
+			DSPSymbols::FillLabelMap(labels);
+			DSPProfiler::WriteReport(filename, &labels);
+		}
+		break;
 	}
 }
 
@@ -227,6 +227,7 @@ EVT_MENU(IDM_UNDOLOADSTATE,     CFrame::OnUndoLoadState)
 EVT_MENU(IDM_UNDOSAVESTATE,     CFrame::OnUndoSaveState)
 EVT_MENU(IDM_LOADSTATEFILE, CFrame::OnLoadStateFromFile)
 EVT_MENU(IDM_SAVESTATEFILE, CFrame::OnSaveStateToFile)
+EVT_MENU(IDM_REWIND,        CFrame::OnRewind)
 
 EVT_MENU_RANGE(IDM_LOADSLOT1, IDM_LOADSLOT10, CFrame::OnLoadState)
 EVT_MENU_RANGE(IDM_LOADLAST1, IDM_LOADLAST8, CFrame::OnLoadLastState)
@@ -814,6 +815,7 @@ int GetCmdForHotkey(unsigned int key)
 	case HK_UNDO_SAVE_STATE: return IDM_UNDOSAVESTATE;
 	case HK_LOAD_STATE_FILE: return IDM_LOADSTATEFILE;
 	case HK_SAVE_STATE_FILE: return IDM_SAVESTATEFILE;
+	case HK_REWIND: return IDM_REWIND;
 	}
 
 	return -1;
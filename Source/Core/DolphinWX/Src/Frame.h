@@ -292,6 +292,7 @@ private:
 	void OnLoadLastState(wxCommandEvent& event);
 	void OnSaveFirstState(wxCommandEvent& event);
 	void OnUndoLoadState(wxCommandEvent& event);
+	void OnRewind(wxCommandEvent& event);
 	void OnUndoSaveState(wxCommandEvent& event);
 
 	void OnFrameSkip(wxCommandEvent& event);
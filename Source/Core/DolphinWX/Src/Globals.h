@@ -30,6 +30,7 @@ enum
 	IDM_UNDOSAVESTATE,
 	IDM_LOADSTATEFILE,
 	IDM_SAVESTATEFILE,
+	IDM_REWIND,
 	IDM_SAVESLOT1,
 	IDM_SAVESLOT2,
 	IDM_SAVESLOT3,
@@ -198,6 +199,8 @@ enum
 	// Profiler
 	IDM_PROFILEBLOCKS,
 	IDM_WRITEPROFILE,
+	IDM_PROFILEDSPBLOCKS,
+	IDM_WRITEDSPPROFILE,
 	// --------------------------------------------------------------
 
 	// --------------------------------------------------------------
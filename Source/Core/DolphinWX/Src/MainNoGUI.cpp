@@ -31,6 +31,8 @@
 #include "ConfigManager.h"
 #include "LogManager.h"
 #include "BootManager.h"
+#include "Movie.h"
+#include "Replay.h"
 
 bool rendererHasFocus = true;
 bool running = true;
@@ -266,14 +268,23 @@ int main(int argc, char* argv[])
 	[NSApp finishLaunching];
 #endif
 	int ch, help = 0;
+	bool replay = false;
+	Replay::Settings replaySettings;
 	struct option longopts[] = {
 		{ "exec",	no_argument,	NULL,	'e' },
 		{ "help",	no_argument,	NULL,	'h' },
 		{ "version",	no_argument,	NULL,	'v' },
+		{ "movie",	required_argument,	NULL,	'm' },
+		{ "replay",	no_argument,	NULL,	'r' },
+		{ "hash-file",	required_argument,	NULL,	'o' },
+		{ "hash-reference",	required_argument,	NULL,	'c' },
+		{ "hash-interval",	required_argument,	NULL,	'i' },
+		{ "hash",	required_argument,	NULL,	'H' },
+		{ "no-render",	no_argument,	NULL,	'n' },
 		{ NULL,		0,		NULL,	0 }
 	};
 
-	while ((ch = getopt_long(argc, argv, "eh?v", longopts, 0)) != -1) {
+	while ((ch = getopt_long(argc, argv, "eh?vm:ro:c:i:H:n", longopts, 0)) != -1) {
 		switch (ch) {
 		case 'e':
 			break;
@@ -284,16 +295,50 @@ int main(int argc, char* argv[])
 		case 'v':
 			fprintf(stderr, "%s\n", scm_rev_str);
 			return 1;
+		case 'm':
+			replaySettings.m_Movie = optarg;
+			break;
+		case 'r':
+			replay = true;
+			break;
+		case 'o':
+			replaySettings.m_HashFile = optarg;
+			break;
+		case 'c':
+			replaySettings.m_ReferenceFile = optarg;
+			break;
+		case 'i':
+			replaySettings.m_Interval = atoi(optarg);
+			break;
+		case 'H':
+			if (!Replay::ParseHashes(optarg, replaySettings.m_Hashes))
+				help = 1;
+			break;
+		case 'n':
+			replaySettings.m_Render = false;
+			break;
 		}
 	}
 
+	if (replay && (replaySettings.m_Movie.empty() || replaySettings.m_Interval == 0))
+		help = 1;
+
 	if (help == 1 || argc == optind) {
 		fprintf(stderr, "%s\n\n", scm_rev_str);
 		fprintf(stderr, "A multi-platform Gamecube/Wii emulator\n\n");
-		fprintf(stderr, "Usage: %s [-e <file>] [-h] [-v]\n", argv[0]);
+		fprintf(stderr, "Usage: %s [-e <file>] [-h] [-v] [-m <movie> [-r]] <file>\n", argv[0]);
 		fprintf(stderr, "  -e, --exec	Load the specified file\n");
 		fprintf(stderr, "  -h, --help	Show this help message\n");
 		fprintf(stderr, "  -v, --help	Print version and exit\n");
+		fprintf(stderr, "  -m, --movie <file>	Play the movie\n");
+		fprintf(stderr, "  -r, --replay	Replay the movie as fast as possible and exit at its end\n");
+		fprintf(stderr, "Replay options:\n");
+		fprintf(stderr, "  -o, --hash-file <file>	Write the hashes to file\n");
+		fprintf(stderr, "  -c, --hash-reference <file>	Compare with the hashes in file,\n"
+			"				stop at the first difference\n");
+		fprintf(stderr, "  -i, --hash-interval <n>	Hash every n VI fields (60)\n");
+		fprintf(stderr, "  -H, --hash <list>	Hashes to take: state,xfb,audio (all)\n");
+		fprintf(stderr, "  -n, --no-render	Don't draw anything\n");
 		return 1;
 	}
 
@@ -304,6 +349,35 @@ int main(int argc, char* argv[])
 		m_LocalCoreStartupParameter.m_strVideoBackend);
 	WiimoteReal::LoadSettings();
 
+	if (replay)
+	{
+		// No event loop, there is nobody to press keys
+		int result = 1;
+		if (Replay::Start(replaySettings))
+		{
+#if defined HAVE_X11 && HAVE_X11
+			XInitThreads();
+#endif
+			if (BootManager::BootCore(argv[optind]))
+			{
+				while (running)
+					Common::SleepCurrentThread(50);
+				BootManager::Stop();
+			}
+			result = Replay::Stop() ? 0 : 2;
+			fprintf(stdout, "%s\n", Replay::GetReport().c_str());
+		}
+
+		WiimoteReal::Shutdown();
+		VideoBackend::ClearList();
+		SConfig::Shutdown();
+		LogManager::Shutdown();
+		return result;
+	}
+
+	if (!replaySettings.m_Movie.empty() && !Movie::PlayInput(replaySettings.m_Movie.c_str()))
+		fprintf(stderr, "Failed to play %s\n", replaySettings.m_Movie.c_str());
+
 	// No use running the loop when booting fails
 	if (BootManager::BootCore(argv[optind]))
 	{
@@ -506,18 +506,43 @@ void CMemcardManager::CopyDeleteClick(wxCommandEvent& event)
 		slot = SLOT_A;
 	case ID_SAVEIMPORT_B:
 	{
-		wxString fileName = wxFileSelector(
+		// Several saves can be imported at once, converting is one at a time
+		wxFileDialog dialog(this,
 			_("Select a save file to import"),
 			(strcmp(DefaultIOPath.c_str(), "/Users/GC") == 0)
 				? StrToWxStr("")
 				: StrToWxStr(DefaultIOPath),
-			wxEmptyString, wxEmptyString,
+			wxEmptyString,
 			_("GameCube Savegame files(*.gci;*.gcs;*.sav)") + wxString(wxT("|*.gci;*.gcs;*.sav|")) +
 			_("Native GCI files(*.gci)") + wxString(wxT("|*.gci|")) +
 			_("MadCatz Gameshark files(*.gcs)") + wxString(wxT("|*.gcs|")) +
 			_("Datel MaxDrive/Pro files(*.sav)") + wxString(wxT("|*.sav")),
-			wxFD_OPEN | wxFD_FILE_MUST_EXIST, this);
-		if (!fileName.empty() && !fileName2.empty())
+			wxFD_OPEN | wxFD_FILE_MUST_EXIST | (fileName2.empty() ? wxFD_MULTIPLE : 0));
+		if (dialog.ShowModal() != wxID_OK)
+			break;
+
+		if (fileName2.empty())
+		{
+			wxArrayString paths;
+			dialog.GetPaths(paths);
+			std::vector<std::string> fileNames;
+			for (size_t i = 0; i < paths.size(); i++)
+				fileNames.push_back(WxStrToStr(paths[i]));
+
+			std::vector<u32> results;
+			u32 ret = memoryCard[slot]->ImportGciBatch(fileNames, results);
+			for (size_t i = 0; i < results.size(); i++)
+			{
+				if (results[i] != SUCCESS)
+					CopyDeleteSwitch(results[i], slot);
+			}
+			if (ret == SUCCESS)
+				CopyDeleteSwitch(SUCCESS, slot);
+			break;
+		}
+
+		wxString fileName = dialog.GetPath();
+		if (!fileName.empty())
 		{
 			wxString temp2 = wxFileSelector(_("Save GCI as..."),
 				wxEmptyString, wxEmptyString, wxT(".gci"),
@@ -577,9 +602,15 @@ void CMemcardManager::CopyDeleteClick(wxCommandEvent& event)
 		File::CreateDir(path1);
 		if(PanicYesNoT("Warning: This will overwrite any existing saves that are in the folder:\n"
 					"%s\nand have the same name as a file on your memcard\nContinue?", path1.c_str()))
-		for (int i = 0; i < DIRLEN; i++)
 		{
-			CopyDeleteSwitch(memoryCard[slot]->ExportGci(i, NULL, path1), -1);
+			std::vector<u8> indices;
+			for (u8 i = 0; i < memoryCard[slot]->GetNumFiles(); i++)
+				indices.push_back(memoryCard[slot]->GetFileIndex(i));
+
+			std::vector<u32> results;
+			memoryCard[slot]->ExportGciBatch(indices, path1, results);
+			for (size_t i = 0; i < results.size(); i++)
+				CopyDeleteSwitch(results[i], -1);
 		}
 		break;
 	}
@@ -354,6 +354,14 @@ NetPlayDiag::NetPlayDiag(wxWindow* const parent, const CGameListCtrl* const game
 		padbuf_spin->Bind(wxEVT_COMMAND_SPINCTRL_UPDATED, &NetPlayDiag::OnAdjustBuffer, this);
 		bottom_szr->Add(padbuf_spin, 0, wxCENTER);
 
+		wxCheckBox* const adaptive_chkbox = new wxCheckBox(panel, wxID_ANY, _("Auto"));
+		adaptive_chkbox->Bind(wxEVT_COMMAND_CHECKBOX_CLICKED, &NetPlayDiag::OnAdaptiveBuffer, this);
+		bottom_szr->Add(adaptive_chkbox, 0, wxCENTER);
+
+		m_udp_pads = new wxCheckBox(panel, wxID_ANY, _("UDP pads"));
+		m_udp_pads->SetValue(true);
+		bottom_szr->Add(m_udp_pads, 0, wxCENTER);
+
 		m_memcard_write = new wxCheckBox(panel, wxID_ANY, _("Write memcards (GC)"));
 		bottom_szr->Add(m_memcard_write, 0, wxCENTER);
 	}
@@ -412,6 +420,9 @@ void NetPlayDiag::GetNetSettings(NetSettings &settings)
 	settings.m_DSPHLE = instance.m_LocalCoreStartupParameter.bDSPHLE;
 	settings.m_DSPEnableJIT = instance.m_EnableJIT;
 	settings.m_WriteToMemcard = m_memcard_write->GetValue();
+	settings.m_UDPPads = m_udp_pads->GetValue();
+	settings.m_DesyncCheckInterval = std::max(instance.m_LocalCoreStartupParameter.iDesyncCheckInterval, 0);
+	settings.m_DesyncCheckRanges = instance.m_LocalCoreStartupParameter.strDesyncCheckRanges;
 	settings.m_EXIDevice[0] = instance.m_EXIDevice[0];
 	settings.m_EXIDevice[1] = instance.m_EXIDevice[1];
 }
@@ -496,6 +507,11 @@ void NetPlayDiag::OnAdjustBuffer(wxCommandEvent& event)
 	m_chat_text->AppendText(StrToWxStr(ss.str()).Append(wxT('\n')));
 }
 
+void NetPlayDiag::OnAdaptiveBuffer(wxCommandEvent& event)
+{
+	netplay_server->SetAdaptiveBuffer(event.IsChecked());
+}
+
 void NetPlayDiag::OnQuit(wxCommandEvent&)
 {
 	Destroy();
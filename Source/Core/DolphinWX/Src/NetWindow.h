@@ -91,6 +91,7 @@ private:
 	void OnThread(wxCommandEvent& event);
 	void OnChangeGame(wxCommandEvent& event);
 	void OnAdjustBuffer(wxCommandEvent& event);
+	void OnAdaptiveBuffer(wxCommandEvent& event);
 	void OnConfigPads(wxCommandEvent& event);
 	void GetNetSettings(NetSettings &settings);
 	std::string FindGame();
@@ -99,6 +100,7 @@ private:
 	wxTextCtrl*		m_chat_text;
 	wxTextCtrl*		m_chat_msg_text;
 	wxCheckBox*		m_memcard_write;
+	wxCheckBox*		m_udp_pads;
 	wxCheckBox*		m_record_chkbox;
 
 	std::string		m_selected_game;
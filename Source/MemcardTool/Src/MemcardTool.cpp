@@ -0,0 +1,298 @@
+// Copyright 2013 Dolphin Emulator Project
+// Licensed under GPLv2
+// Refer to the license.txt file included.
+
+// Lists, checks and edits memory card images without starting the emulator.
+// Imports, exports and removals go through the GCMemcard batch calls, so a
+// card is read once and only the blocks that changed are written back.
+
+#include <cstdio>
+#include <cstdlib>
+
+#include "Common.h"
+#include "FileUtil.h"
+#include "StringUtil.h"
+#include "Host.h"
+#include "HW/GCMemcard.h"
+
+// Stub out the host, nothing here runs the core
+bool Host_RendererHasFocus() { return false; }
+void Host_ConnectWiimote(int wm_idx, bool connect) {}
+bool Host_GetKeyState(int keycode) { return false; }
+void Host_GetRenderWindowSize(int& x, int& y, int& width, int& height) { x = y = width = height = 0; }
+void Host_Message(int Id) {}
+void Host_NotifyMapLoaded() {}
+void Host_RefreshDSPDebuggerWindow() {}
+void Host_RequestRenderWindowSize(int width, int height) {}
+void Host_SetStartupDebuggingParameters() {}
+void Host_SetWiiMoteConnectionState(int _State) {}
+void Host_ShowJitResults(unsigned int address) {}
+void Host_SysMessage(const char *fmt, ...) {}
+void Host_UpdateBreakPointView() {}
+void Host_UpdateDisasmDialog() {}
+void Host_UpdateLogDisplay() {}
+void Host_UpdateMainFrame() {}
+void Host_UpdateStatusBar(const char* _pText, int Filed) {}
+void Host_UpdateTitle(const char* title) {}
+void* Host_GetInstance() { return NULL; }
+void* Host_GetRenderHandle() { return NULL; }
+
+static const char *ResultText(u32 result)
+{
+	switch (result)
+	{
+	case SUCCESS:			return "ok";
+	case NOMEMCARD:			return "not a memory card";
+	case OPENFAIL:			return "could not be opened or has an unknown extension";
+	case OUTOFBLOCKS:		return "not enough free blocks";
+	case OUTOFDIRENTRIES:	return "no free directory entries";
+	case LENGTHFAIL:		return "invalid length";
+	case INVALIDFILESIZE:	return "invalid file size";
+	case TITLEPRESENT:		return "title already on the card";
+	case SAVFAIL:			return "bad .sav header";
+	case GCSFAIL:			return "bad .gcs header";
+	case FAIL:				return "invalid BAT or directory entry";
+	case WRITEFAIL:			return "write failed";
+	case DELETE_FAIL:		return "no such file, or its blocks don't match the BAT";
+	default:				return "unknown error";
+	}
+}
+
+static void PrintUsage()
+{
+	printf("Usage: memcardtool <command> [arguments]\n"
+		"  list <card>...                     list the saves on each card\n"
+		"  check <card>...                    test checksums and count free blocks\n"
+		"  fix <card>...                      fix checksums\n"
+		"  create [--sjis] <card>...          create formatted 16MB cards\n"
+		"  import <card> <save>...            import .gci/.gcs/.sav files\n"
+		"  export <card> <directory> [index]... export saves as .gci, all if no index given\n"
+		"  remove <card> <index>...           remove saves\n"
+		"Indices are the directory indices shown by list.\n");
+}
+
+static GCMemcard *OpenCard(const std::string &filename)
+{
+	// GCMemcard would offer to create it
+	if (!File::Exists(filename))
+	{
+		fprintf(stderr, "%s: no such file\n", filename.c_str());
+		return NULL;
+	}
+
+	GCMemcard *card = new GCMemcard(filename.c_str());
+	if (!card->IsValid())
+	{
+		fprintf(stderr, "%s: %s\n", filename.c_str(), ResultText(NOMEMCARD));
+		delete card;
+		return NULL;
+	}
+	return card;
+}
+
+static bool ParseIndices(char **args, int count, std::vector<u8> &indices)
+{
+	for (int i = 0; i < count; i++)
+	{
+		u32 index;
+		if (!TryParse(args[i], &index) || index >= DIRLEN)
+		{
+			fprintf(stderr, "Invalid index \"%s\"\n", args[i]);
+			return false;
+		}
+		indices.push_back((u8)index);
+	}
+	return true;
+}
+
+static bool SaveCard(GCMemcard &card, const std::string &filename)
+{
+	if (card.FixChecksums() && card.Save())
+		return true;
+	fprintf(stderr, "%s: %s\n", filename.c_str(), ResultText(WRITEFAIL));
+	return false;
+}
+
+static bool List(const std::string &filename)
+{
+	GCMemcard *card = OpenCard(filename);
+	if (!card)
+		return false;
+
+	printf("%s: %u saves, %u free blocks\n", filename.c_str(), card->GetNumFiles(), card->GetFreeBlocks());
+	for (u8 i = 0; i < card->GetNumFiles(); i++)
+	{
+		const u8 index = card->GetFileIndex(i);
+		printf("  %3u  %s%s  %-32s  %4u blocks  %s\n", index,
+			card->DEntry_GameCode(index).c_str(), card->DEntry_Makercode(index).c_str(),
+			card->DEntry_FileName(index).c_str(), card->DEntry_BlockCount(index),
+			card->GetSaveComment1(index).c_str());
+	}
+	delete card;
+	return true;
+}
+
+static bool Check(const std::string &filename, bool fix)
+{
+	GCMemcard *card = OpenCard(filename);
+	if (!card)
+		return false;
+
+	bool ok = true;
+	const u32 errors = card->TestChecksums();
+	if (fix)
+	{
+		ok = !errors || SaveCard(*card, filename);
+		printf("%s: %s\n", filename.c_str(), !errors ? "checksums are fine" : ok ? "checksums fixed" : "not fixed");
+	}
+	else
+	{
+		ok = !errors;
+		printf("%s: %s, %u saves, %u free blocks\n", filename.c_str(),
+			ok ? "checksums are fine" : StringFromFormat("checksum errors 0x%02x", errors).c_str(),
+			card->GetNumFiles(), card->GetFreeBlocks());
+	}
+	delete card;
+	return ok;
+}
+
+static bool Create(const std::string &filename, bool sjis)
+{
+	if (File::Exists(filename))
+	{
+		fprintf(stderr, "%s: already exists\n", filename.c_str());
+		return false;
+	}
+
+	GCMemcard card(filename.c_str(), true, sjis);
+	if (!card.IsValid() || !File::Exists(filename))
+	{
+		fprintf(stderr, "%s: %s\n", filename.c_str(), ResultText(WRITEFAIL));
+		return false;
+	}
+	printf("%s: created\n", filename.c_str());
+	return true;
+}
+
+static bool PrintResults(const std::vector<std::string> &names, const std::vector<u32> &results)
+{
+	bool ok = true;
+	for (size_t i = 0; i < results.size(); i++)
+	{
+		printf("  %s: %s\n", names[i].c_str(), ResultText(results[i]));
+		ok &= results[i] == SUCCESS;
+	}
+	return ok;
+}
+
+static bool Import(const std::string &filename, char **args, int count)
+{
+	GCMemcard *card = OpenCard(filename);
+	if (!card)
+		return false;
+
+	std::vector<std::string> saves(args, args + count);
+	std::vector<u32> results;
+	const u32 ret = card->ImportGciBatch(saves, results);
+	bool ok = PrintResults(saves, results);
+	if (ret == SUCCESS)
+		ok &= SaveCard(*card, filename);
+	delete card;
+	return ok;
+}
+
+static std::vector<std::string> IndexNames(const std::vector<u8> &indices)
+{
+	std::vector<std::string> names;
+	for (size_t i = 0; i < indices.size(); i++)
+		names.push_back(StringFromFormat("%u", indices[i]));
+	return names;
+}
+
+static bool Export(const std::string &filename, const std::string &directory, char **args, int count)
+{
+	std::vector<u8> indices;
+	if (!ParseIndices(args, count, indices))
+		return false;
+
+	GCMemcard *card = OpenCard(filename);
+	if (!card)
+		return false;
+
+	if (indices.empty())
+	{
+		for (u8 i = 0; i < card->GetNumFiles(); i++)
+			indices.push_back(card->GetFileIndex(i));
+	}
+
+	File::CreateFullPath(directory + DIR_SEP);
+	std::vector<u32> results;
+	card->ExportGciBatch(indices, directory, results);
+	const bool ok = PrintResults(IndexNames(indices), results);
+	delete card;
+	return ok;
+}
+
+static bool Remove(const std::string &filename, char **args, int count)
+{
+	std::vector<u8> indices;
+	if (!ParseIndices(args, count, indices))
+		return false;
+
+	GCMemcard *card = OpenCard(filename);
+	if (!card)
+		return false;
+
+	std::vector<u32> results;
+	const u32 ret = card->RemoveFiles(indices, results);
+	bool ok = PrintResults(IndexNames(indices), results);
+	if (ret == SUCCESS)
+		ok &= SaveCard(*card, filename);
+	delete card;
+	return ok;
+}
+
+int main(int argc, char *argv[])
+{
+	if (argc < 3)
+	{
+		PrintUsage();
+		return 1;
+	}
+
+	const std::string command = argv[1];
+	char **args = argv + 2;
+	int count = argc - 2;
+	bool ok = true;
+
+	if (command == "list" || command == "check" || command == "fix")
+	{
+		for (int i = 0; i < count; i++)
+			ok &= command == "list" ? List(args[i]) : Check(args[i], command == "fix");
+	}
+	else if (command == "create")
+	{
+		const bool sjis = !strcmp(args[0], "--sjis");
+		for (int i = sjis ? 1 : 0; i < count; i++)
+			ok &= Create(args[i], sjis);
+	}
+	else if (command == "import" && count >= 2)
+	{
+		ok = Import(args[0], args + 1, count - 1);
+	}
+	else if (command == "export" && count >= 2)
+	{
+		ok = Export(args[0], args[1], args + 2, count - 2);
+	}
+	else if (command == "remove" && count >= 2)
+	{
+		ok = Remove(args[0], args + 1, count - 1);
+	}
+	else
+	{
+		PrintUsage();
+		return 1;
+	}
+
+	return ok ? 0 : 1;
+}
@@ -0,0 +1,211 @@
+// Copyright 2013 Dolphin Emulator Project
+// Licensed under GPLv2
+// Refer to the license.txt file included.
+
+#include <algorithm>
+#include <iostream>
+#include <vector>
+
+#include "Common.h"
+#include "DSP/DSPAccelerator.h"
+
+extern int fail_count;
+
+// Compares AcceleratorDecodeSamples against a straight port of the old one
+// sample at a time accelerator, with the end check (and loop) done before
+// each sample like the AX HLE does.
+
+static std::vector<u8> aram;
+static const s16 coefs[16] = {
+	0x0400, 0x0000, 0x0800, -0x0400, 0x0600, -0x0200, 0x0200, 0x0100,
+	-0x0100, 0x0300, 0x0700, -0x0600, 0x0100, 0x0000, 0x0500, -0x0100,
+};
+
+static u8 ReadTestARAM(u32 address)
+{
+	return aram[address % aram.size()];
+}
+
+static s16 ReferenceGetSample(AcceleratorState &s, u32 loop_addr)
+{
+	if ((s.cur_addr & ~1) == (s.end_addr & ~1))
+		s.cur_addr = loop_addr;
+
+	s16 ret = 0;
+	switch (s.format)
+	{
+	case 0x00:
+	{
+		if ((s.cur_addr & 15) == 0)
+		{
+			s.pred_scale = ReadTestARAM((s.cur_addr & ~15) >> 1);
+			s.cur_addr += 2;
+		}
+
+		int scale = 1 << (s.pred_scale & 0xF);
+		int coef_idx = (s.pred_scale >> 4) & 0x7;
+
+		s32 coef1 = s.coefs[coef_idx * 2 + 0];
+		s32 coef2 = s.coefs[coef_idx * 2 + 1];
+
+		int temp = (s.cur_addr & 1) ?
+				(ReadTestARAM(s.cur_addr >> 1) & 0xF) :
+				(ReadTestARAM(s.cur_addr >> 1) >> 4);
+
+		if (temp >= 8)
+			temp -= 16;
+
+		int val = (scale * temp) + ((0x400 + coef1 * s.yn1 + coef2 * s.yn2) >> 11);
+
+		if (val > 0x7FFF) val = 0x7FFF;
+		else if (val < -0x7FFF) val = -0x7FFF;
+
+		s.yn2 = s.yn1;
+		s.yn1 = val;
+		s.cur_addr += 1;
+		ret = val;
+		break;
+	}
+	case 0x0A:
+		ret = (ReadTestARAM(s.cur_addr * 2) << 8) | ReadTestARAM(s.cur_addr * 2 + 1);
+		s.yn2 = s.yn1;
+		s.yn1 = ret;
+		s.cur_addr += 1;
+		break;
+	case 0x19:
+		ret = ReadTestARAM(s.cur_addr) << 8;
+		s.yn2 = s.yn1;
+		s.yn1 = ret;
+		s.cur_addr += 1;
+		break;
+	}
+	return ret;
+}
+
+static void BlockGetSamples(AcceleratorState &s, u32 loop_addr, s16 *out, u32 count)
+{
+	u32 decoded = 0;
+	while (decoded < count)
+	{
+		if (AcceleratorAtEnd(s.cur_addr, s.end_addr))
+			s.cur_addr = loop_addr;
+		decoded += AcceleratorDecodeSamples(s, out + decoded, count - decoded, ReadTestARAM);
+	}
+}
+
+static void TestFormat(const char *name, u16 format, u32 start, u32 end, u32 loop_addr, u32 block_size)
+{
+	AcceleratorState ref;
+	ref.cur_addr = start;
+	ref.end_addr = end;
+	ref.format = format;
+	ref.pred_scale = 0;
+	ref.yn1 = 0;
+	ref.yn2 = 0;
+	ref.coefs = coefs;
+	AcceleratorState block = ref;
+
+	const u32 total = 3000;
+	std::vector<s16> expected(total), actual(total);
+	for (u32 i = 0; i < total; i++)
+		expected[i] = ReferenceGetSample(ref, loop_addr);
+	for (u32 i = 0; i < total; i += block_size)
+		BlockGetSamples(block, loop_addr, &actual[i], std::min(block_size, total - i));
+
+	for (u32 i = 0; i < total; i++)
+	{
+		if (expected[i] != actual[i])
+		{
+			std::cout << "FAIL (" << name << ", blocks of " << block_size << "): sample " << i
+			          << " is " << actual[i] << ", expected " << expected[i] << std::endl;
+			fail_count++;
+			return;
+		}
+	}
+	if (ref.cur_addr != block.cur_addr || ref.yn1 != block.yn1 ||
+	    ref.yn2 != block.yn2 || ref.pred_scale != block.pred_scale)
+	{
+		std::cout << "FAIL (" << name << ", blocks of " << block_size << "): final state differs" << std::endl;
+		fail_count++;
+	}
+}
+
+// Stands in for the accelerator: numbers the samples it decodes
+struct CountingDecoder
+{
+	u32 *decoded;
+	u32 *largest_call;
+
+	void operator()(s16 *samples, u32 count)
+	{
+		for (u32 i = 0; i < count; i++)
+			samples[i] = (s16)(*decoded)++;
+		*largest_call = std::max(*largest_call, count);
+	}
+};
+
+// The resampler may pull more or fewer samples than expected
+static void TestSampleReader(u32 expected, u32 pulled)
+{
+	s16 buffer[8 + 4];
+	for (u32 i = 8; i < ArraySize(buffer); i++)
+		buffer[i] = 0x5A5A;
+
+	u32 decoded = 0, largest_call = 0;
+	CountingDecoder decoder = { &decoded, &largest_call };
+	AcceleratorSampleReader<CountingDecoder> reader(buffer, 8, expected, decoder);
+
+	for (u32 i = 0; i < pulled; i++)
+	{
+		if (reader.Next() != (s16)i)
+		{
+			std::cout << "FAIL (sample reader, " << expected << " expected, " << pulled << " pulled): sample " << i << " out of order" << std::endl;
+			fail_count++;
+			return;
+		}
+	}
+
+	// Up to the expected count, then exactly what was pulled
+	const u32 max_decoded = std::max(expected, pulled);
+	if (largest_call > 8 || decoded > max_decoded || (pulled > expected && decoded != pulled))
+	{
+		std::cout << "FAIL (sample reader, " << expected << " expected, " << pulled << " pulled): decoded " << decoded << std::endl;
+		fail_count++;
+	}
+	for (u32 i = 8; i < ArraySize(buffer); i++)
+	{
+		if (buffer[i] != 0x5A5A)
+		{
+			std::cout << "FAIL (sample reader, " << expected << " expected, " << pulled << " pulled): wrote past the buffer" << std::endl;
+			fail_count++;
+			break;
+		}
+	}
+}
+
+void AcceleratorTests()
+{
+	TestSampleReader(20, 20);
+	TestSampleReader(20, 13);
+	TestSampleReader(5, 40);
+	TestSampleReader(0, 3);
+	TestSampleReader(16, 17);
+
+	aram.resize(0x800);
+	u32 seed = 0x12345678;
+	for (u32 i = 0; i < aram.size(); i++)
+	{
+		seed = seed * 1103515245 + 12345;
+		aram[i] = seed >> 16;
+	}
+
+	const u32 block_sizes[] = { 1, 7, 14, 32, 96, 3000 };
+	for (u32 i = 0; i < ArraySize(block_sizes); i++)
+	{
+		// Loops that end on odd and even addresses, mid frame for ADPCM.
+		TestFormat("ADPCM", ACCELERATOR_FORMAT_ADPCM, 0x002, 0x1f5, 0x042, block_sizes[i]);
+		TestFormat("ADPCM", ACCELERATOR_FORMAT_ADPCM, 0x102, 0x130, 0x112, block_sizes[i]);
+		TestFormat("PCM16", ACCELERATOR_FORMAT_PCM16, 0x010, 0x2a1, 0x020, block_sizes[i]);
+		TestFormat("PCM8", ACCELERATOR_FORMAT_PCM8, 0x000, 0x333, 0x100, block_sizes[i]);
+	}
+}
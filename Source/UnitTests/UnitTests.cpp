@@ -18,12 +18,16 @@
 #include <cmath>
 #include <iostream>
 
+#include "ChunkFile.h"
 #include "StringUtil.h"
 #include "MathUtil.h"
+#include "Timer.h"
 #include "PowerPC/PowerPC.h"
+#include "HW/Memmap.h"
 #include "HW/SI_DeviceGCController.h"
 
 void AudioJitTests();
+void AcceleratorTests();
 
 using namespace std;
 int fail_count = 0;
@@ -49,8 +53,91 @@ int fail_count = 0;
 		fail_count++; \
 	}
 
+// Hashed page table at 8MB mapping effective 0x7E000000+ onto physical 1MB+
+static const u32 TLB_TEST_HTAB = 0x00800000;
+static const u32 TLB_TEST_VSID = 0x123;
+static const u32 TLB_TEST_PAGES = 1024;
+
+static u32 TLBTestEA(u32 page) { return 0x7E000000 + page * 4096; }
+static u32 TLBTestPA(u32 page) { return 0x00100000 + page * 4096; }
+
+static void MapTestPage(u32 page, u32 pa)
+{
+	const u32 ea = TLBTestEA(page);
+	const u32 hash = (TLB_TEST_VSID ^ ((ea >> 12) & 0xffff)) & PowerPC::ppcState.pagetable_hashmask;
+	u8* pteg = Memory::GetPointer(PowerPC::ppcState.pagetable_base | (hash << 6));
+
+	for (int i = 0; i < 8; i++)
+	{
+		const u32 pte1 = (1u << 31) | (TLB_TEST_VSID << 7) | ((ea >> 22) & 0x3f);
+		const u32 old = Common::swap32(*(u32*)&pteg[i * 8]);
+		if (old == 0 || old == pte1)
+		{
+			*(u32*)&pteg[i * 8] = Common::swap32(pte1);
+			*(u32*)&pteg[i * 8 + 4] = Common::swap32(pa & 0xfffff000);
+			return;
+		}
+	}
+}
+
 void CoreTests()
 {
+	Memory::Init();
+	PowerPC::ppcState.spr[SPR_SDR] = TLB_TEST_HTAB;
+	Memory::SDRUpdated();
+	PowerPC::ppcState.sr[7] = TLB_TEST_VSID;
+	for (u32 page = 0; page < TLB_TEST_PAGES; page++)
+		MapTestPage(page, TLBTestPA(page));
+
+	EXPECT_EQ((TLBTestPA(5) | 0x123), Memory::TranslateAddress(TLBTestEA(5) | 0x123, Memory::FLAG_READ));
+	EXPECT_EQ(TLBTestPA(700), Memory::TranslateAddress(TLBTestEA(700), Memory::FLAG_WRITE));
+
+	// Changing the PTE isn't seen until tlbie
+	MapTestPage(5, TLBTestPA(6));
+	EXPECT_EQ(TLBTestPA(5), Memory::TranslateAddress(TLBTestEA(5), Memory::FLAG_READ));
+	Memory::InvalidateTLBEntry(TLBTestEA(5));
+	EXPECT_EQ(TLBTestPA(6), Memory::TranslateAddress(TLBTestEA(5), Memory::FLAG_READ));
+	MapTestPage(5, TLBTestPA(5));
+	Memory::InvalidateTLB();
+
+	// 256MB DBAT at 0x80000000 onto physical 0, next to the paged mappings
+	PowerPC::ppcState.spr[SPR_DBAT0U] = 0x80001ffe;
+	PowerPC::ppcState.spr[SPR_DBAT0L] = 0x00000002;
+	Memory::InvalidateTLB();
+	EXPECT_EQ(0x00001234u, Memory::TranslateAddress(0x80001234, Memory::FLAG_READ));
+	EXPECT_EQ(TLBTestPA(5), Memory::TranslateAddress(TLBTestEA(5), Memory::FLAG_READ));
+	EXPECT_EQ(0u, Memory::TranslateAddress(0x7D000000, Memory::FLAG_READ));
+	PowerPC::ppcState.spr[SPR_DBAT0U] = 0;
+	PowerPC::ppcState.spr[SPR_DBAT0L] = 0;
+	Memory::InvalidateTLB();
+
+	Memory::Shutdown();
+}
+
+// Only run with --bench, timings don't belong in the pass/fail run
+void TLBBenchmark()
+{
+	Memory::Init();
+	PowerPC::ppcState.spr[SPR_SDR] = TLB_TEST_HTAB;
+	Memory::SDRUpdated();
+	PowerPC::ppcState.sr[7] = TLB_TEST_VSID;
+	for (u32 page = 0; page < TLB_TEST_PAGES; page++)
+		MapTestPage(page, TLBTestPA(page));
+	Memory::InvalidateTLB();
+
+	// A working set that fits in the TLB, then one that doesn't
+	const u32 working_sets[] = { 64, TLB_TEST_PAGES };
+	for (int w = 0; w < 2; w++)
+	{
+		u32 sum = 0;
+		const u64 start = Common::Timer::GetTimeUs();
+		for (u32 i = 0; i < 4000000; i++)
+			sum += Memory::TranslateAddress(TLBTestEA((i * 7) % working_sets[w]), Memory::FLAG_READ);
+		const u64 elapsed = Common::Timer::GetTimeUs() - start;
+		printf("TLB: %u pages, %.1f ns per translation (%08x)\n", working_sets[w], elapsed * 1000.0 / 4000000, sum);
+	}
+
+	Memory::Shutdown();
 }
 
 void MathTests()
@@ -129,14 +216,112 @@ void StringTests()
 	EXPECT_EQ(".jpg", ext);
 }
 
+struct ChunkTestState
+{
+	u32 value;
+	u16 pod_array[3000];
+	std::vector<std::string> strings;
+	std::pair<u8, u32> pair_array[4];
+
+	void DoState(PointerWrap& p)
+	{
+		p.Do(value);
+		p.DoArray(pod_array, 3000);
+		p.Do(strings);
+		p.DoArray(pair_array, 4);
+		p.DoMarker("ChunkTestState");
+	}
+};
+
+struct FenceTestData
+{
+	u8* end;
+	int waits;
+};
+
+static u8* FenceTestWait(void* userdata, u8* needed)
+{
+	FenceTestData* fence = (FenceTestData*)userdata;
+	fence->waits++;
+	if (needed > fence->end)
+		return NULL;
+	return std::min(fence->end, needed + 1000);
+}
+
+void ChunkFileTests()
+{
+	ChunkTestState a;
+	a.value = 0xDEADBEEF;
+	for (int i = 0; i < 3000; i++)
+		a.pod_array[i] = (u16)(i * 7);
+	a.strings.push_back("abc");
+	a.strings.push_back(std::string(5000, 'x'));
+	for (int i = 0; i < 4; i++)
+		a.pair_array[i] = std::make_pair((u8)i, (u32)(i * 1000));
+
+	// Two pass reference
+	u8* ptr = NULL;
+	PointerWrap measure(&ptr, PointerWrap::MODE_MEASURE);
+	a.DoState(measure);
+	std::vector<u8> reference((size_t)ptr);
+	ptr = &reference[0];
+	PointerWrap write(&ptr, PointerWrap::MODE_WRITE);
+	a.DoState(write);
+
+	// Single pass, starting from a buffer too small so the arena has to grow
+	std::vector<u8> arena(16);
+	arena.shrink_to_fit();
+	PointerWrap single(arena);
+	a.DoState(single);
+	EXPECT_EQ(reference.size(), single.FinishArena());
+	EXPECT_TRUE((reference == arena));
+
+	ChunkTestState b;
+	ptr = &arena[0];
+	PointerWrap read(&ptr, PointerWrap::MODE_READ);
+	b.DoState(read);
+	EXPECT_EQ(PointerWrap::MODE_READ, read.GetMode());
+	EXPECT_EQ(a.value, b.value);
+	EXPECT_EQ(0, memcmp(a.pod_array, b.pod_array, sizeof(a.pod_array)));
+	EXPECT_TRUE((a.strings == b.strings));
+	EXPECT_EQ(a.pair_array[3].second, b.pair_array[3].second);
+
+	// Reading behind a fence that only moves forward 1000 bytes at a time
+	ChunkTestState c;
+	FenceTestData fence = { &arena[0] + arena.size(), 0 };
+	ptr = &arena[0];
+	PointerWrap fenced(&ptr, PointerWrap::MODE_READ);
+	fenced.SetReadFence(&arena[0], FenceTestWait, &fence);
+	c.DoState(fenced);
+	EXPECT_EQ(PointerWrap::MODE_READ, fenced.GetMode());
+	EXPECT_TRUE((fence.waits > 1));
+	EXPECT_TRUE((a.strings == c.strings));
+
+	// A fence that never reaches the end aborts the read
+	ChunkTestState d;
+	fence.end = &arena[0] + arena.size() / 2;
+	ptr = &arena[0];
+	PointerWrap cut(&ptr, PointerWrap::MODE_READ);
+	cut.SetReadFence(&arena[0], FenceTestWait, &fence);
+	d.DoState(cut);
+	EXPECT_EQ(PointerWrap::MODE_MEASURE, cut.GetMode());
+}
 
 int main(int argc, char* argv[])
 {
+	if (argc > 1 && !strcmp(argv[1], "--bench"))
+	{
+		TLBBenchmark();
+		return 0;
+	}
+
 	AudioJitTests();
+	AcceleratorTests();
 
 	CoreTests();
 	MathTests();
 	StringTests();
+	ChunkFileTests();
 	if (fail_count == 0)
 	{
 		printf("All tests passed.\n");